@@ -10,6 +10,7 @@
 #include "net_io.h"
 #include "notifications.h"
 #include "osm2go_annotations.h"
+#include <osm2go_log.h>
 #include "settings.h"
 
 #include <algorithm>
@@ -127,15 +128,15 @@ bool api_limits::parseXml(const xmlDocGuard &xml)
                   } else if(strcasecmp(reinterpret_cast<const char *>(policy_node->name), "timeout") == 0) {
                     m_apiTimeout = xml_get_prop_uint(policy_node, "seconds");
                   } else
-                    printf("DEBUG: found unhandled osm/api/%s\n", policy_node->name);
+                    OSM2GO_LOG(Net, Debug, "found unhandled osm/api/%s", policy_node->name);
                 }
               }
             } else
-              printf("DEBUG: found unhandled osm/%s\n", sub_node->name);
+              OSM2GO_LOG(Net, Debug, "found unhandled osm/%s", sub_node->name);
           }
         }
       } else
-        printf("DEBUG: found unhandled %s\n", cur_node->name);
+        OSM2GO_LOG(Net, Debug, "found unhandled %s", cur_node->name);
     }
   }
 
@@ -162,7 +163,7 @@ bool api_limits::queryXml(const char *url)
 
     return false;
   } else {
-    printf("ok, parse doc tree\n");
+    OSM2GO_LOG(Net, Debug, "ok, parse doc tree");
 
     return api_limits::parseXml(doc);
   }
@@ -0,0 +1,267 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Rolf Eike Beer <eike@sf-mail.de>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "cache_set.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include "osm2go_annotations.h"
+#include <osm2go_log.h>
+
+namespace {
+
+const size_t chunk_size = 64 * 1024 - 64; ///< leave some room for the malloc overhead
+const size_t initial_table_size = 1024;
+const uint32_t dead_generation = UINT32_MAX; ///< marker for released entries
+
+inline size_t entry_size(size_t len)
+{
+  // header, string, terminating 0, aligned for the next header
+  const size_t align = sizeof(uint32_t);
+  return (3 * sizeof(uint32_t) + len + 1 + align - 1) & ~(align - 1);
+}
+
+} // namespace
+
+cache_set::cache_set()
+  : table(initial_table_size, nullptr)
+  , entries(0)
+  , next_generation(1)
+{
+}
+
+cache_set::~cache_set()
+{
+  for(std::map<unsigned int, chunk *>::const_iterator it = chunks.begin(); it != chunks.end(); it++) {
+    chunk *c = it->second;
+    while(c != nullptr) {
+      chunk *next = c->next;
+      free(c);
+      c = next;
+    }
+  }
+}
+
+// FNV-1a
+uint32_t cache_set::hash(const char *str, size_t len) noexcept
+{
+  uint32_t ret = 2166136261u;
+  for(size_t i = 0; i < len; i++) {
+    ret ^= static_cast<unsigned char>(str[i]);
+    ret *= 16777619u;
+  }
+  return ret;
+}
+
+const char *cache_set::find(const char *value, size_t len, uint32_t h, size_t &slot) const
+{
+  const size_t mask = table.size() - 1;
+  for(slot = h & mask; table[slot] != nullptr; slot = (slot + 1) & mask) {
+    const char *str = table[slot];
+    const entry_header *hdr = header(str);
+    if(hdr->hash == h && hdr->length == len && memcmp(str, value, len) == 0)
+      return str;
+  }
+  return nullptr;
+}
+
+const char *cache_set::add(const char *value, size_t len, uint32_t h, size_t slot)
+{
+  const size_t need = entry_size(len);
+  const unsigned int generation = currentGeneration();
+  chunk *&head = chunks[generation];
+  chunk *c = head;
+  if(unlikely(c == nullptr || c->size - c->used < need)) {
+    const size_t sz = std::max(need, chunk_size);
+    c = static_cast<chunk *>(malloc(sizeof(chunk) + sz));
+    if(unlikely(c == nullptr))
+      throw std::bad_alloc();
+    c->size = sz;
+    c->used = 0;
+    // a large string gets a block of its own, keep using the current one for everything else
+    if(head != nullptr && need > chunk_size / 4) {
+      c->next = head->next;
+      head->next = c;
+    } else {
+      c->next = head;
+      head = c;
+    }
+  }
+
+  entry_header *hdr = reinterpret_cast<entry_header *>(reinterpret_cast<char *>(c + 1) + c->used);
+  c->used += need;
+  hdr->hash = h;
+  hdr->length = static_cast<uint32_t>(len);
+  hdr->generation = generation;
+  char *str = reinterpret_cast<char *>(hdr + 1);
+  memcpy(str, value, len);
+  str[len] = '\0';
+
+  table[slot] = str;
+  entries++;
+
+  return str;
+}
+
+void cache_set::rebuild()
+{
+  std::fill(table.begin(), table.end(), nullptr);
+  const size_t mask = table.size() - 1;
+
+  for(std::map<unsigned int, chunk *>::const_iterator it = chunks.begin(); it != chunks.end(); it++) {
+    for(const chunk *c = it->second; c != nullptr; c = c->next) {
+      const char *data = reinterpret_cast<const char *>(c + 1);
+      for(size_t pos = 0; pos < c->used; ) {
+        const entry_header *hdr = reinterpret_cast<const entry_header *>(data + pos);
+        pos += entry_size(hdr->length);
+        if(hdr->generation == dead_generation)
+          continue;
+
+        size_t slot = hdr->hash & mask;
+        while(table[slot] != nullptr)
+          slot = (slot + 1) & mask;
+        table[slot] = reinterpret_cast<const char *>(hdr + 1);
+      }
+    }
+  }
+}
+
+void cache_set::grow()
+{
+  table.assign(table.size() * 2, nullptr);
+  rebuild();
+}
+
+const char *cache_set::insert(const char *value, size_t len)
+{
+  if(unlikely(value == nullptr))
+    return nullptr;
+
+  const uint32_t h = hash(value, len);
+  std::lock_guard<std::mutex> lock(mutex);
+  size_t slot;
+  const char *ret = find(value, len, h, slot);
+  if(likely(ret != nullptr)) {
+    // used by someone else, keep it forever
+    entry_header *hdr = header(ret);
+    if(hdr->generation != currentGeneration())
+      hdr->generation = 0;
+    return ret;
+  }
+
+  // keep the table at most half full
+  if(unlikely((entries + 1) * 2 > table.size())) {
+    grow();
+    find(value, len, h, slot);
+  }
+
+  return add(value, len, h, slot);
+}
+
+const char *cache_set::getValue(const char *value, size_t len) const
+{
+  const uint32_t h = hash(value, len);
+  std::lock_guard<std::mutex> lock(mutex);
+  size_t slot;
+  return find(value, len, h, slot);
+}
+
+unsigned int cache_set::currentGeneration() const
+{
+  const std::map<std::thread::id, unsigned int>::const_iterator it = generations.find(std::this_thread::get_id());
+  return it == generations.end() ? 0 : it->second;
+}
+
+unsigned int cache_set::setGeneration(unsigned int generation)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  const std::thread::id self = std::this_thread::get_id();
+  const unsigned int previous = currentGeneration();
+  if(generation == 0)
+    generations.erase(self);
+  else
+    generations[self] = generation;
+  return previous;
+}
+
+unsigned int cache_set::newGeneration()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  assert(next_generation != dead_generation);
+  return next_generation++;
+}
+
+void cache_set::releaseGeneration(unsigned int generation)
+{
+  assert(generation != 0);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  assert(generation != currentGeneration());
+
+  const std::map<unsigned int, chunk *>::iterator it = chunks.find(generation);
+  if(it == chunks.end())
+    return;
+
+  chunk *c = it->second;
+  chunks.erase(it);
+
+  size_t released = 0;
+  while(c != nullptr) {
+    chunk *next = c->next;
+    bool keep = false;
+    char *data = reinterpret_cast<char *>(c + 1);
+    for(size_t pos = 0; pos < c->used; ) {
+      entry_header *hdr = reinterpret_cast<entry_header *>(data + pos);
+      pos += entry_size(hdr->length);
+      if(hdr->generation == generation) {
+        hdr->generation = dead_generation;
+        released++;
+      } else if(hdr->generation != dead_generation) {
+        keep = true;
+      }
+    }
+
+    if(keep) {
+      // contains strings that became permanent
+      chunk *&perm = chunks[0];
+      if(perm == nullptr) {
+        c->next = nullptr;
+        perm = c;
+      } else {
+        c->next = perm->next;
+        perm->next = c;
+      }
+    } else {
+      free(c);
+    }
+    c = next;
+  }
+
+  OSM2GO_LOG(Osm, Debug, "released %zu of %zu cached strings", released, entries);
+  entries -= released;
+  if(released > 0)
+    rebuild();
+}
+
+size_t cache_set::size() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return entries;
+}
+
+size_t cache_set::memory_size() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  size_t ret = table.capacity() * sizeof(table.front());
+  for(std::map<unsigned int, chunk *>::const_iterator it = chunks.begin(); it != chunks.end(); it++)
+    for(const chunk *c = it->second; c != nullptr; c = c->next)
+      ret += sizeof(*c) + c->size;
+  return ret;
+}
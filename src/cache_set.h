@@ -6,89 +6,91 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
-#include <unordered_set>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include <osm2go_annotations.h>
 #include <osm2go_cpp.h>
 
 /**
- * @brief a cache wrapping an unordered_set for caching strings
+ * @brief a cache for strings that returns the same pointer for equal strings
  *
- * The main purpose is to avoid the allocation of a temporary std::string
- * instance for lookups, otherwise std::unordered_set<std::string> could be
- * used.
+ * The strings are stored in larger memory blocks (the arena), preceded by
+ * their hash and length. Lookups can be done with a given length, so the
+ * string needs neither be terminated nor measured again. Returned strings are
+ * always 0-terminated, so they can be used as plain C strings.
+ *
+ * As long as a string is cached it is always returned at the same address, so
+ * cached strings can be compared by pointer.
+ *
+ * Strings can be assigned to a generation, which can be released as a whole
+ * once the data using them is gone (see newGeneration()).
+ *
+ * All members may be called from different threads at the same time, e.g.
+ * while a project is parsed in the background. The active generation is
+ * tracked per thread.
  */
 class cache_set {
-  struct values_equal {
-    bool operator()(const char *a, const char *b) const noexcept
-    {
-      return a == b || strcmp(a, b) == 0;
-    }
+  struct entry_header {
+    uint32_t hash;
+    uint32_t length;
+    uint32_t generation;
   };
 
-  /**
-   * @brief build a hash about a character sequence
-   *
-   * One can't simply use std::hash, as that hashes the pointer, not the
-   * contents behind it. All implementations have an internal helper that takes
-   * a buffer and a length (used e.g. for std::hash<std::string>), but the name
-   * of this differs between implementations.
-   */
-  struct str_hash {
-    size_t operator()(const char *s) const noexcept
-    {
-      const size_t l = strlen(s);
-      size_t ret = 0;
-      if (l <= sizeof(size_t)) {
-        memcpy(&ret, s, l);
-      } else {
-        // use both start and end of the string in the hash to avoid too many hash
-        // collisions when values have a common prefix
-        memcpy(&ret, s, sizeof(size_t) / 2);
-        memcpy(reinterpret_cast<void *>(reinterpret_cast<uintptr_t>(&ret) + 2),
-               s + l - sizeof(size_t) / 2, sizeof(size_t) / 2);
-        ret ^= l;
-      }
-      return ret;
-    }
+  struct chunk {
+    chunk *next;
+    size_t size; ///< usable bytes after the header
+    size_t used;
   };
 
-  typedef std::unordered_set<const char *, str_hash, values_equal> content_type;
-  content_type contents;
+  std::vector<const char *> table; ///< open addressing table, size is a power of 2
+  size_t entries;
+  /// the chunks of every generation, the permanent ones have generation 0
+  std::map<unsigned int, chunk *> chunks;
+  /// the active generation of every thread that has one
+  std::map<std::thread::id, unsigned int> generations;
+  unsigned int next_generation;
+  mutable std::mutex mutex; ///< protects all of the above
 
-  static inline void value_free(const char *m)
-  {
-    free(const_cast<char *>(m));
-  }
+  static inline entry_header *header(const char *str)
+  { return reinterpret_cast<entry_header *>(const_cast<char *>(str)) - 1; }
 
-  /**
-   * @brief do the actual insertion
-   * @param value a valid element (i.e. not empty)
-   */
-  const char *inner_insert(const char *value)
-  {
-    content_type::const_iterator it = contents.find(value);
-    if (unlikely(it == contents.end()))
-      it = contents.insert(strdup(value)).first;
+  static uint32_t hash(const char *str, size_t len) noexcept;
 
-    return *it;
-  }
+  const char *find(const char *value, size_t len, uint32_t h, size_t &slot) const;
+  const char *add(const char *value, size_t len, uint32_t h, size_t slot);
+  void grow();
+  void rebuild();
+
+  /// the active generation of the calling thread, the mutex must be held
+  unsigned int currentGeneration() const;
+  /// set the active generation of the calling thread, returns the previous one
+  unsigned int setGeneration(unsigned int generation);
 
 public:
-  ~cache_set()
-  {
-    // free the values behind the keys
-    std::for_each(contents.begin(), contents.end(), value_free);
-  }
+  cache_set();
+  ~cache_set();
+
+  /**
+   * @brief get the cached copy of the given string, adding it if needed
+   * @param value the string to look up
+   * @param len the length of value
+   * @returns the cached string or nullptr if value is nullptr
+   */
+  const char *insert(const char *value, size_t len);
 
-  const char *insert(const char *value)
+  inline const char *insert(const char *value)
   {
     if (unlikely(value == nullptr))
       return nullptr;
 
-    return inner_insert(value);
+    return insert(value, strlen(value));
   }
 
   inline const char *insert(const std::string &value)
@@ -96,15 +98,67 @@ public:
     if (unlikely(value.empty()))
       return nullptr;
 
-    return inner_insert(value.c_str());
+    return insert(value.c_str(), value.size());
   }
 
-  const char *getValue(const char *value) const
-  {
-    const content_type::const_iterator it = contents.find(value);
-    if (unlikely(it == contents.end()))
-      return nullptr;
+  /**
+   * @brief get the cached copy of the given string without adding it
+   * @returns the cached string or nullptr if it is not cached
+   *
+   * The result must only be used temporarily, e.g. for comparisons, it may
+   * be released together with its generation.
+   */
+  const char *getValue(const char *value, size_t len) const;
 
-    return *it;
-  }
+  inline const char *getValue(const char *value) const
+  { return getValue(value, strlen(value)); }
+
+  /**
+   * @brief get the length of a string returned by this cache
+   */
+  static inline size_t length(const char *cached)
+  { return header(cached)->length; }
+
+  /**
+   * @brief create a new generation
+   *
+   * Strings first inserted while the generation is active (see
+   * generation_scope) belong to it. If such a string is returned again while
+   * a different or no generation is active it becomes permanent. All strings
+   * still belonging to the generation are released by releaseGeneration().
+   */
+  unsigned int newGeneration();
+
+  /**
+   * @brief release all strings that only belong to the given generation
+   *
+   * Afterwards the released strings must not be used anymore.
+   */
+  void releaseGeneration(unsigned int generation);
+
+  /**
+   * @brief the number of cached strings
+   */
+  size_t size() const;
+
+  /**
+   * @brief the memory allocated for the cached strings
+   */
+  size_t memory_size() const;
+
+  /**
+   * @brief makes a generation the active one of the calling thread for the
+   *        lifetime of this object
+   */
+  class generation_scope {
+    cache_set &cache;
+    const unsigned int previous;
+    generation_scope(const generation_scope &) O2G_DELETED_FUNCTION;
+    generation_scope &operator=(const generation_scope &) O2G_DELETED_FUNCTION;
+  public:
+    inline generation_scope(cache_set &c, unsigned int generation)
+      : cache(c), previous(c.setGeneration(generation)) {}
+    inline ~generation_scope()
+    { cache.setGeneration(previous); }
+  };
 };
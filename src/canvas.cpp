@@ -12,6 +12,7 @@
 #include "canvas_p.h"
 
 #include "map.h"
+#include "memory_usage.h"
 
 #include <algorithm>
 #include <cassert>
@@ -40,6 +41,17 @@ std::optional<unsigned int> canvas_t::get_item_segment(const canvas_item_t *item
   return poly->get_segment(pos.x, pos.y, fuzziness);
 }
 
+std::optional<unsigned int> canvas_t::get_item_marker(const canvas_item_t *item, lpos_t pos) const
+{
+  const item_mapping_t::const_iterator it = item_mapping.find(item);
+  assert(it != item_mapping.end());
+  assert(it->second->type == CANVAS_ITEM_MARKERS);
+
+  const canvas_item_info_markers *markers = static_cast<const canvas_item_info_markers *>(it->second);
+
+  return markers->get_marker(pos.x, pos.y, EXTRA_FUZZINESS_METER + EXTRA_FUZZINESS_PIXEL / static_cast<float>(get_zoom()));
+}
+
 namespace {
 
 /* remove item_info from chain as its visual representation */
@@ -89,6 +101,77 @@ canvas_item_info_poly::canvas_item_info_poly(canvas_t* cv, canvas_item_t* it,
   memcpy(points.get(), p.data(), p.size() * sizeof(points[0]));
 }
 
+canvas_item_info_markers::canvas_item_info_markers(canvas_t *cv, canvas_item_t *it,
+                                                   const std::vector<lpos_t> &c, unsigned int r)
+  : canvas_item_info_t(CANVAS_ITEM_MARKERS, cv, it, new item_info_destroyer<canvas_item_info_markers>(this, cv))
+  , radius(r)
+  , num_points(c.size())
+  , centers(new lpos_t[c.size()])
+{
+  memcpy(centers.get(), c.data(), c.size() * sizeof(centers[0]));
+}
+
+std::optional<unsigned int> canvas_item_info_markers::get_marker(int x, int y, float fuzziness) const
+{
+  std::optional<unsigned int> ret;
+  const float limit = radius + fuzziness;
+  float mindist = limit * limit;
+
+  for(unsigned int i = 0; i < num_points; i++) {
+    const float dx = centers[i].x - x;
+    const float dy = centers[i].y - y;
+    const float dist = dx * dx + dy * dy;
+    if(dist < mindist) {
+      mindist = dist;
+      ret = i;
+    }
+  }
+
+  return ret;
+}
+
+void canvas_item_info_poly::set_points(const std::vector<lpos_t> &p)
+{
+  if(p.size() != num_points) {
+    points.reset(new lpos_t[p.size()]);
+    num_points = p.size();
+  }
+  memcpy(points.get(), p.data(), p.size() * sizeof(points[0]));
+}
+
+void canvas_t::circle_update(canvas_item_circle *item, lpos_t c, float radius, int border,
+                             color_t fill_col, color_t border_col)
+{
+  item->set_center(c);
+  item->set_radius(radius);
+  item->set_style(border, border_col, fill_col);
+
+  const item_mapping_t::iterator it = item_mapping.find(item);
+  if(it == item_mapping.end())
+    return;
+
+  assert(it->second->type == CANVAS_ITEM_CIRCLE);
+  canvas_item_info_circle *info = static_cast<canvas_item_info_circle *>(it->second);
+  info->center = c;
+  info->radius = static_cast<unsigned int>(radius) + border;
+}
+
+void canvas_t::poly_update(canvas_item_t *item, const std::vector<lpos_t> &points, float width,
+                           color_t color, color_t fill)
+{
+  static_cast<canvas_item_polyline *>(item)->set_points(points);
+  item->set_style(width, color, fill);
+
+  const item_mapping_t::iterator it = item_mapping.find(item);
+  if(it == item_mapping.end())
+    return;
+
+  assert(it->second->type == CANVAS_ITEM_POLY);
+  canvas_item_info_poly *info = static_cast<canvas_item_info_poly *>(it->second);
+  info->width = width;
+  info->set_points(points);
+}
+
 std::optional<unsigned int> canvas_item_info_poly::get_segment(int x, int y, float fuzziness) const
 {
   unsigned int retval;
@@ -135,6 +218,26 @@ std::optional<unsigned int> canvas_item_info_poly::get_segment(int x, int y, flo
     return std::optional<unsigned int>();
 }
 
+size_t canvas_t::memory_size() const
+{
+  size_t ret = memory_usage::heap(item_mapping);
+  const item_mapping_t::const_iterator itEnd = item_mapping.end();
+  for(item_mapping_t::const_iterator it = item_mapping.begin(); it != itEnd; it++) {
+    if(it->second->type == CANVAS_ITEM_CIRCLE) {
+      ret += sizeof(canvas_item_info_circle) + sizeof(item_info_destroyer<canvas_item_info_circle>);
+    } else if(it->second->type == CANVAS_ITEM_MARKERS) {
+      const canvas_item_info_markers *markers = static_cast<const canvas_item_info_markers *>(it->second);
+      ret += sizeof(*markers) + sizeof(item_info_destroyer<canvas_item_info_markers>) +
+             markers->num_points * sizeof(markers->centers[0]);
+    } else {
+      const canvas_item_info_poly *poly = static_cast<const canvas_item_info_poly *>(it->second);
+      ret += sizeof(*poly) + sizeof(item_info_destroyer<canvas_item_info_poly>) +
+             poly->num_points * sizeof(poly->points[0]);
+    }
+  }
+  return ret;
+}
+
 void map_item_destroyer::run(canvas_item_t *)
 {
   delete mi;
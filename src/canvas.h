@@ -64,9 +64,23 @@ struct canvas_item_t {
 
   /****** manipulating items ******/
   void set_zoom_max(float zoom_max);
+
+  /**
+   * @brief set the dash pattern of the line
+   *
+   * Passing 0 as dash_length_on makes the line solid again.
+   */
   void set_dashed(float line_width, unsigned int dash_length_on,
                   unsigned int dash_length_off);
 
+  /**
+   * @brief change line width and colors
+   *
+   * For circles this is the border width and color. The fill color is
+   * ignored for polylines.
+   */
+  void set_style(float width, color_t color, color_t fill);
+
   /**
    * @brief associates the map item with this canvas item
    *
@@ -98,6 +112,7 @@ struct canvas_item_circle : public canvas_item_t {
   canvas_item_circle &operator=(const canvas_item_circle &) O2G_DELETED_FUNCTION;
 
   void set_radius(float radius);
+  void set_center(lpos_t c);
 };
 
 struct canvas_item_polyline : public canvas_item_t {
@@ -107,8 +122,8 @@ struct canvas_item_polyline : public canvas_item_t {
   /**
    * @brief update the visible points
    *
-   * This must not be called for selectable items. In fact, it is intended
-   * only to grow GPS track items.
+   * This must not be called for selectable items, use canvas_t::poly_update()
+   * for them. This also works for items created by canvas_t::polygon_new().
    */
   void set_points(const std::vector<lpos_t> &points);
 };
@@ -127,6 +142,13 @@ public:
   typedef std::unordered_map<const canvas_item_t *, canvas_item_info_t *> item_mapping_t;
   item_mapping_t item_mapping;
 
+  /**
+   * @brief the memory used to find the items at a given position
+   *
+   * The memory used by the platform canvas for the items is not included.
+   */
+  size_t memory_size() const;
+
   lpos_t window2world(const osm2go_platform::screenpos &p) const;
 
   /**
@@ -146,11 +168,45 @@ public:
    */
   bool set_background(const std::string &filename);
 
+  /**
+   * @brief add a tile to the background
+   * @param filename the image file to load
+   * @param min the top left corner of the covered area
+   * @param max the bottom right corner of the covered area
+   * @returns if loading was successful
+   *
+   * The image is stretched to cover the given area. All tiles are removed
+   * together with the background image by set_background().
+   */
+  bool add_background_tile(const std::string &filename, lpos_t min, lpos_t max);
+
+  /**
+   * @brief remove all background tiles
+   *
+   * Unlike set_background() this keeps the offset set by move_background().
+   */
+  void clear_background_tiles();
+
   /**
    * @brief move the background image
+   *
+   * If the background is made of tiles all of them are moved by the offset
+   * of x and y to the top left corner of the canvas bounds.
    */
   void move_background(int x, int y);
 
+  /**
+   * @brief the position of the background as set by move_background()
+   */
+  lpos_t background_position() const;
+
+  /**
+   * @brief get the currently visible area
+   * @param min the top left corner in canvas coordinates
+   * @param max the bottom right corner in canvas coordinates
+   */
+  void visible_area(lpos_t &min, lpos_t &max) const;
+
   void erase(unsigned int group_mask);
 
   /**
@@ -204,11 +260,60 @@ public:
                              color_t fill);
   canvas_item_pixmap *image_new(canvas_group_t group, icon_item *icon, lpos_t pos, float scale);
 
+  /**
+   * @brief create a single item showing filled circles at all given positions
+   *
+   * This is much cheaper than one item per circle if many are needed. If the
+   * item is selectable get_item_marker() tells which circle is at a position.
+   */
+  canvas_item_t *markers_new(canvas_group_t group, const std::vector<lpos_t> &centers,
+                             float radius, color_t fill);
+
+  /**
+   * @brief create a single item drawing all given lines
+   *
+   * The item must not be placed in a selectable group.
+   */
+  canvas_item_t *polylines_new(canvas_group_t group, const std::vector<std::vector<lpos_t> > &lines,
+                               float width, color_t color);
+
+  /**
+   * @brief create a single item filling all given polygons without border
+   *
+   * The item must not be placed in a selectable group.
+   */
+  canvas_item_t *polygons_new(canvas_group_t group, const std::vector<std::vector<lpos_t> > &polygons,
+                              color_t fill);
+
+  /***** updating items ******/
+
+  /**
+   * @brief change position, size and colors of an existing circle
+   *
+   * The arguments are the same as for circle_new(). In contrast to the item
+   * methods this also updates the information to find the item.
+   */
+  void circle_update(canvas_item_circle *item, lpos_t c, float radius, int border,
+                     color_t fill_col, color_t border_col = color_t::transparent());
+
+  /**
+   * @brief change points, line width and colors of an existing polyline or polygon
+   *
+   * The fill color is ignored for polylines.
+   */
+  void poly_update(canvas_item_t *item, const std::vector<lpos_t> &points, float width,
+                   color_t color, color_t fill = color_t::transparent());
+
   /**
    * @brief get the polygon/polyway segment a certain coordinate is over
    */
   std::optional<unsigned int> get_item_segment(const canvas_item_t *item, lpos_t pos) const;
 
+  /**
+   * @brief get the index of the circle of an item created by markers_new() at the given position
+   */
+  std::optional<unsigned int> get_item_marker(const canvas_item_t *item, lpos_t pos) const;
+
   /**
    * @brief make sure the given coordinate is visible on screen
    * @return if the position must be read new
@@ -23,7 +23,7 @@
 #define EXTRA_FUZZINESS_METER  0
 #define EXTRA_FUZZINESS_PIXEL  8
 
-enum canvas_item_type_t { CANVAS_ITEM_CIRCLE, CANVAS_ITEM_POLY };
+enum canvas_item_type_t { CANVAS_ITEM_CIRCLE, CANVAS_ITEM_POLY, CANVAS_ITEM_MARKERS };
 
 class canvas_item_info_t {
 protected:
@@ -38,8 +38,8 @@ class canvas_item_info_circle : public canvas_item_info_t {
 public:
   canvas_item_info_circle(canvas_t *cv, canvas_item_t *it, lpos_t c, const unsigned int r);
 
-  const lpos_t center;
-  const unsigned int radius;
+  lpos_t center;
+  unsigned int radius;
 };
 
 class canvas_item_info_poly : public canvas_item_info_t {
@@ -48,13 +48,35 @@ public:
                         float wd, const std::vector<lpos_t> &p);
 
   bool is_polygon;
-  const float width;
+  float width;
   // stored as single items to save one size_t of memory per object
-  const unsigned int num_points;
-  const std::unique_ptr<lpos_t[]> points;
+  unsigned int num_points;
+  std::unique_ptr<lpos_t[]> points;
+
+  /**
+   * @brief replace the points
+   *
+   * The buffer is only reallocated if the number of points changes.
+   */
+  void set_points(const std::vector<lpos_t> &p);
 
   /**
    * @brief get the polygon/polyway segment a certain coordinate is over
    */
   std::optional<unsigned int> get_segment(int x, int y, float fuzziness) const;
 };
+
+class canvas_item_info_markers : public canvas_item_info_t {
+public:
+  canvas_item_info_markers(canvas_t *cv, canvas_item_t *it, const std::vector<lpos_t> &c,
+                           unsigned int r);
+
+  const unsigned int radius;
+  const unsigned int num_points;
+  const std::unique_ptr<lpos_t[]> centers;
+
+  /**
+   * @brief get the marker closest to the given position
+   */
+  std::optional<unsigned int> get_marker(int x, int y, float fuzziness) const;
+};
@@ -0,0 +1,277 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Rolf Eike Beer <eike@sf-mail.de>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include <osm2go_cpp.h>
+#include <osm2go_stl.h>
+
+/**
+ * @brief a vector that shares its contents with copies of itself until one of them is modified
+ *
+ * Copying an instance only increments a reference count. All const accesses
+ * read the shared contents, the first non-const access on a shared instance
+ * creates a private copy (see detach()). Non-const accessors always detach,
+ * even if the result is only used for reading, so use const access where
+ * possible.
+ *
+ * An empty instance does not allocate any memory.
+ *
+ * The reference count is not atomic, instances must not be shared across threads.
+ */
+template<typename T>
+class cow_vector {
+  struct shared_data {
+    inline shared_data() : refs(1) {}
+    explicit inline shared_data(const std::vector<T> &other) : refs(1), items(other) {}
+
+    unsigned int refs;
+    std::vector<T> items;
+  };
+
+  shared_data *d; ///< nullptr if empty
+
+  static const std::vector<T> &empty_items()
+  {
+    static const std::vector<T> e;
+    return e;
+  }
+
+  inline const std::vector<T> &items() const noexcept
+  { return d == nullptr ? empty_items() : d->items; }
+
+  void release() noexcept
+  {
+    if(d != nullptr && --d->refs == 0)
+      delete d;
+    d = nullptr;
+  }
+
+  /**
+   * @brief make sure this instance is the only owner of the contents
+   *
+   * If the contents are shared the other owners get the copy, this instance
+   * keeps the existing buffer. This way iterators that were taken before remain
+   * valid and refer to the modified contents.
+   */
+  std::vector<T> &detach()
+  {
+    if(d == nullptr) {
+      d = new shared_data();
+    } else if(d->refs > 1) {
+      shared_data *n = new shared_data(d->items);
+      n->items.swap(d->items);
+      d->refs--;
+      d = n;
+    }
+    return d->items;
+  }
+
+public:
+  typedef typename std::vector<T>::value_type value_type;
+  typedef typename std::vector<T>::size_type size_type;
+  typedef typename std::vector<T>::difference_type difference_type;
+  typedef typename std::vector<T>::reference reference;
+  typedef typename std::vector<T>::const_reference const_reference;
+  typedef typename std::vector<T>::iterator iterator;
+  typedef typename std::vector<T>::const_iterator const_iterator;
+  typedef typename std::vector<T>::reverse_iterator reverse_iterator;
+  typedef typename std::vector<T>::const_reverse_iterator const_reverse_iterator;
+
+  inline cow_vector() noexcept : d(nullptr) {}
+  inline cow_vector(const cow_vector &other) noexcept
+    : d(other.d)
+  {
+    if(d != nullptr)
+      d->refs++;
+  }
+  template<typename InputIt>
+  cow_vector(InputIt first, InputIt last)
+    : d(nullptr)
+  {
+    if(first != last)
+      detach().assign(first, last);
+  }
+#if __cplusplus >= 201103L
+  inline cow_vector(cow_vector &&other) noexcept
+    : d(other.d)
+  {
+    other.d = nullptr;
+  }
+#endif
+  inline ~cow_vector()
+  { release(); }
+
+  cow_vector &operator=(const cow_vector &other) noexcept
+  {
+    if(other.d != nullptr)
+      other.d->refs++;
+    release();
+    d = other.d;
+    return *this;
+  }
+#if __cplusplus >= 201103L
+  inline cow_vector &operator=(cow_vector &&other) noexcept
+  {
+    release();
+    std::swap(d, other.d);
+    return *this;
+  }
+#endif
+
+  inline operator const std::vector<T> &() const noexcept
+  { return items(); }
+
+  /**
+   * @brief check if the contents are shared with another instance
+   */
+  inline bool isShared() const noexcept
+  { return d != nullptr && d->refs > 1; }
+
+  /**
+   * @brief the memory used by the contents
+   *
+   * Shared contents are split evenly between their owners, so the sum over
+   * all instances is the memory actually used.
+   */
+  inline size_t memory_size() const noexcept
+  { return d == nullptr ? 0 : (sizeof(*d) + d->items.capacity() * sizeof(T)) / d->refs; }
+
+  // read access
+
+  inline bool empty() const noexcept
+  { return d == nullptr || d->items.empty(); }
+  inline size_type size() const noexcept
+  { return d == nullptr ? 0 : d->items.size(); }
+
+  inline const_iterator begin() const noexcept
+  { return items().begin(); }
+  inline const_iterator end() const noexcept
+  { return items().end(); }
+  inline const_iterator cbegin() const noexcept
+  { return items().begin(); }
+  inline const_iterator cend() const noexcept
+  { return items().end(); }
+  inline const_reverse_iterator rbegin() const noexcept
+  { return items().rbegin(); }
+  inline const_reverse_iterator rend() const noexcept
+  { return items().rend(); }
+
+  inline const_reference front() const
+  { return items().front(); }
+  inline const_reference back() const
+  { return items().back(); }
+  inline const_reference at(size_type n) const
+  { return items().at(n); }
+  inline const_reference operator[](size_type n) const
+  { return items()[n]; }
+
+  // write access, all of these detach
+
+  inline iterator begin()
+  { return detach().begin(); }
+  inline iterator end()
+  { return detach().end(); }
+  inline reverse_iterator rbegin()
+  { return detach().rbegin(); }
+  inline reverse_iterator rend()
+  { return detach().rend(); }
+
+  inline reference front()
+  { return detach().front(); }
+  inline reference back()
+  { return detach().back(); }
+  inline reference at(size_type n)
+  { return detach().at(n); }
+  inline reference operator[](size_type n)
+  { return detach()[n]; }
+
+  inline void push_back(const T &value)
+  { detach().push_back(value); }
+  inline void pop_back()
+  { detach().pop_back(); }
+#if __cplusplus >= 201103L
+  template<typename... Args>
+  inline void emplace_back(Args &&... args)
+  { detach().emplace_back(std::forward<Args>(args)...); }
+#endif
+
+  // positions are converted to indexes first as they may point into the static empty list
+  iterator insert(const_iterator pos, const T &value)
+  {
+    const difference_type idx = std::distance(cbegin(), pos);
+    std::vector<T> &v = detach();
+    return v.insert(std::next(v.begin(), idx), value);
+  }
+  template<typename InputIt>
+  void insert(const_iterator pos, InputIt first, InputIt last)
+  {
+    const difference_type idx = std::distance(cbegin(), pos);
+    std::vector<T> &v = detach();
+    v.insert(std::next(v.begin(), idx), first, last);
+  }
+
+  iterator erase(const_iterator pos)
+  {
+    const difference_type idx = std::distance(cbegin(), pos);
+    std::vector<T> &v = detach();
+    return v.erase(std::next(v.begin(), idx));
+  }
+  iterator erase(const_iterator first, const_iterator last)
+  {
+    const difference_type idx = std::distance(cbegin(), first);
+    const difference_type cnt = std::distance(first, last);
+    std::vector<T> &v = detach();
+    const iterator f = std::next(v.begin(), idx);
+    return v.erase(f, std::next(f, cnt));
+  }
+
+  inline void resize(size_type n)
+  { detach().resize(n); }
+  inline void reserve(size_type n)
+  { detach().reserve(n); }
+
+  /**
+   * @brief remove all elements and free their memory
+   */
+  inline void clear() noexcept
+  { release(); }
+
+  inline void swap(cow_vector &other) noexcept
+  { std::swap(d, other.d); }
+
+  /**
+   * @brief exchange the contents with a plain vector
+   *
+   * Shared contents are not copied for this, the other owners just keep them.
+   */
+  void swap(std::vector<T> &other)
+  {
+    if(d == nullptr || d->refs > 1) {
+      release();
+      d = new shared_data();
+    }
+    d->items.swap(other);
+  }
+
+  friend inline bool operator==(const cow_vector &a, const cow_vector &b)
+  { return a.d == b.d || a.items() == b.items(); }
+  friend inline bool operator!=(const cow_vector &a, const cow_vector &b)
+  { return !(a == b); }
+  friend inline bool operator==(const cow_vector &a, const std::vector<T> &b)
+  { return a.items() == b; }
+  friend inline bool operator!=(const cow_vector &a, const std::vector<T> &b)
+  { return a.items() != b; }
+  friend inline bool operator==(const std::vector<T> &a, const cow_vector &b)
+  { return a == b.items(); }
+  friend inline bool operator!=(const std::vector<T> &a, const cow_vector &b)
+  { return a != b.items(); }
+};
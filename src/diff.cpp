@@ -15,6 +15,8 @@
 #include "notifications.h"
 #include "osm.h"
 #include "osm_objects.h"
+#include "osm_p.h"
+#include "perf_trace.h"
 #include "project.h"
 #include "uicontrol.h"
 
@@ -23,14 +25,20 @@
 #include <cerrno>
 #include <cstring>
 #include <fcntl.h>
+#include <iterator>
 #include <libxml/parser.h>
 #include <libxml/tree.h>
+#include <libxml/xmlreader.h>
+#include <libxml/xmlwriter.h>
+#include <memory>
+#include <mutex>
 #include <sys/stat.h>
 #include <unistd.h>
 
 #include "osm2go_annotations.h"
 #include <osm2go_cpp.h>
 #include <osm2go_i18n.h>
+#include <osm2go_log.h>
 
 #if !defined(LIBXML_TREE_ENABLED) || !defined(LIBXML_OUTPUT_ENABLED)
 #error "libxml doesn't support required tree or output"
@@ -66,154 +74,284 @@ project_diff_name(const project_t *project)
 }
 
 struct diff_save_tags_functor {
-  xmlNode * const node;
-  explicit inline diff_save_tags_functor(xmlNodePtr n) : node(n) {}
+  xmlTextWriterPtr const writer;
+  explicit inline diff_save_tags_functor(xmlTextWriterPtr w) : writer(w) {}
   void operator()(const tag_t &tag) const {
-    xmlNodePtr tag_node = xmlNewChild(node, nullptr,
-                                      BAD_CAST "tag", nullptr);
-    xmlNewProp(tag_node, BAD_CAST "k", BAD_CAST tag.key);
-    xmlNewProp(tag_node, BAD_CAST "v", BAD_CAST tag.value);
+    xmlTextWriterStartElement(writer, BAD_CAST "tag");
+    xmlTextWriterWriteAttribute(writer, BAD_CAST "k", BAD_CAST tag.key);
+    xmlTextWriterWriteAttribute(writer, BAD_CAST "v", BAD_CAST tag.value);
+    xmlTextWriterEndElement(writer);
   }
 };
 
 void
-diff_save_tags(const base_object_t *obj, xmlNodePtr node)
+diff_save_tags(const base_object_t *obj, xmlTextWriterPtr writer)
 {
-  diff_save_tags_functor fc(node);
+  diff_save_tags_functor fc(writer);
   obj->tags.for_each(fc);
 }
 
 /**
-  * @brief save the common OSM object information
-  * @param root_node the XML node to append to
+  * @brief start the element of an OSM object and write the common information
+  * @param writer the XML writer
   * @param obj the object to save
   * @param tname the name of the XML node
-  * @return XML node object
+  *
+  * The caller has to close the element.
   */
-xmlNodePtr
-diff_save_state_n_id(xmlNodePtr root_node, const base_object_t *obj, const char *tname)
+void
+diff_save_state_n_id(xmlTextWriterPtr writer, const base_object_t *obj, const char *tname)
 {
-  xmlNodePtr node = xmlNewChild(root_node, nullptr, BAD_CAST tname, nullptr);
+  xmlTextWriterStartElement(writer, BAD_CAST tname);
 
   if(obj->isDeleted())
-    xmlNewProp(node, BAD_CAST "state", BAD_CAST "deleted");
+    xmlTextWriterWriteAttribute(writer, BAD_CAST "state", BAD_CAST "deleted");
   else if(obj->isNew())
-    xmlNewProp(node, BAD_CAST "state", BAD_CAST "new");
+    xmlTextWriterWriteAttribute(writer, BAD_CAST "state", BAD_CAST "new");
 
   /* all items need an id */
-  xmlNewProp(node, BAD_CAST "id", BAD_CAST obj->id_string().c_str());
-
-  return node;
+  xmlTextWriterWriteAttribute(writer, BAD_CAST "id", BAD_CAST obj->id_string().c_str());
 }
 
 template<typename T ENABLE_IF_CONVERTIBLE(T *, base_object_t *)>
 class diff_save_objects {
-  xmlNode * const root_node;
-  inline void save_additional_info(const T *m, xmlNodePtr xmlnode) const;
+  xmlTextWriterPtr const writer;
+  inline void save_additional_info(const T *m) const;
 public:
-  explicit inline diff_save_objects(xmlNodePtr r) : root_node(r) {}
-  void operator()(const std::pair<item_id_t, T *> &pair) const {
-    if(!pair.second->isDirty())
-      return;
-
-    xmlNodePtr xmlnode = diff_save_state_n_id(root_node, pair.second, T::api_string());
-
-    if(pair.second->isDeleted())
-      return;
+  explicit inline diff_save_objects(xmlTextWriterPtr w) : writer(w) {}
+  void operator()(const T *obj) const {
+    diff_save_state_n_id(writer, obj, T::api_string());
 
     /* additional info is only required if the object hasn't been deleted */
-    save_additional_info(pair.second, xmlnode);
+    if(!obj->isDeleted()) {
+      save_additional_info(obj);
+      diff_save_tags(obj, writer);
+    }
 
-    diff_save_tags(pair.second, xmlnode);
+    xmlTextWriterEndElement(writer);
   }
 };
 
 template<>
-void diff_save_objects<node_t>::save_additional_info(const node_t *m, xmlNodePtr xmlnode) const
+void diff_save_objects<node_t>::save_additional_info(const node_t *m) const
 {
-  m->pos.toXmlProperties(xmlnode);
+  m->pos.toXmlProperties(writer);
 }
 
 struct diff_save_ways {
-  xmlNode * const root_node;
+  xmlTextWriterPtr const writer;
   osm_t::ref osm;
-  explicit inline diff_save_ways(xmlNodePtr r, osm_t::ref o) : root_node(r), osm(o) { }
-  void operator()(const std::pair<item_id_t, way_t *> &pair) const;
+  explicit inline diff_save_ways(xmlTextWriterPtr w, osm_t::ref o) : writer(w), osm(o) { }
+  void operator()(const way_t *way) const;
 };
 
-void diff_save_ways::operator()(const std::pair<item_id_t, way_t *> &pair) const
+void diff_save_ways::operator()(const way_t *way) const
 {
-  const way_t * const way = pair.second;
-  bool hidden = osm->wayIsHidden(way);
-  if(!way->isDirty() && !hidden)
-    return;
+  diff_save_state_n_id(writer, way, way_t::api_string());
+
+  if(!way->isDeleted()) {
+    if(osm->wayIsHidden(way))
+      xmlTextWriterWriteAttribute(writer, BAD_CAST "hidden", BAD_CAST "true");
+
+    /* additional info is only required if the way hasn't been deleted */
+    /* and if the dirty flags is set. (otherwise e.g. only the hidden
+     * flag may be set) */
+    if(way->flags & OSM_FLAG_DIRTY) {
+      way->write_node_chain(writer);
+      diff_save_tags(way, writer);
+    }
+  }
 
-  xmlNodePtr node_way = diff_save_state_n_id(root_node, way, way_t::api_string());
+  xmlTextWriterEndElement(writer);
+}
 
-  if(way->isDeleted())
-    return;
+template<>
+void diff_save_objects<relation_t>::save_additional_info(const relation_t *m) const
+{
+  m->generate_member_xml(writer);
+}
 
-  if(hidden)
-    xmlNewProp(node_way, BAD_CAST "hidden", BAD_CAST "true");
+inline bool objectIdCompare(const base_object_t *a, const base_object_t *b)
+{
+  return a->id < b->id;
+}
 
-  /* additional info is only required if the way hasn't been deleted */
-  /* and if the dirty flags is set. (otherwise e.g. only the hidden
-   * flag may be set) */
-  if(way->flags & OSM_FLAG_DIRTY) {
-    way->write_node_chain(node_way);
-    diff_save_tags(way, node_way);
+/**
+ * @brief collect the modified objects of one type ordered by id
+ *
+ * The added objects all have negative ids, changed and deleted ones are each
+ * already sorted, so this does not need to look at any unmodified object.
+ */
+template<typename T>
+std::vector<T *>
+diff_objects(const osm_t::dirty_t::counter<T> &dirty)
+{
+  std::vector<T *> ret;
+  ret.reserve(dirty.added.size() + dirty.changed.size() + dirty.deleted.size());
+  ret.insert(ret.end(), dirty.added.begin(), dirty.added.end());
+  std::merge(dirty.changed.begin(), dirty.changed.end(), dirty.deleted.begin(), dirty.deleted.end(),
+             std::back_inserter(ret), objectIdCompare);
+
+  return ret;
+}
+
+struct hidden_clean_way {
+  inline bool operator()(const way_t *way) const
+  {
+    return !way->isDirty();
   }
+};
+
+} // namespace
+
+diff_snapshot::diff_snapshot(const project_t *project, xmlBufferPtr buf)
+  : state(project->diffState)
+  , generation(++state->generation)
+  , dirfd(fcntl(project->dirfd, F_DUPFD_CLOEXEC, 0))
+  , diff_name(diff_filename(project))
+  , buffer(buf)
+{
 }
 
-template<>
-void diff_save_objects<relation_t>::save_additional_info(const relation_t *m, xmlNodePtr xmlnode) const
+diff_snapshot::~diff_snapshot()
 {
-  m->generate_member_xml(xmlnode);
+  if(buffer != nullptr)
+    xmlBufferFree(buffer);
 }
 
-} // namespace
+bool diff_snapshot::write()
+{
+  PERF_SCOPE("diff_snapshot::write");
+  std::lock_guard<std::mutex> lock(state->mutex);
 
-void project_t::diff_save() const {
+  if(unlikely(state->written > generation)) {
+    OSM2GO_LOG(Diff, Debug, "diff snapshot %u is outdated, a newer one has already been saved", generation);
+    return false;
+  }
+
+  if(buffer == nullptr) {
+    unlinkat(dirfd, diff_name.c_str(), 0);
+    state->written = generation;
+    return true;
+  }
+
+  /* write the diff to a new file so the original one needs intact until
+   * saving is completed */
+  const char *ndiff = "save.diff";
+  fdguard fd(openat(dirfd, ndiff, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+  if(unlikely(!fd.valid())) {
+    OSM2GO_LOG(Diff, Error, "error creating '%s': %s", ndiff, strerror(errno));
+    return false;
+  }
+
+  const char *data = reinterpret_cast<const char *>(xmlBufferContent(buffer));
+  size_t len = xmlBufferLength(buffer);
+  while(len > 0) {
+    const ssize_t r = ::write(fd, data, len);
+    if(unlikely(r < 0)) {
+      if(errno == EINTR)
+        continue;
+      OSM2GO_LOG(Diff, Error, "error writing '%s': %s", ndiff, strerror(errno));
+      unlinkat(dirfd, ndiff, 0);
+      return false;
+    }
+    data += r;
+    len -= r;
+  }
+
+  /* make sure the contents are on disk before replacing the old file */
+  if(unlikely(fsync(fd) != 0)) {
+    OSM2GO_LOG(Diff, Error, "error syncing '%s': %s", ndiff, strerror(errno));
+    unlinkat(dirfd, ndiff, 0);
+    return false;
+  }
+
+  /* if we reach this point writing the new file worked and we */
+  /* can move it over the real file */
+  if(unlikely(renameat(dirfd, ndiff, dirfd, diff_name.c_str()) != 0)) {
+    OSM2GO_LOG(Diff, Error, "error %i when moving '%s' to '%s'", errno, ndiff, diff_name.c_str());
+    unlinkat(dirfd, ndiff, 0);
+    return false;
+  }
+
+  state->written = generation;
+  return true;
+}
+
+diff_snapshot *project_t::diff_collect() const
+{
   if(unlikely(!osm))
-    return;
+    return nullptr;
 
   if(osm->is_clean(true)) {
-    printf("data set is clean, removing diff if present\n");
-    diff_remove_file();
-    return;
+    OSM2GO_LOG(Diff, Debug, "data set is clean, removing diff if present");
+    return new diff_snapshot(this, nullptr);
   }
 
-  const std::string &diff_name = diff_filename(this);
+  OSM2GO_LOG(Diff, Debug, "data set is dirty, generating diff");
+
+  const osm_t::dirty_t dirty = osm->modified();
+
+  std::vector<way_t *> ways = diff_objects(dirty.ways);
+  /* ways that are only hidden are not part of the dirty set */
+  std::vector<way_t *> hidden;
+  std::copy_if(osm->hiddenWays.begin(), osm->hiddenWays.end(), std::back_inserter(hidden),
+               hidden_clean_way());
+  if(!hidden.empty()) {
+    std::sort(hidden.begin(), hidden.end(), objectIdCompare);
+    std::vector<way_t *> dirtyWays;
+    dirtyWays.swap(ways);
+    ways.reserve(dirtyWays.size() + hidden.size());
+    std::merge(dirtyWays.begin(), dirtyWays.end(), hidden.begin(), hidden.end(),
+               std::back_inserter(ways), objectIdCompare);
+  }
 
-  printf("data set is dirty, generating diff\n");
+  xmlBufferPtr buf = xmlBufferCreate();
+  xmlTextWriterPtr writer = buf == nullptr ? nullptr : xmlNewTextWriterMemory(buf, 0);
+  if(unlikely(writer == nullptr)) {
+    OSM2GO_LOG(Diff, Error, "error creating the diff writer");
+    if(buf != nullptr)
+      xmlBufferFree(buf);
+    return nullptr;
+  }
 
-  /* write the diff to a new file so the original one needs intact until
-   * saving is completed */
-  const std::string ndiff = path + "save.diff";
+  xmlTextWriterSetIndent(writer, 1);
+  xmlTextWriterSetIndentString(writer, BAD_CAST "  ");
+  xmlTextWriterStartDocument(writer, nullptr, "UTF-8", nullptr);
+  xmlTextWriterStartElement(writer, BAD_CAST "diff");
+  xmlTextWriterWriteAttribute(writer, BAD_CAST "name", BAD_CAST name.c_str());
 
-  xmlDocGuard doc(xmlNewDoc(BAD_CAST "1.0"));
-  xmlNodePtr root_node = xmlNewNode(nullptr, BAD_CAST "diff");
-  xmlNewProp(root_node, BAD_CAST "name", BAD_CAST name.c_str());
-  xmlDocSetRootElement(doc.get(), root_node);
+  const std::vector<node_t *> nodes = diff_objects(dirty.nodes);
+  std::for_each(nodes.begin(), nodes.end(), diff_save_objects<node_t>(writer));
+  std::for_each(ways.begin(), ways.end(), diff_save_ways(writer, osm));
+  const std::vector<relation_t *> relations = diff_objects(dirty.relations);
+  std::for_each(relations.begin(), relations.end(), diff_save_objects<relation_t>(writer));
 
-  std::for_each(osm->nodes.begin(), osm->nodes.end(), diff_save_objects<node_t>(root_node));
-  std::for_each(osm->ways.begin(), osm->ways.end(), diff_save_ways(root_node, osm));
-  std::for_each(osm->relations.begin(), osm->relations.end(), diff_save_objects<relation_t>(root_node));
+  const bool ok = xmlTextWriterEndDocument(writer) >= 0;
+  xmlFreeTextWriter(writer);
 
-  xmlSaveFormatFileEnc(ndiff.c_str(), doc.get(), "UTF-8", 1);
+  if(unlikely(!ok)) {
+    OSM2GO_LOG(Diff, Error, "error generating the diff");
+    xmlBufferFree(buf);
+    return nullptr;
+  }
 
-  /* if we reach this point writing the new file worked and we */
-  /* can move it over the real file */
-  if(renameat(-1, ndiff.c_str(), dirfd, diff_name.c_str()) != 0)
-    fprintf(stderr, "error %i when moving '%s' to '%s'\n", errno, ndiff.c_str(), diff_name.c_str());
+  return new diff_snapshot(this, buf);
+}
+
+void project_t::diff_save() const {
+  PERF_SCOPE("project_t::diff_save");
+  std::unique_ptr<diff_snapshot> snapshot(diff_collect());
+  if(likely(snapshot))
+    snapshot->write();
 }
 
 namespace {
 
 item_id_t
-xml_get_prop_int(xmlNode *node, const char *prop, item_id_t def)
+xml_get_prop_int(xmlTextReaderPtr reader, const char *prop, item_id_t def)
 {
-  xmlString str(xmlGetProp(node, BAD_CAST prop));
+  xmlString str(xmlTextReaderGetAttribute(reader, BAD_CAST prop));
 
   if(str)
     return strtoll(str, nullptr, 10);
@@ -222,35 +360,59 @@ xml_get_prop_int(xmlNode *node, const char *prop, item_id_t def)
 }
 
 int
-xml_get_prop_state(xmlNode *node)
+xml_get_prop_state(xmlTextReaderPtr reader)
 {
-  xmlString str(xmlGetProp(node, BAD_CAST "state"));
+  xmlString str(xmlTextReaderGetAttribute(reader, BAD_CAST "state"));
 
   if(!str || strcmp(str, "new") == 0)
     return OSM_FLAG_DIRTY;
   else if(likely(strcmp(str, "deleted") == 0))
     return OSM_FLAG_DELETED;
 
-  printf("  Illegal state entry '%s'\n", static_cast<const char *>(str));
+  OSM2GO_LOG(Diff, Warning, "  Illegal state entry '%s'", static_cast<const char *>(str));
 
   return -1;
 }
 
-osm_t::TagMap
-xml_scan_tags(xmlNodePtr node)
+/**
+ * @brief call a functor for all child elements of the current element
+ * @param reader the reader positioned on the start of the parent element
+ * @param fc the functor, called with the name of the child element
+ *
+ * Afterwards the reader is positioned on the end of the parent element.
+ */
+template<typename T>
+void
+xml_scan_children(xmlTextReaderPtr reader, T &fc)
 {
-  /* scan for tags */
-  osm_t::TagMap  ret;
+  if(xmlTextReaderIsEmptyElement(reader))
+    return;
+
+  const int depth = xmlTextReaderDepth(reader);
 
-  for(; node != nullptr; node = node->next) {
-    if(node->type == XML_ELEMENT_NODE) {
-      if(likely(strcmp(reinterpret_cast<const char *>(node->name), "tag") == 0))
-        osm_t::parse_tag(node, ret);
+  int ret = xmlTextReaderRead(reader);
+  while(ret == 1 &&
+        (xmlTextReaderNodeType(reader) != XML_READER_TYPE_END_ELEMENT ||
+         xmlTextReaderDepth(reader) != depth)) {
+    if(xmlTextReaderNodeType(reader) == XML_READER_TYPE_ELEMENT) {
+      fc(reinterpret_cast<const char *>(xmlTextReaderConstName(reader)));
+      xml_skip_element(reader);
     }
+    ret = xmlTextReaderRead(reader);
   }
-  return ret;
 }
 
+/* scan for tags */
+struct xml_scan_tags {
+  xmlTextReaderPtr const reader;
+  osm_t::TagMap tags;
+  explicit inline xml_scan_tags(xmlTextReaderPtr r) : reader(r) {}
+  inline void operator()(const char *name) {
+    if(likely(strcmp(name, "tag") == 0))
+      osm_t::parse_tag(reader, tags);
+  }
+};
+
 void deleteDiffObject(osm_t::ref osm, node_t *n)
 {
   // don't touch the reference count here: if this node was part of a way is needs to be
@@ -281,48 +443,46 @@ void deleteDiffObject(osm_t::ref osm, relation_t *r)
 }
 
 template<typename T ENABLE_IF_CONVERTIBLE(T *, base_object_t *)>
-T *restore_object(xmlNodePtr xml_node, osm_t::ref osm)
+T *restore_object(xmlTextReaderPtr reader, osm_t::ref osm)
 {
-  printf("Restoring %s", T::api_string());
-
   /* read properties */
-  item_id_t id = xml_get_prop_int(xml_node, "id", ID_ILLEGAL);
+  item_id_t id = xml_get_prop_int(reader, "id", ID_ILLEGAL);
   if(unlikely(id == ID_ILLEGAL)) {
-    printf("\n  %s entry missing id\n", T::api_string());
+    OSM2GO_LOG(Diff, Warning, "  %s entry missing id", T::api_string());
     return nullptr;
   }
 
-  printf(" " ITEM_ID_FORMAT "\n", id);
+  OSM2GO_LOG(Diff, Debug, "Restoring %s " ITEM_ID_FORMAT, T::api_string(), id);
 
   /* evaluate properties */
   T *ret;
 
-  switch(xml_get_prop_state(xml_node)) {
+  switch(xml_get_prop_state(reader)) {
   case OSM_FLAG_DELETED:
-    printf("  Restoring DELETE flag\n");
+    OSM2GO_LOG(Diff, Debug, "  Restoring DELETE flag");
 
     ret = osm->object_by_id<T>(id);
     if(likely(ret != nullptr))
       deleteDiffObject(osm, ret);
     else
-      printf("  WARNING: no object with that id found\n");
+      OSM2GO_LOG(Diff, Warning, "  no object with that id found");
     return nullptr;
 
   case OSM_FLAG_DIRTY:
     if(id < 0) {
-      printf("  Restoring NEW object\n");
+      OSM2GO_LOG(Diff, Debug, "  Restoring NEW object");
 
       ret = new T(base_attributes(id));
 
       osm->insert(ret);
     } else {
-      printf("  Valid id/position (DIRTY)\n");
+      OSM2GO_LOG(Diff, Debug, "  Valid id/position (DIRTY)");
 
       ret = osm->object_by_id<T>(id);
       if(likely(ret != nullptr))
         osm->mark_dirty(ret);
       else
-        printf("  WARNING: no object with that id found\n");
+        OSM2GO_LOG(Diff, Warning, "  no object with that id found");
     }
     return ret;
 
@@ -346,27 +506,33 @@ struct existingNodeFinder {
 };
 
 void
-diff_restore_node(xmlNodePtr node_node, osm_t::ref osm, std::unordered_map<item_id_t, item_id_t> &replaced)
+diff_restore_node(xmlTextReaderPtr reader, osm_t::ref osm, std::unordered_map<item_id_t, item_id_t> &replaced,
+                  node_projector &projector)
 {
-  node_t *node = restore_object<node_t>(node_node, osm);
-  if (node == nullptr)
+  node_t *node = restore_object<node_t>(reader, osm);
+  if (node == nullptr) {
+    xml_skip_element(reader);
     return;
+  }
 
-  pos_t pos = pos_t::fromXmlProperties(node_node);
+  pos_t pos = pos_t::fromXmlProperties(reader);
   if(unlikely(!pos.valid())) {
-    printf("  Node not deleted, but no valid position\n");
+    OSM2GO_LOG(Diff, Warning, "  Node not deleted, but no valid position");
+    xml_skip_element(reader);
     return;
   }
   bool pos_diff = node->isNew() || node->pos != pos;
   if (pos_diff) {
     node->pos = pos;
-    node->lpos = node->pos.toLpos(osm->bounds);
+    projector.add(node);
   }
 
-  osm_t::TagMap ntags = xml_scan_tags(node_node->children);
+  xml_scan_tags scanner(reader);
+  xml_scan_children(reader, scanner);
+  osm_t::TagMap &ntags = scanner.tags;
   /* check if the same changes have been done upstream */
   if(node->flags & OSM_FLAG_DIRTY && !pos_diff && node->tags == ntags) {
-    printf("  node " ITEM_ID_FORMAT " has the same values and position as upstream, discarding diff\n", node->id);
+    OSM2GO_LOG(Diff, Debug, "  node " ITEM_ID_FORMAT " has the same values and position as upstream, discarding diff", node->id);
     osm->unmark_dirty(node);
     return;
   }
@@ -375,13 +541,15 @@ diff_restore_node(xmlNodePtr node_node, osm_t::ref osm, std::unordered_map<item_
     // look if we find a node at the same position and with the same tags that is not new
     node_t *oldNode = osm->find_node(existingNodeFinder(pos, ntags));
     if (oldNode != nullptr) {
-      printf("  node " ITEM_ID_FORMAT " seems to already exist as node " ITEM_ID_FORMAT ", discarding it\n", node->id, oldNode->id);
+      OSM2GO_LOG(Diff, Debug, "  node " ITEM_ID_FORMAT " seems to already exist as node " ITEM_ID_FORMAT ", discarding it", node->id, oldNode->id);
       replaced[node->id] = oldNode->id;
+      projector.remove(node);
       osm->node_delete(node);
       return;
     }
   }
 
+  osm_t::TagChangeGuard guard(*osm, object_t(node));
   node->tags.replace(ntags);
 }
 
@@ -397,32 +565,48 @@ struct existingWayFinder {
   const way_t *way;
 };
 
+/* scan for nodes and tags */
+struct xml_scan_way {
+  xml_scan_tags tags;
+  osm_t::ref osm;
+  const std::unordered_map<item_id_t, item_id_t> * const replaced_nodes;
+  node_chain_t chain;
+  inline xml_scan_way(xmlTextReaderPtr r, osm_t::ref o, const std::unordered_map<item_id_t, item_id_t> *rn)
+    : tags(r), osm(o), replaced_nodes(rn) {}
+  void operator()(const char *name);
+};
+
+void xml_scan_way::operator()(const char *name)
+{
+  if(strcmp(name, "nd") == 0) {
+    /* attach node to node_chain */
+    node_t *tmp = osm->parse_way_nd(tags.reader, replaced_nodes);
+    if(likely(tmp != nullptr))
+      chain.push_back(tmp);
+  } else {
+    tags(name);
+  }
+}
+
 void
-diff_restore_way(xmlNodePtr node_way, osm_t::ref osm,
+diff_restore_way(xmlTextReaderPtr reader, osm_t::ref osm,
                  const std::unordered_map<item_id_t, item_id_t> *replaced_nodes,
                  std::unordered_map<item_id_t, item_id_t> &replaced_ways)
 {
-  way_t *way = restore_object<way_t>(node_way, osm);
-  if (way == nullptr)
+  way_t *way = restore_object<way_t>(reader, osm);
+  if (way == nullptr) {
+    xml_skip_element(reader);
     return;
+  }
 
   /* handle hidden flag */
-  if(xml_get_prop_bool(node_way, "hidden"))
+  if(xml_get_prop_bool(reader, "hidden"))
     osm->waySetHidden(way);
 
   /* update node_chain */
-  /* scan for nodes */
-  node_chain_t new_chain;
-  for(xmlNode *nd_node = node_way->children; nd_node != nullptr; nd_node = nd_node->next) {
-    if(nd_node->type == XML_ELEMENT_NODE) {
-      if(likely(strcmp(reinterpret_cast<const char *>(nd_node->name), "nd") == 0)) {
-        /* attach node to node_chain */
-        node_t *tmp = osm->parse_way_nd(nd_node, replaced_nodes);
-        if(likely(tmp != nullptr))
-          new_chain.push_back(tmp);
-      }
-    }
-  }
+  xml_scan_way scanner(reader, osm, replaced_nodes);
+  xml_scan_children(reader, scanner);
+  node_chain_t &new_chain = scanner.chain;
 
   /* only replace the original nodes if new nodes have actually been */
   /* found. */
@@ -434,12 +618,13 @@ diff_restore_way(xmlNodePtr node_way, osm_t::ref osm,
     osm_node_chain_unref(new_chain);
     new_chain.clear();
 
-    osm_t::TagMap ntags = xml_scan_tags(node_way->children);
+    const osm_t::TagMap &ntags = scanner.tags.tags;
     if (way->tags != ntags) {
+      osm_t::TagChangeGuard guard(*osm, object_t(way));
       way->tags.replace(ntags);
     } else if (!ntags.empty()) {
       if (sameChain) {
-        printf("way " ITEM_ID_FORMAT " has the same nodes and tags as upstream, discarding diff\n", way->id);
+        OSM2GO_LOG(Diff, Debug, "way " ITEM_ID_FORMAT " has the same nodes and tags as upstream, discarding diff", way->id);
         osm->unmark_dirty(way);
       }
     }
@@ -447,7 +632,7 @@ diff_restore_way(xmlNodePtr node_way, osm_t::ref osm,
     /* only replace tags if nodes have been found before. if no nodes */
     /* were found this wasn't a dirty entry but e.g. only the hidden */
     /* flag had been set */
-    printf("  no nodes restored, way isn't dirty!\n");
+    OSM2GO_LOG(Diff, Debug, "  no nodes restored, way isn't dirty!");
     osm->unmark_dirty(way);
   }
 
@@ -455,7 +640,7 @@ diff_restore_way(xmlNodePtr node_way, osm_t::ref osm,
     // look if we find a node at the same position and with the same tags that is not new
     way_t *oldWay = osm->find_way(existingWayFinder(way));
     if (oldWay != nullptr) {
-      printf("  way " ITEM_ID_FORMAT " seems to already exist as way " ITEM_ID_FORMAT ", discarding it\n", way->id, oldWay->id);
+      OSM2GO_LOG(Diff, Debug, "  way " ITEM_ID_FORMAT " seems to already exist as way " ITEM_ID_FORMAT ", discarding it", way->id, oldWay->id);
       replaced_ways[way->id] = oldWay->id;
       osm->way_delete(way, nullptr);
       return;
@@ -463,35 +648,53 @@ diff_restore_way(xmlNodePtr node_way, osm_t::ref osm,
   }
 }
 
+/* scan for members and tags */
+struct xml_scan_relation {
+  xml_scan_tags tags;
+  osm_t::ref osm;
+  const std::unordered_map<item_id_t, item_id_t> * const replaced_nodes;
+  const std::unordered_map<item_id_t, item_id_t> * const replaced_ways;
+  std::vector<member_t> members;
+  inline xml_scan_relation(xmlTextReaderPtr r, osm_t::ref o, const std::unordered_map<item_id_t, item_id_t> *rn,
+                           const std::unordered_map<item_id_t, item_id_t> *rw)
+    : tags(r), osm(o), replaced_nodes(rn), replaced_ways(rw) {}
+  void operator()(const char *name);
+};
+
+void xml_scan_relation::operator()(const char *name)
+{
+  if(strcmp(name, "member") == 0) {
+    /* attach member to member_chain */
+    osm->parse_relation_member(tags.reader, members, replaced_nodes, replaced_ways);
+  } else {
+    tags(name);
+  }
+}
+
 void
-diff_restore_relation(xmlNodePtr node_rel, osm_t::ref osm,
+diff_restore_relation(xmlTextReaderPtr reader, osm_t::ref osm,
                       const std::unordered_map<item_id_t, item_id_t> *replaced_nodes,
                       const std::unordered_map<item_id_t, item_id_t> *replaced_ways)
 {
-  relation_t *relation = restore_object<relation_t>(node_rel, osm);
-  if (relation == nullptr)
+  relation_t *relation = restore_object<relation_t>(reader, osm);
+  if (relation == nullptr) {
+    xml_skip_element(reader);
     return;
+  }
+
+  xml_scan_relation scanner(reader, osm, replaced_nodes, replaced_ways);
+  xml_scan_children(reader, scanner);
 
   bool was_changed = false;
-  osm_t::TagMap ntags = xml_scan_tags(node_rel->children);
+  const osm_t::TagMap &ntags = scanner.tags.tags;
   if(relation->tags != ntags) {
+    osm_t::TagChangeGuard guard(*osm, object_t(relation));
     relation->tags.replace(ntags);
     was_changed = true;
   }
 
   /* update members */
-
-  /* scan for members */
-  std::vector<member_t> members;
-  for(xmlNode *member_node = node_rel->children; member_node != nullptr;
-      member_node = member_node->next) {
-    if(member_node->type == XML_ELEMENT_NODE) {
-      if(likely(strcmp(reinterpret_cast<const char *>(member_node->name), "member") == 0)) {
-	/* attach member to member_chain */
-        osm->parse_relation_member(member_node, members, replaced_nodes, replaced_ways);
-      }
-    }
-  }
+  std::vector<member_t> &members = scanner.members;
 
   if(relation->members != members) {
     /* this may be an existing relation, so remove members to */
@@ -501,69 +704,110 @@ diff_restore_relation(xmlNodePtr node_rel, osm_t::ref osm,
   }
 
   if(!was_changed && (relation->flags & OSM_FLAG_DIRTY)) {
-    printf("relation " ITEM_ID_FORMAT " has the same members and tags as upstream, discarding diff\n", relation->id);
+    OSM2GO_LOG(Diff, Debug, "relation " ITEM_ID_FORMAT " has the same members and tags as upstream, discarding diff", relation->id);
     osm->unmark_dirty(relation);
   }
 }
 
 } // namespace
 
-unsigned int project_t::diff_restore()
+unsigned int project_t::diff_restore(trstring *message)
 {
   const std::string &diff_name = project_diff_name(this);
   if(diff_name.empty()) {
-    printf("no diff present!\n");
+    OSM2GO_LOG(Diff, Debug, "no diff present!");
     return DIFF_NONE_PRESENT;
   }
 
   fdguard difffd(dirfd, diff_name.c_str(), O_RDONLY);
 
-  /* parse the file and get the DOM */
-  xmlDocGuard doc(xmlReadFd(difffd, nullptr, nullptr, XML_PARSE_NONET));
-  if(unlikely(!doc)) {
-    error_dlg(trstring("Error: could not parse file %1\n").arg(diff_name));
+  /* the file is read as a stream, only the current object is kept in memory */
+  xmlTextReaderGuard reader(difffd.valid() ? xmlReaderForFd(difffd, nullptr, nullptr, XML_PARSE_NONET) : nullptr);
+  if(unlikely(!reader || xmlTextReaderRead(reader.get()) != 1)) {
+    trstring msg = trstring("Error: could not parse file %1\n").arg(diff_name);
+    if(message != nullptr)
+      message->swap(msg);
+    else
+      error_dlg(msg);
     return DIFF_INVALID;
   }
 
-  printf("diff %s found, applying ...\n", diff_name.c_str());
+  OSM2GO_LOG(Diff, Info, "diff %s found, applying ...", diff_name.c_str());
+
+  // the strings read here are only used by the restored objects
+  cache_set::generation_scope cscope(value_cache, osm->cacheGeneration);
 
   unsigned int res = DIFF_RESTORED;
   std::unordered_map<item_id_t, item_id_t> replaced_nodes;
   std::unordered_map<item_id_t, item_id_t> replaced_ways;
+  // the nodes come first, their screen positions are needed only afterwards
+  node_projector projector(osm->bounds);
 
-  for (xmlNode *cur_node = xmlDocGetRootElement(doc.get()); cur_node != nullptr;
-       cur_node = cur_node->next) {
-    if (cur_node->type == XML_ELEMENT_NODE) {
-      if(strcmp(reinterpret_cast<const char *>(cur_node->name), "diff") == 0) {
-        xmlString str(xmlGetProp(cur_node, BAD_CAST "name"));
-        if(!str.empty()) {
-          const char *cstr = str;
-          printf("diff for project %s\n", cstr);
-          if(unlikely(name != cstr)) {
-            warning_dlg(trstring("Diff name (%1) does not match project name (%2)").arg(cstr).arg(name));
-            res |= DIFF_PROJECT_MISMATCH;
-          }
-        }
-
-        for(xmlNodePtr node_node = cur_node->children; node_node != nullptr;
-            node_node = node_node->next) {
-          if(node_node->type == XML_ELEMENT_NODE) {
-            if(strcmp(reinterpret_cast<const char *>(node_node->name), node_t::api_string()) == 0)
-              diff_restore_node(node_node, osm, replaced_nodes);
+  int ret;
+  do {
+    if(xmlTextReaderNodeType(reader.get()) != XML_READER_TYPE_ELEMENT)
+      continue;
 
-            else if(strcmp(reinterpret_cast<const char *>(node_node->name), way_t::api_string()) == 0)
-              diff_restore_way(node_node, osm, &replaced_nodes, replaced_ways);
+    if(unlikely(strcmp(reinterpret_cast<const char *>(xmlTextReaderConstName(reader.get())), "diff") != 0)) {
+      xml_skip_element(reader.get());
+      continue;
+    }
 
-            else if(likely(strcmp(reinterpret_cast<const char *>(node_node->name), relation_t::api_string()) == 0))
-              diff_restore_relation(node_node, osm, &replaced_nodes, &replaced_ways);
+    xmlString str(xmlTextReaderGetAttribute(reader.get(), BAD_CAST "name"));
+    if(!str.empty()) {
+      const char *cstr = str;
+      OSM2GO_LOG(Diff, Debug, "diff for project %s", cstr);
+      if(unlikely(name != cstr)) {
+        trstring msg = trstring("Diff name (%1) does not match project name (%2)").arg(cstr).arg(name);
+        if(message != nullptr)
+          message->swap(msg);
+        else
+          warning_dlg(msg);
+        res |= DIFF_PROJECT_MISMATCH;
+      }
+    }
 
-            else {
-	      printf("WARNING: item %s not restored\n", node_node->name);
-              res |= DIFF_ELEMENTS_IGNORED;
-            }
-	  }
-	}
+    if(xmlTextReaderIsEmptyElement(reader.get()))
+      continue;
+
+    const int depth = xmlTextReaderDepth(reader.get());
+    ret = xmlTextReaderRead(reader.get());
+    while(ret == 1 &&
+          (xmlTextReaderNodeType(reader.get()) != XML_READER_TYPE_END_ELEMENT ||
+           xmlTextReaderDepth(reader.get()) != depth)) {
+      if(xmlTextReaderNodeType(reader.get()) == XML_READER_TYPE_ELEMENT) {
+        const char *subname = reinterpret_cast<const char *>(xmlTextReaderConstName(reader.get()));
+        if(strcmp(subname, node_t::api_string()) == 0)
+          diff_restore_node(reader.get(), osm, replaced_nodes, projector);
+        else if(strcmp(subname, way_t::api_string()) == 0) {
+          projector.flush();
+          diff_restore_way(reader.get(), osm, &replaced_nodes, replaced_ways);
+        } else if(likely(strcmp(subname, relation_t::api_string()) == 0)) {
+          projector.flush();
+          diff_restore_relation(reader.get(), osm, &replaced_nodes, &replaced_ways);
+        } else {
+          OSM2GO_LOG(Diff, Warning, "item %s not restored", subname);
+          res |= DIFF_ELEMENTS_IGNORED;
+          xml_skip_element(reader.get());
+        }
       }
+      ret = xmlTextReaderRead(reader.get());
+    }
+  } while((ret = xmlTextReaderRead(reader.get())) == 1);
+
+  projector.flush();
+
+  /* everything before the error has already been applied, keep it */
+  if(unlikely(ret < 0)) {
+    OSM2GO_LOG(Diff, Warning, "diff %s is damaged, it has only partly been restored", diff_name.c_str());
+    res |= DIFF_ELEMENTS_IGNORED;
+    // a mismatching project name is the more important hint
+    if(!(res & DIFF_PROJECT_MISMATCH)) {
+      trstring msg = trstring("The diff file %1 is damaged, only the changes before the damage have been restored").arg(diff_name);
+      if(message != nullptr)
+        message->swap(msg);
+      else
+        warning_dlg(msg);
     }
   }
 
@@ -576,9 +820,20 @@ unsigned int project_t::diff_restore()
 
 void diff_restore(project_t::ref project, MainUi *uicontrol) {
   assert(project->osm);
-  unsigned int flags = project->diff_restore();
+  diff_restore_notify(project->diff_restore(), uicontrol);
+}
+
+void diff_restore_notify(unsigned int flags, MainUi *uicontrol, const trstring &message)
+{
+  if(unlikely(!message.isEmpty())) {
+    if(flags & DIFF_INVALID)
+      error_dlg(message);
+    else
+      warning_dlg(message);
+  }
+
   if(flags & DIFF_HAS_HIDDEN) {
-    printf("hidden flags have been restored, enable show_add menu\n");
+    OSM2GO_LOG(Diff, Debug, "hidden flags have been restored, enable show_add menu");
 
     uicontrol->showNotification(_("Some objects are hidden"), MainUi::Highlight);
     uicontrol->setActionEnable(MainUi::MENU_ITEM_MAP_SHOW_ALL, true);
@@ -626,6 +881,9 @@ bool project_t::diff_file_present() const
 }
 
 void project_t::diff_remove_file() const {
+  /* make sure no pending snapshot brings the file back */
+  std::lock_guard<std::mutex> lock(diffState->mutex);
+  diffState->written = ++diffState->generation;
   unlinkat(dirfd, diff_filename(this).c_str(), 0);
 }
 
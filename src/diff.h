@@ -6,10 +6,14 @@
 
 #pragma once
 
+#include "fdguard.h"
 #include "osm.h"
 #include "project.h"
 
 #include <libxml/tree.h>
+#include <memory>
+#include <mutex>
+#include <string>
 
 #include <osm2go_platform.h>
 
@@ -26,6 +30,64 @@ enum diff_restore_results {
 
 void diff_restore(project_t::ref project, MainUi *uicontrol);
 
+/**
+ * @brief update the user interface for the result of project_t::diff_restore()
+ * @param flags the diff_restore_results returned by the restore
+ * @param message the problem stored by the restore, if any
+ *
+ * This allows the diff to be restored in a background thread.
+ */
+void diff_restore_notify(unsigned int flags, MainUi *uicontrol,
+                         const trstring &message = trstring());
+
+/**
+ * @brief the synchronization state of the diff file of a project
+ *
+ * Every snapshot gets a new generation number when it is created. A snapshot
+ * is only written if no newer one has reached the disk before, so a delayed
+ * background write never overwrites more recent changes.
+ */
+struct diff_file_state {
+  inline diff_file_state() noexcept : generation(0), written(0) {}
+
+  std::mutex mutex;         ///< serializes all modifications of the diff file
+  unsigned int generation;  ///< the last generation handed out, only used from the main thread
+  unsigned int written;     ///< the generation of the file on disk, protected by mutex
+};
+
+/**
+ * @brief the changes of a project serialized in memory
+ *
+ * The snapshot does not reference the project or the OSM data, so it can be
+ * written to disk from any thread while editing goes on.
+ */
+class diff_snapshot {
+  friend struct project_t;
+
+  diff_snapshot(const project_t *project, xmlBufferPtr buf);
+
+  const std::shared_ptr<diff_file_state> state;
+  const unsigned int generation;
+  fdguard dirfd;            ///< a private copy of the project directory descriptor
+  const std::string diff_name;
+  xmlBufferPtr buffer;      ///< the contents, nullptr if the diff file should be removed
+
+public:
+  diff_snapshot() = delete;
+  diff_snapshot(const diff_snapshot &) = delete;
+  diff_snapshot &operator=(const diff_snapshot &) = delete;
+  ~diff_snapshot();
+
+  /**
+   * @brief write the contents to the diff file
+   * @returns if the diff file on disk matches this snapshot
+   *
+   * The data is synced to disk before the old diff file is replaced. If a
+   * newer snapshot has been written in the mean time nothing is done.
+   */
+  bool write();
+};
+
 /**
  * @brief move the diff from one project to another
  * @param oldproj the source project
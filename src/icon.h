@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <string>
 
 class icon_item {
@@ -33,4 +34,9 @@ public:
   icon_item *load(const std::string &sname, int limit = -1);
 
   void icon_free(icon_item *buf);
+
+  /**
+   * @brief the memory used by the pixel data of the cached icons
+   */
+  size_t memory_size() const;
 };
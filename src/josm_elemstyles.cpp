@@ -16,6 +16,7 @@
 #include "josm_presets.h"
 #include "map.h"
 #include "misc.h"
+#include "perf_trace.h"
 #include "SaxParser.h"
 #include "style.h"
 
@@ -32,6 +33,7 @@
 
 #include "osm2go_annotations.h"
 #include <osm2go_cpp.h>
+#include <osm2go_log.h>
 #include <osm2go_platform.h>
 #include "osm2go_stl.h"
 
@@ -149,7 +151,7 @@ parse_color(const char *col, color_t &color, ColorMap &colors)
     const ColorMap::const_iterator it = colors.find(colname);
     if(it == colors.end()) {
       if(unlikely(!hash)) {
-        printf("found invalid colour name reference '%s'\n", col);
+        OSM2GO_LOG(Style, Warning, "found invalid colour name reference '%s'", col);
       } else {
         colors[colname] = color;
       }
@@ -259,7 +261,7 @@ void StyleSax::characters(const char *ch, int len)
   default:
     for(int pos = 0; pos < len; pos++)
       if(!isspace(ch[pos])) {
-        printf("unhandled character data: %*.*s state %i\n", len, len, ch, state);
+        OSM2GO_LOG(Style, Warning, "unhandled character data: %*.*s state %i", len, len, ch, state);
         break;
       }
   }
@@ -280,7 +282,7 @@ parse_width_mod(const char *mod_str, elemstyle_width_mod_t &value)
       value.mod = ES_MOD_PERCENT;
       value.width = strtoul(mod_str, nullptr, 10);
     } else
-      printf("warning: unable to parse modifier %s\n", mod_str);
+      OSM2GO_LOG(Style, Warning, "unable to parse modifier %s", mod_str);
   }
 }
 
@@ -300,13 +302,13 @@ void StyleSax::startElement(const char *name, const char **attrs)
   StateMap::const_iterator it = std::find_if(tags.begin(), tags.end(), tag_find(name));
 
   if(unlikely(it == tags.end())) {
-    fprintf(stderr, "found unhandled element %s\n", name);
+    OSM2GO_LOG(Style, Warning, "found unhandled element %s", name);
     return;
   }
 
   if(unlikely(state != it->oldState)) {
-    fprintf(stderr, "found element %s in state %i, but expected %i\n",
-            name, state, it->oldState);
+    OSM2GO_LOG(Style, Warning, "found element %s in state %i, but expected %i",
+               name, state, it->oldState);
     return;
   }
 
@@ -337,11 +339,11 @@ void StyleSax::startElement(const char *name, const char **attrs)
       }
     }
     if(unlikely(k == nullptr)) {
-      printf("WARNING: found condition without k(ey) attribute\n");
+      OSM2GO_LOG(Style, Warning, "found condition without k(ey) attribute");
       break;
     }
     if(unlikely(invert && v == nullptr)) {
-      printf("WARNING: found condition without v(alue) attribute, but with invert\n");
+      OSM2GO_LOG(Style, Warning, "found condition without v(alue) attribute, but with invert");
       break;
     }
 
@@ -393,7 +395,7 @@ void StyleSax::startElement(const char *name, const char **attrs)
           else
             line->dash_length_off = line->dash_length_on;
           if(unlikely(*end != '\0')) {
-            printf("WARNING: invalid value '%s' for dashed\n", dval);
+            OSM2GO_LOG(Style, Warning, "invalid value '%s' for dashed", dval);
             line->dash_length_on = 0;
             line->dash_length_off = 0;
           }
@@ -466,7 +468,7 @@ void StyleSax::endElement(const char *name)
   assert(state == it->newState);
 
   if(unlikely(state == TagRule && styles.back()->conditions.empty())) {
-    printf("Rule %zu has no conditions\n", styles.size());
+    OSM2GO_LOG(Style, Warning, "Rule %zu has no conditions", styles.size());
     delete styles.back();
     styles.pop_back();
   }
@@ -478,17 +480,17 @@ void StyleSax::endElement(const char *name)
 
 bool josm_elemstyle::load_elemstyles(const char *fname)
 {
-  printf("Loading JOSM elemstyles %s ...\n", fname);
+  OSM2GO_LOG(Style, Info, "Loading JOSM elemstyles %s ...", fname);
 
   const std::string &filename = find_file(fname);
   if(unlikely(filename.empty())) {
-    printf("elemstyle file not found\n");
+    OSM2GO_LOG(Style, Warning, "elemstyle file not found");
     return false;
   }
 
   StyleSax sx;
   if(unlikely(!sx.parse(filename))) {
-    fprintf(stderr, "error parsing elemstyles\n");
+    OSM2GO_LOG(Style, Error, "error parsing elemstyles");
     return false;
   } else {
     elemstyles.swap(sx.styles);
@@ -610,6 +612,7 @@ void colorize_node::operator()(const elemstyle_t *elemstyle)
 void
 josm_elemstyle::colorize(node_t *n) const
 {
+  PERF_SCOPE("colorize node");
   n->zoom_max = node.zoom_max;
 
   bool somematch = false;
@@ -727,6 +730,7 @@ void apply_condition::operator()(const elemstyle_t* elemstyle)
 
 void josm_elemstyle::colorize(way_t *w) const
 {
+  PERF_SCOPE("colorize way");
   /* use dark grey/no stroke/not filled for everything unknown */
   w->draw.color = way.color;
   w->draw.width = way.width;
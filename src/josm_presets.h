@@ -24,6 +24,11 @@ public:
    * @brief collect the roles suggested by presets for the given object in the given relation
    */
   virtual std::set<std::string> roles(const relation_t *relation, const object_t &obj) const = 0;
+
+  /**
+   * @brief the memory used by the loaded presets
+   */
+  virtual size_t memory_size() const = 0;
 };
 
 std::string josm_icon_name_adjust(const char *name) __attribute__((nonnull(1)));
@@ -407,6 +407,8 @@ public:
 
   std::set<std::string> roles(const relation_t *relation, const object_t &obj) const override;
 
+  size_t memory_size() const override;
+
   void lru_update(const presets_item_t *item);
 };
 
@@ -6,6 +6,7 @@
 
 #include "josm_presets_p.h"
 
+#include "memory_usage.h"
 #include "SaxParser.h"
 
 #include <algorithm>
@@ -27,6 +28,7 @@
 #include <unordered_map>
 
 #include "osm2go_annotations.h"
+#include <osm2go_log.h>
 #include <osm2go_platform.h>
 #include "osm2go_stl.h"
 
@@ -105,7 +107,7 @@ josm_type_bit(const char *type, char sep)
     return it->first;
 
   // This prints the remaining string even if a separator follows. Who cares.
-  printf("WARNING: unexpected type %s\n", type);
+  OSM2GO_LOG(Presets, Warning, "unexpected type %s", type);
   return 0;
 }
 
@@ -316,34 +318,49 @@ struct name_find {
   }
 };
 
+class dump_tag {
+  std::string &path;
+public:
+  explicit inline dump_tag(std::string &p) : path(p) {}
+  void operator()(PresetSax::State st);
+};
+
 void
-dumpTag(PresetSax::State st)
+dump_tag::operator()(PresetSax::State st)
 {
   if(st == PresetSax::UnknownTag || st == PresetSax::IntermediateTag) {
-    printf("*/");
+    path += "*/";
   } else {
     const PresetSax::StateMap &tags = PresetSax::preset_state_map();
     const PresetSax::StateMap::const_iterator nitEnd = tags.end();
     const PresetSax::StateMap::const_iterator nit = std::find_if(tags.begin(), nitEnd, name_find(st));
     assert(nit != nitEnd);
-    printf("%s/", nit->name);
+    path += nit->name;
+    path += '/';
   }
 }
 
 void
 PresetSax::dumpState(const char *before, const char *after0, const char *after1) const
 {
-  if(before != nullptr)
-    printf("%s ", before);
-  std::for_each(std::next(state.begin()), state.end(), dumpTag);
+  // don't build the message if nobody will see it
+  if(!osm2go_log::enabled(osm2go_log::Presets, osm2go_log::Warning))
+    return;
+
+  std::string msg;
+  if(before != nullptr) {
+    msg = before;
+    msg += ' ';
+  }
+  std::for_each(std::next(state.begin()), state.end(), dump_tag(msg));
   if(after0 != nullptr) {
-    fputs(after0, stdout);
+    msg += after0;
     if(after1 != nullptr)
-      fputs(after1, stdout);
+      msg += after1;
   } else {
     assert_null(after1);
   }
-  puts("");
+  OSM2GO_LOG(Presets, Warning, "%s", msg.c_str());
 }
 
 /**
@@ -421,7 +438,7 @@ bool find_link_parent::operator()(presets_item_t *t)
 void PresetSax::find_link_ref::operator()(PresetSax::LLinks::value_type &l)
 {
   if(unlikely(!px.resolvePresetLink(l.first, l.second))) {
-    printf("found preset_link with unmatched preset_name '%s'\n", l.second.c_str());
+    OSM2GO_LOG(Presets, Warning, "found preset_link with unmatched preset_name '%s'", l.second.c_str());
     // delete the link widget everywhere it was inserted
     find_link_parent fc(l.first);
     const std::vector<presets_item_t *>::const_iterator itEnd = px.presets.items.end();
@@ -457,7 +474,7 @@ void PresetSax::characters(const char *ch, int len)
 {
   for(int pos = 0; pos < len; pos++)
     if(unlikely(!isspace(ch[pos]))) {
-      printf("unhandled character data: %*.*s state %i\n", len, len, ch, state.back());
+      OSM2GO_LOG(Presets, Warning, "unhandled character data: %*.*s state %i", len, len, ch, state.back());
       return;
     }
 }
@@ -1128,7 +1145,7 @@ chunkFromPair(const ChunkMap::value_type &p)
 
 bool presets_items_internal::addFile(const std::string &filename, const std::string &basepath, int basefd)
 {
-  printf("... %s\n", filename.c_str());
+  OSM2GO_LOG(Presets, Info, "... %s", filename.c_str());
 
   PresetSax p(*this, basepath, basefd);
   if(!p.parse(filename))
@@ -1160,7 +1177,7 @@ void presets_items_internal::lru_update(const presets_item_t *item)
 
 presets_items *presets_items::load()
 {
-  printf("Loading JOSM presets ...\n");
+  OSM2GO_LOG(Presets, Info, "Loading JOSM presets ...");
 
   std::unique_ptr<presets_items_internal> presets(std::make_unique<presets_items_internal>());
 
@@ -1313,13 +1330,13 @@ presets_element_selectable::presets_element_selectable(presets_element_type_t t,
     const size_t vsz = values.size();
     // catch mismatches of the array sizes
     if (unlikely(dsz < vsz)) {
-      printf("WARNING: got %zu values, but %zu display_values, filling with values\n", vsz, dsz);
+      OSM2GO_LOG(Presets, Warning, "got %zu values, but %zu display_values, filling with values", vsz, dsz);
       // simply use the values as display_values as it would have happened on empty display_values list
       while (dsz < vsz)
         display_values.push_back(values[dsz++]);
     } else if (unlikely(dsz > vsz)) {
       // drop the superfluous values at the back
-      printf("WARNING: got %zu values, but %zu display_values, truncating\n", vsz, dsz);
+      OSM2GO_LOG(Presets, Warning, "got %zu values, but %zu display_values, truncating", vsz, dsz);
       display_values.resize(vsz);
     }
   }
@@ -1435,3 +1452,82 @@ presets_items_internal::~presets_items_internal()
   std::for_each(items.begin(), items.end(), std::default_delete<presets_item_t>());
   std::for_each(chunks.begin(), chunks.end(), std::default_delete<presets_item_t>());
 }
+
+namespace {
+
+size_t strings_memory(const std::vector<std::string> &strings)
+{
+  size_t ret = memory_usage::heap(strings);
+  for(size_t i = 0; i < strings.size(); i++)
+    ret += memory_usage::heap(strings[i]);
+  return ret;
+}
+
+size_t roles_memory(const std::vector<presets_item::role> &roles)
+{
+  size_t ret = memory_usage::heap(roles);
+  for(size_t i = 0; i < roles.size(); i++)
+    ret += memory_usage::heap(roles[i].name);
+  return ret;
+}
+
+size_t selectable_memory(const presets_element_selectable *sel)
+{
+  return memory_usage::heap(sel->def) + strings_memory(sel->values) + strings_memory(sel->display_values);
+}
+
+size_t element_memory(size_t sum, const presets_element_t *w)
+{
+  sum += memory_usage::heap(w->key) + memory_usage::heap(w->text);
+
+  switch(w->type) {
+  case WIDGET_TYPE_COMBO:
+    return sum + sizeof(presets_element_combo) + selectable_memory(static_cast<const presets_element_selectable *>(w));
+  case WIDGET_TYPE_MULTISELECT:
+    return sum + sizeof(presets_element_multiselect) + selectable_memory(static_cast<const presets_element_selectable *>(w));
+  case WIDGET_TYPE_CHUNK_LIST_ENTRIES:
+    return sum + sizeof(presets_element_list_entry_chunks) + selectable_memory(static_cast<const presets_element_selectable *>(w));
+  case WIDGET_TYPE_CHUNK_ROLE_ENTRIES: {
+    const presets_element_role_entry_chunks *re = static_cast<const presets_element_role_entry_chunks *>(w);
+    return sum + sizeof(*re) + selectable_memory(re) + roles_memory(re->roles);
+  }
+  case WIDGET_TYPE_TEXT:
+    return sum + sizeof(presets_element_text) + memory_usage::heap(static_cast<const presets_element_text *>(w)->def);
+  case WIDGET_TYPE_KEY:
+    return sum + sizeof(presets_element_key) + memory_usage::heap(static_cast<const presets_element_key *>(w)->value);
+  case WIDGET_TYPE_CHECK:
+    return sum + sizeof(presets_element_checkbox) + memory_usage::heap(static_cast<const presets_element_checkbox *>(w)->value_on);
+  case WIDGET_TYPE_LINK:
+    return sum + sizeof(presets_element_link);
+  case WIDGET_TYPE_REFERENCE:
+    return sum + sizeof(presets_element_reference);
+  default:
+    return sum + sizeof(presets_element_t);
+  }
+}
+
+size_t item_memory(size_t sum, const presets_item_t *item)
+{
+  if(item->isItem()) {
+    const presets_item *it = static_cast<const presets_item *>(item);
+    sum += sizeof(*it) + memory_usage::heap(it->name) + memory_usage::heap(it->icon) +
+           memory_usage::heap(it->widgets) + roles_memory(it->roles) + memory_usage::heap(it->link);
+    return std::accumulate(it->widgets.begin(), it->widgets.end(), sum, element_memory);
+  } else if(item->type & presets_item_t::TY_GROUP) {
+    const presets_item_group *gr = static_cast<const presets_item_group *>(item);
+    sum += sizeof(*gr) + memory_usage::heap(gr->name) + memory_usage::heap(gr->icon) +
+           memory_usage::heap(gr->items);
+    return std::accumulate(gr->items.begin(), gr->items.end(), sum, item_memory);
+  } else {
+    return sum + sizeof(presets_item_separator);
+  }
+}
+
+} // namespace
+
+size_t presets_items_internal::memory_size() const
+{
+  size_t ret = sizeof(*this) + memory_usage::heap(items) + memory_usage::heap(chunks) + memory_usage::heap(lru);
+  ret = std::accumulate(items.begin(), items.end(), ret, item_memory);
+  return std::accumulate(chunks.begin(), chunks.end(), ret, item_memory);
+}
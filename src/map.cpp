@@ -12,12 +12,15 @@
 #include "gps_state.h"
 #include "iconbar.h"
 #include "map_hl.h"
+#include "memory_usage.h"
 #include "notifications.h"
 #include "object_dialogs.h"
+#include "perf_trace.h"
 #include "project.h"
 #include "style.h"
 #include "track.h"
 #include "uicontrol.h"
+#include "wms.h"
 
 #include <algorithm>
 #include <cassert>
@@ -26,12 +29,16 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <limits>
+#include <map>
 #include <memory>
+#include <unordered_set>
 #include <vector>
 
 #include "osm2go_annotations.h"
 #include <osm2go_cpp.h>
 #include <osm2go_i18n.h>
+#include <osm2go_log.h>
 #include <osm2go_platform.h>
 #include <osm2go_stl.h>
 
@@ -44,8 +51,15 @@ struct map_bg_modifier {
   {
     map->background_items[way] = item;
   }
+  static map_item_t *find(map_t *map, way_t *way);
 };
 
+map_item_t *map_bg_modifier::find(map_t *map, way_t *way)
+{
+  std::unordered_map<visible_item_t *, map_item_t *>::const_iterator it = map->background_items.find(way);
+  return it == map->background_items.end() ? nullptr : it->second;
+}
+
 void map_bg_modifier::remove(map_t *map, visible_item_t *way)
 {
   std::unordered_map<visible_item_t *, map_item_t *>::iterator it = map->background_items.find(way);
@@ -60,7 +74,7 @@ static void map_statusbar(const std::unique_ptr<MainUi> &uicontrol, const object
                           osm_t::ref osm) {
   MainUi::NotificationFlags flags = static_cast<base_object_t *>(object)->tags.hasTagCollisions() ?
                                     MainUi::Highlight : MainUi::NoFlags;
-  uicontrol->showNotification(object.get_name(*osm), flags);
+  uicontrol->showNotification(osm->objectName(object), flags);
 }
 
 void map_t::outside_error() {
@@ -154,24 +168,28 @@ points_from_node_chain(const way_t *way)
   return points;
 }
 
+/**
+ * @brief collects the arrows and node markers of a selected way
+ *
+ * They are drawn afterwards as one canvas item each, as long ways would
+ * otherwise need thousands of items.
+ */
 class draw_selected_way_functor {
   node_t *last;
   const float arrow_width;
-  map_t * const map;
-  way_t * const way;
-  const float radius;
+  const map_t * const map;
+  std::unordered_set<node_t *> marked;
 public:
-  draw_selected_way_functor(float a, map_t *m, way_t *w)
-    : last(nullptr), arrow_width(a), map(m), way(w)
-    , radius(map->style->node.radius * map->appdata.project->map_state.detail) {}
+  std::vector<std::vector<lpos_t> > arrows;
+  std::vector<node_t *> nodes;
+
+  draw_selected_way_functor(float a, const map_t *m)
+    : last(nullptr), arrow_width(a), map(m) {}
   void operator()(node_t *node);
 };
 
 void draw_selected_way_functor::operator()(node_t *node)
 {
-  map_item_t item;
-  item.object = node;
-
   /* draw an arrow between every two nodes */
   if(last != nullptr) {
     struct { float x, y; } diff;
@@ -194,16 +212,13 @@ void draw_selected_way_functor::operator()(node_t *node)
       points[1] = lpos_t(center.x + diff.y - diff.x, center.y - diff.x - diff.y);
       points[2] = lpos_t(center.x - diff.y - diff.x, center.y + diff.x - diff.y);
 
-      map->highlight.polygon_new(map, CANVAS_GROUP_WAYS_DIR, way,
-                                 points, map->style->highlight.arrow_color);
+      arrows.push_back(points);
     }
   }
 
-  if(!map->highlight.isHighlighted(item)) {
-    /* create a new map item for every node */
-    map->highlight.circle_new(map, CANVAS_GROUP_NODES_IHL, node, radius,
-                              map->style->highlight.node_color);
-  }
+  /* mark every node only once, e.g. the first and last of closed ways are identical */
+  if(marked.insert(node).second)
+    nodes.push_back(node);
 
   last = node;
 }
@@ -224,8 +239,16 @@ void map_t::select_way(way_t *way) {
                             appdata.project->map_state.detail;
 
   const node_chain_t &node_chain = way->node_chain;
-  std::for_each(node_chain.begin(), node_chain.end(),
-                draw_selected_way_functor(arrow_width, this, way));
+  const draw_selected_way_functor fc = std::for_each(node_chain.begin(), node_chain.end(),
+                                                     draw_selected_way_functor(arrow_width, this));
+
+  if(!fc.arrows.empty())
+    highlight.items.push_back(canvas->polygons_new(CANVAS_GROUP_WAYS_DIR, fc.arrows,
+                                                   style->highlight.arrow_color));
+  if(!fc.nodes.empty())
+    highlight.markers_new(this, CANVAS_GROUP_NODES_IHL, way, fc.nodes,
+                          style->node.radius * appdata.project->map_state.detail,
+                          style->highlight.node_color);
 
   /* a way needs at least 2 points to be drawn */
   assert(selected.object.operator==(way));
@@ -235,25 +258,31 @@ void map_t::select_way(way_t *way) {
     highlight.polyline_new(this, CANVAS_GROUP_WAYS_HL, way, points, style->highlight.color);
 }
 
+/**
+ * @brief collects the highlight shapes of all relation members
+ *
+ * All members of the same kind are drawn as a single canvas item, lines only
+ * need separate items for different widths.
+ */
 class relation_select_functor {
-  map_t * const map;
+  const map_t * const map;
 public:
-  explicit inline relation_select_functor(map_t *m) : map(m) {}
-  void operator()(member_t &member);
+  std::vector<node_t *> nodes;
+  std::vector<std::vector<lpos_t> > areas;
+  std::map<float, std::vector<std::vector<lpos_t> > > lines; ///< by line width
+
+  explicit inline relation_select_functor(const map_t *m) : map(m) {}
+  void operator()(const member_t &member);
 };
 
-void relation_select_functor::operator()(member_t& member)
+void relation_select_functor::operator()(const member_t &member)
 {
-  canvas_item_t *item = nullptr;
-
   switch(member.object.type) {
   case object_t::NODE: {
     node_t *node = static_cast<node_t *>(member.object);
-    printf("  -> node " ITEM_ID_FORMAT "\n", node->id);
+    OSM2GO_LOG(Map, Trace, "  -> node " ITEM_ID_FORMAT, node->id);
 
-    item = map->canvas->circle_new(CANVAS_GROUP_NODES_HL, node->lpos,
-                             map->style->highlight.width + map->style->node.radius,
-                             0, map->style->highlight.color);
+    nodes.push_back(node);
     break;
     }
   case object_t::WAY: {
@@ -262,12 +291,10 @@ void relation_select_functor::operator()(member_t& member)
     const std::vector<lpos_t> &points = points_from_node_chain(way);
     if(likely(!points.empty())) {
       if(way->draw.flags & OSM_DRAW_FLAG_AREA) {
-        item = map->canvas->polygon_new(CANVAS_GROUP_WAYS_HL, points, 0, 0,
-                                  map->style->highlight.color);
+        areas.push_back(points);
       } else {
         const float hwdth = way->draw.drawWidth() + 2 * map->style->highlight.width;
-        item = map->canvas->polyline_new(CANVAS_GROUP_WAYS_HL, points, hwdth,
-                                   map->style->highlight.color);
+        lines[hwdth].push_back(points);
       }
     }
     break;
@@ -276,15 +303,11 @@ void relation_select_functor::operator()(member_t& member)
   default:
     break;
   }
-
-  /* attach item to item chain */
-  if(item != nullptr)
-    map->highlight.items.push_back(item);
 }
 
 
 void map_t::select_relation(relation_t *relation) {
-  printf("highlighting relation " ITEM_ID_FORMAT "\n", relation->id);
+  OSM2GO_LOG(Map, Debug, "highlighting relation " ITEM_ID_FORMAT, relation->id);
 
   assert(highlight.isEmpty());
 
@@ -295,8 +318,18 @@ void map_t::select_relation(relation_t *relation) {
   appdata.iconbar->map_item_selected(selected.object);
 
   /* process all members */
-  relation_select_functor fc(this);
-  std::for_each(relation->members.begin(), relation->members.end(), fc);
+  const relation_select_functor fc = std::for_each(relation->members.cbegin(), relation->members.cend(),
+                                                   relation_select_functor(this));
+
+  const color_t color = style->highlight.color;
+  if(!fc.areas.empty())
+    highlight.items.push_back(canvas->polygons_new(CANVAS_GROUP_WAYS_HL, fc.areas, color));
+  for(std::map<float, std::vector<std::vector<lpos_t> > >::const_iterator it = fc.lines.begin();
+      it != fc.lines.end(); it++)
+    highlight.items.push_back(canvas->polylines_new(CANVAS_GROUP_WAYS_HL, it->second, it->first, color));
+  if(!fc.nodes.empty())
+    highlight.markers_new(this, CANVAS_GROUP_NODES_HL, nullptr, fc.nodes,
+                          style->highlight.width + style->node.radius, color);
 }
 
 static inline void map_object_select(map_t *map, way_t *way)
@@ -345,55 +378,92 @@ void map_t::item_deselect() {
   selected.object.type = object_t::ILLEGAL;
 }
 
+/**
+ * @brief check if the existing canvas item of an object can be updated in place
+ *
+ * The group is part of the check as the items of some groups are stored in
+ * the platform canvas in a way that does not allow moving them.
+ */
+static inline bool
+map_item_reusable(const map_item_t *map_item, map_item_t::Shape shape, canvas_group_t group)
+{
+  return map_item != nullptr && map_item->shape == shape && map_item->group == group;
+}
+
 static void
 map_node_new(map_t *map, node_t *node, float radius, int width, color_t fill, color_t border)
 {
-  map_item_t *map_item = new map_item_t(object_t(node));
-
   style_t::IconCache::const_iterator it;
 
   const float detail = map->appdata.project->map_state.detail;
-  if(!map->style->icon.enable ||
-     (it = map->style->node_icons.find(node->id)) == map->style->node_icons.end())
-    map_item->item = map->canvas->circle_new(CANVAS_GROUP_NODES, node->lpos,
-       radius, width, fill, border);
-  else
-    map_item->item = map->canvas->image_new(CANVAS_GROUP_NODES, it->second, node->lpos,
-                                            detail * map->style->icon.scale);
+  const bool icon = map->style->icon.enable &&
+                    (it = map->style->node_icons.find(node->id)) != map->style->node_icons.end();
 
-  map_item->item->set_zoom_max(node->zoom_max / (2 * detail));
+  map_item_t *map_item = node->map_item;
+  if(!icon && map_item_reusable(map_item, map_item_t::Circle, CANVAS_GROUP_NODES)) {
+    map->canvas->circle_update(static_cast<canvas_item_circle *>(map_item->item), node->lpos,
+                               radius, width, fill, border);
+  } else {
+    if(!icon) {
+      map_item = new map_item_t(object_t(node),
+                                map->canvas->circle_new(CANVAS_GROUP_NODES, node->lpos,
+                                                        radius, width, fill, border),
+                                map_item_t::Circle, CANVAS_GROUP_NODES);
+    } else {
+      map_item = new map_item_t(object_t(node),
+                                map->canvas->image_new(CANVAS_GROUP_NODES, it->second, node->lpos,
+                                                       detail * map->style->icon.scale),
+                                map_item_t::Icon, CANVAS_GROUP_NODES);
+    }
 
-  /* attach map_item to nodes map_item_chain */
-  if(node->map_item != nullptr)
-    delete node->map_item->item;
-  node->map_item = map_item;
+    /* attach map_item to nodes map_item_chain */
+    if(node->map_item != nullptr)
+      delete node->map_item->item;
+    node->map_item = map_item;
 
-  map_item->item->set_user_data(map_item);
+    map_item->item->set_user_data(map_item);
+  }
+
+  map_item->item->set_zoom_max(node->zoom_max / (2 * detail));
 }
 
-static map_item_t *map_way_new(map_t *map, canvas_group_t group,
+/**
+ * @brief draw the way into the given group
+ * @param old the previous item of the way in this role, may be nullptr
+ *
+ * The old item is updated in place if possible, otherwise it is destroyed.
+ */
+static map_item_t *map_way_new(map_t *map, map_item_t *old, canvas_group_t group,
                                way_t *way, const std::vector<lpos_t> &points, float width,
                                color_t color, color_t fill_color)
 {
-  map_item_t *map_item = new map_item_t(object_t(way));
+  const map_item_t::Shape shape = (way->draw.flags & OSM_DRAW_FLAG_AREA) &&
+                                  !map->style->area.color.is_transparent() ?
+                                  map_item_t::Polygon : map_item_t::Polyline;
+
+  map_item_t *map_item;
+  if(map_item_reusable(old, shape, group)) {
+    map_item = old;
+    map->canvas->poly_update(map_item->item, points, width, color, fill_color);
+  } else {
+    if(old != nullptr)
+      delete old->item;
 
-  if(way->draw.flags & OSM_DRAW_FLAG_AREA) {
-    if(!map->style->area.color.is_transparent())
+    map_item = new map_item_t(object_t(way), nullptr, shape, group);
+    if(shape == map_item_t::Polygon)
       map_item->item = map->canvas->polygon_new(group, points, width, color, fill_color);
     else
       map_item->item = map->canvas->polyline_new(group, points, width, color);
-  } else {
-    map_item->item = map->canvas->polyline_new(group, points, width, color);
+
+    map_item->item->set_user_data(map_item);
   }
 
   map_item->item->set_zoom_max(way->zoom_max / (2 * map->appdata.project->map_state.detail));
 
-  /* a ways outline itself is never dashed */
-  if (group != CANVAS_GROUP_WAYS_OL && way->draw.dash_length_on > 0)
+  /* a ways outline itself is never dashed, a reused item may need to become solid again */
+  if (group != CANVAS_GROUP_WAYS_OL && (way->draw.dash_length_on > 0 || map_item == old))
     map_item->item->set_dashed(width, way->draw.dash_length_on, way->draw.dash_length_off);
 
-  map_item->item->set_user_data(map_item);
-
   return map_item;
 }
 
@@ -411,18 +481,10 @@ public:
 
 void map_way_draw_functor::operator()(way_t *way)
 {
-  /* don't draw a way that's not there anymore */
-  if(unlikely(way->isDeleted()))
-    return;
-
-  if(unlikely(map->appdata.project->osm->wayIsHidden(way)))
+  /* don't draw a way that's not there anymore, but remove a previous drawing */
+  if(unlikely(way->isDeleted() || map->appdata.project->osm->wayIsHidden(way))) {
+    way->item_chain_destroy(map);
     return;
-
-  /* attach map_item to ways map_item_chain */
-  if(way->map_item != nullptr) {
-    delete way->map_item->item;
-    // no need to reset map_item, it will immediately be overwritten
-    map_bg_modifier::remove(map, way);
   }
 
   /* allocate space for nodes */
@@ -430,16 +492,27 @@ void map_way_draw_functor::operator()(way_t *way)
   const std::vector<lpos_t> &points = points_from_node_chain(way);
   if(unlikely(points.empty())) {
     /* draw a single dot where this single node is */
-    way->map_item = new map_item_t(object_t(way));
-
     assert(!way->node_chain.empty());
-    way->map_item->item = map->canvas->circle_new(CANVAS_GROUP_WAYS, way->node_chain.front()->lpos,
-                                             map->style->node.radius, 0,
-                                             map->style->node.color, 0);
+    map_bg_modifier::remove(map, way);
+
+    if(map_item_reusable(way->map_item, map_item_t::Circle, CANVAS_GROUP_WAYS)) {
+      map->canvas->circle_update(static_cast<canvas_item_circle *>(way->map_item->item),
+                                 way->first_node()->lpos, map->style->node.radius, 0,
+                                 map->style->node.color, 0);
+    } else {
+      if(way->map_item != nullptr)
+        delete way->map_item->item;
 
-    // TODO: decide: do we need canvas_item_t::set_zoom_max() here too?
+      way->map_item = new map_item_t(object_t(way),
+                                     map->canvas->circle_new(CANVAS_GROUP_WAYS, way->first_node()->lpos,
+                                                             map->style->node.radius, 0,
+                                                             map->style->node.color, 0),
+                                     map_item_t::Circle, CANVAS_GROUP_WAYS);
 
-    way->map_item->item->set_user_data(way->map_item);
+      // TODO: decide: do we need canvas_item_t::set_zoom_max() here too?
+
+      way->map_item->item->set_user_data(way->map_item);
+    }
   } else {
     /* draw way */
     const float detail = map->appdata.project->map_state.detail;
@@ -452,14 +525,18 @@ void map_way_draw_functor::operator()(way_t *way)
       areacol = way->draw.area.color;
     } else if(way->draw.flags & OSM_DRAW_FLAG_BG) {
       gr = CANVAS_GROUP_WAYS_INT;
-      map_bg_modifier::add(map, way, map_way_new(map, CANVAS_GROUP_WAYS_OL, way, points,
+      map_bg_modifier::add(map, way, map_way_new(map, map_bg_modifier::find(map, way),
+                                                 CANVAS_GROUP_WAYS_OL, way, points,
                                                  way->draw.bg.width * detail,
                                                  way->draw.bg.color, color_t::transparent()));
     } else {
       gr = CANVAS_GROUP_WAYS;
     }
 
-    way->map_item = map_way_new(map, gr, way, points, width, way->draw.color, areacol);
+    if(gr != CANVAS_GROUP_WAYS_INT)
+      map_bg_modifier::remove(map, way);
+
+    way->map_item = map_way_new(map, way->map_item, gr, way, points, width, way->draw.color, areacol);
   }
 }
 
@@ -500,9 +577,11 @@ public:
 
 void map_node_draw_functor::operator()(node_t *node)
 {
-  /* don't draw a node that's not there anymore */
-  if(unlikely(node->isDeleted()))
+  /* don't draw a node that's not there anymore, but remove a previous drawing */
+  if(unlikely(node->isDeleted())) {
+    node->item_chain_destroy(map);
     return;
+  }
 
   int width;
   color_t fill, col;
@@ -515,6 +594,7 @@ void map_node_draw_functor::operator()(node_t *node)
     fill = map->style->node.color;
     col = 0;
   } else {
+    node->item_chain_destroy(map);
     return;
   }
 
@@ -538,8 +618,7 @@ void map_t::redraw_item(T *obj)
   if(is_selected)
     item_deselect();
 
-  obj->item_chain_destroy(this);
-
+  // the existing canvas items are updated in place where possible
   style->colorize(obj);
   draw(obj);
 
@@ -635,19 +714,28 @@ static void map_free_map_item_chains(appdata_t &appdata) {
 }
 
 map_item_t *
-map_t::item_at(canvas_item_t *item)
+map_t::item_at(canvas_item_t *item, lpos_t pos)
 {
   if(item == nullptr) {
-    printf("  there's no item\n");
+    OSM2GO_LOG(Map, Trace, "  there's no item");
     return nullptr;
   }
 
-  printf("  there's an item (%p)\n", item);
+  OSM2GO_LOG(Map, Trace, "  there's an item (%p)", item);
 
   map_item_t *map_item = item->get_user_data();
 
-  if(map_item == nullptr)
-    printf("  item has no user data!\n");
+  if(map_item == nullptr) {
+    OSM2GO_LOG(Map, Trace, "  item has no user data!");
+  } else if(map_item->shape == map_item_t::Markers) {
+    node_t *node = highlight.marker_at(canvas, item, pos);
+    if(node == nullptr)
+      return nullptr;
+
+    markerHit.object = node;
+    markerHit.item = item;
+    map_item = &markerHit;
+  }
 
   return map_item;
 }
@@ -655,13 +743,13 @@ map_t::item_at(canvas_item_t *item)
 /* get the item at position x, y */
 map_item_t *map_t::item_at(lpos_t pos)
 {
-  return item_at(canvas->get_item_at(pos));
+  return item_at(canvas->get_item_at(pos), pos);
 }
 
 /* get the real item (no highlight) at x, y */
-void map_t::pen_down_item(canvas_item_t *citem)
+void map_t::pen_down_item(canvas_item_t *citem, lpos_t pos)
 {
-  pen_down.on_item = item_at(citem);
+  pen_down.on_item = item_at(citem, pos);
 
   if(pen_down.on_item == nullptr)
     return;
@@ -671,10 +759,10 @@ void map_t::pen_down_item(canvas_item_t *citem)
 
   visible_item_t * const vis = static_cast<visible_item_t *>(static_cast<base_object_t *>(pen_down.on_item->object));
   if(vis->map_item != nullptr) {
-    printf("  using parent item %s #" ITEM_ID_FORMAT "\n", vis->apiString(), vis->id);
+    OSM2GO_LOG(Map, Trace, "  using parent item %s #" ITEM_ID_FORMAT, vis->apiString(), vis->id);
     pen_down.on_item = vis->map_item;
   } else {
-    printf("  no parent, working on highlight itself\n");
+    OSM2GO_LOG(Map, Trace, "  no parent, working on highlight itself");
   }
 }
 
@@ -686,12 +774,14 @@ void map_t::pen_down_item(canvas_item_t *citem)
 bool map_t::scroll_to_if_offscreen(lpos_t lpos) {
   // Ignore anything outside the working area
   if (!appdata.project->osm->bounds.contains(lpos)) {
-    printf("cannot scroll to (%d, %d): outside the working area\n", lpos.x, lpos.y);
+    OSM2GO_LOG(Map, Debug, "cannot scroll to (%d, %d): outside the working area", lpos.x, lpos.y);
     return false;
   }
 
-  if(!canvas->ensureVisible(lpos))
+  if(!canvas->ensureVisible(lpos)) {
     appdata.project->map_state.scroll_offset = canvas->scroll_get();
+    update_bg_tiles();
+  }
 
   return true;
 }
@@ -729,6 +819,8 @@ void map_t::set_zoom(double zoom, bool update_scroll_offsets) {
       gps_item->set_radius(radius);
     }
   }
+
+  update_bg_tiles();
 }
 
 static bool distance_above(const map_t *map, const osm2go_platform::screenpos &p, int limit) {
@@ -742,6 +834,7 @@ static bool distance_above(const map_t *map, const osm2go_platform::screenpos &p
 void map_t::scroll_step(const osm2go_platform::screenpos &p)
 {
   appdata.project->map_state.scroll_offset = canvas->scroll_step(p);
+  update_bg_tiles();
 }
 
 bool map_t::item_is_selected_node(const map_item_t *map_item) const
@@ -780,7 +873,7 @@ bool map_t::item_is_selected_way(const map_item_t *map_item) const
 void map_t::highlight_refresh() {
   object_t old = selected.object;
 
-  printf("type to refresh is %d\n", old.type);
+  OSM2GO_LOG(Map, Debug, "type to refresh is %d", old.type);
   if(old.type == object_t::ILLEGAL)
     return;
 
@@ -878,7 +971,7 @@ void map_t::touchnode_update(lpos_t pos) {
 
 void map_t::button_press(const osm2go_platform::screenpos &p)
 {
-  printf("left button pressed\n");
+  OSM2GO_LOG(Map, Trace, "left button pressed");
   pen_down.is = true;
 
   /* save press position */
@@ -887,7 +980,7 @@ void map_t::button_press(const osm2go_platform::screenpos &p)
 
   /* determine wether this press was on an item */
   lpos_t pos = canvas->window2world(p);
-  pen_down_item(canvas->get_item_at(pos));
+  pen_down_item(canvas->get_item_at(pos), pos);
 
   /* check if the clicked item is a highlighted node as the user */
   /* might want to drag that */
@@ -934,24 +1027,25 @@ void map_t::button_release(const osm2go_platform::screenpos &p)
       pen_down.drag = distance_above(this, p, MAP_DRAG_LIMIT);
 
     if(!pen_down.drag) {
-      printf("left button released after click\n");
+      OSM2GO_LOG(Map, Trace, "left button released after click");
 
       object_t old_sel = selected.object;
       map_handle_click(this);
 
       if(old_sel.type != object_t::ILLEGAL && old_sel == selected.object) {
-        printf("re-selected same item of type %u, pushing it to the bottom\n", old_sel.type);
+        OSM2GO_LOG(Map, Trace, "re-selected same item of type %u, pushing it to the bottom", old_sel.type);
         if(selected.item == nullptr) {
-          printf("  item has no visible representation to push\n");
+          OSM2GO_LOG(Map, Trace, "  item has no visible representation to push");
         } else {
           /* update clicked item, to correctly handle the click */
-          pen_down_item(canvas->get_next_item_at(canvas->window2world(pen_down.at), selected.item));
+          const lpos_t pos = canvas->window2world(pen_down.at);
+          pen_down_item(canvas->get_next_item_at(pos, selected.item), pos);
 
           map_handle_click(this);
         }
       }
     } else {
-      printf("left button released after drag\n");
+      OSM2GO_LOG(Map, Trace, "left button released after drag");
 
       /* just scroll if we didn't drag an selected item */
       if(!pen_down.on_selected_node) {
@@ -959,10 +1053,10 @@ void map_t::button_release(const osm2go_platform::screenpos &p)
         scroll_step(d);
       } else {
         if (pen_down.on_item->object.type != object_t::NODE) {
-          printf("ignoring bogus release event on item of type %i\n", pen_down.on_item->object.type);
+          OSM2GO_LOG(Map, Debug, "ignoring bogus release event on item of type %i", pen_down.on_item->object.type);
           return;
         }
-        printf("released after dragging node\n");
+        OSM2GO_LOG(Map, Trace, "released after dragging node");
         hl_cursor_clear();
 
         /* now actually move the node */
@@ -972,7 +1066,7 @@ void map_t::button_release(const osm2go_platform::screenpos &p)
     break;
 
   case MAP_ACTION_NODE_ADD: {
-    printf("released after NODE ADD\n");
+    OSM2GO_LOG(Map, Debug, "released after NODE ADD");
     hl_cursor_clear();
 
     /* convert mouse position to canvas (world) position */
@@ -1000,21 +1094,21 @@ void map_t::button_release(const osm2go_platform::screenpos &p)
     break;
   }
   case MAP_ACTION_WAY_ADD:
-    printf("released after WAY ADD\n");
+    OSM2GO_LOG(Map, Debug, "released after WAY ADD");
     hl_cursor_clear();
 
     way_add_segment(canvas->window2world(p));
     break;
 
   case MAP_ACTION_WAY_NODE_ADD:
-    printf("released after WAY NODE ADD\n");
+    OSM2GO_LOG(Map, Debug, "released after WAY NODE ADD");
     hl_cursor_clear();
 
     way_node_add(canvas->window2world(p));
     break;
 
   case MAP_ACTION_WAY_CUT:
-    printf("released after WAY CUT\n");
+    OSM2GO_LOG(Map, Debug, "released after WAY CUT");
     hl_cursor_clear();
 
     way_cut(canvas->window2world(p));
@@ -1118,8 +1212,66 @@ map_t::~map_t()
   appdata.map = nullptr;
 }
 
+namespace {
+
+inline bool
+map_in_area(const node_t *node, lpos_t min, lpos_t max)
+{
+  return node->lpos.x >= min.x && node->lpos.x <= max.x &&
+         node->lpos.y >= min.y && node->lpos.y <= max.y;
+}
+
+/**
+ * @brief check if the bounding box of the way intersects the area
+ */
+bool
+map_in_area(const way_t *way, lpos_t min, lpos_t max)
+{
+  const node_chain_t &chain = way->node_chain;
+  if(chain.empty())
+    return false;
+
+  lpos_t wmin = chain.front()->lpos;
+  lpos_t wmax = wmin;
+  for(node_chain_t::const_iterator it = chain.begin(); it != chain.end(); it++) {
+    const lpos_t p = (*it)->lpos;
+    if(map_in_area(*it, min, max))
+      return true;
+    wmin.x = std::min(wmin.x, p.x);
+    wmin.y = std::min(wmin.y, p.y);
+    wmax.x = std::max(wmax.x, p.x);
+    wmax.y = std::max(wmax.y, p.y);
+  }
+
+  return wmin.x <= max.x && wmax.x >= min.x && wmin.y <= max.y && wmax.y >= min.y;
+}
+
+/**
+ * @brief draws the objects inside of an area and remembers the others
+ */
+template<typename T, typename D>
+class map_area_draw_functor {
+  D draw;
+  const lpos_t min, max;
+  std::vector<item_id_t> &outside;
+public:
+  inline map_area_draw_functor(D d, lpos_t mn, lpos_t mx, std::vector<item_id_t> &o)
+    : draw(d), min(mn), max(mx), outside(o) {}
+  void operator()(std::pair<item_id_t, T *> pair)
+  {
+    if(map_in_area(pair.second, min, max))
+      draw(pair);
+    else
+      outside.push_back(pair.first);
+  }
+};
+
+} // namespace
+
 void map_t::init() {
-  const bounds_t &bounds = appdata.project->osm->bounds;
+  PERF_SCOPE("map_t::init");
+  osm_t::ref osm = appdata.project->osm;
+  const bounds_t &bounds = osm->bounds;
 
   /* update canvas background color */
   set_bg_color_from_style();
@@ -1129,16 +1281,78 @@ void map_t::init() {
 
   map_state_t &state = appdata.project->map_state;
   set_zoom(state.zoom, false);
-  paint();
 
-  printf("restore scroll position %f/%f\n",
-         state.scroll_offset.x(), state.scroll_offset.y());
+  OSM2GO_LOG(Map, Debug, "restore scroll position %f/%f",
+                         state.scroll_offset.x(), state.scroll_offset.y());
 
   state.scroll_offset = canvas->scroll_to(state.scroll_offset);
+
+  // draw what the user sees first, the rest is done by paint_remaining()
+  lpos_t vmin, vmax;
+  canvas->visible_area(vmin, vmax);
+
+  pendingWays.clear();
+  pendingNodes.clear();
+
+  std::for_each(osm->ways.begin(), osm->ways.end(),
+                map_area_draw_functor<way_t, map_way_draw_functor>(map_way_draw_functor(this, style.get()),
+                                                                   vmin, vmax, pendingWays));
+  std::for_each(osm->nodes.begin(), osm->nodes.end(),
+                map_area_draw_functor<node_t, map_node_draw_functor>(map_node_draw_functor(this, style.get()),
+                                                                     vmin, vmax, pendingNodes));
+
+  map_frisket_draw(this, bounds);
+
+  PERF_COUNT("map_t::init pending objects", pendingWays.size() + pendingNodes.size());
+  OSM2GO_LOG(Map, Debug, "%zu ways and %zu nodes are outside of the visible area",
+                         pendingWays.size(), pendingNodes.size());
+
+  // paint_remaining() takes them from the back
+  std::reverse(pendingWays.begin(), pendingWays.end());
+  std::reverse(pendingNodes.begin(), pendingNodes.end());
+}
+
+void map_t::paint_remaining() {
+  PERF_SCOPE("map_t::paint_remaining");
+
+  // small enough to keep the interface responsive, without one everything is drawn at once
+  const bool interactive = appdata_t::window != nullptr;
+  const size_t chunk = interactive ? 2000 : std::numeric_limits<size_t>::max();
+
+  // if the map is cleared while the events are processed the lists are emptied
+  while(!pendingWays.empty() || !pendingNodes.empty()) {
+    osm_t::ref osm = appdata.project->osm;
+
+    for(size_t i = 0; i < chunk && !pendingWays.empty(); i++) {
+      // objects may have been removed in the meantime
+      way_t *way = osm->object_by_id<way_t>(pendingWays.back());
+      pendingWays.pop_back();
+      if(likely(way != nullptr))
+        drawColorized(way);
+    }
+
+    // all ways are drawn before the nodes like paint() does
+    for(size_t i = 0; i < chunk && pendingWays.empty() && !pendingNodes.empty(); i++) {
+      node_t *node = osm->object_by_id<node_t>(pendingNodes.back());
+      pendingNodes.pop_back();
+      if(likely(node != nullptr)) {
+        style->colorize(node);
+        draw(node);
+      }
+    }
+
+    if(!interactive)
+      break;
+
+    // the application or the project may be closed while the events are processed
+    osm2go_platform::process_events();
+    if(unlikely(appdata_t::window == nullptr || !appdata.project))
+      break;
+  }
 }
 
 void map_t::clear(clearLayers layers) {
-  printf("freeing map contents\n");
+  OSM2GO_LOG(Map, Debug, "freeing map contents");
 
   unsigned int group_mask;
   switch(layers) {
@@ -1164,6 +1378,8 @@ void map_t::clear(clearLayers layers) {
 
   // only clear the map, the items are deleted through the canvas
   background_items.clear();
+  pendingWays.clear();
+  pendingNodes.clear();
   map_free_map_item_chains(appdata);
 
   /* remove a possibly existing highlight */
@@ -1173,23 +1389,27 @@ void map_t::clear(clearLayers layers) {
 }
 
 void map_t::paint() {
+  PERF_SCOPE("map_t::paint");
   osm_t::ref osm = appdata.project->osm;
 
   assert(canvas != nullptr);
+  pendingWays.clear();
+  pendingNodes.clear();
+  PERF_COUNT("painted objects", osm->ways.size() + osm->nodes.size());
 
-  printf("drawing ways ...\n");
+  OSM2GO_LOG(Map, Debug, "drawing ways ...");
   std::for_each(osm->ways.begin(), osm->ways.end(), map_way_draw_functor(this, style.get()));
 
-  printf("drawing single nodes ...\n");
+  OSM2GO_LOG(Map, Debug, "drawing single nodes ...");
   std::for_each(osm->nodes.begin(), osm->nodes.end(), map_node_draw_functor(this, style.get()));
 
-  printf("drawing frisket...\n");
+  OSM2GO_LOG(Map, Debug, "drawing frisket...");
   map_frisket_draw(this, osm->bounds);
 }
 
 /* called from several icons like e.g. "node_add" */
 void map_t::set_action(map_action_t act) {
-  printf("map action set to %d\n", act);
+  OSM2GO_LOG(Map, Debug, "map action set to %d", act);
 
   action.type = act;
 
@@ -1211,7 +1431,7 @@ void map_t::set_action(map_action_t act) {
 
   case MAP_ACTION_WAY_ADD: {
     statusbar_text = _("Place first node of new way");
-    printf("starting new way\n");
+    OSM2GO_LOG(Map, Debug, "starting new way");
 
     item_deselect();
     way_add_begin();
@@ -1365,18 +1585,27 @@ namespace {
  * @return point array
  */
 std::vector<lpos_t>
-canvas_points_init(const bounds_t &bounds, std::vector<track_point_t>::const_iterator point,
+canvas_points_init(const bounds_t &bounds, track_point_list::const_iterator point,
                    const unsigned int count)
 {
-  std::vector<lpos_t> points;
-  points.reserve(count);
-  lpos_t lpos;
+  std::vector<pos_float_t> lat, lon;
+  lat.reserve(count);
+  lon.reserve(count);
 
   for(unsigned int i = 0; i < count; i++) {
-    points.push_back(point->pos.toLpos(bounds));
+    lat.push_back(point->pos.lat);
+    lon.push_back(point->pos.lon);
     point++;
   }
 
+  std::vector<int> x(count), y(count);
+  bounds.project(lat.data(), lon.data(), x.data(), y.data(), count);
+
+  std::vector<lpos_t> points;
+  points.reserve(count);
+  for(unsigned int i = 0; i < count; i++)
+    points.push_back(lpos_t(x[i], y[i]));
+
   return points;
 }
 
@@ -1402,11 +1631,11 @@ void map_t::track_draw_seg(track_seg_t &seg) {
   /* nothing should have been drawn by now ... */
   assert(seg.item_chain.empty());
 
-  const std::vector<track_point_t>::const_iterator itEnd = seg.track_points.end();
-  std::vector<track_point_t>::const_iterator it = seg.track_points.begin();
+  const track_point_list::const_iterator itEnd = seg.track_points.end();
+  track_point_list::const_iterator it = seg.track_points.begin();
   while(it != itEnd) {
     /* skip all points not on screen */
-    std::vector<track_point_t>::const_iterator tmp = std::find_if(it, itEnd, out_of_bounds(bounds, true));
+    track_point_list::const_iterator tmp = std::find_if(it, itEnd, out_of_bounds(bounds, true));
 
     if(tmp == itEnd) {
       // the segment ends in a segment that is not on screen
@@ -1416,11 +1645,11 @@ void map_t::track_draw_seg(track_seg_t &seg) {
     /* actually start drawing with the last position that was offscreen */
     /* so the track nicely enters the viewing area */
     if (tmp != it)
-      it = std::prev(tmp);
+      it = tmp - 1;
 
     /* count nodes that _are_ on screen */
     tmp = std::find_if(tmp, itEnd, out_of_bounds(bounds, false));
-    unsigned int visible = std::distance(it, tmp);
+    unsigned int visible = tmp - it;
 
     /* the last element is still on screen, so save the number of elements in
      * the point list to avoid recalculation on update */
@@ -1436,7 +1665,7 @@ void map_t::track_draw_seg(track_seg_t &seg) {
     }
 
     /* allocate space for nodes */
-    printf("visible are %u\n", visible);
+    OSM2GO_LOG(Map, Trace, "visible are %u", visible);
     std::vector<lpos_t> points = canvas_points_init(bounds, it, visible);
     it = tmp;
 
@@ -1451,7 +1680,7 @@ void map_t::track_draw_seg(track_seg_t &seg) {
 void map_t::track_update_seg(track_seg_t &seg) {
   const bounds_t &bounds = appdata.project->osm->bounds;
 
-  printf("-- APPENDING TO TRACK --\n");
+  OSM2GO_LOG(Map, Trace, "-- APPENDING TO TRACK --");
   assert(!seg.track_points.empty());
 
   /* there are two cases: either the second last point was on screen */
@@ -1459,23 +1688,23 @@ void map_t::track_update_seg(track_seg_t &seg) {
   /* is the case */
 
   /* search last point */
-  const std::vector<track_point_t>::const_iterator itEnd = seg.track_points.end();
-  std::vector<track_point_t>::const_iterator last = std::prev(itEnd);
+  const track_point_list::const_iterator itEnd = seg.track_points.end();
+  track_point_list::const_iterator last = itEnd - 1;
   /* check if the last and second_last points are visible */
   const bool last_is_visible = bounds.ll.contains(last->pos);
   const bool second_last_is_visible = (elements_drawn > 0);
 
   /* if both are invisible, then nothing has changed on screen */
   if(!last_is_visible && !second_last_is_visible) {
-    printf("second_last and last entry are invisible -> doing nothing\n");
+    OSM2GO_LOG(Map, Trace, "second_last and last entry are invisible -> doing nothing");
     elements_drawn = 0;
     return;
   }
 
-  const std::vector<track_point_t>::const_iterator begin = // start of track to draw
+  const track_point_list::const_iterator begin = // start of track to draw
                                                    second_last_is_visible
-                                                   ? std::prev(itEnd, elements_drawn + 1)
-                                                   : std::prev(itEnd, 2);
+                                                   ? itEnd - (elements_drawn + 1)
+                                                   : itEnd - 2;
 
   /* since we are updating an existing track, it sure has at least two
    * points, second_last must be valid and its "next" (last) also */
@@ -1483,7 +1712,7 @@ void map_t::track_update_seg(track_seg_t &seg) {
   assert(last != itEnd);
 
   /* count points to be placed */
-  const size_t npoints = std::distance(begin, itEnd);
+  const size_t npoints = itEnd - begin;
   assert_cmpnum_op(seg.track_points.size(), >=, npoints);
   elements_drawn = last_is_visible ? npoints : 0;
 
@@ -1502,14 +1731,14 @@ void map_t::track_update_seg(track_seg_t &seg) {
     /* be visible nodes in the chain */
     assert(!seg.item_chain.empty());
 
-    printf("second_last is visible -> updating last segment to %zu points\n", npoints);
+    OSM2GO_LOG(Map, Trace, "second_last is visible -> updating last segment to %zu points", npoints);
 
     static_cast<canvas_item_polyline *>(seg.item_chain.back())->set_points(points);
   } else {
     assert(begin + 1 == last);
     assert(last_is_visible);
 
-    printf("second last is invisible -> start new screen segment\n");
+    OSM2GO_LOG(Map, Trace, "second last is invisible -> start new screen segment");
 
     canvas_item_t *item = canvas->polyline_new(CANVAS_GROUP_TRACK, points,
                                                style->track.width, style->track.color);
@@ -1551,7 +1780,7 @@ void map_t::track_draw(TrackVisibility visibility, track_t &track) {
 }
 
 void track_t::clear() {
-  printf("removing track\n");
+  OSM2GO_LOG(Map, Debug, "removing track");
 
   std::for_each(segments.begin(), segments.end(), free_track_item_chain<true>);
 }
@@ -1561,6 +1790,9 @@ void track_t::clear_current()
   assert(!segments.empty());
   free_track_item_chain<true>(segments.back());
   segments.back().track_points.clear();
+
+  // the points are already in the log, so it needs to be written again
+  reset_log();
 }
 
 /**
@@ -1629,6 +1861,7 @@ setMenuEntries(const std::unique_ptr<MainUi> &uicontrol, bool en)
 void map_t::remove_bg_image()
 {
   cancel_bg_adjust();
+  bg_tiles.reset();
 
   canvas->set_background(std::string());
 
@@ -1651,6 +1884,7 @@ bool map_t::set_bg_image(const std::string &filename, osm2go_platform::screenpos
   const lpos_t min = appdata.project->osm->bounds.min;
 
   cancel_bg_adjust();
+  bg_tiles.reset();
 
   bg_offset = offset;
 
@@ -1667,16 +1901,39 @@ bool map_t::set_bg_image(const std::string &filename, osm2go_platform::screenpos
   return ret;
 }
 
+void map_t::set_bg_tiles(osm2go_platform::screenpos offset)
+{
+  cancel_bg_adjust();
+  canvas->set_background(std::string());
+
+  bg_offset = offset;
+  bg_tiles.reset(new wms_tiles_t(*appdata.project, osm2go_platform::cachepath() + "wms/"));
+
+  // an empty background still has to be moved so tiles added later get the offset
+  const lpos_t min = appdata.project->osm->bounds.min;
+  canvas->move_background(min.x + bg_offset.x(), min.y + bg_offset.y());
+
+  update_bg_tiles();
+
+  setMenuEntries(appdata.uicontrol, true);
+}
+
+void map_t::update_bg_tiles()
+{
+  if(bg_tiles)
+    bg_tiles->update(canvas);
+}
+
 /* -------- hide and show objects (for performance reasons) ------- */
 
 void map_t::hide_selected() {
   if(selected.object.type != object_t::WAY) {
-    printf("selected item is not a way\n");
+    OSM2GO_LOG(Map, Debug, "selected item is not a way");
     return;
   }
 
   way_t *way = static_cast<way_t *>(selected.object);
-  printf("hiding way #" ITEM_ID_FORMAT "\n", way->id);
+  OSM2GO_LOG(Map, Debug, "hiding way #" ITEM_ID_FORMAT, way->id);
 
   item_deselect();
   appdata.project->osm->waySetHidden(way);
@@ -1712,7 +1969,7 @@ void map_t::detail_change(float detail, trstring::native_type_arg banner_msg)
   item_deselect();
 
   appdata.project->map_state.detail = detail;
-  printf("changing detail factor to %f\n", detail);
+  OSM2GO_LOG(Map, Debug, "changing detail factor to %f", detail);
 
   clear(MAP_LAYER_OBJECTS_ONLY);
   paint();
@@ -1767,6 +2024,36 @@ void map_t::info_selected()
   }
 }
 
+namespace {
+
+struct count_map_items {
+  size_t &count;
+  explicit inline count_map_items(size_t &c) : count(c) {}
+  template<typename T>
+  inline void operator()(const std::pair<const item_id_t, T *> &pair)
+  {
+    if(pair.second->map_item != nullptr)
+      count++;
+  }
+};
+
+} // namespace
+
+void map_t::memory_usage(memory_report &report) const
+{
+  // a highlight item has at most one map item
+  size_t items = background_items.size() + highlight.items.size();
+  if(appdata.project && appdata.project->osm) {
+    const osm_t::ref osm = appdata.project->osm;
+    std::for_each(osm->nodes.begin(), osm->nodes.end(), count_map_items(items));
+    std::for_each(osm->ways.begin(), osm->ways.end(), count_map_items(items));
+  }
+
+  report.add("map items", items, items * sizeof(map_item_t) + memory_usage::heap(background_items) +
+                                 memory_usage::heap(highlight.items));
+  report.add("canvas items", canvas->item_mapping.size(), canvas->memory_size());
+}
+
 map_state_t::map_state_t() noexcept
   : scroll_offset(0, 0)
 {
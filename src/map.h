@@ -16,6 +16,7 @@
 #include <string>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include <osm2go_i18n.h>
 #include <osm2go_platform.h>
@@ -55,17 +56,36 @@ struct appdata_t;
 class canvas_t;
 struct canvas_item_circle;
 struct canvas_item_t;
+class memory_report;
 class style_t;
+class wms_tiles_t;
 struct track_seg_t;
 struct track_t;
 
 struct map_item_t {
-  map_item_t(object_t o = object_t(), canvas_item_t *i = nullptr)
-    : object(o), item(i) {}
+  /**
+   * @brief the kind of canvas item
+   *
+   * This is used to decide if the item can be updated in place on redraw.
+   */
+  enum Shape {
+    Other,
+    Circle,
+    Icon,
+    Polyline,
+    Polygon,
+    Markers     ///< the node markers of a highlight, see map_highlight_t::marker_at()
+  };
+
+  map_item_t(object_t o = object_t(), canvas_item_t *i = nullptr, Shape s = Other,
+             canvas_group_t g = CANVAS_GROUP_BG)
+    : object(o), item(i), shape(s), group(g) {}
   map_item_t(const map_item_t &) O2G_DELETED_FUNCTION;
 
   object_t object;
   canvas_item_t *item;
+  Shape shape;
+  canvas_group_t group;
 };
 
 class map_t {
@@ -105,6 +125,7 @@ public:
 private:
   /* background image related stuff */
   osm2go_platform::screenpos bg_offset;
+  std::unique_ptr<wms_tiles_t> bg_tiles;  ///< set if a tiled WMS background is used
 
   struct {
     map_action_t type;            // current action type in progress
@@ -133,7 +154,23 @@ public:
   osm_t::TagMap last_way_tags;
 
   virtual void set_autosave(bool enable) = 0;
+
+  /**
+   * @brief set up the view for the current project and draw the visible area
+   *
+   * The objects outside of the visible area are left out, they are drawn by
+   * a following call to paint_remaining().
+   */
   void init();
+
+  /**
+   * @brief draw the objects left out by init()
+   *
+   * The objects are drawn in chunks, pending GUI events are processed in
+   * between so the map can already be used.
+   */
+  void paint_remaining();
+
   void paint();
   void clear(clearLayers layers);
   void item_deselect();
@@ -149,6 +186,11 @@ public:
   bool item_is_selected_node(const map_item_t *map_item) const;
   bool scroll_to_if_offscreen(lpos_t lpos);
 
+  /**
+   * @brief add the memory used for the visual representation to the report
+   */
+  void memory_usage(memory_report &report) const;
+
   /* track stuff */
   void track_draw(TrackVisibility visibility, track_t &track);
   void track_draw_seg(track_seg_t &seg);
@@ -159,6 +201,18 @@ public:
 
   /* background stuff */
   bool set_bg_image(const std::string &filename, osm2go_platform::screenpos offset);
+
+  /**
+   * @brief use the tiled WMS layer configured in the project as background
+   */
+  void set_bg_tiles(osm2go_platform::screenpos offset);
+
+  /**
+   * @brief load the background tiles for the visible area
+   *
+   * Does nothing if no tiled background is used.
+   */
+  void update_bg_tiles();
   void set_bg_color_from_style();
   void remove_bg_image();
   /* this cancels any wms adjustment in progress */
@@ -175,10 +229,22 @@ private:
   /**
    * @brief update the item that was clicked on
    * @param citem the canvas item that was selected
+   * @param pos the position the item was searched at
    */
-  void pen_down_item(canvas_item_t *citem);
+  void pen_down_item(canvas_item_t *citem, lpos_t pos);
+
+  /**
+   * @brief get the map item of the given canvas item
+   *
+   * For the node markers of a highlight the map item of the node at the given
+   * position is returned.
+   */
+  map_item_t *item_at(canvas_item_t *item, lpos_t pos);
+
+  map_item_t markerHit;            ///< the node of the highlight markers last found by item_at()
 
-  map_item_t *item_at(canvas_item_t *item);
+  std::vector<item_id_t> pendingWays;   ///< the ways left out by init(), the last is drawn first
+  std::vector<item_id_t> pendingNodes;  ///< the nodes left out by init(), the last is drawn first
 
 public:
   void detail_increase();
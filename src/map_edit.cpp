@@ -23,6 +23,7 @@
 #include "osm2go_annotations.h"
 #include <osm2go_cpp.h>
 #include <osm2go_i18n.h>
+#include <osm2go_log.h>
 #include <osm2go_platform.h>
 #include "api_limits.h"
 
@@ -59,11 +60,11 @@ void map_t::way_add_segment(lpos_t pos) {
     if(appdata.project->map_state.zoom * std::sqrt(static_cast<float>((lnpos.x - pos.x) * (lnpos.x - pos.x) +
                               (lnpos.y - pos.y) * (lnpos.y - pos.y))) < 5.0f) {
 #if 0
-      printf("detected double click -> simulate ok click\n");
+      OSM2GO_LOG(Edit, Debug, "detected double click -> simulate ok click");
       touchnode_clear();
       action_ok();
 #else
-      printf("detected double click -> ignore it as accidential\n");
+      OSM2GO_LOG(Edit, Debug, "detected double click -> ignore it as accidential");
 #endif
       return;
     }
@@ -78,7 +79,7 @@ void map_t::way_add_segment(lpos_t pos) {
   node_t *node = touchnode_get_node();
   osm_t::ref osm = appdata.project->osm;
   if(node != nullptr) {
-    printf("  re-using node #" ITEM_ID_FORMAT "\n", node->id);
+    OSM2GO_LOG(Edit, Debug, "  re-using node #" ITEM_ID_FORMAT, node->id);
 
     assert(action.way);
 
@@ -132,19 +133,19 @@ void map_t::way_add_segment(lpos_t pos) {
 
 static void map_unref_ways(node_t *node)
 {
-  printf("    node #" ITEM_ID_FORMAT " (used by %u)\n",
-         node->id, node->ways);
+  OSM2GO_LOG(Edit, Trace, "    node #" ITEM_ID_FORMAT " (used by %u)",
+                          node->id, node->ways);
 
   assert_cmpnum_op(node->ways, >, 0);
   node->ways--;
   if(node->ways == 0 && node->id == ID_ILLEGAL) {
-    printf("      -> freeing temp node\n");
+    OSM2GO_LOG(Edit, Trace, "      -> freeing temp node");
     delete node;
   }
 }
 
 void map_t::way_add_cancel() {
-  printf("  removing temporary way\n");
+  OSM2GO_LOG(Edit, Trace, "  removing temporary way");
   assert(action.way);
 
   appdata.project->osm->way_delete(action.way.release(), nullptr, map_unref_ways);
@@ -159,8 +160,8 @@ public:
 
 void map_draw_nodes::operator()(node_t* node)
 {
-  printf("    node #" ITEM_ID_FORMAT " (used by %u)\n",
-         node->id, node->ways);
+  OSM2GO_LOG(Edit, Trace, "    node #" ITEM_ID_FORMAT " (used by %u)",
+                          node->id, node->ways);
 
   if(node->id == ID_ILLEGAL) {
     /* we can be sure that no node gets inserted twice (even if twice in */
@@ -182,7 +183,7 @@ void map_t::way_add_ok() {
   /* into the node chain */
 
   /* (their way count will be 0 after removing the way) */
-  node_chain_t &chain = action.way->node_chain;
+  const node_chain_t &chain = action.way->node_chain;
   std::for_each(chain.begin(), chain.end(), map_draw_nodes(this));
 
   /* attach to existing way if the user requested so */
@@ -204,12 +205,12 @@ void map_t::way_add_ok() {
   /* be extending it. Joining the same way doesn't make sense. */
   bool showInfo = work->tags.empty();
   if(action.ends_on == work) {
-    printf("  the new way ends on itself -> don't join itself\n");
+    OSM2GO_LOG(Edit, Debug, "  the new way ends on itself -> don't join itself");
     action.ends_on = nullptr;
   } else if(action.ends_on != nullptr && osm2go_platform::yes_no(_("Join way?"),
                                            _("Do you want to join the way present at this location?"),
                                                           MISC_AGAIN_ID_EXTEND_WAY_END)) {
-    printf("  this new way ends on another way\n");
+    OSM2GO_LOG(Edit, Debug, "  this new way ends on another way");
     // this is triggered when the new way ends on an existing way, this can
     // happen even if an existing way was extended before
 
@@ -317,7 +318,7 @@ void map_t::way_cut(lpos_t pos) {
   node_chain_t::iterator cut_at;
   way_t *way = nullptr;
   if(cut_at_node) {
-    printf("  cut at node\n");
+    OSM2GO_LOG(Edit, Debug, "  cut at node");
 
     /* node must not be first or last node of way */
     assert(selected.object.type == object_t::WAY);
@@ -328,12 +329,12 @@ void map_t::way_cut(lpos_t pos) {
       cut_at = std::find(way->node_chain.begin(), way->node_chain.end(),
                          static_cast<node_t *>(item->object));
     } else {
-      printf("  won't cut as it's last or first node\n");
+      OSM2GO_LOG(Edit, Debug, "  won't cut as it's last or first node");
       return;
     }
 
   } else {
-    printf("  cut at segment\n");
+    OSM2GO_LOG(Edit, Debug, "  cut at segment");
     std::optional<unsigned int> c = canvas->get_item_segment(item->item, pos);
     if(!c)
       return;
@@ -346,8 +347,8 @@ void map_t::way_cut(lpos_t pos) {
   assert_cmpnum_op(way->node_chain.size(), >, 2);
 
   /* move parts of node_chain to the new way */
-  printf("  moving everthing after segment %zi to new way\n",
-         cut_at - way->node_chain.begin());
+  OSM2GO_LOG(Edit, Debug, "  moving everthing after segment %zi to new way",
+                          cut_at - way->node_chain.begin());
 
   /* clear selection */
   item_deselect();
@@ -355,7 +356,7 @@ void map_t::way_cut(lpos_t pos) {
   /* create a duplicate of the currently selected way */
   way_t * const neww = way->split(appdata.project->osm, cut_at, cut_at_node);
 
-  printf("original way still has %zu nodes\n", way->node_chain.size());
+  OSM2GO_LOG(Edit, Debug, "original way still has %zu nodes", way->node_chain.size());
 
   /* draw the updated old way */
   drawColorized(way);
@@ -392,7 +393,7 @@ void redraw_way::operator()(const std::pair<item_id_t, way_t *> &p)
   // limit the real work to the number of ways this node is actually part of
   cnt--;
 
-  printf("  node is part of way #" ITEM_ID_FORMAT ", redraw!\n", way->id);
+  OSM2GO_LOG(Edit, Trace, "  node is part of way #" ITEM_ID_FORMAT ", redraw!", way->id);
 
   /* draw current way */
   map->drawColorized(way);
@@ -405,8 +406,9 @@ void map_t::node_move(map_item_t *map_item, const osm2go_platform::screenpos &p)
   assert(map_item->object.type == object_t::NODE);
   node_t *node = static_cast<node_t *>(map_item->object);
 
-  printf("released dragged node #" ITEM_ID_FORMAT ", was at %d %d (%f %f)\n",
-         node->id, node->lpos.x, node->lpos.y, node->pos.lat, node->pos.lon);
+  const pos_t oldpos = node->pos;
+  OSM2GO_LOG(Edit, Debug, "released dragged node #" ITEM_ID_FORMAT ", was at %d %d (%f %f)",
+                          node->id, node->lpos.x, node->lpos.y, oldpos.lat, oldpos.lon);
 
   /* check if it was dropped onto another node */
   bool joined_with_touchnode = false;
@@ -438,7 +440,7 @@ void map_t::node_move(map_item_t *map_item, const osm2go_platform::screenpos &p)
                     _("The resulting node contains some conflicting tags. Please solve these."));
 
       /* check whether this will also join two ways */
-      printf("  checking if node is end of way\n");
+      OSM2GO_LOG(Edit, Debug, "  checking if node is end of way");
 
       if(ways2join_cnt > 2) {
         message_dlg(_("Too many ways to join"),
@@ -448,8 +450,8 @@ void map_t::node_move(map_item_t *map_item, const osm2go_platform::screenpos &p)
                 osm2go_platform::yes_no(_("Join ways?"),
                          _("Do you want to join the dragged way with the one you dropped it on?"),
                                         MISC_AGAIN_ID_JOIN_WAYS)) {
-        printf("  about to join ways #" ITEM_ID_FORMAT " and #" ITEM_ID_FORMAT "\n",
-               ways2join[0]->id, ways2join[1]->id);
+        OSM2GO_LOG(Edit, Debug, "  about to join ways #" ITEM_ID_FORMAT " and #" ITEM_ID_FORMAT,
+                                ways2join[0]->id, ways2join[1]->id);
 
         if(osm->mergeWays(ways2join[0], ways2join[1], this).conflict)
           message_dlg(_("Way tag conflict"),
@@ -478,8 +480,9 @@ void map_t::node_move(map_item_t *map_item, const osm2go_platform::screenpos &p)
     /* convert pos back to lpos to see rounding errors */
     node->lpos = node->pos.toLpos(osm->bounds);
 
-    printf("  now at %d %d (%f %f)\n",
-	   node->lpos.x, node->lpos.y, node->pos.lat, node->pos.lon);
+    const pos_t newpos = node->pos;
+    OSM2GO_LOG(Edit, Debug, "  now at %d %d (%f %f)",
+                            node->lpos.x, node->lpos.y, newpos.lat, newpos.lon);
   }
 
   /* now update the visual representation of the node */
@@ -12,16 +12,20 @@
 #include "style.h"
 
 #include <algorithm>
+#include <cassert>
 #include <cstdio>
 
 #include <osm2go_cpp.h>
+#include <osm2go_log.h>
 
 void map_highlight_t::clear()
 {
-  printf("removing highlight\n");
+  OSM2GO_LOG(Map, Trace, "removing highlight");
 
   std::for_each(items.begin(), items.end(), std::default_delete<canvas_item_t>());
   items.clear();
+  markers = nullptr;
+  markerNodes.clear();
 }
 
 /* create a new item for the cursor */
@@ -58,9 +62,43 @@ bool map_highlight_t::isHighlighted(const map_item_t &item) const
 {
   if(isEmpty())
     return false;
+  if(item.object.type == object_t::NODE &&
+     std::find(markerNodes.begin(), markerNodes.end(), static_cast<node_t *>(item.object)) != markerNodes.end())
+    return true;
   return std::any_of(items.begin(), items.end(), find_highlighted(item));
 }
 
+void map_highlight_t::markers_new(map_t *map, canvas_group_t group, way_t *way,
+                                  const std::vector<node_t *> &nodes, float radius, color_t color)
+{
+  std::vector<lpos_t> centers;
+  centers.reserve(nodes.size());
+  for(std::vector<node_t *>::const_iterator it = nodes.begin(); it != nodes.end(); it++)
+    centers.push_back((*it)->lpos);
+
+  canvas_item_t *item = map->canvas->markers_new(group, centers, radius, color);
+  items.push_back(item);
+
+  if(way == nullptr)
+    return;
+
+  assert(markers == nullptr);
+  markers = item;
+  markerNodes = nodes;
+
+  map_item_t *map_item = new map_item_t(object_t(way), item, map_item_t::Markers, group);
+  item->set_user_data(map_item);
+}
+
+node_t *map_highlight_t::marker_at(const canvas_t *canvas, const canvas_item_t *item, lpos_t pos) const
+{
+  if(item == nullptr || item != markers)
+    return nullptr;
+
+  const std::optional<unsigned int> idx = canvas->get_item_marker(item, pos);
+  return idx ? markerNodes[*idx] : nullptr;
+}
+
 void map_highlight_t::circle_new(map_t *map, canvas_group_t group, node_t *node,
                                  float radius, color_t color)
 {
@@ -71,15 +109,6 @@ void map_highlight_t::circle_new(map_t *map, canvas_group_t group, node_t *node,
   map_item->item->set_user_data(map_item);
 }
 
-void map_highlight_t::polygon_new(map_t *map, canvas_group_t group, way_t *way,
-                                  const std::vector<lpos_t> &points, color_t color) {
-  map_item_t *map_item = new map_item_t(object_t(way));
-  map_item->item = map->canvas->polygon_new(group, points, 0, 0, color);
-  items.push_back(map_item->item);
-
-  map_item->item->set_user_data(map_item);
-}
-
 void map_highlight_t::polyline_new(map_t *map, canvas_group_t group, way_t *way,
                                    const std::vector<lpos_t> &points, color_t color)
 {
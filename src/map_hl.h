@@ -20,6 +20,17 @@ class way_t;
 struct map_highlight_t {
   std::vector<canvas_item_t *> items;
 
+  /**
+   * @brief the selectable markers item and the nodes of its markers
+   *
+   * All node markers of a selected way are drawn by a single canvas item, the
+   * map item of that item refers to the way.
+   */
+  canvas_item_t *markers;
+  std::vector<node_t *> markerNodes;
+
+  inline map_highlight_t() : markers(nullptr) {}
+
   inline bool isEmpty() const noexcept
   { return items.empty(); }
 
@@ -30,12 +41,24 @@ struct map_highlight_t {
 
   void clear();
 
+  /**
+   * @brief draw markers for all given nodes as a single item
+   * @param way the object the item belongs to, nullptr if it should not be selectable
+   *
+   * Only one selectable markers item can exist at a time.
+   */
+  void markers_new(map_t *map, canvas_group_t group, way_t *way, const std::vector<node_t *> &nodes,
+                   float radius, color_t color);
+
+  /**
+   * @brief get the node of the markers item at the given position
+   * @retval nullptr item is not the markers item or there is no marker at pos
+   */
+  node_t *marker_at(const canvas_t *canvas, const canvas_item_t *item, lpos_t pos) const;
+
   void circle_new(map_t *map, canvas_group_t group, node_t *node, float radius, color_t color);
 
   void polyline_new(map_t *map, canvas_group_t group, way_t *way,
                     const std::vector<lpos_t> &points, color_t color);
 
-  void polygon_new(map_t *map, canvas_group_t group, way_t *way,
-                   const std::vector<lpos_t> &points, color_t color);
-
 };
@@ -0,0 +1,91 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Rolf Eike Beer <eike@sf-mail.de>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "memory_usage.h"
+
+#include "appdata.h"
+#include "cache_set.h"
+#include "icon.h"
+#include "josm_presets.h"
+#include "map.h"
+#include "osm.h"
+#include "osm_p.h"
+#include "project.h"
+#include "track.h"
+
+#include <cstdio>
+
+void memory_report::add(const char *name, size_t count, size_t bytes)
+{
+  entry e;
+  e.name = name;
+  e.count = count;
+  e.bytes = bytes;
+  entries.push_back(e);
+}
+
+size_t memory_report::total() const
+{
+  size_t ret = 0;
+  for(size_t i = 0; i < entries.size(); i++)
+    ret += entries[i].bytes;
+  return ret;
+}
+
+std::string memory_report::text() const
+{
+  std::string ret;
+  char buf[128];
+
+  snprintf(buf, sizeof(buf), "%-20s %10s %12s\n", "", "objects", "kB");
+  ret += buf;
+  for(size_t i = 0; i < entries.size(); i++) {
+    const entry &e = entries[i];
+    if(e.count > 0)
+      snprintf(buf, sizeof(buf), "%-20s %10zu %12.1f\n", e.name, e.count, e.bytes / 1024.0);
+    else
+      snprintf(buf, sizeof(buf), "%-20s %10s %12.1f\n", e.name, "", e.bytes / 1024.0);
+    ret += buf;
+  }
+  snprintf(buf, sizeof(buf), "\n%-20s %10s %12.1f\n", "total", "", total() / 1024.0);
+  ret += buf;
+
+  return ret;
+}
+
+memory_report memory_report::collect(const appdata_t &appdata)
+{
+  memory_report ret;
+
+  if(appdata.project && appdata.project->osm)
+    appdata.project->osm->memory_usage(ret);
+
+  ret.add("string cache", value_cache.size(), value_cache.memory_size());
+  ret.add("icons", 0, appdata.icons.memory_size());
+
+  if(appdata.presets)
+    ret.add("presets", 0, appdata.presets->memory_size());
+
+  if(appdata.track.track) {
+    const track_t &track = *appdata.track.track;
+    size_t points = 0;
+    for(size_t i = 0; i < track.segments.size(); i++)
+      points += track.segments[i].track_points.size();
+    ret.add("track points", points, track.memory_size());
+  }
+
+  if(appdata.map != nullptr)
+    appdata.map->memory_usage(ret);
+
+  return ret;
+}
+
+size_t memory_usage::heap(const std::string &s)
+{
+  // the capacity of an empty string is what fits into the object itself
+  static const size_t inplace = std::string().capacity();
+  return s.capacity() > inplace ? s.capacity() + 1 : 0;
+}
@@ -0,0 +1,91 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Rolf Eike Beer <eike@sf-mail.de>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+/**
+ * @file memory_usage.h
+ *
+ * Estimates of the memory used by the different parts of the program.
+ *
+ * The numbers are calculated from the sizes of the containers, allocator
+ * overhead is not included. They are meant to show which part uses most of
+ * the memory, not to match the numbers of the operating system.
+ */
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct appdata_t;
+
+class memory_report {
+public:
+  struct entry {
+    const char *name;
+    size_t count;   ///< the number of objects, 0 if this is not meaningful
+    size_t bytes;
+  };
+
+  std::vector<entry> entries;
+
+  void add(const char *name, size_t count, size_t bytes);
+
+  /**
+   * @brief the sum of all entries
+   */
+  size_t total() const;
+
+  /**
+   * @brief format the entries as a table
+   */
+  std::string text() const;
+
+  /**
+   * @brief collect the memory usage of everything reachable from appdata
+   */
+  static memory_report collect(const appdata_t &appdata);
+};
+
+namespace memory_usage {
+
+/**
+ * @brief the bytes allocated by a string
+ *
+ * Short strings are stored inside the object and need no extra memory.
+ */
+size_t heap(const std::string &s);
+
+template<typename T, typename A>
+inline size_t heap(const std::vector<T, A> &v)
+{
+  return v.capacity() * sizeof(T);
+}
+
+// the nodes of a red-black tree have 3 pointers and the color
+template<typename K, typename V, typename C, typename A>
+inline size_t heap(const std::map<K, V, C, A> &m)
+{
+  return m.size() * (sizeof(typename std::map<K, V, C, A>::value_type) + 4 * sizeof(void *));
+}
+
+template<typename K, typename V, typename C, typename A>
+inline size_t heap(const std::multimap<K, V, C, A> &m)
+{
+  return m.size() * (sizeof(typename std::multimap<K, V, C, A>::value_type) + 4 * sizeof(void *));
+}
+
+// every node has a next pointer and may cache the hash
+template<typename K, typename V, typename H, typename E, typename A>
+inline size_t heap(const std::unordered_map<K, V, H, E, A> &m)
+{
+  return m.size() * (sizeof(typename std::unordered_map<K, V, H, E, A>::value_type) + 2 * sizeof(void *)) +
+         m.bucket_count() * sizeof(void *);
+}
+
+} // namespace memory_usage
@@ -8,9 +8,12 @@
 
 #include "pos.h"
 
+#include <cassert>
 #include <cstring>
 #include <strings.h>
 
+#include "osm2go_annotations.h"
+
 double xml_get_prop_float(xmlNode *node, const char *prop) {
   xmlString str(xmlGetProp(node, BAD_CAST prop));
   return xml_parse_float(str);
@@ -24,6 +27,41 @@ bool xml_get_prop_bool(xmlNode *node, const char *prop) {
   return (strcasecmp(prop_str, "true") == 0);
 }
 
+bool xml_get_prop_bool(xmlTextReaderPtr reader, const char *prop) {
+  xmlString prop_str(xmlTextReaderGetAttribute(reader, BAD_CAST prop));
+  if(!prop_str)
+    return false;
+
+  return (strcasecmp(prop_str, "true") == 0);
+}
+
+static inline int __attribute__((nonnull(2)))
+my_strcmp(const xmlChar *a, const xmlChar *b)
+{
+  if(a == nullptr)
+    return -1;
+  return strcmp(reinterpret_cast<const char *>(a), reinterpret_cast<const char *>(b));
+}
+
+void xml_skip_element(xmlTextReaderPtr reader)
+{
+  assert_cmpnum(xmlTextReaderNodeType(reader), XML_READER_TYPE_ELEMENT);
+  if(xmlTextReaderIsEmptyElement(reader))
+    return;
+
+  int depth = xmlTextReaderDepth(reader);
+  const xmlChar *name = xmlTextReaderConstName(reader);
+  assert(name != nullptr);
+
+  int ret = xmlTextReaderRead(reader);
+  while(ret == 1 &&
+        (xmlTextReaderNodeType(reader) != XML_READER_TYPE_END_ELEMENT ||
+         xmlTextReaderDepth(reader) > depth ||
+         my_strcmp(xmlTextReaderConstName(reader), name) != 0)) {
+    ret = xmlTextReaderRead(reader);
+  }
+}
+
 void format_float_int(int val, unsigned int decimals, char *str)
 {
   int off = 0;
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <libxml/tree.h>
+#include <libxml/xmlreader.h>
 #include <memory>
 
 #include <osm2go_stl.h>
@@ -39,8 +40,25 @@ struct xmlDocDelete {
 
 typedef std::unique_ptr<xmlDoc, xmlDocDelete> xmlDocGuard;
 
+struct xmlTextReaderDelete {
+  inline void operator()(xmlTextReaderPtr reader) {
+    xmlFreeTextReader(reader);
+  }
+};
+
+typedef std::unique_ptr<xmlTextReader, xmlTextReaderDelete> xmlTextReaderGuard;
+
 double xml_get_prop_float(xmlNode *node, const char *prop);
 bool xml_get_prop_bool(xmlNode *node, const char *prop);
+bool xml_get_prop_bool(xmlTextReaderPtr reader, const char *prop);
+
+/**
+ * @brief skip the current element including everything below it
+ * @param reader the reader positioned on the start of an element
+ *
+ * Afterwards the reader is positioned on the end of the element.
+ */
+void xml_skip_element(xmlTextReaderPtr reader);
 
 static inline double xml_parse_float(const xmlChar *str)
 {
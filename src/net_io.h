@@ -8,6 +8,7 @@
 
 #include <curl/curl.h>
 #include <string>
+#include <vector>
 
 #include <osm2go_i18n.h>
 #include <osm2go_platform.h>
@@ -45,6 +46,65 @@ bool net_io_download_file(osm2go_platform::Widget *parent,
 bool net_io_download_mem(osm2go_platform::Widget *parent, const std::string &url,
                          std::string &data, trstring::native_type_arg title);
 
+struct net_io_file_request {
+  inline net_io_file_request(const std::string &u, const std::string &f)
+    : url(u), filename(f), ok(false) {}
+  std::string url;
+  std::string filename;
+  bool ok;  ///< set if the file was downloaded successfully
+};
+
+/**
+ * @brief downloads files in the background
+ *
+ * The requests are started in the order they were added, with at most the
+ * given number of transfers at the same time. The data is first written to
+ * a temporary file that is renamed once the download is complete, so an
+ * existing file is always complete. Transfers that take too long are
+ * aborted. No dialogs are shown.
+ */
+class net_io_async_t {
+public:
+  /**
+   * @brief called from the main loop for every finished request
+   *
+   * The ok member of the request tells if the file is now present. The
+   * downloader must not be destroyed from within the callback.
+   */
+  typedef void (*callback)(void *context, const net_io_file_request &request);
+
+protected:
+  const callback done;
+  void * const cb_context;
+
+  net_io_async_t(callback cb, void *context)
+    : done(cb)
+    , cb_context(context)
+  {
+  }
+public:
+  /**
+   * @brief abort all transfers still running
+   *
+   * The callback is not called for them.
+   */
+  virtual ~net_io_async_t() {}
+
+  /**
+   * @brief queue a new request
+   *
+   * The callback is never called from within this function.
+   */
+  virtual void add(const net_io_file_request &request) = 0;
+
+  /**
+   * @brief the number of requests not yet finished
+   */
+  virtual size_t pending() const = 0;
+
+  static net_io_async_t *create(unsigned int parallel, callback cb, void *context);
+};
+
 /**
  * @brief translate HTTP status code to string
  * @param id the HTTP status code
@@ -14,9 +14,11 @@
 
 #include "cache_set.h"
 #include "map.h"
+#include "memory_usage.h"
 #include "misc.h"
 #include "osm_objects.h"
 #include "pos.h"
+#include "tag_index.h"
 
 #include <algorithm>
 #include <array>
@@ -35,6 +37,7 @@
 #include "osm2go_annotations.h"
 #include <osm2go_cpp.h>
 #include <osm2go_i18n.h>
+#include <osm2go_log.h>
 #include <osm2go_platform.h>
 
 cache_set value_cache;
@@ -156,6 +159,12 @@ bool osm_t::tagSubset(const TagMap &sub, const TagMap &super)
 
 void relation_object_replacer::operator()(relation_t *r)
 {
+  // check without write access first, the members may be shared with the original object
+  if(static_cast<const relation_t *>(r)->find_member_object(old) == r->members.cend())
+    return;
+
+  osm->mark_dirty(r);
+
   const std::vector<member_t>::iterator itBegin = r->members.begin();
   std::vector<member_t>::iterator itEnd = r->members.end();
 
@@ -163,8 +172,6 @@ void relation_object_replacer::operator()(relation_t *r)
     if(it->object != old)
       continue;
 
-    osm->mark_dirty(r);
-
     it->object = replace;
 
     // check if this member now is the same as the next or previous one
@@ -195,9 +202,9 @@ public:
 void relation_membership_functor::operator()(const std::pair<item_id_t, relation_t *>& p)
 {
   relation_t * const rel = p.second;
-  const std::vector<member_t>::const_iterator itEnd = rel->members.end();
+  const std::vector<member_t>::const_iterator itEnd = rel->members.cend();
   bool aFound = false, bFound = false;
-  for(std::vector<member_t>::const_iterator it = rel->members.begin();
+  for(std::vector<member_t>::const_iterator it = rel->members.cbegin();
       it != itEnd && (!aFound || !bFound); it++) {
     if(*it == a) {
       if(!aFound) {
@@ -306,14 +313,18 @@ osm_t::mergeResult<node_t> osm_t::mergeNodes(node_t *first, node_t *second, std:
 
   for(wit = witBegin; remove->ways > 0 && wit != witEnd; wit++) {
     way_t * const way = wit->second;
+    if(!way->contains_node(remove))
+      continue;
+
+    OSM2GO_LOG(Osm, Trace, "  found node in way #" ITEM_ID_FORMAT, way->id);
+
+    mark_dirty(way);
+
     const node_chain_t::iterator itBegin = way->node_chain.begin();
     node_chain_t::iterator it = itBegin;
     node_chain_t::iterator itEnd = way->node_chain.end();
 
     while(remove->ways > 0 && (it = std::find(it, itEnd, remove)) != itEnd) {
-      printf("  found node in way #" ITEM_ID_FORMAT "\n", way->id);
-
-      mark_dirty(way);
       // check if this node is the same as the neighbor
       if((it != itBegin && *std::prev(it) == keep) || (std::next(it) != itEnd && *std::next(it) == keep)) {
         // this node would now be twice in the way at adjacent positions
@@ -347,7 +358,12 @@ osm_t::mergeResult<node_t> osm_t::mergeNodes(node_t *first, node_t *second, std:
                 relation_object_replacer(this, object_t(remove), object_t(keep)));
 
   /* transfer tags from "remove" to "keep" */
-  bool conflict = keep->tags.merge(remove->tags);
+  bool conflict;
+  {
+    TagChangeGuard keepGuard(*this, object_t(keep));
+    TagChangeGuard removeGuard(*this, object_t(remove));
+    conflict = keep->tags.merge(remove->tags);
+  }
 
   /* remove must not have any references to ways anymore */
   assert_cmpnum(remove->ways, 0);
@@ -414,9 +430,14 @@ bool tag_list_t::merge(tag_list_t &other)
 
   bool conflict = false;
 
+  // this also detaches the contents before iterators to the other list are taken,
+  // both may have been sharing the same data
+  contents.reserve(contents.size() + other.contents.size());
+
   /* ---------- transfer tags from way[1] to way[0] ----------- */
-  const std::vector<tag_t>::const_iterator itEnd = other.contents->end();
-  for(std::vector<tag_t>::const_iterator srcIt = std::cbegin(*other.contents); srcIt != itEnd; srcIt++) {
+  const cow_vector<tag_t> &src_tags = other.contents;
+  const std::vector<tag_t>::const_iterator itEnd = src_tags.end();
+  for(std::vector<tag_t>::const_iterator srcIt = src_tags.begin(); srcIt != itEnd; srcIt++) {
     const tag_t &src = *srcIt;
     /* don't copy discardable tags or tags that already
      * exist in identical form */
@@ -424,11 +445,11 @@ bool tag_list_t::merge(tag_list_t &other)
       /* check if same key but with different value is present */
       if(!conflict)
         conflict = contains(tag_match_functor(src, false));
-      contents->push_back(src);
+      contents.push_back(src);
     }
   }
 
-  other.contents.reset();
+  other.contents.clear();
 
   return conflict;
 }
@@ -460,14 +481,13 @@ public:
  */
 template<typename T>
 static std::optional<bool> tag_list_compare_base(const tag_list_t &list,
-                                                 const std::unique_ptr<std::vector<tag_t> > &contents,
+                                                 const cow_vector<tag_t> &contents,
                                                  const T &other, unsigned int &t1discardables)
 {
   if(list.empty() && other.empty())
     return false;
 
-  // Special case for an empty list as contents is not set in this case and
-  // must not be dereferenced. Check if t2 only consists of a creator tag, in
+  // Special case for an empty list. Check if t2 only consists of a creator tag, in
   // which case both lists would still be considered the same, or not. Not
   // further checks need to be done for the end result.
   const typename T::const_iterator t2start = other.begin();
@@ -477,9 +497,9 @@ static std::optional<bool> tag_list_compare_base(const tag_list_t &list,
     return (other.size() != t2discardables);
 
   /* first check list length, otherwise deleted tags are hard to detect */
-  std::vector<tag_t>::size_type ocnt = contents->size();
-  const std::vector<tag_t>::const_iterator t1End = contents->end();
-  t1discardables = std::count_if(std::cbegin(*contents), t1End, check_discardable_tag());
+  std::vector<tag_t>::size_type ocnt = contents.size();
+  const std::vector<tag_t>::const_iterator t1End = contents.end();
+  t1discardables = std::count_if(contents.begin(), t1End, check_discardable_tag());
 
   // the result can't become negative here as it was checked before that contents is not empty
   if (other.size() - t2discardables != ocnt - t1discardables)
@@ -497,8 +517,8 @@ bool tag_list_t::operator!=(const std::vector<tag_t> &t2) const {
   const std::vector<tag_t>::const_iterator t2End = t2.end();
   const std::vector<tag_t>::const_iterator t2start = t2.begin();
 
-  std::vector<tag_t>::const_iterator t1it = contents->begin();
-  const std::vector<tag_t>::const_iterator t1End = contents->end();
+  std::vector<tag_t>::const_iterator t1it = contents.begin();
+  const std::vector<tag_t>::const_iterator t1End = contents.end();
 
   for (; t1it != t1End; t1it++) {
     if (t1discardables && t1it->is_discardable()) {
@@ -527,8 +547,8 @@ bool tag_list_t::operator!=(const osm_t::TagMap &t2) const {
   if(r)
     return *r;
 
-  std::vector<tag_t>::const_iterator t1it = contents->begin();
-  const std::vector<tag_t>::const_iterator t1End = contents->end();
+  std::vector<tag_t>::const_iterator t1it = contents.begin();
+  const std::vector<tag_t>::const_iterator t1End = contents.end();
 
   for (; t1it != t1End; t1it++) {
     if (t1discardables && t1it->is_discardable()) {
@@ -572,8 +592,8 @@ bool tag_list_t::hasTagCollisions() const
   if(empty())
     return false;
 
-  const std::vector<tag_t>::const_iterator itEnd = contents->end();
-  for(std::vector<tag_t>::const_iterator it = contents->begin();
+  const std::vector<tag_t>::const_iterator itEnd = contents.end();
+  for(std::vector<tag_t>::const_iterator it = contents.begin();
       std::next(it) != itEnd; it++) {
     if (std::any_of(std::next(it), itEnd, collision_functor(*it)))
       return true;
@@ -584,7 +604,12 @@ bool tag_list_t::hasTagCollisions() const
 template<typename T>
 void osm_t::wipeImpl(T *obj)
 {
+  invalidateNames();
+
   if (likely(obj->id != ID_ILLEGAL)) {
+    if (tagIndex)
+      tagIndex->remove(object_t(obj));
+
     size_t rcnt = objects<T>().erase(obj->id);
     assert_cmpnum(rcnt, 1);
 
@@ -614,7 +639,7 @@ static void osm_unref_node(node_t* node)
 
 void osm_node_chain_unref(node_chain_t &node_chain)
 {
-  std::for_each(node_chain.begin(), node_chain.end(), osm_unref_node);
+  std::for_each(node_chain.cbegin(), node_chain.cend(), osm_unref_node);
 }
 
 void osm_t::wipe(way_t *way)
@@ -632,36 +657,35 @@ bool relation_t::is_multipolygon() const {
   return tp != nullptr && (strcmp(tp, "multipolygon") == 0);
 }
 
-class gen_xml_relation_functor {
-  xmlNodePtr const xml_node;
-public:
-  explicit inline gen_xml_relation_functor(xmlNodePtr n) : xml_node(n) {}
-  void operator()(const member_t &member);
-};
-
-void gen_xml_relation_functor::operator()(const member_t &member)
+static const char *member_type_string(const member_t &member)
 {
-  xmlNodePtr m_node = xmlNewChild(xml_node,nullptr,BAD_CAST "member", nullptr);
-
-  const char *typestr;
   switch(member.object.type) {
   case object_t::NODE:
   case object_t::NODE_ID:
-    typestr = node_t::api_string();
-    break;
+    return node_t::api_string();
   case object_t::WAY:
   case object_t::WAY_ID:
-    typestr = way_t::api_string();
-    break;
+    return way_t::api_string();
   case object_t::RELATION:
   case object_t::RELATION_ID:
-    typestr = relation_t::api_string();
-    break;
+    return relation_t::api_string();
   default:
     assert_unreachable();
   }
+}
+
+class gen_xml_relation_functor {
+  xmlNodePtr const xml_node;
+public:
+  explicit inline gen_xml_relation_functor(xmlNodePtr n) : xml_node(n) {}
+  void operator()(const member_t &member);
+};
+
+void gen_xml_relation_functor::operator()(const member_t &member)
+{
+  xmlNodePtr m_node = xmlNewChild(xml_node,nullptr,BAD_CAST "member", nullptr);
 
-  xmlNewProp(m_node, BAD_CAST "type", BAD_CAST typestr);
+  xmlNewProp(m_node, BAD_CAST "type", BAD_CAST member_type_string(member));
   xmlNewProp(m_node, BAD_CAST "ref", BAD_CAST member.object.id_string().c_str());
 
   if(member.role != nullptr)
@@ -673,6 +697,29 @@ void relation_t::generate_member_xml(xmlNodePtr xml_node) const
   std::for_each(members.begin(), members.end(), gen_xml_relation_functor(xml_node));
 }
 
+class write_xml_relation_functor {
+  xmlTextWriterPtr const writer;
+public:
+  explicit inline write_xml_relation_functor(xmlTextWriterPtr w) : writer(w) {}
+  void operator()(const member_t &member);
+};
+
+void write_xml_relation_functor::operator()(const member_t &member)
+{
+  xmlTextWriterStartElement(writer, BAD_CAST "member");
+  xmlTextWriterWriteAttribute(writer, BAD_CAST "type", BAD_CAST member_type_string(member));
+  xmlTextWriterWriteAttribute(writer, BAD_CAST "ref", BAD_CAST member.object.id_string().c_str());
+
+  if(member.role != nullptr)
+    xmlTextWriterWriteAttribute(writer, BAD_CAST "role", BAD_CAST member.role);
+  xmlTextWriterEndElement(writer);
+}
+
+void relation_t::generate_member_xml(xmlTextWriterPtr writer) const
+{
+  std::for_each(members.begin(), members.end(), write_xml_relation_functor(writer));
+}
+
 void osm_t::wipe(relation_t *relation)
 {
   wipeImpl(relation);
@@ -766,6 +813,24 @@ void way_t::write_node_chain(xmlNodePtr way_node) const {
   std::for_each(node_chain.begin(), node_chain.end(), add_xml_node_refs(way_node));
 }
 
+class write_xml_node_refs {
+  xmlTextWriterPtr const writer;
+public:
+  explicit inline write_xml_node_refs(xmlTextWriterPtr w) : writer(w) {}
+  void operator()(const node_t *node);
+};
+
+void write_xml_node_refs::operator()(const node_t* node)
+{
+  xmlTextWriterStartElement(writer, BAD_CAST "nd");
+  xmlTextWriterWriteAttribute(writer, BAD_CAST "ref", BAD_CAST node->id_string().c_str());
+  xmlTextWriterEndElement(writer);
+}
+
+void way_t::write_node_chain(xmlTextWriterPtr writer) const {
+  std::for_each(node_chain.begin(), node_chain.end(), write_xml_node_refs(writer));
+}
+
 /* build xml representation for a changeset */
 xmlChar *osm_generate_xml_changeset(const std::string &comment,
                                     const std::string &src) {
@@ -816,8 +881,57 @@ template<typename T> void osm_t::attachObject(T *obj)
     else
       obj->id = it->first - 1;
   }
-  printf("Attaching %s " ITEM_ID_FORMAT "\n", obj->apiString(), obj->id);
+  OSM2GO_LOG(Osm, Debug, "Attaching %s " ITEM_ID_FORMAT, obj->apiString(), obj->id);
   map[obj->id] = obj;
+
+  invalidateNames();
+  if(tagIndex)
+    tagIndex->add(object_t(obj));
+}
+
+node_projector::node_projector(const bounds_t &b)
+  : bounds(b)
+{
+  nodes.reserve(batch_size);
+  lat.reserve(batch_size);
+  lon.reserve(batch_size);
+  x.resize(batch_size);
+  y.resize(batch_size);
+}
+
+void node_projector::add(node_t *node)
+{
+  const pos_t pos = node->pos;
+  nodes.push_back(node);
+  lat.push_back(pos.lat);
+  lon.push_back(pos.lon);
+
+  if(unlikely(nodes.size() == batch_size))
+    flush();
+}
+
+void node_projector::remove(const node_t *node)
+{
+  const std::vector<node_t *>::iterator it = std::find(nodes.begin(), nodes.end(), node);
+  if(it == nodes.end())
+    return;
+
+  const size_t idx = it - nodes.begin();
+  nodes.erase(it);
+  lat.erase(lat.begin() + idx);
+  lon.erase(lon.begin() + idx);
+}
+
+void node_projector::flush()
+{
+  const size_t count = nodes.size();
+  bounds.project(lat.data(), lon.data(), x.data(), y.data(), count);
+  for(size_t i = 0; i < count; i++)
+    nodes[i]->lpos = lpos_t(x[i], y[i]);
+
+  nodes.clear();
+  lat.clear();
+  lon.clear();
 }
 
 node_t *osm_t::node_new(const lpos_t lpos) {
@@ -863,6 +977,7 @@ osm_t::updateTags(object_t o, const TagMap &ntags)
   if (static_cast<base_object_t *>(o)->tags == ntags)
     return;
 
+  TagChangeGuard guard(*this, o);
   const base_object_t * const origobj = originalObject(o);
   bool tagsUpdated = false;
 
@@ -925,22 +1040,21 @@ public:
 void node_chain_delete_functor::operator()(std::pair<item_id_t, way_t *> p)
 {
   way_t * const way = p.second;
-  node_chain_t &chain = way->node_chain;
-  bool modified = false;
+  // check without write access first, the chain may be shared with the original object
+  if(!way->contains_node(node))
+    return;
+
+  osm->mark_dirty(way);
 
+  // and add the way to the list of affected ways
+  way_chain.push_back(way);
+
+  node_chain_t &chain = way->node_chain;
   node_chain_t::iterator it = chain.begin();
   // special case closed ways where the closing node is deleted
   bool needsClose = way->is_closed() && way->ends_with_node(node);
 
   while((it = std::find(it, chain.end(), node)) != chain.end()) {
-    if (!modified) {
-      modified = true;
-      osm->mark_dirty(way);
-
-      // and add the way to the list of affected ways
-      way_chain.push_back(way);
-    }
-
     // remove node from chain
     it = chain.erase(it);
   }
@@ -994,7 +1108,7 @@ cloneForDeletion(way_t &o)
 relation_t *
 cloneForDeletion(relation_t &o)
 {
-  std::vector<member_t> members;
+  cow_vector<member_t> members;
   members.swap(o.members);
   relation_t *ret = new relation_t(o);
   ret->members.swap(members);
@@ -1008,7 +1122,7 @@ void osm_t::markDeleted(T &obj)
 {
   // new objects should simply be deleted
   if (obj.isNew()) {
-    printf("permanently delete %s #" ITEM_ID_FORMAT "\n", obj.apiString(), obj.id);
+    OSM2GO_LOG(Osm, Debug, "permanently delete %s #" ITEM_ID_FORMAT, obj.apiString(), obj.id);
 
     assert(originalObjects<T>().find(obj.id) == originalObjects<T>().end());
     wipe(&obj);
@@ -1017,7 +1131,13 @@ void osm_t::markDeleted(T &obj)
 
   std::unordered_map<item_id_t, const T *> &orig = originalObjects<T>();
 
-  printf("mark %s #" ITEM_ID_FORMAT " as deleted\n", obj.apiString(), obj.id);
+  OSM2GO_LOG(Osm, Debug, "mark %s #" ITEM_ID_FORMAT " as deleted", obj.apiString(), obj.id);
+
+  invalidateNames();
+
+  // deleted objects have no tags, so they are not in the index anymore
+  if (tagIndex)
+    tagIndex->remove(object_t(&obj));
 
   // no need to keep anything, it was already in the dirty map
   if (obj.flags & OSM_FLAG_DIRTY) {
@@ -1075,13 +1195,18 @@ public:
 void remove_member_functor::operator()(std::pair<item_id_t, relation_t *> pair)
 {
   relation_t * const relation = pair.second;
+  // check without write access first, the members may be shared with the original object
+  if(std::find(relation->members.cbegin(), relation->members.cend(), obj) == relation->members.cend())
+    return;
+
+  OSM2GO_LOG(Osm, Debug, "  from relation #" ITEM_ID_FORMAT, relation->id);
+
+  osm->mark_dirty(relation);
+
   std::vector<member_t>::iterator itEnd = relation->members.end();
   std::vector<member_t>::iterator it = relation->members.begin();
 
   while((it = std::find(it, itEnd, obj)) != itEnd) {
-    printf("  from relation #" ITEM_ID_FORMAT "\n", relation->id);
-
-    osm->mark_dirty(relation);
     it = relation->members.erase(it);
     // refresh end iterator as the vector was modified
     itEnd = relation->members.end();
@@ -1091,12 +1216,42 @@ void remove_member_functor::operator()(std::pair<item_id_t, relation_t *> pair)
 /* remove the given object from all relations. used if the object is to */
 /* be deleted */
 void osm_t::remove_from_relations(object_t obj) {
-  printf("removing %s #" ITEM_ID_FORMAT " from all relations:\n", static_cast<base_object_t *>(obj)->apiString(), obj.get_id());
+  OSM2GO_LOG(Osm, Debug, "removing %s #" ITEM_ID_FORMAT " from all relations:", static_cast<base_object_t *>(obj)->apiString(), obj.get_id());
 
   std::for_each(relations.begin(), relations.end(),
                 remove_member_functor(this, obj));
 }
 
+namespace {
+
+class membership_collector {
+  osm_t::MembershipMap &map;
+  const object_t &obj;
+public:
+  inline membership_collector(osm_t::MembershipMap &m, const object_t &o) : map(m), obj(o) {}
+  void operator()(const std::pair<item_id_t, relation_t *> &pair) const;
+};
+
+void membership_collector::operator()(const std::pair<item_id_t, relation_t *> &pair) const
+{
+  const relation_t * const relation = pair.second;
+  if(relation->isDeleted())
+    return;
+
+  const std::vector<member_t>::const_iterator it = relation->find_member_object(obj);
+  if(it != relation->members.cend())
+    map[relation] = std::distance(relation->members.cbegin(), it);
+}
+
+} // namespace
+
+osm_t::MembershipMap osm_t::memberships(const object_t &obj) const
+{
+  MembershipMap ret;
+  std::for_each(relations.begin(), relations.end(), membership_collector(ret, obj));
+  return ret;
+}
+
 relation_t *osm_t::attach(relation_t *relation)
 {
   attachObject(relation);
@@ -1108,8 +1263,8 @@ class find_relation_members {
 public:
   explicit inline find_relation_members(const object_t o) : obj(o) {}
   bool operator()(const std::pair<item_id_t, relation_t *> &pair) const {
-    const std::vector<member_t>::const_iterator itEnd = pair.second->members.end();
-    return std::find(std::cbegin(pair.second->members), itEnd, obj) != itEnd;
+    const std::vector<member_t>::const_iterator itEnd = pair.second->members.cend();
+    return std::find(pair.second->members.cbegin(), itEnd, obj) != itEnd;
   }
 };
 
@@ -1122,8 +1277,8 @@ public:
 
 void osm_unref_way_free::operator()(node_t *node)
 {
-  printf("checking node #" ITEM_ID_FORMAT " (still used by %u)\n",
-         node->id, node->ways);
+  OSM2GO_LOG(Osm, Trace, "checking node #" ITEM_ID_FORMAT " (still used by %u)",
+                         node->id, node->ways);
   assert_cmpnum_op(node->ways, >, 0);
   node->ways--;
 
@@ -1148,9 +1303,9 @@ void osm_t::way_delete(way_t *way, map_t *map, void (*unref)(node_t *))
   /* delete all nodes that aren't in other use now */
   node_chain_t &chain = way->node_chain;
   if(unref == nullptr)
-    std::for_each(chain.begin(), chain.end(), osm_unref_way_free(this));
+    std::for_each(chain.cbegin(), chain.cend(), osm_unref_way_free(this));
   else
-    std::for_each(chain.begin(), chain.end(), unref);
+    std::for_each(chain.cbegin(), chain.cend(), unref);
 
   /* there must not be anything left in this chain */
   assert_null(way->map_item);
@@ -1222,7 +1377,7 @@ void reverse_direction_sensitive_tags_functor::operator()(tag_t &etag)
       etag = tag_t::uncached(oneway, DS_ONEWAY_FWD);
       n_tags_altered++;
     } else {
-      printf("warning: unknown oneway value: %s\n", etag.value);
+      OSM2GO_LOG(Osm, Warning, "unknown oneway value: %s", etag.value);
     }
   } else if (etag.key_compare(sidewalk)) {
     if (etag.value_compare_ci(right)) {
@@ -1282,24 +1437,31 @@ void reverse_roles::operator()(const std::pair<item_id_t, relation_t *> &pair)
     return;
 
   // First find the member corresponding to our way:
-  const std::vector<member_t>::iterator mitEnd = relation->members.end();
-  std::vector<member_t>::iterator member = std::find(relation->members.begin(), mitEnd, way);
-  if(member == relation->members.end())
+  const std::vector<member_t>::const_iterator mitBegin = relation->members.cbegin();
+  const std::vector<member_t>::const_iterator mitEnd = relation->members.cend();
+  const std::vector<member_t>::const_iterator member = std::find(mitBegin, mitEnd, way);
+  if(member == mitEnd)
     return;
 
   // Then flip its role if it's one of the direction-sensitive ones
+  const char *nrole;
   if (member->role == nullptr) {
-    printf("null role in route relation -> ignore\n");
+    OSM2GO_LOG(Osm, Debug, "null role in route relation -> ignore");
+    return;
   } else if (member->role == DS_ROUTE_FORWARD || strcasecmp(member->role, DS_ROUTE_FORWARD) == 0) {
-    member->role = DS_ROUTE_REVERSE;
-    osm->mark_dirty(relation);
-    ++n_roles_flipped;
+    nrole = DS_ROUTE_REVERSE;
   } else if (member->role == DS_ROUTE_REVERSE || strcasecmp(member->role, DS_ROUTE_REVERSE) == 0) {
-    member->role = DS_ROUTE_FORWARD;
-    osm->mark_dirty(relation);
-    ++n_roles_flipped;
+    nrole = DS_ROUTE_FORWARD;
+  } else {
+    return;
   }
 
+  // mark dirty before the modification so the original object keeps the old role
+  const std::vector<member_t>::size_type idx = std::distance(mitBegin, member);
+  osm->mark_dirty(relation);
+  relation->members[idx].role = nrole;
+  ++n_roles_flipped;
+
   // TODO: what about numbered stops? Guess we ignore them; there's no
   // consensus about whether they should be placed on the way or to one side
   // of it.
@@ -1311,7 +1473,10 @@ way_t::reverse(osm_t::ref osm)
   std::pair<unsigned int, unsigned int> ret = std::make_pair<unsigned int, unsigned int>(0, 0);
 
   osm->mark_dirty(this);
-  tags.for_each(reverse_direction_sensitive_tags_functor(ret.first));
+  {
+    osm_t::TagChangeGuard guard(*osm, object_t(this));
+    tags.modify_each(reverse_direction_sensitive_tags_functor(ret.first));
+  }
 
   std::reverse(node_chain.begin(), node_chain.end());
 
@@ -1401,8 +1566,8 @@ void relation_transfer::operator()(const std::pair<item_id_t, relation_t *> &pai
   osm->mark_dirty(relation);
 
   for(; it != itEnd; it = std::find_if(std::next(it), itEnd, fc)) {
-    printf("way #" ITEM_ID_FORMAT " is part of relation #" ITEM_ID_FORMAT " at position %zu, adding way #" ITEM_ID_FORMAT "\n",
-           src->id, relation->id, std::distance(relation->members.begin(), it), dst->id);
+    OSM2GO_LOG(Osm, Debug, "way #" ITEM_ID_FORMAT " is part of relation #" ITEM_ID_FORMAT " at position %zu, adding way #" ITEM_ID_FORMAT,
+                           src->id, relation->id, std::distance(relation->members.begin(), it), dst->id);
 
     member_t m(object_t(dst), *it);
 
@@ -1423,7 +1588,7 @@ void relation_transfer::operator()(const std::pair<item_id_t, relation_t *> &pai
 
     // make dst member of the same relation
     if(insertBefore) {
-      printf("\tinserting before way #" ITEM_ID_FORMAT " to keep relation ordering\n", src->id);
+      OSM2GO_LOG(Osm, Debug, "\tinserting before way #" ITEM_ID_FORMAT " to keep relation ordering", src->id);
       it = relation->members.insert(it, m);
       // skip this object when calling fc again, it can't be the searched one
       it++;
@@ -1449,7 +1614,7 @@ way_t *way_t::split(osm_t::ref osm, node_chain_t::iterator cut_at, bool cut_at_n
    * split into two ways. Splitting closed ways is much less complex as there
    * will be no second way, the only modification done is the node chain. */
   if(is_closed()) {
-    printf("CLOSED WAY -> rotate by %zi\n", cut_at - node_chain.begin());
+    OSM2GO_LOG(Osm, Debug, "CLOSED WAY -> rotate by %zi", cut_at - node_chain.begin());
 
     // un-close the way
     node_chain.back()->ways--;
@@ -1515,22 +1680,29 @@ osm_t::TagMap tag_list_t::asMap() const
   osm_t::TagMap new_tags;
 
   if(!empty())
-    std::for_each(contents->begin(), contents->end(), tag_map_functor(new_tags));
+    std::for_each(contents.begin(), contents.end(), tag_map_functor(new_tags));
 
   return new_tags;
 }
 
 void tag_list_t::copy(const tag_list_t &other)
 {
-  assert(!contents);
+  assert(contents.empty());
 
   if(other.empty())
     return;
 
-  contents.reset(new std::vector<tag_t>());
-  contents->reserve(other.contents->size());
+  const std::vector<tag_t>::const_iterator itEnd = other.contents.end();
+  if(!std::any_of(other.contents.begin(), itEnd, tag_t::isDiscardable)) {
+    // nothing to filter, just share the data until one of the lists is modified
+    contents = other.contents;
+    return;
+  }
 
-  std::remove_copy_if(other.contents->begin(), other.contents->end(), std::back_inserter(*contents), tag_t::isDiscardable);
+  std::vector<tag_t> tags;
+  tags.reserve(other.contents.size());
+  std::remove_copy_if(other.contents.begin(), itEnd, std::back_inserter(tags), tag_t::isDiscardable);
+  contents.swap(tags);
 }
 
 member_t::member_t(object_t::type_t t) noexcept
@@ -1582,7 +1754,10 @@ template<typename T> const T *osm_t::findOriginalById(item_id_t id) const
 }
 
 osm_t::osm_t()
-  : uploadPolicy(Upload_Normal)
+  : namesRevision(0)
+  , revision(0)
+  , uploadPolicy(Upload_Normal)
+  , cacheGeneration(value_cache.newGeneration())
 {
   bounds.ll = pos_area(pos_t(NAN, NAN), pos_t(NAN, NAN));
 }
@@ -1605,6 +1780,8 @@ osm_t::~osm_t()
   std::for_each(original.ways.begin(), original.ways.end(), pairfree<const way_t>);
   std::for_each(original.nodes.begin(), original.nodes.end(), pairfree<const node_t>);
   std::for_each(original.relations.begin(), original.relations.end(), pairfree<const relation_t>);
+
+  value_cache.releaseGeneration(cacheGeneration);
 }
 
 osm_t::dirty_t::dirty_t(const osm_t &osm)
@@ -1668,27 +1845,173 @@ osm_t::dirty_t::counter<T>::counter(const osm_t &osm)
 namespace {
 
 template<typename T>
-inline void object_insert(std::map<item_id_t, T *> &map, T *o)
+inline void object_insert(std::map<item_id_t, T *> &map, T *o, tag_index_t *index)
 {
   bool b = map.insert(std::make_pair(o->id, o)).second;
   assert(b); (void)b;
+
+  if(index != nullptr)
+    index->add(object_t(o));
 }
 
 } // namespace
 
 void osm_t::insert(node_t *node)
 {
-  object_insert(nodes, node);
+  object_insert(nodes, node, tagIndex.get());
 }
 
 void osm_t::insert(way_t *way)
 {
-  object_insert(ways, way);
+  object_insert(ways, way, tagIndex.get());
 }
 
 void osm_t::insert(relation_t *relation)
 {
-  object_insert(relations, relation);
+  object_insert(relations, relation, tagIndex.get());
+}
+
+void osm_t::buildTagIndex()
+{
+  tagIndex.reset(new tag_index_t(*this));
+}
+
+namespace {
+
+template<typename T>
+class tag_query_scan {
+  const std::vector<tag_query_t::condition> &conditions;
+  std::vector<object_t> &result;
+public:
+  inline tag_query_scan(const std::vector<tag_query_t::condition> &c, std::vector<object_t> &r)
+    : conditions(c), result(r) {}
+  void operator()(const std::pair<item_id_t, T *> &pair)
+  {
+    if(!pair.second->tags.empty() && tag_query_t::matches(pair.second->tags, conditions))
+      result.push_back(object_t(pair.second));
+  }
+};
+
+template<typename T>
+void tag_scan(const std::map<item_id_t, T *> &map, object_t::type_t type, const tag_query_t &query,
+              const std::vector<tag_query_t::condition> &conditions, std::vector<object_t> &result)
+{
+  if(query.matchesType(type))
+    std::for_each(map.begin(), map.end(), tag_query_scan<T>(conditions, result));
+}
+
+} // namespace
+
+std::vector<object_t> osm_t::find_tagged(const tag_query_t &query) const
+{
+  if(tagIndex)
+    return tagIndex->find(query);
+
+  std::vector<object_t> ret;
+  std::vector<tag_query_t::condition> conditions;
+  if(!query.resolve(conditions))
+    return ret;
+
+  // the maps are sorted by id, and this is done in the order of the types
+  tag_scan(nodes, object_t::NODE, query, conditions, ret);
+  tag_scan(ways, object_t::WAY, query, conditions, ret);
+  tag_scan(relations, object_t::RELATION, query, conditions, ret);
+
+  return ret;
+}
+
+osm_t::TagChangeGuard::TagChangeGuard(osm_t &o, const object_t &obj)
+  : osm(o)
+  , index(o.tagIndex.get())
+  , object(obj)
+{
+  if(index != nullptr)
+    index->remove(object);
+}
+
+osm_t::TagChangeGuard::~TagChangeGuard()
+{
+  osm.invalidateNames();
+  if(index != nullptr)
+    index->add(object);
+}
+
+namespace {
+
+/**
+ * @brief sums up the memory of the objects in one of the object maps
+ */
+struct object_memory {
+  size_t objects;
+  size_t tags;
+  size_t members; ///< node chains and relation members
+
+  object_memory() : objects(0), tags(0), members(0) {}
+
+  inline size_t total() const
+  { return objects + tags + members; }
+
+  void add(const node_t *node)
+  {
+    objects += sizeof(*node);
+    tags += node->tags.memory_size();
+  }
+  void add(const way_t *way)
+  {
+    objects += sizeof(*way);
+    tags += way->tags.memory_size();
+    members += way->node_chain.memory_size();
+  }
+  void add(const relation_t *relation)
+  {
+    objects += sizeof(*relation);
+    tags += relation->tags.memory_size();
+    members += relation->members.memory_size();
+  }
+
+  template<typename K, typename T>
+  inline void operator()(const std::pair<K, T *> &pair)
+  { add(pair.second); }
+};
+
+struct user_memory {
+  size_t &bytes;
+  explicit inline user_memory(size_t &b) : bytes(b) {}
+  inline void operator()(const std::pair<const int, std::string> &pair)
+  { bytes += memory_usage::heap(pair.second); }
+};
+
+} // namespace
+
+void osm_t::memory_usage(memory_report &report) const
+{
+  const object_memory &nm = std::for_each(nodes.begin(), nodes.end(), object_memory());
+  const object_memory &wm = std::for_each(ways.begin(), ways.end(), object_memory());
+  const object_memory &rm = std::for_each(relations.begin(), relations.end(), object_memory());
+
+  report.add("nodes", nodes.size(), memory_usage::heap(nodes) + nm.objects);
+  report.add("ways", ways.size(), memory_usage::heap(ways) + wm.objects + wm.members);
+  report.add("relations", relations.size(), memory_usage::heap(relations) + rm.objects + rm.members);
+  report.add("tag lists", 0, nm.tags + wm.tags + rm.tags);
+
+  // the originals share their tags and members with the modified objects until those are changed
+  object_memory om;
+  om = std::for_each(original.nodes.begin(), original.nodes.end(), om);
+  om = std::for_each(original.ways.begin(), original.ways.end(), om);
+  om = std::for_each(original.relations.begin(), original.relations.end(), om);
+  report.add("original objects", original.nodes.size() + original.ways.size() + original.relations.size(),
+             memory_usage::heap(original.nodes) + memory_usage::heap(original.ways) +
+             memory_usage::heap(original.relations) + om.total());
+
+  report.add("object names", objectNames.size() + relationNames.size(),
+             memory_usage::heap(objectNames) + memory_usage::heap(relationNames));
+
+  if(tagIndex)
+    report.add("tag index", tagIndex->size(), tagIndex->memory_size());
+
+  size_t userBytes = memory_usage::heap(users);
+  std::for_each(users.begin(), users.end(), user_memory(userBytes));
+  report.add("users", users.size(), userBytes);
 }
 
 const base_object_t *
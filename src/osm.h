@@ -11,6 +11,7 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cinttypes>
 #include <cstdint>
 #include <cstdlib>
@@ -25,10 +26,12 @@
 #include <osm2go_annotations.h>
 #include <osm2go_cpp.h>
 #include <osm2go_i18n.h>
+#include <osm2go_log.h>
 #include "osm2go_stl.h"
 
 #include <libxml/parser.h>
 #include <libxml/tree.h>
+#include <libxml/xmlreader.h>
 
 #define OSM_FLAG_DIRTY    (1<<0)
 #define OSM_FLAG_DELETED  (1<<1)
@@ -42,11 +45,14 @@ typedef int64_t item_id_t;
 
 class base_object_t;
 class map_t;
+class memory_report;
 class node_t;
 class osm_t;
 class relation_t;
 class way_t;
 class tag_t;
+class tag_index_t;
+class tag_query_t;
 typedef std::vector<way_t *> way_chain_t;
 class xmlString;
 
@@ -196,6 +202,16 @@ class osm_t {
   template<typename T> const T *findOriginalById(item_id_t id) const;
   template<typename T> inline std::unordered_map<item_id_t, const T *> &originalObjects();
   template<typename T> inline const std::unordered_map<item_id_t, const T *> &originalObjects() const;
+
+  std::unique_ptr<tag_index_t> tagIndex; ///< nullptr until buildTagIndex() is called
+
+  /// the results of objectName() and relationName()
+  mutable std::unordered_map<const base_object_t *, trstring> objectNames;
+  mutable std::unordered_map<const relation_t *, trstring> relationNames;
+  mutable unsigned int namesRevision; ///< the value of revision when the cached names were created
+  unsigned int revision;              ///< incremented by modifications that may change the names of objects
+
+  void validateNames() const;
 public:
   typedef const std::unique_ptr<osm_t> &ref;
 
@@ -222,8 +238,8 @@ public:
 
       inline void debug(const char *prefix) const
       {
-        printf("%s new %2zu, dirty %2zu, deleted %2zu", prefix,
-               added.size(), changed.size(), deleted.size());
+        OSM2GO_LOG(Osm, Debug, "%s new %2zu, dirty %2zu, deleted %2zu", prefix,
+                               added.size(), changed.size(), deleted.size());
       }
     };
 
@@ -258,6 +274,7 @@ public:
   } original;
   std::map<int, std::string> users;   ///< mapping of user id to username
   UploadPolicy uploadPolicy;
+  const unsigned int cacheGeneration; ///< the value cache generation of the strings only used by this instance
 
   template<typename T>
   T *object_by_id(item_id_t id) const;
@@ -304,6 +321,16 @@ public:
 
   void remove_from_relations(object_t obj);
 
+  /// maps the relations to the index of the first member referencing an object
+  typedef std::unordered_map<const relation_t *, size_t> MembershipMap;
+
+  /**
+   * @brief collect all relations the given object is member of
+   *
+   * Deleted relations are ignored.
+   */
+  MembershipMap memberships(const object_t &obj) const;
+
   /**
    * @brief completely remove the object from the maps
    *
@@ -319,6 +346,32 @@ private:
 public:
   trstring unspecified_name(const object_t &obj) const;
 
+  /**
+   * @brief get the name of the object for display
+   *
+   * This is the same as object_t::get_name(), but the result is cached until
+   * the next modification of any object.
+   */
+  trstring objectName(const object_t &obj) const;
+
+  /**
+   * @brief get the name of the relation for display
+   *
+   * This is the same as relation_t::descriptiveNameOrId(), but the result is
+   * cached until the next modification of any object.
+   */
+  trstring relationName(const relation_t *relation) const;
+
+  /**
+   * @brief drop the cached names
+   *
+   * This is done automatically for all modifications done through this class,
+   * like mark_dirty() or updateTags(). Code that changes objects without
+   * marking them dirty must call this.
+   */
+  inline void invalidateNames() noexcept
+  { revision++; }
+
 private:
   template<typename T, typename _Predicate ENABLE_IF_CONVERTIBLE(T *, base_object_t *)> inline
   T *find_object(const std::map<item_id_t, T *> &map, _Predicate pred) const {
@@ -340,6 +393,9 @@ public:
   template<typename T ENABLE_IF_CONVERTIBLE(T *, base_object_t *)>
   void mark_dirty(T *obj)
   {
+    // the caller is about to change something
+    invalidateNames();
+
     // if already marked or never uploaded then don't store it in the original map
     if (obj->flags != 0 || obj->isNew())
       return;
@@ -358,6 +414,8 @@ public:
   template<typename T ENABLE_IF_CONVERTIBLE(T *, base_object_t *)>
   void unmark_dirty(T *obj)
   {
+    invalidateNames();
+
     obj->flags &= ~OSM_FLAG_DIRTY;
     unsigned int flags = obj->flags;
     assert_cmpnum(flags, 0); (void)flags;
@@ -429,6 +487,51 @@ public:
     return find_object(relations, pred);
   }
 
+  /**
+   * @brief create an index of all tags to speed up find_tagged()
+   *
+   * Once the index exists it is kept up to date for all tag changes done
+   * through this class. Code changing the tags of an object directly must
+   * use a TagChangeGuard for this.
+   */
+  void buildTagIndex();
+
+  inline bool hasTagIndex() const noexcept
+  { return static_cast<bool>(tagIndex); }
+
+  /**
+   * @brief find all objects matching the given tags
+   * @returns the matching objects sorted by type and id
+   *
+   * Without tag index all objects of the requested types are checked.
+   */
+  std::vector<object_t> find_tagged(const tag_query_t &query) const;
+
+  /**
+   * @brief add the memory used by the objects and their tags to the report
+   *
+   * The tag strings are not included, they live in the value cache.
+   */
+  void memory_usage(memory_report &report) const;
+
+  /**
+   * @brief keeps the tag index consistent while the tags of an object are changed
+   *
+   * The tags of the object must not be changed while the guard is being
+   * created, the index is updated again when it is destroyed. This also
+   * drops the cached names.
+   */
+  class TagChangeGuard {
+    osm_t &osm;
+    tag_index_t * const index;
+    const object_t object;
+    TagChangeGuard(const TagChangeGuard &) O2G_DELETED_FUNCTION;
+    TagChangeGuard &operator=(const TagChangeGuard &) O2G_DELETED_FUNCTION;
+  public:
+    TagChangeGuard(osm_t &osm, const object_t &obj);
+    ~TagChangeGuard();
+  };
+
   enum NodeDeleteFlags {
     NodeDeleteDefault,   ///< remove it from all ways and relations it is part of
     NodeDeleteKeepRefs,  ///< do not remove this node from ways and relations
@@ -462,16 +565,16 @@ public:
   trstring::native_type sanity_check() const;
 
   /**
-   * @brief parse the XML node for tag values
-   * @param a_node the XML node to parse
+   * @brief parse the current XML element for tag values
+   * @param reader the XML reader positioned on the tag element
    * @param tags the tag vector the new node is added to
    */
-  static void parse_tag(xmlNode* a_node, TagMap &tags);
+  static void parse_tag(xmlTextReaderPtr reader, TagMap &tags);
 
   void parse_relation_member(const xmlString &tp, const xmlString &refstr, const xmlString &role, std::vector<member_t> &members,
                              const std::unordered_map<item_id_t, item_id_t> *replacedNodeIds = nullptr,
                              const std::unordered_map<item_id_t, item_id_t> *replacedWayIds = nullptr);
-  void parse_relation_member(xmlNode *a_node, std::vector<member_t> &members,
+  void parse_relation_member(xmlTextReaderPtr reader, std::vector<member_t> &members,
                              const std::unordered_map<item_id_t, item_id_t> *replacedNodeIds = nullptr,
                              const std::unordered_map<item_id_t, item_id_t> *replacedWayIds = nullptr);
 
@@ -480,9 +583,30 @@ public:
    *
    * The reference count on the node will be incremented.
    */
-  node_t *parse_way_nd(xmlNode *a_node, const std::unordered_map<item_id_t, item_id_t> *replacedNodeIds) const;
+  node_t *parse_way_nd(xmlTextReaderPtr reader, const std::unordered_map<item_id_t, item_id_t> *replacedNodeIds) const;
+
+  /**
+   * @brief the state of a parser running in a background thread
+   */
+  struct parse_progress {
+    inline parse_progress() : fraction(0), cancel(false) {}
+
+    std::atomic<float> fraction;  ///< the part of the file already parsed, negative if unknown
+    std::atomic<bool> cancel;     ///< set from another thread to stop parsing
+  };
 
-  static osm_t *parse(const std::string &path, const std::string &filename);
+  /**
+   * @brief read OSM data from file
+   * @param path the directory of the file, used if filename has no path component
+   * @param filename the file to read
+   * @param progress the progress of the parser is stored here, or nullptr
+   * @returns the parsed data, nullptr on error or if parsing was cancelled
+   *
+   * If progress is given the function does not touch the user interface, so
+   * it may be run in a background thread. Otherwise pending GUI events are
+   * processed while parsing.
+   */
+  static osm_t *parse(const std::string &path, const std::string &filename, parse_progress *progress = nullptr);
 
   /**
    * @brief check if a TagMap contains the other
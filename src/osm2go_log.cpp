@@ -0,0 +1,137 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Rolf Eike Beer <eike@sf-mail.de>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "osm2go_log.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+
+const char *categoryNames[osm2go_log::NumCategories] = {
+  "osm",
+  "parser",
+  "map",
+  "edit",
+  "track",
+  "diff",
+  "project",
+  "style",
+  "presets",
+  "net",
+  "wms",
+  "gpsmap",
+  "ui",
+  "perf"
+};
+
+const char *levelNames[] = {
+  "error",
+  "warning",
+  "info",
+  "debug",
+  "trace"
+};
+
+int findName(const char **names, unsigned int count, const std::string &name)
+{
+  for(unsigned int i = 0; i < count; i++)
+    if(name == names[i])
+      return i;
+  return -1;
+}
+
+/**
+ * @brief apply the settings from the environment at startup
+ */
+struct env_config {
+  env_config()
+  {
+    const char *spec = getenv("OSM2GO_LOG");
+    if(spec != nullptr && !osm2go_log::configure(spec))
+      fprintf(stderr, "invalid entries in OSM2GO_LOG: %s\n", spec);
+  }
+};
+
+env_config envConfig;
+
+} // namespace
+
+unsigned char osm2go_log::thresholds[osm2go_log::NumCategories] = {
+  Info, Info, Info, Info, Info, Info, Info, Info, Info, Info, Info, Info, Info, Info
+};
+
+void osm2go_log::write(Category, Level level, const char *fmt, ...)
+{
+  va_list args;
+  va_start(args, fmt);
+
+  // keep messages from different threads apart
+  flockfile(stdout);
+  if(level < Info) {
+    fputs(levelNames[level], stdout);
+    fputs(": ", stdout);
+  }
+  vfprintf(stdout, fmt, args);
+  putc_unlocked('\n', stdout);
+  funlockfile(stdout);
+
+  va_end(args);
+}
+
+bool osm2go_log::configure(const char *spec)
+{
+  const unsigned int levelCount = sizeof(levelNames) / sizeof(levelNames[0]);
+  bool ret = true;
+
+  while(*spec != '\0') {
+    const char *end = strchr(spec, ',');
+    if(end == nullptr)
+      end = spec + strlen(spec);
+    const std::string entry(spec, end);
+    spec = *end == ',' ? end + 1 : end;
+
+    if(entry.empty())
+      continue;
+
+    std::string::size_type eq = entry.find('=');
+    int category = -1;
+    int level;
+    if(eq == std::string::npos) {
+      level = findName(levelNames, levelCount, entry);
+    } else {
+      category = findName(categoryNames, NumCategories, entry.substr(0, eq));
+      level = findName(levelNames, levelCount, entry.substr(eq + 1));
+      if(unlikely(category < 0)) {
+        ret = false;
+        continue;
+      }
+    }
+
+    if(unlikely(level < 0)) {
+      ret = false;
+    } else if(category < 0) {
+      memset(thresholds, level, sizeof(thresholds));
+    } else {
+      thresholds[category] = level;
+    }
+  }
+
+  return ret;
+}
+
+void osm2go_log::reset()
+{
+  memset(thresholds, Info, sizeof(thresholds));
+}
+
+const char *osm2go_log::categoryName(Category category)
+{
+  return categoryNames[category];
+}
@@ -0,0 +1,103 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Rolf Eike Beer <eike@sf-mail.de>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+/**
+ * @file osm2go_log.h
+ *
+ * Diagnostic messages sorted by category and level.
+ *
+ * Messages with a level above OSM2GO_LOG_MAX_LEVEL are removed at compile
+ * time. The others are only formatted if their level is enabled for their
+ * category at runtime. This is configured with the environment variable
+ * OSM2GO_LOG, e.g. "OSM2GO_LOG=debug" or "OSM2GO_LOG=warning,map=trace,net=debug".
+ * By default everything up to Info is shown.
+ */
+
+#include <osm2go_annotations.h>
+
+namespace osm2go_log {
+
+enum Category {
+  Osm,        ///< the OSM data and its modification
+  Parser,     ///< reading OSM data
+  Map,        ///< drawing and user interaction with the map
+  Edit,       ///< map editing operations
+  Track,      ///< GPS tracks
+  Diff,       ///< saving and restoring local changes
+  Project,    ///< project handling
+  Style,      ///< map styles
+  Presets,    ///< tagging presets
+  Net,        ///< network access and communication with the OSM API
+  Wms,        ///< WMS background images
+  GpsMap,     ///< the GPS map widget
+  Ui,         ///< other user interface code
+  Perf,       ///< the timing instrumentation
+  NumCategories
+};
+
+enum Level {
+  Error,
+  Warning,
+  Info,
+  Debug,
+  Trace
+};
+
+/**
+ * @brief the highest enabled level for every category
+ */
+extern unsigned char thresholds[NumCategories];
+
+inline bool enabled(Category category, Level level)
+{
+  return static_cast<unsigned int>(level) <= thresholds[category];
+}
+
+/**
+ * @brief format and print a message
+ *
+ * The message is terminated by a newline, it is not needed in fmt.
+ */
+void write(Category category, Level level, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+/**
+ * @brief change the runtime thresholds
+ * @param spec a comma separated list of "level" or "category=level" entries
+ * @returns if spec could be parsed completely
+ *
+ * Entries are applied in order, a plain level sets all categories. Invalid
+ * entries are ignored.
+ */
+bool configure(const char *spec);
+
+/**
+ * @brief reset all categories to the default threshold
+ */
+void reset();
+
+const char *categoryName(Category category);
+
+} // namespace osm2go_log
+
+#ifndef OSM2GO_LOG_MAX_LEVEL
+#define OSM2GO_LOG_MAX_LEVEL 4
+#endif
+
+/**
+ * @brief print a diagnostic message
+ * @param category a value of osm2go_log::Category without the namespace
+ * @param level a value of osm2go_log::Level without the namespace
+ *
+ * The arguments are only evaluated if the message is enabled.
+ */
+#define OSM2GO_LOG(category, level, ...) \
+  do { \
+    if(osm2go_log::level <= OSM2GO_LOG_MAX_LEVEL && \
+       unlikely(osm2go_log::enabled(osm2go_log::category, osm2go_log::level))) \
+      osm2go_log::write(osm2go_log::category, osm2go_log::level, __VA_ARGS__); \
+  } while(0)
@@ -15,7 +15,9 @@
 #include "net_io.h"
 #include "notifications.h"
 #include "osm.h"
+#include <osm2go_log.h>
 #include "osm2go_platform.h"
+#include "perf_trace.h"
 #include "project.h"
 #include "settings.h"
 #include "uicontrol.h"
@@ -41,7 +43,7 @@
 
 bool osm_download(osm2go_platform::Widget *parent, project_t *project)
 {
-  printf("download osm for %s ...\n", project->name.c_str());
+  OSM2GO_LOG(Net, Info, "download osm for %s ...", project->name.c_str());
   settings_t::ref settings = settings_t::instance();
   const std::string &defaultServer = settings->server;
 
@@ -53,7 +55,7 @@ bool osm_download(osm2go_platform::Widget *parent, project_t *project)
                   parent);
     } else if(unlikely(ends_with(project->rserver, '/'))) {
       /* server url should not end with a slash */
-      printf("removing trailing slash\n");
+      OSM2GO_LOG(Net, Debug, "removing trailing slash");
       project->rserver.resize(project->rserver.size() - 1);
     }
 
@@ -104,7 +106,7 @@ bool osm_download(osm2go_platform::Widget *parent, project_t *project)
   osmData.reset();
 
   /* if there's a new file use this from now on */
-  printf("download ok, replacing previous file\n");
+  OSM2GO_LOG(Net, Info, "download ok, replacing previous file");
 
   if(wasGzip != isGzip) {
     const std::string oldfname = (project->osmFile[0] == '/' ? std::string() : project->path) +
@@ -264,7 +266,7 @@ osm_update_item(osm_upload_context_t &context, xmlChar *xml_str,
       }
     } else {
       /* this will return the id on a successful create */
-      printf("request to parse successful reply '%s'\n", write_data.c_str());
+      OSM2GO_LOG(Net, Debug, "request to parse successful reply '%s'", write_data.c_str());
       item_id_t result = strtoull(write_data.c_str(), nullptr, 10);
       context.append(trstring(format).arg(result), COLOR_OK);
 
@@ -347,6 +349,7 @@ osm_post_xml(osm_upload_context_t &context, const xmlString &xml_str, int len,
 bool
 upload_object(osm_upload_context_t &context, base_object_t *obj, bool is_new)
 {
+  PERF_SCOPE("upload_object");
   /* make sure gui gets updated */
   osm2go_platform::process_events();
 
@@ -365,7 +368,7 @@ upload_object(osm_upload_context_t &context, base_object_t *obj, bool is_new)
   /* upload this object */
   xmlString xml_str(obj->generate_xml(context.changeset));
   if(likely(xml_str)) {
-    printf("uploading %s " ITEM_ID_FORMAT " to %s\n", obj->apiString(), obj->id, url.c_str());
+    OSM2GO_LOG(Net, Debug, "uploading %s " ITEM_ID_FORMAT " to %s", obj->apiString(), obj->id, url.c_str());
 
     std::optional<item_id_t> id = osm_update_item(context, xml_str.get(), url.c_str(), is_new ? _("ok: id #%1\n") : _("ok: version #%1\n"));
     if(id) {
@@ -478,7 +481,7 @@ osm_create_changeset(osm_upload_context_t &context)
   /* create changeset request */
   xmlString xml_str(osm_generate_xml_changeset(context.comment, context.src));
   if(xml_str) {
-    printf("creating changeset %s from address %p\n", url.c_str(), xml_str.get());
+    OSM2GO_LOG(Net, Debug, "creating changeset %s from address %p", url.c_str(), xml_str.get());
 
     std::optional<item_id_t> changeset = osm_update_item(context, xml_str.get(), url.c_str(), _("ok: id #%1\n"));
     if(changeset) {
@@ -509,6 +512,7 @@ osm_close_changeset(osm_upload_context_t &context)
 
 void osm_upload_context_t::upload(const osm_t::dirty_t &dirty, osm2go_platform::Widget *parent)
 {
+  PERF_SCOPE("osm_upload");
   append(trstring("Log generated by %1 v%2 using API 0.6\n").arg(PACKAGE).arg(VERSION));
   append(trstring("User comment: %1\n").arg(comment));
   if (!src.empty())
@@ -539,7 +543,7 @@ void osm_upload_context_t::upload(const osm_t::dirty_t &dirty, osm2go_platform::
       xmlDocGuard doc(osmchange_init());
       osmchange_delete(dirty, xmlDocGetRootElement(doc.get()), changeset.c_str());
 
-      printf("deleting objects on server\n");
+      OSM2GO_LOG(Net, Debug, "deleting objects on server");
       append(_("Uploading object deletions "));
 
       // deletion was successful, remove the objects
@@ -613,7 +617,7 @@ void osm_upload(appdata_t &appdata)
 {
   project_t::ref project = appdata.project;
   if(unlikely(project->osm->uploadPolicy == osm_t::Upload_Blocked)) {
-    printf("Upload prohibited");
+    OSM2GO_LOG(Net, Warning, "Upload prohibited");
     return;
   }
 
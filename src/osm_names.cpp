@@ -14,6 +14,7 @@
 #include "osm_p.h"
 
 #include "osm_objects.h"
+#include "tag_index.h"
 
 #include <algorithm>
 #include <array>
@@ -33,30 +34,28 @@
 
 namespace {
 
-class typed_relation_member_functor {
+class relation_member_functor {
   const member_t member;
-  const char * const type;
 public:
-  inline typed_relation_member_functor(const char *t, const char *r, const object_t &o)
-    : member(o, r), type(value_cache.insert(t)) {}
-  bool operator()(const std::pair<item_id_t, relation_t *> &it) const
-  { return it.second->tags.get_value("type") == type &&
-           std::find(it.second->members.begin(), it.second->members.end(), member) != it.second->members.end(); }
+  inline relation_member_functor(const char *r, const object_t &o)
+    : member(o, r) {}
+  bool operator()(const object_t &rel) const
+  {
+    const relation_t * const r = static_cast<relation_t *>(rel);
+    return std::find(r->members.cbegin(), r->members.cend(), member) != r->members.cend();
+  }
 };
 
-class pt_relation_member_functor {
-  const member_t member;
-  const char * const type;
-  const char * const stop_area;
-public:
-  inline pt_relation_member_functor(const char *r, const object_t &o)
-    : member(o, r), type(value_cache.insert("public_transport"))
-    , stop_area(value_cache.insert("stop_area")) {}
-  bool operator()(const std::pair<item_id_t, relation_t *> &it) const
-  { return it.second->tags.get_value("type") == type &&
-           it.second->tags.get_value("public_transport") == stop_area &&
-           std::find(it.second->members.begin(), it.second->members.end(), member) != it.second->members.end(); }
-};
+/**
+ * @brief find the first relation matching query that has obj as member with the given role
+ */
+const relation_t *findMemberRelation(const osm_t &osm, const tag_query_t &query, const char *role, const object_t &obj)
+{
+  const std::vector<object_t> rels = osm.find_tagged(query);
+  const std::vector<object_t>::const_iterator it = std::find_if(rels.begin(), rels.end(),
+                                                                relation_member_functor(role, obj));
+  return it == rels.end() ? nullptr : static_cast<relation_t *>(*it);
+}
 
 /**
  * @brief remove underscores from string and replace them by spaces
@@ -246,7 +245,8 @@ std::optional<nameParts> describeBuilding(const osm_t &osm, const object_t &obj,
 
   if(street == nullptr) {
     // check if there is an "associatedStreet" relation where this is a "house" member
-    const relation_t *astreet = osm.find_relation(typed_relation_member_functor("associatedStreet", "house", obj));
+    const relation_t *astreet = findMemberRelation(osm, tag_query_t("type", "associatedStreet", tag_query_t::Relations),
+                                                   "house", obj);
     if(astreet != nullptr)
       street = astreet->tags.get_value("name");
   }
@@ -531,7 +531,9 @@ nameParts nameElements(const osm_t &osm, const object_t &obj, const bool useLife
                           strcmp(rawValue, "platform") == 0 ? rawValue :
                           nullptr;
       if(ptkey != nullptr) {
-        const relation_t *stoparea = osm.find_relation(pt_relation_member_functor(ptkey, obj));
+        const relation_t *stoparea = findMemberRelation(osm, tag_query_t("type", "public_transport", tag_query_t::Relations)
+                                                              .andTag("public_transport", "stop_area"),
+                                                        ptkey, obj);
         if(stoparea != nullptr)
           ret.name = stoparea->tags.get_value("name");
       }
@@ -621,7 +623,7 @@ trstring osm_t::unspecified_name(const object_t &obj) const
   for (std::map<item_id_t, relation_t *>::const_iterator it = relations.begin(); it != itEnd && rtype < 3; it++) {
     // ignore all relations where obj is no member
     const std::vector<member_t>::const_iterator mit = it->second->find_member_object(obj);
-    if (mit == it->second->members.end())
+    if (mit == it->second->members.cend())
       continue;
 
     int nrtype = Member;
@@ -724,6 +726,39 @@ object_t::get_name(const osm_t &osm) const
   }
 }
 
+void osm_t::validateNames() const
+{
+  if (namesRevision == revision)
+    return;
+
+  objectNames.clear();
+  relationNames.clear();
+  namesRevision = revision;
+}
+
+trstring osm_t::objectName(const object_t &obj) const
+{
+  validateNames();
+
+  const base_object_t * const o = static_cast<base_object_t *>(obj);
+  std::unordered_map<const base_object_t *, trstring>::const_iterator it = objectNames.find(o);
+  if (it == objectNames.end())
+    it = objectNames.insert(std::make_pair(o, obj.get_name(*this))).first;
+
+  return it->second;
+}
+
+trstring osm_t::relationName(const relation_t *relation) const
+{
+  validateNames();
+
+  std::unordered_map<const relation_t *, trstring>::const_iterator it = relationNames.find(relation);
+  if (it == relationNames.end())
+    it = relationNames.insert(std::make_pair(relation, relation->descriptiveNameOrId())).first;
+
+  return it->second;
+}
+
 const char *
 relation_t::descriptiveName() const
 {
@@ -17,6 +17,7 @@
 #include "osm2go_annotations.h"
 #include <osm2go_cpp.h>
 #include <osm2go_i18n.h>
+#include <osm2go_log.h>
 #include <osm2go_platform.h>
 
 static_assert(sizeof(tag_list_t) == sizeof(tag_t *), "tag_list_t is not exactly as big as a pointer");
@@ -26,12 +27,23 @@ const char *tag_t::mapToCache(const char *v)
   return value_cache.insert(v);
 }
 
+const char *tag_t::mapToCache(const std::string &v)
+{
+  return value_cache.insert(v.c_str(), v.size());
+}
+
 tag_t::tag_t(const char *k, const char *v)
   : key(mapToCache(k))
   , value(mapToCache(v))
 {
 }
 
+tag_t::tag_t(const std::string &k, const std::string &v)
+  : key(mapToCache(k))
+  , value(mapToCache(v))
+{
+}
+
 namespace {
 
 struct find_discardable_key {
@@ -57,13 +69,12 @@ tag_list_t::operator==(const tag_list_t &other) const
   if (other.empty())
     return empty();
 
-  // now it is safe to dereference as the vector must exist and can't be empty
-  return operator==(*other.contents);
+  return operator==(static_cast<const std::vector<tag_t> &>(other.contents));
 }
 
 bool tag_list_t::empty() const noexcept
 {
-  return !contents || contents->empty();
+  return contents.empty();
 }
 
 bool tag_list_t::hasNonDiscardableTags() const noexcept
@@ -71,8 +82,8 @@ bool tag_list_t::hasNonDiscardableTags() const noexcept
   if(empty())
     return false;
 
-  const std::vector<tag_t>::const_iterator itEnd = contents->end();
-  return std::any_of(std::cbegin(*contents), itEnd, tag_t::is_non_discardable);
+  const std::vector<tag_t>::const_iterator itEnd = contents.end();
+  return std::any_of(contents.begin(), itEnd, tag_t::is_non_discardable);
 }
 
 static bool isRealTag(const tag_t &tag)
@@ -85,8 +96,8 @@ bool tag_list_t::hasRealTags() const noexcept
   if(empty())
     return false;
 
-  const std::vector<tag_t>::const_iterator itEnd = contents->end();
-  return std::any_of(std::cbegin(*contents), itEnd, isRealTag);
+  const std::vector<tag_t>::const_iterator itEnd = contents.end();
+  return std::any_of(contents.begin(), itEnd, isRealTag);
 }
 
 const tag_t *tag_list_t::singleTag() const noexcept
@@ -94,8 +105,8 @@ const tag_t *tag_list_t::singleTag() const noexcept
   if(unlikely(empty()))
     return nullptr;
 
-  const std::vector<tag_t>::const_iterator itEnd = contents->end();
-  const std::vector<tag_t>::const_iterator it = std::find_if(std::cbegin(*contents), itEnd, isRealTag);
+  const std::vector<tag_t>::const_iterator itEnd = contents.end();
+  const std::vector<tag_t>::const_iterator it = std::find_if(contents.begin(), itEnd, isRealTag);
   if(unlikely(it == itEnd))
     return nullptr;
   if (std::any_of(std::next(it), itEnd, isRealTag))
@@ -127,8 +138,8 @@ const char* tag_list_t::get_value(const char *key) const
   if(unlikely(cacheKey == nullptr))
     return nullptr;
 
-  const std::vector<tag_t>::const_iterator itEnd = contents->end();
-  const std::vector<tag_t>::const_iterator it = std::find_if(std::cbegin(*contents),
+  const std::vector<tag_t>::const_iterator itEnd = contents.end();
+  const std::vector<tag_t>::const_iterator it = std::find_if(contents.begin(),
                                                              itEnd, key_match_functor(cacheKey));
   if(it != itEnd)
     return it->value;
@@ -159,22 +170,9 @@ void tag_list_t::replace(std::vector<tag_t> &&ntags)
     return;
   }
 
-  if(!contents) {
-#if __cplusplus >= 201103L
-    contents.reset(new std::vector<tag_t>(std::move(ntags)));
-#else
-    contents.reset(new std::vector<tag_t>(ntags.size(), tag_t::uncached(nullptr, nullptr)));
-    contents->swap(ntags);
-#endif
-  } else {
-#if __cplusplus >= 201103L
-    *contents = std::move(ntags);
-#else
-    contents->swap(ntags);
-#endif
-  }
-
-  shrink_to_fit(*contents);
+  shrink_to_fit(ntags);
+  contents.swap(ntags);
+  ntags.clear();
 }
 
 namespace {
@@ -187,7 +185,7 @@ public:
     if(unlikely(tag_t::is_discardable(p.first.c_str())))
       return;
 
-    tags.push_back(tag_t(p.first.c_str(), p.second.c_str()));
+    tags.push_back(tag_t(p.first, p.second));
   }
 };
 
@@ -199,9 +197,10 @@ void tag_list_t::replace(const osm_t::TagMap &ntags)
   if(ntags.empty())
     return;
 
-  contents.reset(new std::vector<tag_t>());
-  contents->reserve(ntags.size());
-  std::for_each(ntags.begin(), ntags.end(), tag_fill_functor(*contents));
+  std::vector<tag_t> tags;
+  tags.reserve(ntags.size());
+  std::for_each(ntags.begin(), ntags.end(), tag_fill_functor(tags));
+  contents.swap(tags);
 }
 
 base_object_t::base_object_t(const base_attributes &attr) noexcept
@@ -300,7 +299,7 @@ node_t *way_t::insert_node(osm_t::ref osm, unsigned int position, lpos_t coords)
 
 bool way_t::merge(way_t *other, osm_t *osm, map_t *map, const std::vector<relation_t *> &rels)
 {
-  printf("  request to extend way #" ITEM_ID_FORMAT "\n", other->id);
+  OSM2GO_LOG(Osm, Debug, "  request to extend way #" ITEM_ID_FORMAT, other->id);
 
   // drop the visible items
   other->item_chain_destroy(map);
@@ -311,28 +310,33 @@ bool way_t::merge(way_t *other, osm_t *osm, map_t *map, const std::vector<relati
   osm->mark_dirty(this);
   osm->mark_dirty(other);
 
-  const bool collision = tags.merge(other->tags);
+  bool collision;
+  {
+    osm_t::TagChangeGuard guard(*osm, object_t(this));
+    osm_t::TagChangeGuard otherGuard(*osm, object_t(other));
+    collision = tags.merge(other->tags);
+  }
 
   /* make enough room for all nodes */
   node_chain.reserve(node_chain.size() + other->node_chain.size() - 1);
 
   if(other->node_chain.front() == node_chain.front()) {
-    printf("  need to prepend\n");
+    OSM2GO_LOG(Osm, Debug, "  need to prepend");
     node_chain.insert(node_chain.begin(), other->node_chain.rbegin(), std::prev(other->node_chain.rend()));
 
     other->node_chain.resize(1);
   } else if(other->node_chain.back() == node_chain.front()) {
-    printf("  need to prepend\n");
+    OSM2GO_LOG(Osm, Debug, "  need to prepend");
     node_chain.insert(node_chain.begin(), other->node_chain.begin(), std::prev(other->node_chain.end()));
 
     other->node_chain.erase(other->node_chain.begin(), std::prev(other->node_chain.end()));
   } else if(other->node_chain.back() == node_chain.back()) {
-    printf("  need to append\n");
+    OSM2GO_LOG(Osm, Debug, "  need to append");
     node_chain.insert(node_chain.end(), std::next(other->node_chain.rbegin()), other->node_chain.rend());
 
     other->node_chain.erase(other->node_chain.begin(), std::prev(other->node_chain.end()));
   } else {
-    printf("  need to append\n");
+    OSM2GO_LOG(Osm, Debug, "  need to append");
     node_chain.insert(node_chain.end(), std::next(other->node_chain.begin()), other->node_chain.end());
 
     other->node_chain.resize(1);
@@ -424,6 +428,7 @@ void relation_t::updateMembers(std::vector<member_t> &newMembers, osm_t::ref osm
 
   // the object is already marked dirty, so we can modify at will
   members.swap(newMembers);
+  osm->invalidateNames();
 
   // everything back to normal
   if (*this == *orig)
@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include "cow_vector.h"
 #include "osm.h"
 #include "pos.h"
 
@@ -21,9 +22,11 @@ class tag_t {
     : key(k), value(v) {}
 
   static const char *mapToCache(const char *v);
+  static const char *mapToCache(const std::string &v);
 public:
   const char *key, *value;
   tag_t(const char *k, const char *v);
+  tag_t(const std::string &k, const std::string &v);
 
   /**
    * @brief return a tag_t where key and value are not backed by the value cache
@@ -80,7 +83,7 @@ public:
 
 class tag_list_t {
 public:
-  inline tag_list_t() noexcept : contents(nullptr) {}
+  inline tag_list_t() noexcept {}
 
   bool operator==(const tag_list_t &other) const;
   inline bool operator!=(const tag_list_t &other) const
@@ -112,16 +115,20 @@ public:
 
   template<typename _Predicate>
   bool contains(_Predicate pred) const {
-    if(!contents)
-      return false;
-    const std::vector<tag_t>::const_iterator itEnd = contents->end();
-    return std::any_of(std::cbegin(*contents), itEnd, pred);
+    return std::any_of(contents.begin(), contents.end(), pred);
   }
 
   template<typename _Predicate>
   void for_each(_Predicate pred) const {
-    if(contents)
-      std::for_each(contents->begin(), contents->end(), pred);
+    std::for_each(contents.begin(), contents.end(), pred);
+  }
+
+  /**
+   * @brief like for_each(), but pred may modify the tags
+   */
+  template<typename _Predicate>
+  void modify_each(_Predicate pred) {
+    std::for_each(contents.begin(), contents.end(), pred);
   }
 
   /**
@@ -129,7 +136,7 @@ public:
    */
   inline void clear()
   {
-    contents.reset();
+    contents.clear();
   }
 
   /**
@@ -140,7 +147,7 @@ public:
   void copy(const tag_list_t &other);
 
   inline void swap(tag_list_t &other)
-  { std::swap(contents, other.contents); }
+  { contents.swap(other.contents); }
 
   /**
    * @brief replace the current tags with the given ones
@@ -180,10 +187,19 @@ public:
    */
   bool hasTagCollisions() const;
 
+  /**
+   * @brief the memory used for the tag list
+   *
+   * The strings are not included, they live in the value cache.
+   */
+  inline size_t memory_size() const noexcept
+  { return contents.memory_size(); }
+
 private:
   // do not directly use a vector here as many objects do not have
-  // any tags and that would waste too much memory
-  std::unique_ptr<std::vector<tag_t> > contents;
+  // any tags and that would waste too much memory. The list is shared
+  // with the original object when the object is modified.
+  cow_vector<tag_t> contents;
 };
 
 class base_object_t : public base_attributes {
@@ -263,6 +279,12 @@ public:
   void item_chain_destroy(map_t *map);
 };
 
+#ifdef COMPACT_NODE_POS
+typedef pos_fixed_t node_pos_t;
+#else
+typedef pos_t node_pos_t;
+#endif
+
 class node_t : public visible_item_t {
 public:
   node_t(const base_attributes &attr, const lpos_t lp = lpos_t(), const pos_t &p = pos_t()) noexcept
@@ -280,7 +302,7 @@ public:
   { return !operator==(other); }
 
   unsigned int ways;
-  pos_t pos;
+  node_pos_t pos;
   lpos_t lpos;
 
   const char *apiString() const noexcept override {
@@ -293,7 +315,7 @@ protected:
   void generate_xml_custom(xmlNodePtr xml_node) const override;
 };
 
-typedef std::vector<node_t *> node_chain_t;
+typedef cow_vector<node_t *> node_chain_t;
 
 #define OSM_DRAW_FLAG_AREA  (1<<0)
 #define OSM_DRAW_FLAG_BG    (1<<1)
@@ -375,6 +397,7 @@ public:
   const node_t *last_node() const noexcept;
   const node_t *first_node() const noexcept;
   void write_node_chain(xmlNodePtr way_node) const;
+  void write_node_chain(xmlTextWriterPtr writer) const;
 
   const char *apiString() const noexcept override {
     return api_string();
@@ -432,7 +455,7 @@ public:
   inline bool operator!=(const relation_t &other) const
   { return !operator==(other); }
 
-  std::vector<member_t> members;
+  cow_vector<member_t> members;
 
   std::vector<member_t>::const_iterator find_member_object(const object_t &o, std::vector<member_t>::const_iterator it) const;
   inline std::vector<member_t>::const_iterator find_member_object(const object_t &o) const
@@ -498,6 +521,7 @@ public:
   trstring idName() const;
 
   void generate_member_xml(xmlNodePtr xml_node) const;
+  void generate_member_xml(xmlTextWriterPtr writer) const;
 
   bool is_multipolygon() const;
 
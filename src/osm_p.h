@@ -7,6 +7,9 @@
 #pragma once
 
 #include "cache_set.h"
+#include "pos.h"
+
+#include <vector>
 
 struct relation_object_replacer {
   osm_t * const osm;
@@ -26,4 +29,32 @@ struct find_member_object_functor {
   }
 };
 
+/**
+ * @brief collects nodes to calculate their screen positions in batches
+ *
+ * Calculating the projection for a whole batch of nodes at once is cheaper
+ * than doing it one by one (see bounds_t::project()). The screen positions
+ * of the added nodes are only valid after flush() has been called.
+ */
+class node_projector {
+  enum { batch_size = 256 };
+
+  const bounds_t &bounds;
+  std::vector<node_t *> nodes;
+  std::vector<pos_float_t> lat, lon;
+  std::vector<int> x, y;
+
+public:
+  explicit node_projector(const bounds_t &b);
+
+  void add(node_t *node);
+  /**
+   * @brief forget about a node that was added before
+   *
+   * Use this before deleting a node that has not been flushed yet.
+   */
+  void remove(const node_t *node);
+  void flush();
+};
+
 extern cache_set value_cache; ///< the cache for key, value, and role strings
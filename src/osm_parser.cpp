@@ -10,9 +10,11 @@
 #endif
 
 #include "osm.h"
+#include "osm_p.h"
 
 #include "osm_objects.h"
 #include "misc.h"
+#include "perf_trace.h"
 #include "pos.h"
 
 #include <algorithm>
@@ -23,13 +25,18 @@
 #include <ctime>
 #include <string>
 #include <strings.h>
+#include <sys/stat.h>
+#include <vector>
 
 #include <libxml/parser.h>
 #include <libxml/tree.h>
 #include <libxml/xmlreader.h>
 
+#include <string_view.hpp>
+
 #include "osm2go_annotations.h"
 #include <osm2go_cpp.h>
+#include <osm2go_log.h>
 #include <osm2go_platform.h>
 
 #ifndef LIBXML_TREE_ENABLED
@@ -107,14 +114,14 @@ convert_iso8601(const char *str)
 
 /* -------------------- tag handling ----------------------- */
 
-void osm_t::parse_tag(xmlNode *a_node, TagMap &tags)
+void osm_t::parse_tag(xmlTextReaderPtr reader, TagMap &tags)
 {
-  xmlString key(xmlGetProp(a_node, BAD_CAST "k"));
-  xmlString value(xmlGetProp(a_node, BAD_CAST "v"));
+  xmlString key(xmlTextReaderGetAttribute(reader, BAD_CAST "k"));
+  xmlString value(xmlTextReaderGetAttribute(reader, BAD_CAST "v"));
 
   if(unlikely(key.empty() || value.empty())) {
-    printf("empty attribute for tag: k='%s' v='%s'\n", static_cast<const char *>(key),
-           static_cast<const char *>(value));
+    OSM2GO_LOG(Parser, Warning, "empty attribute for tag: k='%s' v='%s'", static_cast<const char *>(key),
+                                static_cast<const char *>(value));
     return;
   }
 
@@ -122,8 +129,8 @@ void osm_t::parse_tag(xmlNode *a_node, TagMap &tags)
   const std::string v = reinterpret_cast<char *>(value.get());
 
   if(unlikely(tags.findTag(k, v) != tags.end())) {
-    printf("duplicate tag: k='%s' v='%s'\n", static_cast<const char *>(key),
-           static_cast<const char *>(value));
+    OSM2GO_LOG(Parser, Warning, "duplicate tag: k='%s' v='%s'", static_cast<const char *>(key),
+                                static_cast<const char *>(value));
     return;
   }
 
@@ -139,7 +146,7 @@ item_id_t checkReplacedId(const char *type, item_id_t id, const std::unordered_m
   if (replacedNodeIds != nullptr) {
     const std::unordered_map<item_id_t, item_id_t>::const_iterator it = replacedNodeIds->find(id);
     if (it != replacedNodeIds->end()) {
-      printf("Reference to %s id " ITEM_ID_FORMAT " replaced with " ITEM_ID_FORMAT "\n", type, id, it->second);
+      OSM2GO_LOG(Parser, Debug, "Reference to %s id " ITEM_ID_FORMAT " replaced with " ITEM_ID_FORMAT, type, id, it->second);
       id = it->second;
     }
   }
@@ -157,7 +164,7 @@ node_t *parse_node_ref(const xmlString &prop, const osm_t *osm, const std::unord
     /* search matching node */
     node = osm->object_by_id<node_t>(id);
     if(unlikely(node == nullptr))
-      printf("Node id " ITEM_ID_FORMAT " not found\n", id);
+      OSM2GO_LOG(Parser, Warning, "Node id " ITEM_ID_FORMAT " not found", id);
     else
       node->ways++;
   }
@@ -167,9 +174,9 @@ node_t *parse_node_ref(const xmlString &prop, const osm_t *osm, const std::unord
 
 } // namespace
 
-node_t *osm_t::parse_way_nd(xmlNode *a_node, const std::unordered_map<item_id_t, item_id_t> *replacedNodeIds) const
+node_t *osm_t::parse_way_nd(xmlTextReaderPtr reader, const std::unordered_map<item_id_t, item_id_t> *replacedNodeIds) const
 {
-  xmlString prop(xmlGetProp(a_node, BAD_CAST "ref"));
+  xmlString prop(xmlTextReaderGetAttribute(reader, BAD_CAST "ref"));
 
   return parse_node_ref(prop, this, replacedNodeIds);
 }
@@ -182,11 +189,11 @@ void osm_t::parse_relation_member(const xmlString &tp, const xmlString &refstr,
                                   const std::unordered_map<item_id_t, item_id_t> *replacedWayIds)
 {
   if(unlikely(tp.empty())) {
-    printf("missing type for relation member\n");
+    OSM2GO_LOG(Parser, Warning, "missing type for relation member");
     return;
   }
   if(unlikely(refstr.empty())) {
-    printf("missing ref for relation member\n");
+    OSM2GO_LOG(Parser, Warning, "missing ref for relation member");
     return;
   }
 
@@ -198,14 +205,14 @@ void osm_t::parse_relation_member(const xmlString &tp, const xmlString &refstr,
   else if(likely(strcmp(tp, relation_t::api_string()) == 0))
     type = object_t::RELATION;
   else {
-    printf("Unable to store illegal type '%s'\n", tp.get());
+    OSM2GO_LOG(Parser, Warning, "Unable to store illegal type '%s'", tp.get());
     return;
   }
 
   char *endp;
   item_id_t id = strtoll(refstr, &endp, 10);
   if(unlikely(*endp != '\0')) {
-    printf("Illegal ref '%s' for relation member\n", refstr.get());
+    OSM2GO_LOG(Parser, Warning, "Illegal ref '%s' for relation member", refstr.get());
     return;
   }
 
@@ -237,13 +244,13 @@ void osm_t::parse_relation_member(const xmlString &tp, const xmlString &refstr,
   members.push_back(member_t(obj, rstr));
 }
 
-void osm_t::parse_relation_member(xmlNode *a_node, std::vector<member_t> &members,
+void osm_t::parse_relation_member(xmlTextReaderPtr reader, std::vector<member_t> &members,
                                   const std::unordered_map<item_id_t, item_id_t> *replacedNodeIds,
                                   const std::unordered_map<item_id_t, item_id_t> *replacedWayIds)
 {
-  xmlString tp(xmlGetProp(a_node, BAD_CAST "type"));
-  xmlString refstr(xmlGetProp(a_node, BAD_CAST "ref"));
-  xmlString role(xmlGetProp(a_node, BAD_CAST "role"));
+  xmlString tp(xmlTextReaderGetAttribute(reader, BAD_CAST "type"));
+  xmlString refstr(xmlTextReaderGetAttribute(reader, BAD_CAST "ref"));
+  xmlString role(xmlTextReaderGetAttribute(reader, BAD_CAST "role"));
 
   parse_relation_member(tp, refstr, role, members, replacedNodeIds, replacedWayIds);
 }
@@ -252,35 +259,6 @@ void osm_t::parse_relation_member(xmlNode *a_node, std::vector<member_t> &member
 
 namespace {
 
-inline int __attribute__((nonnull(2)))
-my_strcmp(const xmlChar *a, const xmlChar *b)
-{
-  if(a == nullptr)
-    return -1;
-  return strcmp(reinterpret_cast<const char *>(a), reinterpret_cast<const char *>(b));
-}
-
-/* skip current element incl. everything below (mainly for testing) */
-void
-skip_element(xmlTextReaderPtr reader)
-{
-  assert_cmpnum(xmlTextReaderNodeType(reader), XML_READER_TYPE_ELEMENT);
-  if(xmlTextReaderIsEmptyElement(reader))
-    return;
-
-  int depth = xmlTextReaderDepth(reader);
-  const xmlChar *name = xmlTextReaderConstName(reader);
-  assert(name != nullptr);
-
-  int ret = xmlTextReaderRead(reader);
-  while(ret == 1 &&
-        (xmlTextReaderNodeType(reader) != XML_READER_TYPE_END_ELEMENT ||
-         xmlTextReaderDepth(reader) > depth ||
-         my_strcmp(xmlTextReaderConstName(reader), name) != 0)) {
-    ret = xmlTextReaderRead(reader);
-  }
-}
-
 /* parse bounds */
 std::optional<bounds_t>
 process_bounds(xmlTextReaderPtr reader)
@@ -288,15 +266,15 @@ process_bounds(xmlTextReaderPtr reader)
   bounds_t bounds;
   if(unlikely(!bounds.init(pos_area(pos_t::fromXmlProperties(reader, "minlat", "minlon"),
                                     pos_t::fromXmlProperties(reader, "maxlat", "maxlon"))))) {
-    fprintf(stderr, "Invalid coordinate in bounds (%f/%f/%f/%f)\n",
-            bounds.ll.min.lat, bounds.ll.min.lon,
-            bounds.ll.max.lat, bounds.ll.max.lon);
+    OSM2GO_LOG(Parser, Error, "Invalid coordinate in bounds (%f/%f/%f/%f)",
+               bounds.ll.min.lat, bounds.ll.min.lon,
+               bounds.ll.max.lat, bounds.ll.max.lon);
 
     return std::optional<bounds_t>();
   }
 
   /* skip everything below */
-  skip_element(reader);
+  xml_skip_element(reader);
 
   bounds.min = bounds.ll.min.toLpos();
   bounds.min.x -= bounds.center.x;
@@ -322,7 +300,7 @@ process_tag(xmlTextReaderPtr reader, std::vector<tag_t> &tags)
   if(likely(!k.empty() && !v.empty()))
     tags.push_back(tag_t(k, v));
   else
-    printf("incomplete tag key/value %s/%s\n", k.get(), v.get());
+    OSM2GO_LOG(Parser, Warning, "incomplete tag key/value %s/%s", k.get(), v.get());
 }
 
 base_attributes
@@ -346,7 +324,7 @@ process_base_attributes(xmlTextReaderPtr reader, osm_t::ref osm)
       char *endp;
       uid = strtol(puid, &endp, 10);
       if(unlikely(*endp)) {
-        printf("WARNING: cannot parse uid '%s' for user '%s'\n", puid.get(), prop.get());
+        OSM2GO_LOG(Parser, Warning, "cannot parse uid '%s' for user '%s'", puid.get(), prop.get());
         uid = -1;
       }
     }
@@ -361,14 +339,16 @@ process_base_attributes(xmlTextReaderPtr reader, osm_t::ref osm)
 }
 
 void
-process_node(xmlTextReaderPtr reader, osm_t::ref osm)
+process_node(xmlTextReaderPtr reader, osm_t::ref osm, node_projector &projector)
 {
   const pos_t pos = pos_t::fromXmlProperties(reader);
 
   base_attributes ba = process_base_attributes(reader, osm);
 
-  node_t *node = osm->node_new(pos, ba);
+  // the screen position is filled in later by the projector
+  node_t *node = new node_t(ba, lpos_t(), pos);
   assert_cmpnum(node->flags, 0);
+  projector.add(node);
 
   osm->insert(node);
 
@@ -391,7 +371,7 @@ process_node(xmlTextReaderPtr reader, osm_t::ref osm)
       if(likely(strcmp(subname, "tag") == 0))
         process_tag(reader, tags);
 
-      skip_element(reader);
+      xml_skip_element(reader);
     }
 
     ret = xmlTextReaderRead(reader);
@@ -399,13 +379,6 @@ process_node(xmlTextReaderPtr reader, osm_t::ref osm)
   node->tags.replace(std::move(tags));
 }
 
-node_t *
-process_nd(xmlTextReaderPtr reader, osm_t::ref osm)
-{
-  xmlString prop(xmlTextReaderGetAttribute(reader, BAD_CAST "ref"));
-  return parse_node_ref(prop, osm.get());
-}
-
 void
 process_way(xmlTextReaderPtr reader, osm_t::ref osm)
 {
@@ -433,30 +406,20 @@ process_way(xmlTextReaderPtr reader, osm_t::ref osm)
     if(xmlTextReaderNodeType(reader) == XML_READER_TYPE_ELEMENT) {
       const char *subname = reinterpret_cast<const char *>(xmlTextReaderConstName(reader));
       if(strcmp(subname, "nd") == 0) {
-        node_t *n = process_nd(reader, osm);
+        node_t *n = osm->parse_way_nd(reader, nullptr);
         if(likely(n != nullptr))
           way->node_chain.push_back(n);
       } else if(likely(strcmp(subname, "tag") == 0)) {
         process_tag(reader, tags);
       }
 
-      skip_element(reader);
+      xml_skip_element(reader);
     }
     ret = xmlTextReaderRead(reader);
   }
   way->tags.replace(std::move(tags));
 }
 
-void
-process_member(xmlTextReaderPtr reader, osm_t::ref osm, std::vector<member_t> &members)
-{
-  xmlString tp(xmlTextReaderGetAttribute(reader, BAD_CAST "type"));
-  xmlString ref(xmlTextReaderGetAttribute(reader, BAD_CAST "ref"));
-  xmlString role(xmlTextReaderGetAttribute(reader, BAD_CAST "role"));
-
-  osm->parse_relation_member(tp, ref, role, members);
-}
-
 void
 process_relation(xmlTextReaderPtr reader, osm_t::ref osm)
 {
@@ -478,6 +441,7 @@ process_relation(xmlTextReaderPtr reader, osm_t::ref osm)
 
   /* scan all elements on same level or its children */
   std::vector<tag_t> tags;
+  std::vector<member_t> members;
   int ret = xmlTextReaderRead(reader);
   while(ret == 1 &&
         (xmlTextReaderNodeType(reader) != XML_READER_TYPE_END_ELEMENT ||
@@ -486,14 +450,15 @@ process_relation(xmlTextReaderPtr reader, osm_t::ref osm)
     if(xmlTextReaderNodeType(reader) == XML_READER_TYPE_ELEMENT) {
       const char *subname = reinterpret_cast<const char *>(xmlTextReaderConstName(reader));
       if(strcmp(subname, "member") == 0)
-        process_member(reader, osm, relation->members);
+        osm->parse_relation_member(reader, members);
       else if(likely(strcmp(subname, "tag") == 0))
         process_tag(reader, tags);
 
-      skip_element(reader);
+      xml_skip_element(reader);
     }
     ret = xmlTextReaderRead(reader);
   }
+  relation->members.swap(members);
   relation->tags.replace(std::move(tags));
 }
 
@@ -507,17 +472,25 @@ parseUploadPolicy(const char *str)
   else if(likely(strcmp(str, "never") == 0))
     return osm_t::Upload_Blocked;
 
-  printf("unknown key for upload found: %s\n", str);
+  OSM2GO_LOG(Parser, Warning, "unknown key for upload found: %s", str);
 
   // just to be cautious
   return osm_t::Upload_Discouraged;
 }
 
+/**
+ * @brief parse the contents of the <osm> element
+ * @param reader the XML reader positioned on the <osm> element
+ * @param progress where to report the progress, or nullptr
+ * @param total the size of the input file, 0 if unknown
+ */
 osm_t *
-process_osm(xmlTextReaderPtr reader)
+process_osm(xmlTextReaderPtr reader, osm_t::parse_progress *progress, long total)
 {
   /* alloc osm structure */
   std::unique_ptr<osm_t> osm(std::make_unique<osm_t>());
+  // the strings read here are only used by this instance
+  cache_set::generation_scope cscope(value_cache, osm->cacheGeneration);
 
   xmlString prop(xmlTextReaderGetAttribute(reader, BAD_CAST "upload"));
   if(unlikely(prop))
@@ -537,6 +510,7 @@ process_osm(xmlTextReaderPtr reader)
     BLOCK_RELATIONS
   };
   enum blocks block = BLOCK_OSM;
+  node_projector projector(osm->bounds);
 
   const int tick_every = 50; // Balance responsive appearance with performance.
   int ret = xmlTextReaderRead(reader);
@@ -554,16 +528,20 @@ process_osm(xmlTextReaderPtr reader)
         osm->bounds = *b;
         block = BLOCK_NODES; // next must be nodes, there must not be more than one bounds
       } else if(block == BLOCK_NODES && strcmp(name, node_t::api_string()) == 0) {
-        process_node(reader, osm);
+        process_node(reader, osm, projector);
       } else if(block <= BLOCK_WAYS && strcmp(name, way_t::api_string()) == 0) {
+        if(block == BLOCK_NODES)
+          projector.flush();
         process_way(reader, osm);
         block = BLOCK_WAYS;
       } else if(likely(block <= BLOCK_RELATIONS && strcmp(name, relation_t::api_string()) == 0)) {
+        if(block == BLOCK_NODES)
+          projector.flush();
         process_relation(reader, osm);
         block = BLOCK_RELATIONS;
       } else {
-        printf("something unknown found: %s\n", name);
-        skip_element(reader);
+        OSM2GO_LOG(Parser, Warning, "something unknown found: %s", name);
+        xml_skip_element(reader);
       }
       break;
     }
@@ -571,6 +549,7 @@ process_osm(xmlTextReaderPtr reader)
     case XML_READER_TYPE_END_ELEMENT:
       /* end element must be for the current element */
       assert_cmpnum(xmlTextReaderDepth(reader), 0);
+      projector.flush();
       return osm.release();
 
     default:
@@ -580,7 +559,14 @@ process_osm(xmlTextReaderPtr reader)
 
     if (num_elems++ > tick_every) {
       num_elems = 0;
-      osm2go_platform::process_events();
+      if(progress == nullptr) {
+        osm2go_platform::process_events();
+      } else if(unlikely(progress->cancel)) {
+        OSM2GO_LOG(Parser, Info, "parsing cancelled");
+        return nullptr;
+      } else if(total > 0) {
+        progress->fraction = std::min(1.0f, static_cast<float>(xmlTextReaderByteConsumed(reader)) / total);
+      }
     }
   }
 
@@ -605,28 +591,38 @@ struct relation_ref_functor {
 };
 
 osm_t *
-process_file(const std::string &filename)
+process_file(const std::string &filename, osm_t::parse_progress *progress)
 {
   std::unique_ptr<osm_t> osm;
   xmlTextReaderPtr reader;
 
+  // the reader counts the uncompressed bytes, so the size of compressed files is useless
+  long total = 0;
+  struct stat st;
+  if(progress != nullptr) {
+    if(!nonstd::string_view(filename).ends_with(".gz") && stat(filename.c_str(), &st) == 0)
+      total = st.st_size;
+    else
+      progress->fraction = -1;
+  }
+
   reader = xmlReaderForFile(filename.c_str(), nullptr, XML_PARSE_NONET);
   if (likely(reader != nullptr)) {
     if(likely(xmlTextReaderRead(reader) == 1)) {
       const char *name = reinterpret_cast<const char *>(xmlTextReaderConstName(reader));
       if(likely(name && strcmp(name, "osm") == 0)) {
-        osm.reset(process_osm(reader));
+        osm.reset(process_osm(reader, progress, total));
         // relations may have references to other relation, which have greater ids
         // those are not present when the relation itself was created, but may be now
         if(likely(osm))
           std::for_each(osm->relations.begin(), osm->relations.end(), relation_ref_functor(osm));
       }
     } else
-      printf("file empty\n");
+      OSM2GO_LOG(Parser, Warning, "file empty");
 
     xmlFreeTextReader(reader);
   } else {
-    fprintf(stderr, "Unable to open %s\n", filename.c_str());
+    OSM2GO_LOG(Parser, Error, "Unable to open %s", filename.c_str());
   }
   return osm.release();
 }
@@ -635,11 +631,18 @@ process_file(const std::string &filename)
 
 /* ----------------------- end of stream parser ------------------- */
 
-osm_t *osm_t::parse(const std::string &path, const std::string &filename) {
+osm_t *osm_t::parse(const std::string &path, const std::string &filename, parse_progress *progress) {
+  PERF_SCOPE("osm_t::parse");
 
   // use stream parser
+  osm_t *ret;
   if(unlikely(filename.find('/') != std::string::npos))
-    return process_file(filename);
+    ret = process_file(filename, progress);
   else
-    return process_file(path + filename);
+    ret = process_file(path + filename, progress);
+
+  if(likely(ret != nullptr))
+    PERF_COUNT("parsed objects", ret->nodes.size() + ret->ways.size() + ret->relations.size());
+
+  return ret;
 }
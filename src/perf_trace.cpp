@@ -0,0 +1,306 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Rolf Eike Beer <eike@sf-mail.de>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "perf_trace.h"
+
+#ifdef OSM2GO_PERF_TRACE
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unistd.h>
+
+#include "osm2go_annotations.h"
+#include <osm2go_log.h>
+
+namespace {
+
+struct event {
+  const perf_trace::site *s;
+  int64_t ts;
+  int64_t value;
+};
+
+/**
+ * @brief the storage of one event in a ring buffer
+ *
+ * The fields are atomic as they may be read by another thread while the
+ * owning thread overwrites them.
+ */
+struct event_slot {
+  std::atomic<const perf_trace::site *> s;
+  std::atomic<int64_t> ts;
+  std::atomic<int64_t> value;
+};
+
+/**
+ * @brief the events of one thread
+ *
+ * Only the owning thread writes to the buffer, so recording needs no locks.
+ * Readers detect entries that have been overwritten while they were copied
+ * by checking head again afterwards, like a sequence lock.
+ */
+struct ring_buffer {
+  enum { Size = 1 << 15 };
+
+  explicit ring_buffer(unsigned int t) : head(0), inUse(true), tid(t) {}
+
+  event_slot events[Size];
+  std::atomic<uint64_t> head;   ///< the number of events ever written
+  bool inUse;                   ///< if a thread currently owns the buffer, protected by registry::mutex
+  unsigned int tid;             ///< protected by registry::mutex
+};
+
+struct registry {
+  registry() : sites(nullptr), epoch(perf_trace::now()), nextTid(1) {}
+
+  std::mutex mutex;
+  /// the buffers of finished threads are reused
+  std::vector<std::unique_ptr<ring_buffer> > buffers;
+  std::atomic<const perf_trace::site *> sites;
+  const int64_t epoch;
+  unsigned int nextTid;         ///< protected by mutex
+
+  static registry &instance()
+  {
+    static registry reg;
+    return reg;
+  }
+
+  ring_buffer *acquire();
+  void release(ring_buffer *buf);
+
+  /**
+   * @brief copy the events of all threads
+   * @returns the events sorted by time and the thread they belong to
+   */
+  std::vector<std::pair<event, unsigned int> > collect();
+};
+
+ring_buffer *registry::acquire()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+
+  for(size_t i = 0; i < buffers.size(); i++) {
+    ring_buffer * const buf = buffers[i].get();
+    if(!buf->inUse) {
+      // the events of the finished thread are dropped, they must not show
+      // up as events of the new one
+      buf->inUse = true;
+      buf->head.store(0, std::memory_order_relaxed);
+      buf->tid = nextTid++;
+      return buf;
+    }
+  }
+
+  buffers.push_back(std::unique_ptr<ring_buffer>(new ring_buffer(nextTid++)));
+  return buffers.back().get();
+}
+
+void registry::release(ring_buffer *buf)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  buf->inUse = false;
+}
+
+struct event_order {
+  inline bool operator()(const std::pair<event, unsigned int> &a, const std::pair<event, unsigned int> &b) const
+  { return a.first.ts < b.first.ts; }
+};
+
+std::vector<std::pair<event, unsigned int> > registry::collect()
+{
+  std::vector<std::pair<event, unsigned int> > ret;
+  std::lock_guard<std::mutex> lock(mutex);
+
+  for(size_t i = 0; i < buffers.size(); i++) {
+    const ring_buffer &buf = *buffers[i];
+    const uint64_t head = buf.head.load(std::memory_order_acquire);
+    const uint64_t first = head > ring_buffer::Size ? head - ring_buffer::Size : 0;
+    const size_t oldSize = ret.size();
+
+    for(uint64_t pos = first; pos < head; pos++) {
+      const event_slot &slot = buf.events[pos % ring_buffer::Size];
+      event ev;
+      ev.s = slot.s.load(std::memory_order_acquire);
+      ev.ts = slot.ts.load(std::memory_order_acquire);
+      ev.value = slot.value.load(std::memory_order_acquire);
+      ret.push_back(std::make_pair(ev, buf.tid));
+    }
+
+    // drop the entries the thread has overwritten in the mean time, and the
+    // one it may be writing right now
+    const uint64_t nhead = buf.head.load(std::memory_order_acquire) + 1;
+    if(unlikely(nhead > first + ring_buffer::Size)) {
+      const uint64_t lost = std::min(nhead - first - ring_buffer::Size, head - first);
+      ret.erase(ret.begin() + oldSize, ret.begin() + oldSize + lost);
+    }
+  }
+
+  std::stable_sort(ret.begin(), ret.end(), event_order());
+
+  return ret;
+}
+
+/**
+ * @brief gives every thread its own buffer
+ */
+class thread_buffer {
+  registry &reg;
+public:
+  thread_buffer() : reg(registry::instance()), buffer(reg.acquire()) {}
+  ~thread_buffer()
+  { reg.release(buffer); }
+
+  ring_buffer * const buffer;
+};
+
+thread_local thread_buffer threadBuffer;
+
+/**
+ * @brief writes the trace file on exit if requested
+ */
+struct trace_writer {
+  trace_writer()
+  {
+    // make sure the registry is destroyed after this object
+    (void) registry::instance();
+  }
+  ~trace_writer()
+  {
+    const char *fname = getenv("OSM2GO_TRACE_FILE");
+    if(fname != nullptr && *fname != '\0')
+      perf_trace::write_chrome_trace(fname);
+  }
+};
+
+trace_writer traceWriter;
+
+struct summary_name_order {
+  inline bool operator()(const perf_trace::summary_entry &a, const perf_trace::summary_entry &b) const
+  { return strcmp(a.name, b.name) < 0; }
+};
+
+} // namespace
+
+perf_trace::site::site(const char *n, Kind k)
+  : name(n)
+  , kind(k)
+  , count(0)
+  , total(0)
+  , max(0)
+{
+  registry &reg = registry::instance();
+  next = reg.sites.load(std::memory_order_relaxed);
+  while(!reg.sites.compare_exchange_weak(next, this, std::memory_order_release, std::memory_order_relaxed)) {
+  }
+}
+
+void perf_trace::record(site &s, int64_t ts, int64_t value)
+{
+  const uint64_t v = value < 0 ? 0 : value;
+  s.count.fetch_add(1, std::memory_order_relaxed);
+  s.total.fetch_add(v, std::memory_order_relaxed);
+  uint64_t oldMax = s.max.load(std::memory_order_relaxed);
+  while(oldMax < v && !s.max.compare_exchange_weak(oldMax, v, std::memory_order_relaxed)) {
+  }
+
+  ring_buffer * const buf = threadBuffer.buffer;
+  const uint64_t head = buf->head.load(std::memory_order_relaxed);
+  event_slot &ev = buf->events[head % ring_buffer::Size];
+  // a reader that sees one of the new values also sees the current head
+  ev.s.store(&s, std::memory_order_release);
+  ev.ts.store(ts, std::memory_order_release);
+  ev.value.store(value, std::memory_order_release);
+  buf->head.store(head + 1, std::memory_order_release);
+}
+
+std::vector<perf_trace::summary_entry> perf_trace::summary()
+{
+  std::vector<summary_entry> ret;
+
+  for(const site *s = registry::instance().sites.load(std::memory_order_acquire); s != nullptr; s = s->next) {
+    summary_entry entry;
+    entry.name = s->name;
+    entry.kind = s->kind;
+    entry.count = s->count.load(std::memory_order_relaxed);
+    entry.total = s->total.load(std::memory_order_relaxed);
+    entry.max = s->max.load(std::memory_order_relaxed);
+    if(entry.count > 0)
+      ret.push_back(entry);
+  }
+
+  std::sort(ret.begin(), ret.end(), summary_name_order());
+
+  return ret;
+}
+
+std::string perf_trace::summary_text()
+{
+  const std::vector<summary_entry> &entries = summary();
+  std::string ret;
+  char buf[256];
+
+  snprintf(buf, sizeof(buf), "%-28s %10s %12s %10s %10s\n", "timer", "calls", "total ms", "mean ms", "max ms");
+  ret += buf;
+  for(size_t i = 0; i < entries.size(); i++) {
+    const summary_entry &e = entries[i];
+    if(e.kind != site::Timer)
+      continue;
+    snprintf(buf, sizeof(buf), "%-28s %10llu %12.3f %10.3f %10.3f\n", e.name,
+             static_cast<unsigned long long>(e.count), e.total / 1e6, e.total / 1e6 / e.count, e.max / 1e6);
+    ret += buf;
+  }
+
+  snprintf(buf, sizeof(buf), "\n%-28s %10s %12s %10s %10s\n", "counter", "samples", "sum", "mean", "max");
+  ret += buf;
+  for(size_t i = 0; i < entries.size(); i++) {
+    const summary_entry &e = entries[i];
+    if(e.kind != site::Counter)
+      continue;
+    snprintf(buf, sizeof(buf), "%-28s %10llu %12llu %10.1f %10llu\n", e.name,
+             static_cast<unsigned long long>(e.count), static_cast<unsigned long long>(e.total),
+             static_cast<double>(e.total) / e.count, static_cast<unsigned long long>(e.max));
+    ret += buf;
+  }
+
+  return ret;
+}
+
+bool perf_trace::write_chrome_trace(const std::string &filename)
+{
+  registry &reg = registry::instance();
+  const std::vector<std::pair<event, unsigned int> > &events = reg.collect();
+
+  FILE *f = fopen(filename.c_str(), "w");
+  if(unlikely(f == nullptr)) {
+    OSM2GO_LOG(Perf, Error, "cannot write trace file %s", filename.c_str());
+    return false;
+  }
+
+  const int pid = getpid();
+  fputs("{\"traceEvents\":[\n", f);
+  for(size_t i = 0; i < events.size(); i++) {
+    const event &ev = events[i].first;
+    // the site names are string literals from the code, no escaping needed
+    if(ev.s->kind == site::Timer)
+      fprintf(f, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%u}",
+              ev.s->name, (ev.ts - reg.epoch) / 1e3, ev.value / 1e3, pid, events[i].second);
+    else
+      fprintf(f, "{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":%d,\"tid\":%u,\"args\":{\"value\":%lld}}",
+              ev.s->name, (ev.ts - reg.epoch) / 1e3, pid, events[i].second, static_cast<long long>(ev.value));
+    fputs(i + 1 < events.size() ? ",\n" : "\n", f);
+  }
+  fputs("],\"displayTimeUnit\":\"ms\"}\n", f);
+
+  const bool ret = ferror(f) == 0;
+  return fclose(f) == 0 && ret;
+}
+
+#endif
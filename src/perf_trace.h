@@ -0,0 +1,134 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Rolf Eike Beer <eike@sf-mail.de>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+/**
+ * @file perf_trace.h
+ *
+ * Timing instrumentation for the expensive operations.
+ *
+ * PERF_SCOPE() measures the time until the end of the current scope,
+ * PERF_COUNT() records a value. Both keep a summary per call site and store
+ * every event in a ring buffer of the calling thread. If the environment
+ * variable OSM2GO_TRACE_FILE is set the events are written to that file in
+ * the Chrome trace format when the program exits.
+ *
+ * Unless OSM2GO_PERF_TRACE is defined the macros expand to nothing.
+ */
+
+#ifdef OSM2GO_PERF_TRACE
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace perf_trace {
+
+/**
+ * @brief one place in the code that is measured
+ *
+ * These are static objects that register themselves on first use.
+ */
+class site {
+public:
+  enum Kind {
+    Timer,    ///< values are durations in nanoseconds
+    Counter   ///< values are arbitrary numbers
+  };
+
+  site(const char *n, Kind k);
+  site() = delete;
+  site(const site &) = delete;
+  site &operator=(const site &) = delete;
+
+  const char * const name;
+  const Kind kind;
+
+  std::atomic<uint64_t> count;  ///< number of recorded values
+  std::atomic<uint64_t> total;  ///< sum of the recorded values
+  std::atomic<uint64_t> max;    ///< the biggest recorded value
+
+  const site *next;             ///< the previously registered site
+};
+
+/**
+ * @brief the current time in nanoseconds
+ */
+inline int64_t now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief store one value for the given site
+ * @param s the call site
+ * @param ts the time of the event
+ * @param value the duration or counter value
+ */
+void record(site &s, int64_t ts, int64_t value);
+
+class scope {
+  site &s;
+  const int64_t start;
+public:
+  explicit inline scope(site &st) : s(st), start(now()) {}
+  inline ~scope()
+  { record(s, start, now() - start); }
+};
+
+struct summary_entry {
+  const char *name;
+  site::Kind kind;
+  uint64_t count;
+  uint64_t total;
+  uint64_t max;
+};
+
+/**
+ * @brief the accumulated values of all sites that have been used
+ * @returns the entries sorted by name
+ */
+std::vector<summary_entry> summary();
+
+/**
+ * @brief the summary as a human readable table
+ */
+std::string summary_text();
+
+/**
+ * @brief write the events of all threads in Chrome trace format
+ * @param filename the file to write
+ * @returns if writing was successful
+ *
+ * Events that are recorded while the file is written may be missing.
+ */
+bool write_chrome_trace(const std::string &filename);
+
+} // namespace perf_trace
+
+#define OSM2GO_PERF_CONCAT2(a, b) a##b
+#define OSM2GO_PERF_CONCAT(a, b) OSM2GO_PERF_CONCAT2(a, b)
+
+#define PERF_SCOPE(name) \
+  static perf_trace::site OSM2GO_PERF_CONCAT(perf_site_, __LINE__)(name, perf_trace::site::Timer); \
+  const perf_trace::scope OSM2GO_PERF_CONCAT(perf_scope_, __LINE__)(OSM2GO_PERF_CONCAT(perf_site_, __LINE__))
+
+#define PERF_COUNT(name, value) \
+  do { \
+    static perf_trace::site perf_site(name, perf_trace::site::Counter); \
+    perf_trace::record(perf_site, perf_trace::now(), value); \
+  } while (0)
+
+#else
+
+#define PERF_SCOPE(name) do {} while (0)
+#define PERF_COUNT(name, value) do {} while (0)
+
+#endif
@@ -20,8 +20,10 @@ typedef GtkMenuShell MenuBar;
 
 #include <osm2go_cpp.h>
 #include "osm2go_i18n.h"
+#include <osm2go_platform.h>
 #include <osm2go_stl.h>
 
+typedef struct _GtkProgressBar GtkProgressBar;
 typedef struct _GtkWidget GtkWidget;
 
 class MainUiGtk : public MainUi {
@@ -30,6 +32,10 @@ class MainUiGtk : public MainUi {
   const std::unique_ptr<statusbar_t> statusbar;
   MenuBar * const menubar;
 
+  osm2go_platform::WidgetGuard progressDialog;
+  GtkProgressBar *progressBar;
+  bool progressCancelled;
+
   GtkWidget *addMenu(GtkWidget *item);
 public:
   MainUiGtk();
@@ -45,6 +51,8 @@ public:
 
   void clearNotification(NotificationFlags flags) override;
 
+  bool updateProgress(const char *message, float fraction);
+
   /**
    * @brief create a new submenu entry in the global menu bar
    */
@@ -8,6 +8,7 @@
 
 #include "appdata.h"
 #include "icon.h"
+#include "memory_usage.h"
 
 #ifndef FREMANTLE
 #define LINK_COLOR "blue"
@@ -28,6 +29,7 @@
 #include <osm2go_annotations.h>
 #include <osm2go_cpp.h>
 #include "osm2go_i18n.h"
+#include <perf_trace.h>
 #include "osm2go_platform.h"
 #include "osm2go_platform_gtk.h"
 #include "osm2go_platform_gtk_icon.h"
@@ -303,9 +305,41 @@ bugs_page_new()
   return vbox;
 }
 
+/**
+ * @brief a read only view for tabular text
+ */
+GtkWidget *
+text_page_new(const std::string &text)
+{
+  GtkTextView *view = GTK_TEXT_VIEW(gtk_text_view_new());
+  gtk_text_view_set_editable(view, FALSE);
+  gtk_text_view_set_cursor_visible(view, FALSE);
+  PangoFontDescription *font = pango_font_description_from_string("Monospace");
+  gtk_widget_modify_font(GTK_WIDGET(view), font);
+  pango_font_description_free(font);
+
+  gtk_text_buffer_set_text(gtk_text_view_get_buffer(view), text.c_str(), text.size());
+
+  return osm2go_platform::scrollable_container(GTK_WIDGET(view));
+}
+
+#ifdef OSM2GO_PERF_TRACE
+inline GtkWidget *
+performance_page_new()
+{
+  return text_page_new(perf_trace::summary_text());
+}
+#endif
+
+inline GtkWidget *
+memory_page_new(const appdata_t &appdata)
+{
+  return text_page_new(memory_report::collect(appdata).text());
+}
+
 } // namespace
 
-void MainUi::about_box()
+void MainUi::about_box(const appdata_t &appdata)
 {
   osm2go_platform::DialogGuard dialog(gtk_dialog_new_with_buttons(static_cast<const gchar *>(_("About OSM2Go")),
                                               GTK_WINDOW(appdata_t::window), GTK_DIALOG_MODAL,
@@ -326,6 +360,10 @@ void MainUi::about_box()
   osm2go_platform::notebook_append_page(notebook, authors_page_new(),        _("Authors"));
   osm2go_platform::notebook_append_page(notebook, donate_page_new(icons),    _("Donate"));
   osm2go_platform::notebook_append_page(notebook, bugs_page_new(),           _("Bugs"));
+  osm2go_platform::notebook_append_page(notebook, memory_page_new(appdata),  _("Memory"));
+#ifdef OSM2GO_PERF_TRACE
+  osm2go_platform::notebook_append_page(notebook, performance_page_new(),    _("Performance"));
+#endif
 
   gtk_box_pack_start(dialog.vbox(), notebook, TRUE, TRUE, 0);
 
@@ -202,6 +202,7 @@ struct area_context_t {
     OsmGpsMap *widget;
     bool needs_redraw;
     OsmGpsMapPoint start;
+    GtkWidget *stats;   ///< shows the usage of the tile caches
   } map;
 };
 
@@ -666,6 +667,18 @@ void on_page_switch(GtkNotebook *nb, GtkWidget *pg, guint pgnum, area_context_t
   map_update(context, true);
 }
 
+void map_stats_update(area_context_t *context)
+{
+  const OsmGpsMapCacheStats st = osm_gps_map_cache_stats(context->map.widget);
+  const guint requests = st.memory_hits + st.disk_hits + st.misses;
+  const guint hits = requests == 0 ? 0 : 100 * (st.memory_hits + st.disk_hits) / requests;
+
+  const trstring msg = trstring("Map tiles: %1% from cache, %2 downloaded, %3 failed")
+                           .arg(hits).arg(st.downloads).arg(st.failures);
+
+  gtk_label_set_text(GTK_LABEL(context->map.stats), static_cast<const gchar *>(msg));
+}
+
 gboolean map_gps_update(gpointer data)
 {
   area_context_t *context = static_cast<area_context_t *>(data);
@@ -677,6 +690,8 @@ gboolean map_gps_update(gpointer data)
   else
     osm_gps_map_gps_clear(context->map.widget);
 
+  map_stats_update(context);
+
   return TRUE;
 }
 
@@ -722,12 +737,18 @@ bool area_edit_t::run() {
   g_signal_connect(context.map.widget, "button-release-event",
                    G_CALLBACK(on_map_button_release_event), &context);
 
-  /* install handler for timed updates of the gps button */
+  context.map.stats = gtk_label_new(nullptr);
+  map_stats_update(&context);
+
+  /* install handler for timed updates of the gps button and the statistics */
   osm2go_platform::Timer timer;
   timer.restart(1, map_gps_update, &context);
   context.map.start.rlon = context.map.start.rlat = NAN;
 
-  osm2go_platform::notebook_append_page(context.notebook, GTK_WIDGET(context.map.widget), _(TAB_LABEL_MAP));
+  vbox = gtk_vbox_new(FALSE, 0);
+  gtk_box_pack_start(GTK_BOX(vbox), GTK_WIDGET(context.map.widget), TRUE, TRUE, 0);
+  gtk_box_pack_start(GTK_BOX(vbox), context.map.stats, FALSE, FALSE, 0);
+  osm2go_platform::notebook_append_page(context.notebook, vbox, _(TAB_LABEL_MAP));
 
   /* ------------ direct min/max edit --------------- */
 
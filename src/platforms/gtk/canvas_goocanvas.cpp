@@ -22,17 +22,22 @@
  */
 
 #include "canvas_goocanvas.h"
+#include "canvas_goocanvas_layer.h"
 
 #include <canvas_p.h>
 #include "map.h"
+#include <perf_trace.h>
 
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstdio>
 #include <cstring>
+#include <string>
 
 #include <osm2go_annotations.h>
 #include <osm2go_cpp.h>
+#include <osm2go_log.h>
 #include "osm2go_platform_gtk.h"
 #include "osm2go_stl.h"
 
@@ -48,6 +53,10 @@ typedef std::unique_ptr<GooCanvasPoints, canvas_points_deleter> pointGuard;
 
 } // namespace
 
+/* the circles and lines of these groups are drawn by a canvas_layer instead */
+/* of creating a GooCanvas item for each of them */
+#define CANVAS_LAYERED ((1<<CANVAS_GROUP_POLYGONS) | (1<<CANVAS_GROUP_WAYS_OL) | (1<<CANVAS_GROUP_WAYS) | (1<<CANVAS_GROUP_WAYS_INT) | (1<<CANVAS_GROUP_NODES))
+
 struct canvas_dimensions {
   canvas_dimensions(double w, double h)
     : width(w), height(h) {}
@@ -87,11 +96,9 @@ static void canvas_delete(canvas_goocanvas *canvas)
 canvas_goocanvas::canvas_goocanvas()
   : canvas_t(goo_canvas_new())
 {
-  GooCanvasItem *root = goo_canvas_get_root_item(GOO_CANVAS(widget));
-
   /* create the groups */
   for(unsigned int gr = 0; gr < group.size(); gr++)
-    group[gr] = goo_canvas_group_new(root, nullptr);
+    create_group(gr);
 
   GObject *w = G_OBJECT(widget);
   g_signal_connect_swapped(w, "destroy",
@@ -105,6 +112,13 @@ canvas_goocanvas::canvas_goocanvas()
                         GDK_POINTER_MOTION_HINT_MASK);
 }
 
+void canvas_goocanvas::create_group(unsigned int gr)
+{
+  group[gr] = goo_canvas_group_new(goo_canvas_get_root_item(GOO_CANVAS(widget)), nullptr);
+  // the layer is the first child, so all plain items of the group are drawn above it
+  layers[gr] = (CANVAS_LAYERED & (1 << gr)) ? canvas_layer::create(group[gr]) : nullptr;
+}
+
 /* ------------------------ accessing the canvas ---------------------- */
 
 void canvas_t::set_background(color_t bg_color) {
@@ -117,11 +131,10 @@ bool canvas_t::set_background(const std::string &filename)
   canvas_goocanvas *gcanvas = static_cast<canvas_goocanvas *>(this);
 
   GooCanvasItem *gr = gcanvas->group[CANVAS_GROUP_BG];
-  int n = goo_canvas_item_get_n_children(gr);
-  if(n > 0) {
-    assert_cmpnum(n, 1);
-    goo_canvas_item_remove_child(gr, 0);
-  }
+  for(int n = goo_canvas_item_get_n_children(gr); n > 0; n--)
+    goo_canvas_item_remove_child(gr, n - 1);
+  goo_canvas_item_set_simple_transform(gr, 0, 0, 1, 0);
+  gcanvas->bg.pix.reset();
 
   if(filename.empty())
     return false;
@@ -146,9 +159,47 @@ bool canvas_t::set_background(const std::string &filename)
   return true;
 }
 
+bool canvas_t::add_background_tile(const std::string &filename, lpos_t min, lpos_t max)
+{
+  canvas_goocanvas *gcanvas = static_cast<canvas_goocanvas *>(this);
+  assert(!gcanvas->bg.pix);
+
+  std::unique_ptr<GdkPixbuf, g_object_deleter> pix(gdk_pixbuf_new_from_file(filename.c_str(), nullptr));
+  if(!pix)
+    return false;
+
+  const double sx = static_cast<double>(max.x - min.x) / gdk_pixbuf_get_width(pix.get());
+  const double sy = static_cast<double>(max.y - min.y) / gdk_pixbuf_get_height(pix.get());
+
+  // the image item keeps its own reference to the pixbuf
+  GooCanvasItem *tile = goo_canvas_image_new(gcanvas->group[CANVAS_GROUP_BG], pix.get(),
+                                             min.x / sx, min.y / sy, nullptr);
+  goo_canvas_item_scale(tile, sx, sy);
+
+  return true;
+}
+
+void canvas_t::clear_background_tiles()
+{
+  canvas_goocanvas *gcanvas = static_cast<canvas_goocanvas *>(this);
+  assert(!gcanvas->bg.pix);
+
+  GooCanvasItem *gr = gcanvas->group[CANVAS_GROUP_BG];
+  for(int n = goo_canvas_item_get_n_children(gr); n > 0; n--)
+    goo_canvas_item_remove_child(gr, n - 1);
+}
+
 void canvas_t::move_background(int x, int y)
 {
   canvas_goocanvas *gcanvas = static_cast<canvas_goocanvas *>(this);
+
+  if(!gcanvas->bg.pix) {
+    // tiles are placed at their real position, so only the offset is applied
+    goo_canvas_item_set_simple_transform(gcanvas->group[CANVAS_GROUP_BG],
+                                         x - gcanvas->bounds.min.x, y - gcanvas->bounds.min.y, 1, 0);
+    return;
+  }
+
   GooCanvasItem *bgitem = goo_canvas_item_get_child(gcanvas->group[CANVAS_GROUP_BG], 0);
   assert(bgitem != nullptr);
 
@@ -158,6 +209,28 @@ void canvas_t::move_background(int x, int y)
                nullptr);
 }
 
+lpos_t canvas_t::background_position() const
+{
+  const canvas_goocanvas *gcanvas = static_cast<const canvas_goocanvas *>(this);
+
+  if(!gcanvas->bg.pix) {
+    gdouble x, y, scale, rotation;
+    goo_canvas_item_get_simple_transform(gcanvas->group[CANVAS_GROUP_BG], &x, &y, &scale, &rotation);
+    return lpos_t(x + gcanvas->bounds.min.x, y + gcanvas->bounds.min.y);
+  }
+
+  GooCanvasItem *bgitem = goo_canvas_item_get_child(gcanvas->group[CANVAS_GROUP_BG], 0);
+  gdouble x, y;
+  g_object_get(G_OBJECT(bgitem), "x", &x, "y", &y, nullptr);
+  return lpos_t(x * gcanvas->bg.scale.x, y * gcanvas->bg.scale.y);
+}
+
+void canvas_t::visible_area(lpos_t &min, lpos_t &max) const
+{
+  min = window2world(osm2go_platform::screenpos(0, 0));
+  max = window2world(osm2go_platform::screenpos(widget->allocation.width, widget->allocation.height));
+}
+
 lpos_t canvas_t::window2world(const osm2go_platform::screenpos &p) const
 {
   double sx = p.x(), sy = p.y();
@@ -189,7 +262,7 @@ double canvas_t::set_zoom(double zoom) {
   if (delta < limit) {
     zoom /= (delta / limit);
 
-    printf("Can't zoom further out (%f)\n", zoom);
+    OSM2GO_LOG(Map, Debug, "Can't zoom further out (%f)", zoom);
   }
 
   goo_canvas_set_scale(GOO_CANVAS(widget), zoom);
@@ -291,7 +364,6 @@ void canvas_t::set_bounds(lpos_t min, lpos_t max) {
 
 void canvas_t::erase(unsigned int group_mask) {
   canvas_goocanvas *gcanvas = static_cast<canvas_goocanvas *>(this);
-  GooCanvasItem *root = goo_canvas_get_root_item(GOO_CANVAS(widget));
 
   if(unlikely((group_mask & (1 << CANVAS_GROUP_BG)) != 0 &&
               goo_canvas_item_get_n_children(gcanvas->group[CANVAS_GROUP_BG]) > 0)) {
@@ -302,7 +374,7 @@ void canvas_t::erase(unsigned int group_mask) {
   for(unsigned int group = CANVAS_GROUP_BG + 1; group < gcanvas->group.size() && group_mask != 0; group++) {
     if(group_mask & (1 << group)) {
       goo_canvas_item_remove(gcanvas->group[group]);
-      gcanvas->group[group] = goo_canvas_group_new(root, nullptr);
+      gcanvas->create_group(group);
       // restore z-order
       if(group < gcanvas->group.size() - 1)
         goo_canvas_item_lower(gcanvas->group[group], gcanvas->group[group + 1]);
@@ -381,16 +453,37 @@ bool item_at_functor::operator()(const canvas_item_info_t *item) const
     const canvas_item_info_poly *poly = static_cast<const canvas_item_info_poly *>(item);
     return poly->get_segment(x, y, ffuzziness) || (poly->is_polygon && inpoly(poly, x, y, fuzziness));
   }
+
+  case CANVAS_ITEM_MARKERS:
+    return static_cast<const canvas_item_info_markers *>(item)->get_marker(x, y, ffuzziness).has_value();
   }
   assert_unreachable();
 }
 
+/**
+ * @brief checks the entries of a canvas_layer
+ */
+class layer_item_at {
+  const item_at_functor &fc;
+public:
+  explicit inline layer_item_at(const item_at_functor &f) : fc(f) {}
+  bool operator()(const canvas_item_t *item) const
+  {
+    const canvas_t::item_mapping_t::const_iterator it = fc.canvas->item_mapping.find(item);
+    return it != fc.canvas->item_mapping.end() && fc(it->second);
+  }
+};
+
 gint
 item_at_compare(gconstpointer i, gconstpointer f)
 {
   const item_at_functor &fc = *static_cast<const item_at_functor *>(f);
   const canvas_item_t * const citem = static_cast<const canvas_item_t *>(i);
 
+  // the entries of the layers are searched separately
+  if(canvas_layer::is_layer(static_cast<GooCanvasItem *>(const_cast<gpointer>(i))))
+    return -1;
+
   const canvas_t::item_mapping_t::const_iterator it = fc.canvas->item_mapping.find(citem);
   if(it == fc.canvas->item_mapping.end()) {
     g_debug("item %p not in canvas map", citem);
@@ -410,9 +503,11 @@ struct g_list_deleter {
 /* try to find the object at position x/y by searching through the */
 /* item_info list */
 canvas_item_t *canvas_t::get_item_at(lpos_t pos) const {
+  PERF_SCOPE("canvas_t::get_item_at");
   /* convert all "fuzziness" into meters */
+  const double zoom = get_zoom();
   const float fuzziness = EXTRA_FUZZINESS_METER +
-    EXTRA_FUZZINESS_PIXEL / get_zoom();
+    EXTRA_FUZZINESS_PIXEL / zoom;
 
   const item_at_functor fc(pos, fuzziness, this);
   GooCanvasBounds find_bounds;
@@ -424,20 +519,36 @@ canvas_item_t *canvas_t::get_item_at(lpos_t pos) const {
                                                                             &find_bounds, TRUE,
                                                                             TRUE, FALSE));
 
-  if (!items)
-    return nullptr;
-
   // items of all kinds and layers are returned, now select the best matching one
-  GList *item = g_list_find_custom(items.get(), &fc, item_at_compare);
-  if (item == nullptr)
-    return nullptr;
+  GList *item = items ? g_list_find_custom(items.get(), &fc, item_at_compare) : nullptr;
+  GooCanvasItem *hit = item != nullptr ? static_cast<GooCanvasItem *>(item->data) : nullptr;
+  GooCanvasItem *hitGroup = hit != nullptr ? goo_canvas_item_get_parent(hit) : nullptr;
+
+  // the plain items of a group are above its layer, which is above all lower groups
+  const canvas_goocanvas *gcanvas = static_cast<const canvas_goocanvas *>(this);
+  for(unsigned int gr = gcanvas->group.size(); gr > 0; gr--) {
+    if(hit != nullptr && hitGroup == gcanvas->group[gr - 1])
+      break;
+
+    canvas_layer *layer = gcanvas->layers[gr - 1];
+    if(layer == nullptr || !(CANVAS_SELECTABLE & (1 << (gr - 1))))
+      continue;
+
+    canvas_layer::entry *e = layer->find_topmost(pos, fc.fuzziness, zoom, layer_item_at(fc));
+    if(e != nullptr)
+      return e->handle();
+  }
 
-  return static_cast<canvas_item_t *>(item->data);
+  return static_cast<canvas_item_t *>(hit);
 }
 
 canvas_item_t *canvas_t::get_next_item_at(lpos_t pos, canvas_item_t *oldtop) const
 {
-  goo_canvas_item_lower(static_cast<GooCanvasItem *>(oldtop), nullptr);
+  canvas_layer::entry *e = canvas_layer::entry_of(oldtop);
+  if(e != nullptr)
+    e->layer->lower(e);
+  else
+    goo_canvas_item_lower(static_cast<GooCanvasItem *>(oldtop), nullptr);
 
   return get_item_at(pos);
 }
@@ -445,13 +556,17 @@ canvas_item_t *canvas_t::get_next_item_at(lpos_t pos, canvas_item_t *oldtop) con
 canvas_item_circle *canvas_t::circle_new(canvas_group_t group, lpos_t c,
                                     float radius, int border,
                                     color_t fill_col, color_t border_col) {
-  canvas_item_t *item =
-    goo_canvas_ellipse_new(static_cast<canvas_goocanvas *>(this)->group[group],
-                           c.x, c.y, radius, radius,
-                           "line-width", static_cast<double>(border),
-                           "stroke-color-rgba", border_col.rgba(),
-                           "fill-color-rgba", fill_col.rgba(),
-                           nullptr);
+  canvas_goocanvas *gcanvas = static_cast<canvas_goocanvas *>(this);
+  canvas_item_t *item;
+  if(gcanvas->layers[group] != nullptr)
+    item = gcanvas->layers[group]->circle_new(c, radius, border, fill_col, border_col);
+  else
+    item = goo_canvas_ellipse_new(gcanvas->group[group],
+                                  c.x, c.y, radius, radius,
+                                  "line-width", static_cast<double>(border),
+                                  "stroke-color-rgba", border_col.rgba(),
+                                  "fill-color-rgba", fill_col.rgba(),
+                                  nullptr);
 
   if(CANVAS_SELECTABLE & (1<<group))
     (void) new canvas_item_info_circle(this, item, c, static_cast<unsigned int>(radius) + border);
@@ -482,21 +597,50 @@ canvas_points_create(const std::vector<lpos_t> &points)
   return gpoints;
 }
 
+/**
+ * @brief create SVG path data for the given lines
+ * @param close if the lines should be closed to polygons
+ */
+std::string
+canvas_path_create(const std::vector<std::vector<lpos_t> > &lines, bool close)
+{
+  std::string ret;
+  char buf[32];
+
+  for(size_t i = 0; i < lines.size(); i++) {
+    const std::vector<lpos_t> &line = lines[i];
+    for(size_t j = 0; j < line.size(); j++) {
+      snprintf(buf, sizeof(buf), "%c%d %d ", j == 0 ? 'M' : 'L', line[j].x, line[j].y);
+      ret += buf;
+    }
+    if(close)
+      ret += "Z ";
+  }
+
+  return ret;
+}
+
 } // namespace
 
 canvas_item_polyline *canvas_t::polyline_new(canvas_group_t group, const std::vector<lpos_t> &points,
                                       float width, color_t color)
 {
-  pointGuard cpoints(canvas_points_create(points));
-
-  canvas_item_t *item =
-    goo_canvas_polyline_new(static_cast<canvas_goocanvas *>(this)->group[group],
-                            FALSE, 0, "points", cpoints.get(),
-                            "line-width", static_cast<double>(width),
-                            "stroke-color-rgba", color.rgba(),
-                            "line-join", CAIRO_LINE_JOIN_ROUND,
-			    "line-cap", CAIRO_LINE_CAP_ROUND,
-                            nullptr);
+  canvas_goocanvas *gcanvas = static_cast<canvas_goocanvas *>(this);
+  canvas_item_t *item;
+  if(gcanvas->layers[group] != nullptr) {
+    item = gcanvas->layers[group]->poly_new(canvas_layer::Polyline, points, width, color,
+                                            color_t::transparent());
+  } else {
+    pointGuard cpoints(canvas_points_create(points));
+
+    item = goo_canvas_polyline_new(gcanvas->group[group],
+                                   FALSE, 0, "points", cpoints.get(),
+                                   "line-width", static_cast<double>(width),
+                                   "stroke-color-rgba", color.rgba(),
+                                   "line-join", CAIRO_LINE_JOIN_ROUND,
+                                   "line-cap", CAIRO_LINE_CAP_ROUND,
+                                   nullptr);
+  }
 
   if(CANVAS_SELECTABLE & (1<<group))
     (void) new canvas_item_info_poly(this, item, false, width, points);
@@ -506,24 +650,84 @@ canvas_item_polyline *canvas_t::polyline_new(canvas_group_t group, const std::ve
 
 canvas_item_t *canvas_t::polygon_new(canvas_group_t group, const std::vector<lpos_t> &points,
                                      float width, color_t color, color_t fill) {
-  pointGuard cpoints(canvas_points_create(points));
+  canvas_goocanvas *gcanvas = static_cast<canvas_goocanvas *>(this);
+  canvas_item_t *item;
+  if(gcanvas->layers[group] != nullptr) {
+    item = gcanvas->layers[group]->poly_new(canvas_layer::Polygon, points, width, color, fill);
+  } else {
+    pointGuard cpoints(canvas_points_create(points));
+
+    item = goo_canvas_polyline_new(gcanvas->group[group],
+                                   TRUE, 0, "points", cpoints.get(),
+                                   "line-width", static_cast<double>(width),
+                                   "stroke-color-rgba", color.rgba(),
+                                   "fill-color-rgba", fill.rgba(),
+                                   "line-join", CAIRO_LINE_JOIN_ROUND,
+                                   "line-cap", CAIRO_LINE_CAP_ROUND,
+                                   nullptr);
+  }
+
+  if(CANVAS_SELECTABLE & (1<<group))
+    (void) new canvas_item_info_poly(this, item, true, width, points);
+
+  return item;
+}
+
+canvas_item_t *canvas_t::markers_new(canvas_group_t group, const std::vector<lpos_t> &centers,
+                                     float radius, color_t fill)
+{
+  // every circle is made of 2 arcs
+  std::string data;
+  char buf[96];
+  for(size_t i = 0; i < centers.size(); i++) {
+    snprintf(buf, sizeof(buf), "M%g %d a%g %g 0 1 0 %g 0 a%g %g 0 1 0 %g 0 Z ",
+             centers[i].x - radius, centers[i].y, radius, radius, 2 * radius,
+             radius, radius, -2 * radius);
+    data += buf;
+  }
 
   canvas_item_t *item =
-    goo_canvas_polyline_new(static_cast<canvas_goocanvas *>(this)->group[group],
-                            TRUE, 0, "points", cpoints.get(),
-                            "line-width", static_cast<double>(width),
-                            "stroke-color-rgba", color.rgba(),
-                            "fill-color-rgba", fill.rgba(),
-			    "line-join", CAIRO_LINE_JOIN_ROUND,
-			    "line-cap", CAIRO_LINE_CAP_ROUND,
-                            nullptr);
+    goo_canvas_path_new(static_cast<canvas_goocanvas *>(this)->group[group], data.c_str(),
+                        "line-width", 0.0,
+                        "stroke-color-rgba", color_t::transparent().rgba(),
+                        "fill-color-rgba", fill.rgba(),
+                        nullptr);
 
   if(CANVAS_SELECTABLE & (1<<group))
-    (void) new canvas_item_info_poly(this, item, true, width, points);
+    (void) new canvas_item_info_markers(this, item, centers, static_cast<unsigned int>(radius));
 
   return item;
 }
 
+canvas_item_t *canvas_t::polylines_new(canvas_group_t group, const std::vector<std::vector<lpos_t> > &lines,
+                                       float width, color_t color)
+{
+  assert((CANVAS_SELECTABLE & (1<<group)) == 0);
+
+  const std::string &data = canvas_path_create(lines, false);
+
+  return goo_canvas_path_new(static_cast<canvas_goocanvas *>(this)->group[group], data.c_str(),
+                             "line-width", static_cast<double>(width),
+                             "stroke-color-rgba", color.rgba(),
+                             "line-join", CAIRO_LINE_JOIN_ROUND,
+                             "line-cap", CAIRO_LINE_CAP_ROUND,
+                             nullptr);
+}
+
+canvas_item_t *canvas_t::polygons_new(canvas_group_t group, const std::vector<std::vector<lpos_t> > &polygons,
+                                      color_t fill)
+{
+  assert((CANVAS_SELECTABLE & (1<<group)) == 0);
+
+  const std::string &data = canvas_path_create(polygons, true);
+
+  return goo_canvas_path_new(static_cast<canvas_goocanvas *>(this)->group[group], data.c_str(),
+                             "line-width", 0.0,
+                             "stroke-color-rgba", color_t::transparent().rgba(),
+                             "fill-color-rgba", fill.rgba(),
+                             nullptr);
+}
+
 /* place the image in pix centered on x/y on the canvas */
 canvas_item_pixmap *canvas_t::image_new(canvas_group_t group, icon_item *icon, lpos_t pos,
                                         float scale)
@@ -546,13 +750,25 @@ canvas_item_pixmap *canvas_t::image_new(canvas_group_t group, icon_item *icon, l
 }
 
 void canvas_item_t::operator delete(void *ptr) {
-  if(G_LIKELY(ptr != nullptr))
+  if(G_UNLIKELY(ptr == nullptr))
+    return;
+
+  canvas_layer::entry *e = canvas_layer::entry_of(static_cast<canvas_item_t *>(ptr));
+  if(e != nullptr)
+    e->layer->remove(e);
+  else
     goo_canvas_item_remove(static_cast<GooCanvasItem *>(ptr));
 }
 
 /* ------------------------ accessing items ---------------------- */
 
 void canvas_item_polyline::set_points(const std::vector<lpos_t> &points) {
+  canvas_layer::entry *e = canvas_layer::entry_of(this);
+  if(e != nullptr) {
+    e->layer->set_points(e, points);
+    return;
+  }
+
   pointGuard cpoints(canvas_points_create(points));
   g_object_set(G_OBJECT(this), "points", cpoints.get(), nullptr);
 }
@@ -560,13 +776,66 @@ void canvas_item_polyline::set_points(const std::vector<lpos_t> &points) {
 void
 canvas_item_circle::set_radius(float radius)
 {
+  canvas_layer::entry *e = canvas_layer::entry_of(this);
+  if(e != nullptr) {
+    e->layer->set_radius(e, radius);
+    return;
+  }
+
   g_object_set(G_OBJECT(this),
                "radius-x", static_cast<gdouble>(radius),
                "radius-y", static_cast<gdouble>(radius),
                nullptr);
 }
 
+void
+canvas_item_circle::set_center(lpos_t c)
+{
+  canvas_layer::entry *e = canvas_layer::entry_of(this);
+  if(e != nullptr) {
+    e->layer->set_center(e, c);
+    return;
+  }
+
+  g_object_set(G_OBJECT(this),
+               "center-x", static_cast<gdouble>(c.x),
+               "center-y", static_cast<gdouble>(c.y),
+               nullptr);
+}
+
+void canvas_item_t::set_style(float width, color_t color, color_t fill)
+{
+  canvas_layer::entry *e = canvas_layer::entry_of(this);
+  if(e != nullptr) {
+    e->layer->set_style(e, width, color, fill);
+    return;
+  }
+
+  // open polylines must not get a fill color, cairo would close the path for filling
+  gboolean filled = TRUE;
+  if(GOO_IS_CANVAS_POLYLINE(this))
+    g_object_get(G_OBJECT(this), "close-path", &filled, nullptr);
+
+  if(filled)
+    g_object_set(G_OBJECT(this),
+                 "line-width", static_cast<gdouble>(width),
+                 "stroke-color-rgba", color.rgba(),
+                 "fill-color-rgba", fill.rgba(),
+                 nullptr);
+  else
+    g_object_set(G_OBJECT(this),
+                 "line-width", static_cast<gdouble>(width),
+                 "stroke-color-rgba", color.rgba(),
+                 nullptr);
+}
+
 void canvas_item_t::set_zoom_max(float zoom_max) {
+  canvas_layer::entry *e = canvas_layer::entry_of(this);
+  if(e != nullptr) {
+    e->layer->set_zoom_max(e, zoom_max);
+    return;
+  }
+
   gdouble vis_thres = zoom_max;
   GooCanvasItemVisibility vis
     = GOO_CANVAS_ITEM_VISIBLE_ABOVE_THRESHOLD;
@@ -582,6 +851,20 @@ void canvas_item_t::set_zoom_max(float zoom_max) {
 
 void canvas_item_t::set_dashed(float line_width, unsigned int dash_length_on,
                                unsigned int dash_length_off) {
+  canvas_layer::entry *e = canvas_layer::entry_of(this);
+  if(e != nullptr) {
+    e->layer->set_dashed(e, dash_length_on, dash_length_off);
+    return;
+  }
+
+  if(dash_length_on == 0) {
+    g_object_set(G_OBJECT(this),
+                 "line-dash", nullptr,
+                 "line-cap", CAIRO_LINE_CAP_ROUND,
+                 nullptr);
+    return;
+  }
+
   GooCanvasLineDash *dash;
   guint cap = CAIRO_LINE_CAP_BUTT;
   if(dash_length_on > line_width)
@@ -598,11 +881,19 @@ void canvas_item_t::set_dashed(float line_width, unsigned int dash_length_on,
 
 void canvas_item_t::set_user_data(map_item_t *data)
 {
-  g_object_set_data(G_OBJECT(this), "user data", data);
+  canvas_layer::entry *e = canvas_layer::entry_of(this);
+  if(e != nullptr)
+    e->user_data = data;
+  else
+    g_object_set_data(G_OBJECT(this), "user data", data);
   destroy_connect(new map_item_destroyer(data));
 }
 
 map_item_t *canvas_item_t::get_user_data() {
+  const canvas_layer::entry *e = canvas_layer::entry_of(this);
+  if(e != nullptr)
+    return e->user_data;
+
   return static_cast<map_item_t *>(g_object_get_data(G_OBJECT(this), "user data"));
 }
 
@@ -615,7 +906,11 @@ static void canvas_item_weak_notify(gpointer data, GObject *obj)
 
 void canvas_item_t::destroy_connect(canvas_item_destroyer *d)
 {
-  g_object_weak_ref(G_OBJECT(this), canvas_item_weak_notify, d);
+  canvas_layer::entry *e = canvas_layer::entry_of(this);
+  if(e != nullptr)
+    e->destroyers.push_back(d);
+  else
+    g_object_weak_ref(G_OBJECT(this), canvas_item_weak_notify, d);
 }
 
 bool canvas_goocanvas::isVisible(const lpos_t lpos) const
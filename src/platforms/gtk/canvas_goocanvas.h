@@ -17,6 +17,7 @@
 
 #include "osm2go_platform_gtk.h"
 
+class canvas_layer;
 struct canvas_dimensions;
 
 class canvas_goocanvas : public canvas_t {
@@ -24,6 +25,13 @@ public:
   canvas_goocanvas();
 
   std::array<GooCanvasItem *, CANVAS_GROUPS> group;
+  /**
+   * @brief the layer items drawing the simple shapes of the group
+   *
+   * These are owned by the group items, nullptr for groups that only have
+   * plain GooCanvas items.
+   */
+  std::array<canvas_layer *, CANVAS_GROUPS> layers;
 
   struct canvas_bounds {
     inline canvas_bounds() : min(lpos_t(0, 0)), max(lpos_t(0, 0)) {}
@@ -35,6 +43,11 @@ public:
     std::unique_ptr<GdkPixbuf, g_object_deleter> pix;
   } bg;
 
+  /**
+   * @brief create the item for the given group and its layer item if needed
+   */
+  void create_group(unsigned int gr);
+
   canvas_dimensions get_viewport_dimensions() const;
   bool isVisible(const lpos_t lpos) const;
 };
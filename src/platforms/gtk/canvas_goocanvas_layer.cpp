@@ -0,0 +1,533 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Rolf Eike Beer <eike@sf-mail.de>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "canvas_goocanvas_layer.h"
+
+#include <perf_trace.h>
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cmath>
+
+#include <osm2go_annotations.h>
+#include <osm2go_cpp.h>
+
+namespace {
+
+struct CanvasLayerItem {
+  GooCanvasItemSimple parent;
+  canvas_layer *layer;
+};
+
+struct CanvasLayerItemClass {
+  GooCanvasItemSimpleClass parent_class;
+};
+
+} // namespace
+
+#if __GNUC__ > 5
+// ignore warnings caused by older glib versions
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wzero-as-null-pointer-constant"
+#if __GNUC__ > 8
+#pragma GCC diagnostic ignored "-Wcast-function-type"
+#endif
+#endif
+G_DEFINE_TYPE(CanvasLayerItem, canvas_layer_item, GOO_TYPE_CANVAS_ITEM_SIMPLE);
+#if __GNUC__ > 5
+#pragma GCC diagnostic pop
+#endif
+
+namespace {
+
+inline CanvasLayerItem *layer_item_cast(gpointer obj)
+{
+  return G_TYPE_CHECK_INSTANCE_CAST(obj, canvas_layer_item_get_type(), CanvasLayerItem);
+}
+
+void canvas_layer_item_dispose(GObject *object)
+{
+  // the destroyers may still access the canvas, so run them as early as possible
+  layer_item_cast(object)->layer->clear();
+
+  G_OBJECT_CLASS(canvas_layer_item_parent_class)->dispose(object);
+}
+
+void canvas_layer_item_finalize(GObject *object)
+{
+  delete layer_item_cast(object)->layer;
+
+  G_OBJECT_CLASS(canvas_layer_item_parent_class)->finalize(object);
+}
+
+void canvas_layer_item_update(GooCanvasItemSimple *simple, cairo_t *cr)
+{
+  const canvas_layer *layer = layer_item_cast(simple)->layer;
+
+  layer->get_bounds(simple->bounds);
+  goo_canvas_item_simple_user_bounds_to_device(simple, cr, &simple->bounds);
+}
+
+void canvas_layer_item_paint(GooCanvasItemSimple *simple, cairo_t *cr, const GooCanvasBounds *bounds)
+{
+  layer_item_cast(simple)->layer->paint(cr, *bounds, goo_canvas_get_scale(simple->canvas));
+}
+
+gboolean canvas_layer_item_is_item_at(GooCanvasItemSimple *, double, double, cairo_t *, gboolean)
+{
+  // the entries are searched by canvas_t::get_item_at(), never report the layer itself
+  return FALSE;
+}
+
+void set_source(cairo_t *cr, color_t c)
+{
+  cairo_set_source_rgba(cr, (c.rgba() >> 24) / 255.0, ((c.rgba() >> 16) & 0xff) / 255.0,
+                        ((c.rgba() >> 8) & 0xff) / 255.0, (c.rgba() & 0xff) / 255.0);
+}
+
+/**
+ * @brief set the line attributes of the given entry
+ */
+void set_stroke(cairo_t *cr, const canvas_layer::entry &e)
+{
+  set_source(cr, e.stroke);
+  cairo_set_line_width(cr, e.width);
+
+  if(e.dash_on > 0) {
+    const double dashes[2] = { static_cast<double>(e.dash_on), static_cast<double>(e.dash_off) };
+    cairo_set_dash(cr, dashes, 2, 0);
+    cairo_set_line_cap(cr, e.dash_on > e.width ? CAIRO_LINE_CAP_ROUND : CAIRO_LINE_CAP_BUTT);
+  } else {
+    cairo_set_dash(cr, nullptr, 0, 0);
+    cairo_set_line_cap(cr, CAIRO_LINE_CAP_ROUND);
+  }
+}
+
+/**
+ * @brief check if both polylines can be drawn with a single stroke
+ *
+ * Translucent lines are never merged, their overlapping parts would not be
+ * blended anymore.
+ */
+inline bool same_stroke(const canvas_layer::entry &a, const canvas_layer::entry &b)
+{
+  return a.stroke == b.stroke && (a.stroke.rgba() & 0xff) == 0xff && a.width == b.width &&
+         a.dash_on == b.dash_on && a.dash_off == b.dash_off;
+}
+
+void add_path(cairo_t *cr, const lpos_t *pts, unsigned int count, bool close)
+{
+  cairo_move_to(cr, pts[0].x, pts[0].y);
+  for(unsigned int i = 1; i < count; i++)
+    cairo_line_to(cr, pts[i].x, pts[i].y);
+  if(close)
+    cairo_close_path(cr);
+}
+
+} // namespace
+
+static void canvas_layer_item_init(CanvasLayerItem *self)
+{
+  self->layer = new canvas_layer(&self->parent);
+}
+
+static void canvas_layer_item_class_init(CanvasLayerItemClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS(klass);
+  object_class->dispose = canvas_layer_item_dispose;
+  object_class->finalize = canvas_layer_item_finalize;
+
+  GooCanvasItemSimpleClass *simple_class = reinterpret_cast<GooCanvasItemSimpleClass *>(klass);
+  simple_class->simple_update = canvas_layer_item_update;
+  simple_class->simple_paint = canvas_layer_item_paint;
+  simple_class->simple_is_item_at = canvas_layer_item_is_item_at;
+}
+
+canvas_layer *canvas_layer::create(GooCanvasItem *parent)
+{
+  gpointer obj = g_object_new(canvas_layer_item_get_type(), nullptr);
+  GooCanvasItem *item = GOO_CANVAS_ITEM(obj);
+  goo_canvas_item_add_child(parent, item, -1);
+  // the parent now holds the only reference
+  g_object_unref(obj);
+
+  return layer_item_cast(obj)->layer;
+}
+
+bool canvas_layer::is_layer(GooCanvasItem *item)
+{
+  return G_TYPE_CHECK_INSTANCE_TYPE(item, canvas_layer_item_get_type());
+}
+
+canvas_layer::canvas_layer(GooCanvasItemSimple *it)
+  : item(it)
+  , released(0)
+  , unusedPoints(0)
+  , min(INT_MAX, INT_MAX)
+  , max(INT_MIN, INT_MIN)
+{
+}
+
+canvas_layer::entry &canvas_layer::allocate(Kind kind)
+{
+  entry *e;
+  if(!reusable.empty()) {
+    e = &entries[reusable.back()];
+    reusable.pop_back();
+  } else {
+    entries.resize(entries.size() + 1);
+    e = &entries.back();
+    e->index = entries.size() - 1;
+  }
+
+  e->layer = this;
+  e->user_data = nullptr;
+  assert(e->destroyers.empty());
+  e->first = points.size();
+  e->count = 0;
+  e->stroke = color_t::transparent();
+  e->fill = color_t::transparent();
+  e->width = 0;
+  e->radius = 0;
+  e->zoom_max = 0;
+  e->dash_on = 0;
+  e->dash_off = 0;
+  e->kind = kind;
+
+  order.push_back(e->index);
+
+  return *e;
+}
+
+void canvas_layer::redraw(const entry &e)
+{
+  // a pending update will redraw the whole layer anyway
+  if(item->canvas == nullptr || item->need_update)
+    return;
+
+  GooCanvasBounds b;
+  b.x1 = e.min.x;
+  b.y1 = e.min.y;
+  b.x2 = e.max.x;
+  b.y2 = e.max.y;
+  goo_canvas_request_redraw(item->canvas, &b);
+}
+
+void canvas_layer::update_bbox(entry &e)
+{
+  const int extra = static_cast<int>(std::ceil(e.width / 2)) + 1;
+
+  if(e.kind == Circle) {
+    const lpos_t &c = points[e.first];
+    const int r = static_cast<int>(std::ceil(e.radius)) + extra;
+    e.min = lpos_t(c.x - r, c.y - r);
+    e.max = lpos_t(c.x + r, c.y + r);
+  } else {
+    e.min = lpos_t(INT_MAX, INT_MAX);
+    e.max = lpos_t(INT_MIN, INT_MIN);
+    for(unsigned int i = e.first; i < e.first + e.count; i++) {
+      e.min.x = std::min(e.min.x, points[i].x);
+      e.min.y = std::min(e.min.y, points[i].y);
+      e.max.x = std::max(e.max.x, points[i].x);
+      e.max.y = std::max(e.max.y, points[i].y);
+    }
+    e.min.x -= extra;
+    e.min.y -= extra;
+    e.max.x += extra;
+    e.max.y += extra;
+  }
+
+  if(e.min.x < min.x || e.min.y < min.y || e.max.x > max.x || e.max.y > max.y) {
+    min.x = std::min(min.x, e.min.x);
+    min.y = std::min(min.y, e.min.y);
+    max.x = std::max(max.x, e.max.x);
+    max.y = std::max(max.y, e.max.y);
+    goo_canvas_item_simple_changed(item, TRUE);
+  } else {
+    redraw(e);
+  }
+}
+
+canvas_item_t *canvas_layer::circle_new(lpos_t c, float radius, float border, color_t fill,
+                                        color_t border_col)
+{
+  entry &e = allocate(Circle);
+  points.push_back(c);
+  e.count = 1;
+  e.radius = radius;
+  e.width = border;
+  e.fill = fill;
+  e.stroke = border_col;
+  update_bbox(e);
+
+  return e.handle();
+}
+
+canvas_item_t *canvas_layer::poly_new(Kind kind, const std::vector<lpos_t> &pts, float width,
+                                      color_t color, color_t fillcol)
+{
+  assert(kind == Polyline || kind == Polygon);
+  assert(!pts.empty());
+
+  entry &e = allocate(kind);
+  points.insert(points.end(), pts.begin(), pts.end());
+  e.count = pts.size();
+  e.width = width;
+  e.stroke = color;
+  e.fill = fillcol;
+  update_bbox(e);
+
+  return e.handle();
+}
+
+void canvas_layer::remove(entry *e)
+{
+  assert(e->layer == this);
+  assert(e->kind != Free);
+
+  redraw(*e);
+
+  std::vector<canvas_item_destroyer *> destroyers;
+  destroyers.swap(e->destroyers);
+  for(std::vector<canvas_item_destroyer *>::const_iterator it = destroyers.begin(); it != destroyers.end(); it++) {
+    (*it)->run(e->handle());
+    delete *it;
+  }
+
+  e->kind = Free;
+  e->user_data = nullptr;
+  unusedPoints += e->count;
+  e->count = 0;
+  released++;
+
+  // the free entries are kept until most of the layer is garbage, so removing
+  // all items of a layer one by one does not become quadratic
+  if((released > 64 && released > order.size() / 2) ||
+     (unusedPoints > 1024 && unusedPoints > points.size() / 2))
+    compact();
+}
+
+void canvas_layer::clear()
+{
+  for(std::vector<unsigned int>::const_iterator it = order.begin(); it != order.end(); it++) {
+    entry &e = entries[*it];
+    if(e.kind == Free)
+      continue;
+
+    std::vector<canvas_item_destroyer *> destroyers;
+    destroyers.swap(e.destroyers);
+    for(std::vector<canvas_item_destroyer *>::const_iterator dit = destroyers.begin(); dit != destroyers.end(); dit++) {
+      (*dit)->run(e.handle());
+      delete *dit;
+    }
+    e.kind = Free;
+  }
+
+  entries.clear();
+  order.clear();
+  reusable.clear();
+  points.clear();
+  released = 0;
+  unusedPoints = 0;
+  min = lpos_t(INT_MAX, INT_MAX);
+  max = lpos_t(INT_MIN, INT_MIN);
+}
+
+void canvas_layer::compact()
+{
+  std::vector<unsigned int> norder;
+  norder.reserve(order.size() - released);
+  std::vector<lpos_t> npoints;
+  npoints.reserve(points.size() - unusedPoints);
+
+  min = lpos_t(INT_MAX, INT_MAX);
+  max = lpos_t(INT_MIN, INT_MIN);
+
+  for(std::vector<unsigned int>::const_iterator it = order.begin(); it != order.end(); it++) {
+    entry &e = entries[*it];
+    if(e.kind == Free) {
+      reusable.push_back(*it);
+      continue;
+    }
+
+    const std::vector<lpos_t>::const_iterator pit = std::next(points.cbegin(), e.first);
+    e.first = npoints.size();
+    npoints.insert(npoints.end(), pit, std::next(pit, e.count));
+    norder.push_back(*it);
+
+    min.x = std::min(min.x, e.min.x);
+    min.y = std::min(min.y, e.min.y);
+    max.x = std::max(max.x, e.max.x);
+    max.y = std::max(max.y, e.max.y);
+  }
+
+  order.swap(norder);
+  points.swap(npoints);
+  released = 0;
+  unusedPoints = 0;
+
+  goo_canvas_item_simple_changed(item, TRUE);
+}
+
+void canvas_layer::set_points(entry *e, const std::vector<lpos_t> &pts)
+{
+  assert(e->kind == Polyline || e->kind == Polygon);
+  assert(!pts.empty());
+
+  redraw(*e);
+
+  if(pts.size() <= e->count) {
+    std::copy(pts.begin(), pts.end(), std::next(points.begin(), e->first));
+    unusedPoints += e->count - pts.size();
+  } else {
+    // the entry can't grow in place, its old points become garbage
+    unusedPoints += e->count;
+    e->first = points.size();
+    points.insert(points.end(), pts.begin(), pts.end());
+  }
+  e->count = pts.size();
+
+  update_bbox(*e);
+}
+
+void canvas_layer::set_radius(entry *e, float radius)
+{
+  assert(e->kind == Circle);
+
+  redraw(*e);
+  e->radius = radius;
+  update_bbox(*e);
+}
+
+void canvas_layer::set_center(entry *e, lpos_t c)
+{
+  assert(e->kind == Circle);
+
+  redraw(*e);
+  points[e->first] = c;
+  update_bbox(*e);
+}
+
+void canvas_layer::set_style(entry *e, float width, color_t stroke, color_t fill)
+{
+  redraw(*e);
+  e->width = width;
+  e->stroke = stroke;
+  if(e->kind != Polyline)
+    e->fill = fill;
+  update_bbox(*e);
+}
+
+void canvas_layer::set_zoom_max(entry *e, float zoom_max)
+{
+  e->zoom_max = zoom_max;
+  redraw(*e);
+}
+
+void canvas_layer::set_dashed(entry *e, unsigned int on, unsigned int off)
+{
+  e->dash_on = on;
+  e->dash_off = off;
+  redraw(*e);
+}
+
+void canvas_layer::lower(entry *e)
+{
+  std::vector<unsigned int>::iterator it = std::find(order.begin(), order.end(), e->index);
+  assert(it != order.end());
+  std::rotate(order.begin(), it, std::next(it));
+  redraw(*e);
+}
+
+void canvas_layer::get_bounds(GooCanvasBounds &bounds) const
+{
+  if(min.x > max.x) {
+    bounds.x1 = bounds.y1 = bounds.x2 = bounds.y2 = 0;
+  } else {
+    bounds.x1 = min.x;
+    bounds.y1 = min.y;
+    bounds.x2 = max.x;
+    bounds.y2 = max.y;
+  }
+}
+
+void canvas_layer::paint(cairo_t *cr, const GooCanvasBounds &bounds, double zoom) const
+{
+  PERF_SCOPE("canvas_layer::paint");
+  unsigned int painted = 0;
+
+  cairo_save(cr);
+  cairo_set_line_join(cr, CAIRO_LINE_JOIN_ROUND);
+  cairo_new_path(cr);
+
+  // consecutive polylines with the same style are collected into one path
+  const entry *pending = nullptr;
+
+  for(std::vector<unsigned int>::const_iterator it = order.begin(); it != order.end(); it++) {
+    const entry &e = entries[*it];
+    if(e.kind == Free || !e.visible(zoom) ||
+       e.max.x < bounds.x1 || e.min.x > bounds.x2 || e.max.y < bounds.y1 || e.min.y > bounds.y2)
+      continue;
+
+    painted++;
+    const lpos_t *pts = points.data() + e.first;
+
+    if(pending != nullptr) {
+      if(e.kind == Polyline && same_stroke(*pending, e)) {
+        add_path(cr, pts, e.count, false);
+        continue;
+      }
+      cairo_stroke(cr);
+      pending = nullptr;
+    }
+
+    switch(e.kind) {
+    case Circle:
+      cairo_arc(cr, pts->x, pts->y, e.radius, 0, 2 * M_PI);
+      if(!e.fill.is_transparent()) {
+        set_source(cr, e.fill);
+        cairo_fill_preserve(cr);
+      }
+      if(e.width > 0 && !e.stroke.is_transparent()) {
+        set_stroke(cr, e);
+        cairo_stroke(cr);
+      } else {
+        cairo_new_path(cr);
+      }
+      break;
+    case Polygon:
+      add_path(cr, pts, e.count, true);
+      if(!e.fill.is_transparent()) {
+        set_source(cr, e.fill);
+        cairo_fill_preserve(cr);
+      }
+      if(e.width > 0 && !e.stroke.is_transparent()) {
+        set_stroke(cr, e);
+        cairo_stroke(cr);
+      } else {
+        cairo_new_path(cr);
+      }
+      break;
+    case Polyline:
+      if(e.width <= 0 || e.stroke.is_transparent())
+        break;
+      set_stroke(cr, e);
+      add_path(cr, pts, e.count, false);
+      pending = &e;
+      break;
+    case Free:
+      assert_unreachable();
+    }
+  }
+
+  if(pending != nullptr)
+    cairo_stroke(cr);
+
+  cairo_restore(cr);
+
+  PERF_COUNT("canvas_layer::paint items", painted);
+}
@@ -0,0 +1,165 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Rolf Eike Beer <eike@sf-mail.de>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <canvas.h>
+#include <color.h>
+#include <pos.h>
+
+#include <cstdint>
+#include <deque>
+#include <goocanvas.h>
+#include <vector>
+
+#include <osm2go_cpp.h>
+
+/**
+ * @brief draws all circles, polylines and polygons of one canvas group
+ *
+ * Creating a GooCanvas item for every object of a big map costs a lot of time
+ * and memory. The items of the static map layers are instead stored in flat
+ * arrays of this class and drawn by a single GooCanvas item with cairo.
+ *
+ * The canvas_item_t pointers handed out for these items point to their entry,
+ * with the lowest bit set. GooCanvasItem pointers are always aligned, so both
+ * kinds of handles can be told apart by entry_of().
+ */
+class canvas_layer {
+public:
+  enum Kind {
+    Free,       ///< the entry is unused
+    Circle,
+    Polyline,
+    Polygon
+  };
+
+  struct entry {
+    canvas_layer *layer;
+    map_item_t *user_data;
+    std::vector<canvas_item_destroyer *> destroyers;
+    unsigned int index;       ///< the position in canvas_layer::entries
+    unsigned int first;       ///< the first point in canvas_layer::points
+    unsigned int count;       ///< the number of points, circles have their center as only point
+    lpos_t min, max;          ///< the bounding box, including the line width
+    color_t stroke, fill;
+    float width;              ///< the line width, or the border width of circles
+    float radius;
+    float zoom_max;           ///< the item is only visible if the zoom is at least this
+    unsigned int dash_on, dash_off;
+    Kind kind;
+
+    inline bool visible(double zoom) const
+    { return zoom_max <= 0 || zoom >= zoom_max; }
+
+    inline canvas_item_t *handle()
+    { return reinterpret_cast<canvas_item_t *>(reinterpret_cast<uintptr_t>(this) | 1); }
+  };
+
+  /**
+   * @brief create a new layer item as child of the given group
+   * @returns the layer, it is owned by the GooCanvas item
+   */
+  static canvas_layer *create(GooCanvasItem *parent);
+
+  /**
+   * @brief check if the given item is the GooCanvas item of a layer
+   */
+  static bool is_layer(GooCanvasItem *item);
+
+  /**
+   * @brief get the entry for the given handle
+   * @retval nullptr the item is a plain GooCanvasItem
+   */
+  static inline entry *entry_of(const canvas_item_t *item)
+  {
+    const uintptr_t p = reinterpret_cast<uintptr_t>(item);
+    return (p & 1) ? reinterpret_cast<entry *>(p & ~static_cast<uintptr_t>(1)) : nullptr;
+  }
+
+  canvas_item_t *circle_new(lpos_t c, float radius, float border, color_t fill, color_t border_col);
+  canvas_item_t *poly_new(Kind kind, const std::vector<lpos_t> &pts, float width, color_t color,
+                          color_t fillcol);
+
+  /**
+   * @brief remove the entry and run its destroyers
+   */
+  void remove(entry *e);
+
+  /**
+   * @brief remove all entries
+   *
+   * This is only used when the layer item is destroyed, the canvas is not
+   * notified.
+   */
+  void clear();
+
+  void set_points(entry *e, const std::vector<lpos_t> &pts);
+  void set_radius(entry *e, float radius);
+  void set_center(entry *e, lpos_t c);
+  void set_style(entry *e, float width, color_t stroke, color_t fill);
+  void set_zoom_max(entry *e, float zoom_max);
+  void set_dashed(entry *e, unsigned int on, unsigned int off);
+
+  /**
+   * @brief move the entry below all others of this layer
+   */
+  void lower(entry *e);
+
+  /**
+   * @brief find the topmost visible entry near the given position
+   * @param pred checks the exact position, called with the candidate entries
+   */
+  template<typename _Predicate>
+  entry *find_topmost(lpos_t pos, int fuzziness, double zoom, _Predicate pred)
+  {
+    for(std::vector<unsigned int>::const_reverse_iterator it = order.rbegin(); it != order.rend(); it++) {
+      entry &e = entries[*it];
+      if(e.kind == Free || !e.visible(zoom) ||
+         pos.x + fuzziness < e.min.x || pos.x - fuzziness > e.max.x ||
+         pos.y + fuzziness < e.min.y || pos.y - fuzziness > e.max.y)
+        continue;
+      if(pred(e.handle()))
+        return &e;
+    }
+    return nullptr;
+  }
+
+  /**
+   * @brief draw all visible entries that intersect the bounds
+   */
+  void paint(cairo_t *cr, const GooCanvasBounds &bounds, double zoom) const;
+
+  /**
+   * @brief the area covered by all entries
+   */
+  void get_bounds(GooCanvasBounds &bounds) const;
+
+  explicit canvas_layer(GooCanvasItemSimple *it);
+  canvas_layer() O2G_DELETED_FUNCTION;
+  canvas_layer(const canvas_layer &) O2G_DELETED_FUNCTION;
+  canvas_layer &operator=(const canvas_layer &) O2G_DELETED_FUNCTION;
+
+private:
+  GooCanvasItemSimple * const item;
+
+  std::deque<entry> entries;          ///< stable storage, the handles point in here
+  std::vector<unsigned int> order;    ///< the drawing order, bottom first, may contain free entries
+  std::vector<unsigned int> reusable; ///< free entries that are no longer referenced by order
+  unsigned int released;              ///< free entries still referenced by order
+  std::vector<lpos_t> points;         ///< the points of all entries
+  size_t unusedPoints;                ///< points no longer used by any entry
+  lpos_t min, max;                    ///< the bounding box of all entries
+
+  entry &allocate(Kind kind);
+  void update_bbox(entry &e);
+  void redraw(const entry &e);
+
+  /**
+   * @brief drop the free entries from order and the unused points
+   */
+  void compact();
+};
@@ -187,6 +187,17 @@ void icon_t::icon_free(icon_item *buf)
   }
 }
 
+size_t icon_t::memory_size() const
+{
+  const icon_buffer::BufferMap &entries = static_cast<const icon_buffer *>(this)->entries;
+  size_t ret = 0;
+  for(icon_buffer::BufferMap::const_iterator it = entries.begin(); it != entries.end(); it++) {
+    const GdkPixbuf *buf = it->second->buffer();
+    ret += sizeof(*it->second) + gdk_pixbuf_get_rowstride(buf) * gdk_pixbuf_get_height(buf);
+  }
+  return ret;
+}
+
 icon_buffer::~icon_buffer()
 {
   std::for_each(entries.begin(), entries.end(),
@@ -222,9 +222,8 @@ cb_menu_download(appdata_t *appdata) {
 void
 cb_menu_wms_import(appdata_t *appdata)
 {
-  std::string fn = wms_import(appdata_t::window, appdata->project);
-  if (!fn.empty())
-    appdata->map->set_bg_image(fn, osm2go_platform::screenpos(0, 0));
+  if(wms_import(appdata_t::window, appdata->project))
+    appdata->map->set_bg_tiles(osm2go_platform::screenpos(0, 0));
 }
 
 void
@@ -539,9 +538,9 @@ void track_clear_current_cb(appdata_t *appdata)
   appdata->track_clear_current();
 }
 
-void about_box(MainUi *uicontrol)
+void about_box(appdata_t *appdata)
 {
-  uicontrol->about_box();
+  appdata->uicontrol->about_box(*appdata);
 }
 
 #ifndef FREMANTLE
@@ -656,7 +655,7 @@ menu_create(appdata_internal &appdata, GtkBox *mainvbox)
                         gtk_separator_menu_item_new());
 
   menu_append_new_item(
-    appdata.uicontrol.get(), submenu, G_CALLBACK(about_box), _("_About"),
+    &appdata, submenu, G_CALLBACK(about_box), _("_About"),
     GTK_STOCK_ABOUT, "<OSM2Go-Main>/About");
 
   menu_append_new_item(
@@ -980,7 +979,7 @@ app_menu_create(appdata_internal &appdata)
 {
   /* -- the applications main menu -- */
   std::array<main_menu_entry_t, 7> main_menu = { {
-    main_menu_entry_t(_("About"),                      G_CALLBACK(about_box), appdata.uicontrol.get()),
+    main_menu_entry_t(_("About"),                      G_CALLBACK(about_box), &appdata),
     main_menu_entry_t(_("Project"),                    G_CALLBACK(cb_menu_project_open), &appdata),
     main_menu_entry_t(MainUi::SUBMENU_VIEW,            G_CALLBACK(on_submenu_view_clicked), &appdata),
     main_menu_entry_t(MainUi::SUBMENU_MAP,             G_CALLBACK(submenu_popup), appdata.app_menu_map.get()),
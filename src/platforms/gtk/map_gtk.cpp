@@ -179,8 +179,55 @@ gboolean map_gtk::key_press_event(unsigned int keyval)
   return FALSE;
 }
 
-static gboolean map_autosave(gpointer data) {
-  map_t *map = static_cast<map_t *>(data);
+namespace {
+
+gpointer autosave_worker(gpointer data)
+{
+  std::unique_ptr<std::shared_ptr<diff_snapshot> > snapshot(static_cast<std::shared_ptr<diff_snapshot> *>(data));
+
+  (*snapshot)->write();
+
+  return nullptr;
+}
+
+} // namespace
+
+void map_gtk::autosave_diff()
+{
+  // the thread still holds a reference while it runs
+  if(unlikely(autosaveData.use_count() > 1)) {
+    g_debug("previous autosave still in progress");
+    return;
+  }
+  autosave_wait();
+
+  autosaveData.reset(appdata.project->diff_collect());
+  if(unlikely(!autosaveData))
+    return;
+
+  std::shared_ptr<diff_snapshot> *threadData = new std::shared_ptr<diff_snapshot>(autosaveData);
+#if GLIB_CHECK_VERSION(2,32,0)
+  autosaveWorker = g_thread_try_new("autosave", autosave_worker, threadData, nullptr);
+#else
+  autosaveWorker = g_thread_create(autosave_worker, threadData, TRUE, nullptr);
+#endif
+  if(unlikely(autosaveWorker == nullptr)) {
+    g_warning("failed to create the autosave thread");
+    autosave_worker(threadData);
+  }
+}
+
+void map_gtk::autosave_wait()
+{
+  if(autosaveWorker != nullptr) {
+    g_thread_join(autosaveWorker);
+    autosaveWorker = nullptr;
+  }
+  autosaveData.reset();
+}
+
+gboolean map_gtk::map_autosave(gpointer data) {
+  map_gtk *map = static_cast<map_gtk *>(data);
 
   /* only do this if root window has focus as otherwise */
   /* a dialog may be open and modifying the basic structures */
@@ -189,7 +236,7 @@ static gboolean map_autosave(gpointer data) {
 
     if(likely(map->appdata.project)) {
       track_save(map->appdata.project, map->appdata.track.track.get());
-      map->appdata.project->diff_save();
+      map->autosave_diff();
     }
   } else
     g_debug("autosave suppressed");
@@ -199,6 +246,7 @@ static gboolean map_autosave(gpointer data) {
 
 map_gtk::map_gtk(appdata_t &a)
   : map_t(a, new canvas_goocanvas())
+  , autosaveWorker(nullptr)
 {
   g_signal_connect_swapped(canvas->widget, "button_press_event",
                            G_CALLBACK(map_button_event), this);
@@ -217,6 +265,8 @@ void map_gtk::set_autosave(bool enable)
 {
   if(enable)
     autosave.restart(120, map_autosave, this);
-  else
+  else {
     autosave.stop();
+    autosave_wait();
+  }
 }
@@ -11,17 +11,37 @@
 #include "osm2go_platform_gtk.h"
 
 #include <glib.h>
+#include <memory>
+
+class diff_snapshot;
 
 class map_gtk : public map_t {
 public:
   explicit map_gtk(appdata_t &a);
-  inline ~map_gtk() override {}
+  inline ~map_gtk() override
+  { autosave_wait(); }
 
   void set_autosave(bool enable) override;
   gboolean key_press_event(unsigned int keyval);
 
 private:
   osm2go_platform::Timer autosave;
+  GThread *autosaveWorker;                    ///< the thread writing the last diff snapshot
+  std::shared_ptr<diff_snapshot> autosaveData; ///< the snapshot, also referenced by the running thread
+
+  /**
+   * @brief write the current changes in the background
+   *
+   * If the previous write has not finished yet nothing is done.
+   */
+  void autosave_diff();
+
+  /**
+   * @brief wait until a pending background write has finished
+   */
+  void autosave_wait();
+
+  static gboolean map_autosave(gpointer data);
 
   static gboolean map_motion_notify_event(GtkWidget *, GdkEventMotion *event, map_gtk *map);
   static gboolean map_button_event(map_gtk *map, GdkEventButton *event);
@@ -7,20 +7,28 @@
 #include "net_io.h"
 
 #include <notifications.h>
+#include <perf_trace.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cstdio>
 #include <cstring>
 #include <curl/curl.h>
 #include <curl/easy.h>
+#include <curl/multi.h>
+#include <deque>
 #include <glib.h>
 #include <gtk/gtk.h>
+#include <list>
 #include <memory>
 #include <string>
 #include <unistd.h>
+#include <vector>
 
 #include "osm2go_annotations.h"
 #include <osm2go_cpp.h>
 #include <osm2go_i18n.h>
+#include <osm2go_log.h>
 #include "osm2go_stl.h"
 #include <osm2go_platform.h>
 #include <osm2go_platform_gtk.h>
@@ -144,11 +152,36 @@ struct f_closer {
   { fclose(f); }
 };
 
+/**
+ * @brief set the options shared by all requests
+ */
+void
+curl_setup_common(CURL *curl, char *errbuf)
+{
+  curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, errbuf);
+
+  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1l);
+
+  /* play nice and report some user agent */
+  curl_easy_setopt(curl, CURLOPT_USERAGENT, PACKAGE "-libcurl/" VERSION);
+
+  /* give up on servers that do not answer or stop sending data */
+  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 30l);
+  curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1l);
+  curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, 120l);
+
+#ifndef CURL_SSLVERSION_MAX_DEFAULT
+#define CURL_SSLVERSION_MAX_DEFAULT 0
+#endif
+  curl_easy_setopt(curl, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1 |
+                   CURL_SSLVERSION_MAX_DEFAULT);
+}
+
 void *worker_thread(void *ptr)
 {
   std::shared_ptr<net_io_request_t> request(*static_cast<std::shared_ptr<net_io_request_t>*>(ptr));
 
-  printf("thread: running\n");
+  OSM2GO_LOG(Net, Debug, "thread: running");
 
   std::unique_ptr<CURL, curl_deleter> curl(curl_easy_init());
   if(likely(curl)) {
@@ -175,18 +208,7 @@ void *worker_thread(void *ptr)
       curl_easy_setopt(curl.get(), CURLOPT_XFERINFOFUNCTION, curl_progress_func);
       curl_easy_setopt(curl.get(), CURLOPT_PROGRESSDATA, request.get());
 
-      curl_easy_setopt(curl.get(), CURLOPT_ERRORBUFFER, request->buffer);
-
-      curl_easy_setopt(curl.get(), CURLOPT_FOLLOWLOCATION, 1l);
-
-      /* play nice and report some user agent */
-      curl_easy_setopt(curl.get(), CURLOPT_USERAGENT, PACKAGE "-libcurl/" VERSION);
-
-#ifndef CURL_SSLVERSION_MAX_DEFAULT
-#define CURL_SSLVERSION_MAX_DEFAULT 0
-#endif
-      curl_easy_setopt(curl.get(), CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1 |
-                       CURL_SSLVERSION_MAX_DEFAULT);
+      curl_setup_common(curl.get(), request->buffer);
 
       std::unique_ptr<curl_slist, curl_slist_deleter> slist;
       if(request->use_compression)
@@ -195,7 +217,7 @@ void *worker_thread(void *ptr)
         curl_easy_setopt(curl.get(), CURLOPT_HTTPHEADER, slist.get());
 
       request->res = curl_easy_perform(curl.get());
-      printf("thread: curl perform returned with %d\n", request->res);
+      OSM2GO_LOG(Net, Debug, "thread: curl perform returned with %d", request->res);
 
       curl_easy_getinfo(curl.get(), CURLINFO_RESPONSE_CODE, &request->response);
 
@@ -207,9 +229,9 @@ void *worker_thread(void *ptr)
 #endif
     }
   } else
-    printf("thread: unable to init curl\n");
+    OSM2GO_LOG(Net, Error, "thread: unable to init curl");
 
-  printf("thread: io done, terminating\n");
+  OSM2GO_LOG(Net, Debug, "thread: io done, terminating");
   return nullptr;
 }
 
@@ -226,6 +248,7 @@ void *worker_thread(void *ptr)
 bool
 net_io_do(osm2go_platform::Widget *parent, net_io_request_t *rq, const std::string &title)
 {
+  PERF_SCOPE("net_io_do");
   /* the request structure is shared between master and worker thread. */
   /* typically the master thread will do some waiting until the worker */
   /* thread returns. But the master may very well stop waiting since e.g. */
@@ -282,11 +305,11 @@ net_io_do(osm2go_platform::Widget *parent, net_io_request_t *rq, const std::stri
 
   /* user pressed cancel */
   if(request.use_count() > 1) {
-    printf("operation cancelled, leave worker alone\n");
+    OSM2GO_LOG(Net, Debug, "operation cancelled, leave worker alone");
     return false;
   }
 
-  printf("worker thread has ended\n");
+  OSM2GO_LOG(Net, Debug, "worker thread has ended");
 
   /* --------- evaluate result --------- */
 
@@ -306,15 +329,213 @@ net_io_do(osm2go_platform::Widget *parent, net_io_request_t *rq, const std::stri
   return true;
 }
 
+/* a single background transfer */
+struct net_io_transfer_t {
+  net_io_transfer_t() : request(nullptr) {}
+
+  std::unique_ptr<CURL, curl_deleter> curl;
+  std::unique_ptr<FILE, f_closer> outfile;
+  std::string partname;       ///< the file the data is written to until complete
+  net_io_file_request *request;
+  char buffer[CURL_ERROR_SIZE];
+};
+
+struct curlm_deleter {
+  inline void operator()(CURLM *multi)
+  { curl_multi_cleanup(multi); }
+};
+
+bool
+start_transfer(CURLM *multi, net_io_file_request &request, net_io_transfer_t &transfer)
+{
+  transfer.request = &request;
+  transfer.partname = request.filename + ".part";
+  transfer.outfile.reset(fopen(transfer.partname.c_str(), "w"));
+  if(unlikely(!transfer.outfile))
+    return false;
+
+  transfer.curl.reset(curl_easy_init());
+  if(unlikely(!transfer.curl)) {
+    transfer.outfile.reset();
+    unlink(transfer.partname.c_str());
+    return false;
+  }
+
+  CURL *curl = transfer.curl.get();
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, transfer.outfile.get());
+  curl_easy_setopt(curl, CURLOPT_URL, request.url.c_str());
+  curl_easy_setopt(curl, CURLOPT_PRIVATE, &transfer);
+  curl_setup_common(curl, transfer.buffer);
+  // nobody waits for these, a single tile must not block the queue for long
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT, 60l);
+
+  curl_multi_add_handle(multi, curl);
+
+  return true;
+}
+
+/**
+ * @brief evaluate a finished transfer
+ */
+void
+finish_transfer(CURLM *multi, net_io_transfer_t &transfer, CURLcode res)
+{
+  CURL *curl = transfer.curl.get();
+  long response = 0;
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response);
+  // e.g. WMS servers report errors as XML documents with status 200
+  char *ctype = nullptr;
+  curl_easy_getinfo(curl, CURLINFO_CONTENT_TYPE, &ctype);
+
+  curl_multi_remove_handle(multi, curl);
+  transfer.curl.reset();
+  transfer.outfile.reset();
+
+  if(res == CURLE_OK && response == 200 && (ctype == nullptr || strncmp(ctype, "image/", 6) == 0) &&
+     rename(transfer.partname.c_str(), transfer.request->filename.c_str()) == 0) {
+    transfer.request->ok = true;
+  } else {
+    OSM2GO_LOG(Net, Warning, "download of %s failed: %d/%ld %s", transfer.request->url.c_str(),
+                      res, response, transfer.buffer);
+    unlink(transfer.partname.c_str());
+  }
+}
+
+/**
+ * @brief background downloads driven from the main loop
+ *
+ * curl_multi_perform() does not block, so the transfers are simply polled
+ * by a timeout source as long as there are any.
+ */
+class net_io_async_curl : public net_io_async_t {
+  struct entry {
+    explicit inline entry(const net_io_file_request &r) : request(r) {}
+    net_io_file_request request;
+    net_io_transfer_t transfer;
+  };
+
+  const unsigned int parallel;
+  std::unique_ptr<CURLM, curlm_deleter> multi;
+  std::deque<net_io_file_request> queue;
+  std::list<entry> active;                    ///< stable addresses for CURLOPT_PRIVATE
+  std::vector<net_io_file_request> finished;  ///< requests that could not even be started
+  guint timer;
+
+  void startNext();
+  static gboolean poll(gpointer data);
+
+public:
+  net_io_async_curl(unsigned int p, callback cb, void *context);
+  ~net_io_async_curl() override;
+
+  void add(const net_io_file_request &request) override;
+  size_t pending() const override
+  { return queue.size() + active.size() + finished.size(); }
+};
+
+net_io_async_curl::net_io_async_curl(unsigned int p, callback cb, void *context)
+  : net_io_async_t(cb, context)
+  , parallel(std::max(p, 1u))
+  , multi(curl_multi_init())
+  , timer(0)
+{
+}
+
+net_io_async_curl::~net_io_async_curl()
+{
+  if(timer != 0)
+    g_source_remove(timer);
+
+  for(std::list<entry>::iterator it = active.begin(); it != active.end(); it++) {
+    curl_multi_remove_handle(multi.get(), it->transfer.curl.get());
+    it->transfer.curl.reset();
+    it->transfer.outfile.reset();
+    unlink(it->transfer.partname.c_str());
+  }
+}
+
+void net_io_async_curl::add(const net_io_file_request &request)
+{
+  queue.push_back(request);
+  startNext();
+
+  if(timer == 0)
+    timer = g_timeout_add(50, poll, this);
+}
+
+void net_io_async_curl::startNext()
+{
+  while(active.size() < parallel && !queue.empty()) {
+    active.emplace_back(queue.front());
+    queue.pop_front();
+
+    entry &e = active.back();
+    if(unlikely(!multi || !start_transfer(multi.get(), e.request, e.transfer))) {
+      finished.push_back(e.request);
+      active.pop_back();
+    }
+  }
+}
+
+gboolean net_io_async_curl::poll(gpointer data)
+{
+  net_io_async_curl * const self = static_cast<net_io_async_curl *>(data);
+
+  std::vector<net_io_file_request> done;
+  done.swap(self->finished);
+
+  if(likely(self->multi)) {
+    int running;
+    curl_multi_perform(self->multi.get(), &running);
+
+    int left;
+    CURLMsg *msg;
+    while((msg = curl_multi_info_read(self->multi.get(), &left)) != nullptr) {
+      if(msg->msg != CURLMSG_DONE)
+        continue;
+
+      net_io_transfer_t *transfer = nullptr;
+      curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &transfer);
+      // msg is invalid once the handle is removed
+      finish_transfer(self->multi.get(), *transfer, msg->data.result);
+
+      for(std::list<entry>::iterator it = self->active.begin(); it != self->active.end(); it++) {
+        if(&it->transfer == transfer) {
+          done.push_back(it->request);
+          self->active.erase(it);
+          break;
+        }
+      }
+    }
+  }
+
+  self->startNext();
+
+  const bool keep = !self->active.empty() || !self->finished.empty();
+  if(!keep)
+    self->timer = 0;
+
+  // the callbacks may add new requests, which restart the timer if needed
+  for(std::vector<net_io_file_request>::const_iterator it = done.begin(); it != done.end(); it++)
+    self->done(self->cb_context, *it);
+
+  return keep ? TRUE : FALSE;
+}
+
 } // namespace
 
+net_io_async_t *net_io_async_t::create(unsigned int parallel, callback cb, void *context)
+{
+  return new net_io_async_curl(parallel, cb, context);
+}
+
 bool net_io_download_file(osm2go_platform::Widget *parent,
                           const std::string &url, const std::string &filename,
                           const std::string &title, bool compress)
 {
   net_io_request_t *request = new net_io_request_t(url, filename, compress);
 
-  printf("net_io: download %s to file %s\n", url.c_str(), filename.c_str());
+  OSM2GO_LOG(Net, Debug, "net_io: download %s to file %s", url.c_str(), filename.c_str());
 
   bool result = net_io_do(parent, request, title);
   if(!result) {
@@ -327,10 +548,10 @@ bool net_io_download_file(osm2go_platform::Widget *parent,
     /* user has restarted the download by then, the worker will erase that */
     /* newly written file */
 
-    printf("request failed, deleting %s\n", filename.c_str());
+    OSM2GO_LOG(Net, Warning, "request failed, deleting %s", filename.c_str());
     unlink(filename.c_str());
   } else
-    printf("request ok\n");
+    OSM2GO_LOG(Net, Debug, "request ok");
 
   return result;
 }
@@ -347,7 +568,7 @@ bool net_io_download_mem(osm2go_platform::Widget *parent, const std::string &url
 {
   net_io_request_t *request = new net_io_request_t(url, &data);
 
-  printf("net_io: download %s to memory\n", url.c_str());
+  OSM2GO_LOG(Net, Debug, "net_io: download %s to memory", url.c_str());
 
   bool result = net_io_do(parent, request, title.toStdString());
   if(unlikely(!result))
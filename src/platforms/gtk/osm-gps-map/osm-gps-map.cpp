@@ -34,7 +34,9 @@
 #include <cstring>
 #include <fcntl.h>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <unordered_map>
 #include <unordered_set>
@@ -43,6 +45,7 @@
 #include <cairo.h>
 #include <gdk/gdk.h>
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <libsoup/soup.h>
 
 #include "converter.h"
@@ -52,6 +55,8 @@
 #include "osm-gps-map-types.h"
 
 #include <osm2go_cpp.h>
+#include <osm2go_log.h>
+#include <osm2go_platform.h>
 #include <osm2go_stl.h>
 #include "../osm2go_platform_gtk.h"
 
@@ -85,6 +90,9 @@
 #define USER_AGENT "OSM2go " VERSION " (https://github.com/osm2go/osm2go)"
 
 #define MAX_TILE_CACHE_SIZE 20
+#define MAX_DISK_CACHE_SIZE (64 * 1024 * 1024)
+// the OSM tile usage policy allows at most 2 parallel downloads
+#define MAX_CONCURRENT_DOWNLOADS 2
 //for customizing the redering of the gps track
 #define UI_GPS_TRACK_WIDTH 4
 #define UI_GPS_POINT_INNER_RADIUS 10
@@ -102,6 +110,74 @@ struct OsmCachedTile
 typedef std::unordered_map<uint64_t, SoupMessage *> tile_queue_t;
 typedef std::unordered_map<uint64_t, OsmCachedTile *> tile_cache_t;
 
+/**
+ * @brief persistent tile storage in the user cache directory
+ *
+ * Every tile is stored in a file of its own. The modification time is
+ * refreshed whenever a tile is used, so the least recently used tiles are
+ * removed once the cache grows beyond MAX_DISK_CACHE_SIZE.
+ */
+class tile_disk_cache_t {
+public:
+    tile_disk_cache_t(const std::string &d, const char *ext);
+
+    const std::string dir;
+    const std::string extension;
+
+    GdkPixbuf *load(unsigned int zoom, unsigned int x, unsigned int y);
+    bool contains(unsigned int zoom, unsigned int x, unsigned int y) const;
+    void store(unsigned int zoom, unsigned int x, unsigned int y, const char *data, gsize len);
+
+private:
+    uint64_t size; ///< bytes used by all tiles, UINT64_MAX if not yet known
+
+    std::string filename(unsigned int zoom, unsigned int x, unsigned int y) const;
+    void trim();
+};
+
+struct OsmGpsMapTile {
+    inline OsmGpsMapTile(unsigned int z, unsigned int tx, unsigned int ty) : zoom(z), x(tx), y(ty) {}
+    unsigned int zoom, x, y;
+};
+
+/**
+ * @brief reads tiles from the disk cache in a worker thread
+ *
+ * Decoding the images while drawing would make moving the map sluggish.
+ * The loaded tiles are put into the memory cache from the main loop and the
+ * map is redrawn, tiles not found on disk are downloaded.
+ */
+class tile_disk_loader_t {
+public:
+    tile_disk_loader_t(OsmGpsMap *m, tile_disk_cache_t &c);
+    ~tile_disk_loader_t();
+
+    /**
+     * @brief queue a tile for loading, if it is not already queued
+     */
+    void request(unsigned int zoom, unsigned int x, unsigned int y);
+
+private:
+    struct job {
+        inline job(unsigned int z, unsigned int tx, unsigned int ty) : tile(z, tx, ty), pixbuf(nullptr) {}
+        const OsmGpsMapTile tile;
+        GdkPixbuf *pixbuf;
+    };
+
+    OsmGpsMap * const map;
+    tile_disk_cache_t &cache;
+    GThreadPool *pool;
+    std::unordered_set<uint64_t> queued;  ///< only used from the main loop
+
+    std::mutex mutex;
+    std::vector<job *> done;              ///< protected by mutex
+    guint idle;                           ///< protected by mutex
+    bool cancelled;                       ///< protected by mutex
+
+    static void work(gpointer data, gpointer user_data);
+    static gboolean deliver(gpointer data);
+};
+
 } // namespace
 
 struct _OsmGpsMapPrivate
@@ -109,6 +185,9 @@ struct _OsmGpsMapPrivate
     tile_queue_t *tile_queue; // gcc 4.2 warns about usage of anonymous namespace here, ignore it
     std::unordered_set<uint64_t> *missing_tiles;
     tile_cache_t *tile_cache; // gcc 4.2 warns about usage of anonymous namespace here, ignore it
+    tile_disk_cache_t *disk_cache;
+    tile_disk_loader_t *disk_loader;
+    OsmGpsMapCacheStats stats;
 
     int map_zoom;
     int max_zoom;
@@ -209,6 +288,7 @@ public:
     const std::string uri;
     const uint64_t hashkey;
     OsmGpsMap * const map;
+    const OsmGpsMapTile tile;
 };
 
 /*
@@ -334,6 +414,25 @@ osm_gps_map_blit_tile(OsmGpsMap *map, GdkPixbuf *pixbuf, int offset_x, int offse
                      GDK_RGB_DITHER_NONE, 0, 0);
 }
 
+/**
+ * @brief put a tile into the memory cache
+ *
+ * The cache takes ownership of the pixbuf. If the tile is already in the
+ * cache (it could be one rendered from another zoom level), it will be
+ * overwritten.
+ */
+void
+osm_gps_map_cache_tile(OsmGpsMapPrivate *priv, uint64_t hashkey, GdkPixbuf *pixbuf)
+{
+    OsmCachedTile *tile = g_slice_new (OsmCachedTile);
+    tile->pixbuf = pixbuf;
+    tile->redraw_cycle = priv->redraw_cycle;
+    tile_cache_t::iterator it = priv->tile_cache->find(hashkey);
+    if (it != priv->tile_cache->end())
+      cached_tile_free(*it);
+    (*priv->tile_cache)[hashkey] = tile;
+}
+
 void
 osm_gps_map_tile_download_complete (SoupSession *session, SoupMessage *msg, gpointer user_data)
 {
@@ -349,8 +448,22 @@ osm_gps_map_tile_download_complete (SoupSession *session, SoupMessage *msg, gpoi
     OsmGpsMap *map = OSM_GPS_MAP(dl->map);
     OsmGpsMapPrivate *priv = map->priv;
 
-    if (SOUP_STATUS_IS_SUCCESSFUL (msg->status_code))
+    if (SOUP_STATUS_IS_SUCCESSFUL (msg->status_code) &&
+        osm_gps_map_tile_data_valid(priv->image_format,
+                                    soup_message_headers_get_content_type(msg->response_headers, nullptr),
+                                    msg->response_body->data, msg->response_body->length) == FALSE)
     {
+        /* e.g. an error page of a proxy, do not put that into the cache */
+        g_warning("Error downloading tile: no valid %s image", priv->image_format);
+        priv->stats.failures++;
+        priv->missing_tiles->insert(dl->hashkey);
+    }
+    else if (SOUP_STATUS_IS_SUCCESSFUL (msg->status_code))
+    {
+        priv->stats.downloads++;
+        priv->disk_cache->store(dl->tile.zoom, dl->tile.x, dl->tile.y,
+                                msg->response_body->data, msg->response_body->length);
+
         /* parse file directly from memory */
         GdkPixbufLoader *loader = gdk_pixbuf_loader_new_with_type (priv->image_format, nullptr);
         if (gdk_pixbuf_loader_write(loader, reinterpret_cast<const guchar *>(msg->response_body->data), msg->response_body->length, nullptr) == FALSE)
@@ -367,23 +480,13 @@ osm_gps_map_tile_download_complete (SoupSession *session, SoupMessage *msg, gpoi
 
         /* Store the tile into the cache */
         if (G_LIKELY (pixbuf))
-        {
-            OsmCachedTile *tile = g_slice_new (OsmCachedTile);
-            tile->pixbuf = pixbuf;
-            tile->redraw_cycle = priv->redraw_cycle;
-            /* if the tile is already in the cache (it could be one
-             * rendered from another zoom level), it will be
-             * overwritten */
-            tile_cache_t::iterator it = priv->tile_cache->find(dl->hashkey);
-            if (it != priv->tile_cache->end())
-              cached_tile_free(*it);
-            (*priv->tile_cache)[dl->hashkey] = tile;
-        }
+            osm_gps_map_cache_tile(priv, dl->hashkey, pixbuf);
         osm_gps_map_map_redraw_idle (map);
     }
     else
     {
         g_warning("Error downloading tile: %d - %s", msg->status_code, msg->reason_phrase);
+        priv->stats.failures++;
         if (msg->status_code == SOUP_STATUS_NOT_FOUND)
         {
             priv->missing_tiles->insert(dl->hashkey);
@@ -417,7 +520,118 @@ tile_download_t::tile_download_t(const char *uri_pattern, OsmGpsMap *m, unsigned
     : uri(replace_map_uri(uri_pattern, z, x, y))
     , hashkey(tile_hash(z, x, y))
     , map(m)
+    , tile(z, x, y)
+{
+}
+
+tile_disk_cache_t::tile_disk_cache_t(const std::string &d, const char *ext)
+    : dir(d)
+    , extension(ext)
+    , size(UINT64_MAX)
+{
+}
+
+std::string
+tile_disk_cache_t::filename(unsigned int zoom, unsigned int x, unsigned int y) const
+{
+    char name[48];
+    g_snprintf(name, sizeof(name), "%u-%u-%u.", zoom, x, y);
+
+    return dir + name + extension;
+}
+
+GdkPixbuf *
+tile_disk_cache_t::load(unsigned int zoom, unsigned int x, unsigned int y)
+{
+    const std::string fname = filename(zoom, x, y);
+    GdkPixbuf *pixbuf = gdk_pixbuf_new_from_file(fname.c_str(), nullptr);
+
+    /* mark as recently used */
+    if (pixbuf != nullptr)
+        g_utime(fname.c_str(), nullptr);
+
+    return pixbuf;
+}
+
+bool
+tile_disk_cache_t::contains(unsigned int zoom, unsigned int x, unsigned int y) const
+{
+    return g_file_test(filename(zoom, x, y).c_str(), G_FILE_TEST_IS_REGULAR) == TRUE;
+}
+
+void
+tile_disk_cache_t::store(unsigned int zoom, unsigned int x, unsigned int y, const char *data, gsize len)
+{
+    if (G_UNLIKELY(size == UINT64_MAX)) {
+        if (!osm2go_platform::create_directories(dir))
+            return;
+        trim();
+    }
+
+    const std::string fname = filename(zoom, x, y);
+    GStatBuf st;
+    const bool existed = g_stat(fname.c_str(), &st) == 0;
+
+    if (G_UNLIKELY(g_file_set_contents(fname.c_str(), data, len, nullptr) == FALSE))
+        return;
+
+    if (existed)
+        size -= std::min<uint64_t>(size, st.st_size);
+    size += len;
+
+    if (size > MAX_DISK_CACHE_SIZE)
+        trim();
+}
+
+struct disk_tile_t {
+    disk_tile_t(const char *n, const GStatBuf &st) : name(n), mtime(st.st_mtime), size(st.st_size) {}
+    std::string name;
+    time_t mtime;
+    uint64_t size;
+};
+
+struct disk_tile_older {
+    inline bool operator()(const disk_tile_t &a, const disk_tile_t &b) const
+    {
+        return a.mtime < b.mtime;
+    }
+};
+
+/**
+ * @brief recalculate the cache size and remove the oldest tiles if needed
+ *
+ * If the cache is too big it is trimmed down to 3/4 of the maximum size, so
+ * this does not need to run again for every new tile.
+ */
+void
+tile_disk_cache_t::trim()
 {
+    GDir *d = g_dir_open(dir.c_str(), 0, nullptr);
+    if (d == nullptr)
+        return;
+
+    std::vector<disk_tile_t> tiles;
+    uint64_t total = 0;
+    for (const gchar *name = g_dir_read_name(d); name != nullptr; name = g_dir_read_name(d)) {
+        GStatBuf st;
+        if (g_stat((dir + name).c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+            continue;
+        tiles.push_back(disk_tile_t(name, st));
+        total += tiles.back().size;
+    }
+    g_dir_close(d);
+
+    if (total > MAX_DISK_CACHE_SIZE) {
+        std::sort(tiles.begin(), tiles.end(), disk_tile_older());
+        for (std::vector<disk_tile_t>::const_iterator it = tiles.begin();
+             it != tiles.end() && total > MAX_DISK_CACHE_SIZE / 4 * 3; it++) {
+            if (g_unlink((dir + it->name).c_str()) == 0)
+                total -= it->size;
+        }
+        OSM2GO_LOG(GpsMap, Info, "tile cache trimmed to %llu bytes", static_cast<unsigned long long>(total));
+    }
+
+    size = total;
 }
 
 void
@@ -457,6 +671,115 @@ osm_gps_map_download_tile (OsmGpsMap *map, int zoom, int x, int y)
     }
 }
 
+tile_disk_loader_t::tile_disk_loader_t(OsmGpsMap *m, tile_disk_cache_t &c)
+    : map(m)
+    , cache(c)
+    , pool(g_thread_pool_new(work, this, 1, FALSE, nullptr))
+    , idle(0)
+    , cancelled(false)
+{
+}
+
+tile_disk_loader_t::~tile_disk_loader_t()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelled = true;
+    }
+
+    /* the jobs still queued are only freed by the worker */
+    if (G_LIKELY(pool != nullptr))
+        g_thread_pool_free(pool, FALSE, TRUE);
+
+    if (idle != 0)
+        g_source_remove(idle);
+
+    for (std::vector<job *>::const_iterator it = done.begin(); it != done.end(); it++) {
+        if ((*it)->pixbuf != nullptr)
+            g_object_unref((*it)->pixbuf);
+        delete *it;
+    }
+}
+
+void
+tile_disk_loader_t::request(unsigned int zoom, unsigned int x, unsigned int y)
+{
+    if (!queued.insert(tile_hash(zoom, x, y)).second)
+        return;
+
+    job *j = new job(zoom, x, y);
+    if (G_UNLIKELY(pool == nullptr)) {
+        // no thread available, read it right away
+        work(j, this);
+    } else {
+        g_thread_pool_push(pool, j, nullptr);
+    }
+}
+
+void
+tile_disk_loader_t::work(gpointer data, gpointer user_data)
+{
+    job *j = static_cast<job *>(data);
+    tile_disk_loader_t * const self = static_cast<tile_disk_loader_t *>(user_data);
+
+    {
+        std::lock_guard<std::mutex> lock(self->mutex);
+        if (self->cancelled) {
+            delete j;
+            return;
+        }
+    }
+
+    j->pixbuf = self->cache.load(j->tile.zoom, j->tile.x, j->tile.y);
+
+    std::lock_guard<std::mutex> lock(self->mutex);
+    if (G_UNLIKELY(self->cancelled)) {
+        if (j->pixbuf != nullptr)
+            g_object_unref(j->pixbuf);
+        delete j;
+        return;
+    }
+    self->done.push_back(j);
+    if (self->idle == 0)
+        self->idle = g_idle_add(deliver, self);
+}
+
+gboolean
+tile_disk_loader_t::deliver(gpointer data)
+{
+    tile_disk_loader_t * const self = static_cast<tile_disk_loader_t *>(data);
+    OsmGpsMapPrivate *priv = self->map->priv;
+
+    std::vector<job *> jobs;
+    {
+        std::lock_guard<std::mutex> lock(self->mutex);
+        jobs.swap(self->done);
+        self->idle = 0;
+    }
+
+    bool redraw = false;
+    for (std::vector<job *>::const_iterator it = jobs.begin(); it != jobs.end(); it++) {
+        const OsmGpsMapTile &t = (*it)->tile;
+        const uint64_t hash = tile_hash(t.zoom, t.x, t.y);
+        self->queued.erase(hash);
+
+        if ((*it)->pixbuf != nullptr) {
+            priv->stats.disk_hits++;
+            osm_gps_map_cache_tile(priv, hash, (*it)->pixbuf);
+            redraw = true;
+        } else {
+            priv->stats.misses++;
+            osm_gps_map_download_tile(self->map, t.zoom, t.x, t.y);
+        }
+        delete *it;
+    }
+
+    if (redraw)
+        osm_gps_map_map_redraw_idle(self->map);
+
+    return FALSE;
+}
+
 GdkPixbuf *
 osm_gps_map_load_cached_tile (OsmGpsMap *map, int zoom, int x, int y)
 {
@@ -539,11 +862,17 @@ osm_gps_map_load_tile (OsmGpsMap *map, int zoom, int x, int y, int offset_x, int
 
     if(pixbuf)
     {
+        priv->stats.memory_hits++;
         osm_gps_map_blit_tile(map, pixbuf.get(), offset_x, offset_y);
     }
     else
     {
-        osm_gps_map_download_tile(map, zoom, x, y);
+        /* then look if it has been downloaded before, the tile is
+         * downloaded if it is not on disk */
+        const uint64_t hash = tile_hash(zoom, x, y);
+        if (priv->tile_queue->find(hash) == priv->tile_queue->end() &&
+            priv->missing_tiles->find(hash) == priv->missing_tiles->end())
+            priv->disk_loader->request(zoom, x, y);
 
         /* try to render the tile by scaling cached tiles from other zoom
          * levels */
@@ -749,15 +1078,13 @@ osm_gps_map_map_redraw (OsmGpsMap *map)
     /* isn't really usable. we'll just ignore this ... */
     if((GTK_WIDGET(map)->allocation.width < 2) ||
        (GTK_WIDGET(map)->allocation.height < 2)) {
-        printf("not a useful sized map yet ...\n");
+        OSM2GO_LOG(GpsMap, Debug, "not a useful sized map yet ...");
         return FALSE;
     }
 
     priv->idle_map_redraw = 0;
 
-#ifdef DRAG_DEBUG
-    printf("trying redraw\n");
-#endif
+    OSM2GO_LOG(GpsMap, Trace, "trying redraw");
 
     /* the motion_notify handler uses priv->pixmap to redraw the area; if we
      * change it while we are dragging, we will end up showing it in the wrong
@@ -812,7 +1139,7 @@ center_coord_update(GtkWidget *widget) {
     gint pixel_x = priv->map_x + widget->allocation.width/2;
     gint pixel_y = priv->map_y + widget->allocation.height/2;
 
-    printf("coord update\n");
+    OSM2GO_LOG(GpsMap, Trace, "coord update");
     priv->center_rlon = pixel2lon(priv->map_zoom, pixel_x);
     priv->center_rlat = pixel2lat(priv->map_zoom, pixel_y);
 }
@@ -1007,12 +1334,14 @@ osm_gps_map_init (OsmGpsMap *object)
     //Change number of concurrent connections option?
 #ifdef USE_SOUP_SESSION_NEW
     priv->soup_session =
-        soup_session_new_with_options(SOUP_SESSION_USER_AGENT,
-                                      USER_AGENT, nullptr);
+        soup_session_new_with_options(SOUP_SESSION_USER_AGENT, USER_AGENT,
+                                      SOUP_SESSION_MAX_CONNS_PER_HOST, MAX_CONCURRENT_DOWNLOADS,
+                                      nullptr);
 #else
     priv->soup_session =
-        soup_session_async_new_with_options(SOUP_SESSION_USER_AGENT,
-                                            USER_AGENT, nullptr);
+        soup_session_async_new_with_options(SOUP_SESSION_USER_AGENT, USER_AGENT,
+                                            SOUP_SESSION_MAX_CONNS_PER_HOST, MAX_CONCURRENT_DOWNLOADS,
+                                            nullptr);
 #endif
 
     const gchar *prx = g_getenv("http_proxy");
@@ -1037,6 +1366,8 @@ osm_gps_map_init (OsmGpsMap *object)
     /* memory cache for most recently used tiles */
     priv->tile_cache = new tile_cache_t();
 
+    memset(&priv->stats, 0, sizeof(priv->stats));
+
     gtk_widget_add_events (GTK_WIDGET (object),
                            GDK_BUTTON_PRESS_MASK | GDK_BUTTON_RELEASE_MASK |
                            GDK_POINTER_MOTION_MASK |
@@ -1065,6 +1396,9 @@ osm_gps_map_setup(OsmGpsMapPrivate *priv) {
     priv->image_format = osm_gps_map_source_get_image_format(OSM_GPS_MAP_SOURCE_OPENSTREETMAP);
     priv->max_zoom = osm_gps_map_source_get_max_zoom(OSM_GPS_MAP_SOURCE_OPENSTREETMAP);
     priv->min_zoom = osm_gps_map_source_get_min_zoom(OSM_GPS_MAP_SOURCE_OPENSTREETMAP);
+
+    /* persistent cache, the OSM tiles are shared by all maps */
+    priv->disk_cache = new tile_disk_cache_t(osm2go_platform::cachepath() + "osm/", priv->image_format);
 }
 
 GObject *
@@ -1074,7 +1408,9 @@ osm_gps_map_constructor (GType gtype, guint n_properties, GObjectConstructParam
     GObject *object =
         G_OBJECT_CLASS(osm_gps_map_parent_class)->constructor(gtype, n_properties, properties);
 
-    osm_gps_map_setup(OSM_GPS_MAP_PRIVATE(object));
+    OsmGpsMapPrivate *priv = OSM_GPS_MAP_PRIVATE(object);
+    osm_gps_map_setup(priv);
+    priv->disk_loader = new tile_disk_loader_t(OSM_GPS_MAP(object), *priv->disk_cache);
 
     return object;
 }
@@ -1089,6 +1425,17 @@ osm_gps_map_dispose (GObject *object)
 
     priv->is_disposed = true;
 
+    const OsmGpsMapCacheStats &st = priv->stats;
+    const guint requests = st.memory_hits + st.disk_hits + st.misses;
+    if (requests > 0)
+        OSM2GO_LOG(GpsMap, Info, "map tiles: %u from memory, %u from disk, %u missing, %u downloaded, %u failed downloads, %.1f%% cache hits",
+                                 st.memory_hits, st.disk_hits, st.misses, st.downloads, st.failures,
+                                 100.0 * (st.memory_hits + st.disk_hits) / requests);
+
+    /* stop loading tiles before anything they would be stored in is gone */
+    delete priv->disk_loader;
+    priv->disk_loader = nullptr;
+
     soup_session_abort(priv->soup_session);
     g_object_unref(priv->soup_session);
 
@@ -1136,6 +1483,7 @@ osm_gps_map_finalize (GObject *object)
     delete priv->tile_queue;
     delete priv->missing_tiles;
     delete priv->tile_cache;
+    delete priv->disk_cache;
 
     G_OBJECT_CLASS (osm_gps_map_parent_class)->finalize (object);
 }
@@ -1292,9 +1640,7 @@ osm_gps_map_button_release (GtkWidget *widget, GdkEventButton *event)
     else
         osm_gps_map_osd_check(map, event->x, event->y);
 
-#ifdef DRAG_DEBUG
-    printf("dragging done\n");
-#endif
+    OSM2GO_LOG(GpsMap, Trace, "dragging done");
 
     priv->drag_counter = -1;
 
@@ -1408,15 +1754,11 @@ osm_gps_map_expose (GtkWidget *widget, GdkEventExpose  *event)
 
     GdkDrawable *drawable = priv->dbuf_pixmap;
 
-#ifdef DRAG_DEBUG
-    printf("expose, map %d/%d\n", priv->map_x, priv->map_y);
-#endif
+    OSM2GO_LOG(GpsMap, Trace, "expose, map %d/%d", priv->map_x, priv->map_y);
 
     if (!priv->drag_mouse_dx && !priv->drag_mouse_dy && event)
     {
-#ifdef DRAG_DEBUG
-        printf("  dragging = %d, event = %p\n", priv->dragging, event);
-#endif
+        OSM2GO_LOG(GpsMap, Trace, "  dragging = %d, event = %p", priv->dragging, event);
 
         gdk_draw_drawable (drawable,
                            widget->style->fg_gc[GTK_WIDGET_STATE (widget)],
@@ -1427,11 +1769,9 @@ osm_gps_map_expose (GtkWidget *widget, GdkEventExpose  *event)
     }
     else
     {
-#ifdef DRAG_DEBUG
-        printf("  drag_mouse %d/%d\n",
-               priv->drag_mouse_dx - EXTRA_BORDER,
-               priv->drag_mouse_dy - EXTRA_BORDER);
-#endif
+        OSM2GO_LOG(GpsMap, Trace, "  drag_mouse %d/%d",
+                                  priv->drag_mouse_dx - EXTRA_BORDER,
+                                  priv->drag_mouse_dy - EXTRA_BORDER);
 
         gdk_draw_drawable (drawable,
                            widget->style->fg_gc[GTK_WIDGET_STATE (widget)],
@@ -1563,6 +1903,34 @@ osm_gps_map_add_bounds(OsmGpsMap *map, const std::pair<OsmGpsMapPoint, OsmGpsMap
     osm_gps_map_map_redraw_idle(map);
 }
 
+gboolean
+osm_gps_map_tile_data_valid(const char *format, const char *content_type, const char *data, gsize len)
+{
+    if (content_type != nullptr && !g_str_has_prefix(content_type, "image/"))
+        return FALSE;
+
+    static const char png_magic[] = "\x89PNG\r\n\x1a\n";
+    static const char jpeg_magic[] = "\xff\xd8\xff";
+
+    const char *magic;
+    if (strcmp(format, "png") == 0)
+        magic = png_magic;
+    else if (strcmp(format, "jpg") == 0 || strcmp(format, "jpeg") == 0)
+        magic = jpeg_magic;
+    else
+        // unknown format, only the decoder can tell
+        return len > 0 ? TRUE : FALSE;
+
+    const size_t mlen = strlen(magic);
+    return len >= mlen && memcmp(data, magic, mlen) == 0 ? TRUE : FALSE;
+}
+
+OsmGpsMapCacheStats
+osm_gps_map_cache_stats(OsmGpsMap *map)
+{
+    return map->priv->stats;
+}
+
 void
 osm_gps_map_gps_add (OsmGpsMap *map, float latitude, float longitude, float heading)
 {
@@ -50,6 +50,17 @@ typedef enum {
     OSD_CUSTOM   // first custom buttom
 } osd_button_t;
 
+/**
+ * @brief usage counters of the tile caches
+ */
+typedef struct {
+    guint memory_hits;    ///< tiles found in the in-memory cache
+    guint disk_hits;      ///< tiles loaded from the on-disk cache
+    guint misses;         ///< tiles not found in any cache
+    guint downloads;      ///< tiles successfully downloaded
+    guint failures;       ///< failed download attempts
+} OsmGpsMapCacheStats;
+
 typedef void (*OsmGpsMapOsdCallback)(osd_button_t but, gpointer data);
 #define	OSM_GPS_MAP_OSD_CALLBACK(f) ((OsmGpsMapOsdCallback) (f))
 
@@ -61,6 +72,16 @@ typedef void (*OsmGpsMapOsdCallback)(osd_button_t but, gpointer data);
 void osm_gps_map_add_track (OsmGpsMap *map, const std::pair<OsmGpsMapPoint, OsmGpsMapPoint> &track);
 void osm_gps_map_add_bounds(OsmGpsMap *map, const std::pair<OsmGpsMapPoint, OsmGpsMapPoint> &bounds);
 #endif
+/**
+ * @brief check if downloaded data is a tile image
+ * @param format the image format of the tile source, e.g. "png"
+ * @param content_type the MIME type sent by the server, may be nullptr
+ * @param data the downloaded data
+ * @param len length of data
+ */
+gboolean osm_gps_map_tile_data_valid(const char *format, const char *content_type,
+                                     const char *data, gsize len);
+OsmGpsMapCacheStats osm_gps_map_cache_stats(OsmGpsMap *map);
 osd_button_t osm_gps_map_osd_check(OsmGpsMap *map, gint x, gint y);
 gboolean osm_gps_map_expose (GtkWidget *widget, GdkEventExpose  *event);
 
@@ -5,6 +5,7 @@
  */
 
 #include "osm2go_i18n.h"
+#include <osm2go_log.h>
 #include "osm2go_platform.h"
 #include "osm2go_platform_gtk.h"
 
@@ -275,8 +276,8 @@ bool osm2go_platform::yes_no(trstring::arg_type title, trstring::arg_type msg, u
   if(dialog_again.not_again & again_bit)
     return ((dialog_again.reply & again_bit) != 0);
 
-  printf("%s: \"%s\"\n", static_cast<const gchar *>(static_cast<trstring::native_type>(title)),
-                         static_cast<const gchar *>(static_cast<trstring::native_type>(msg)));
+  OSM2GO_LOG(Ui, Info, "%s: \"%s\"", static_cast<const gchar *>(static_cast<trstring::native_type>(title)),
+                                       static_cast<const gchar *>(static_cast<trstring::native_type>(msg)));
 
   GtkWindow *p = GTK_WINDOW(parent ? parent : appdata_t::window);
 
@@ -386,6 +387,11 @@ dirguard osm2go_platform::userdatapath()
   return dirguard(std::string(g_get_user_data_dir()) + "/osm2go/presets/");
 }
 
+std::string osm2go_platform::cachepath()
+{
+  return std::string(g_get_user_cache_dir()) + "/osm2go/";
+}
+
 bool osm2go_platform::create_directories(const std::string &path)
 {
   return g_mkdir_with_parents(path.c_str(), S_IRWXU) == 0;
@@ -33,7 +33,7 @@
 namespace {
 
 struct member_context_t {
-  static std::vector<member_t> emptyMembers;  ///< dummy list to show all new relation members as modified
+  static const std::vector<member_t> emptyMembers;  ///< dummy list to show all new relation members as modified
 
   inline member_context_t(relation_t *r, osm_t::ref o, GtkWidget *parent, const presets_items *p)
     : relation(r)
@@ -104,7 +104,7 @@ std::array<gboolean, 3> member_context_t::valuesChanged(size_t index) const
   return ret;
 }
 
-std::vector<member_t> member_context_t::emptyMembers;
+const std::vector<member_t> member_context_t::emptyMembers;
 
 enum {
   MEMBER_COL_TYPE = 0,
@@ -310,7 +310,7 @@ member_list_widget(member_context_t &context)
                                       MEMBER_COL_TYPE_CHANGED, changedVals[0],
                                       MEMBER_COL_ID,           member.object.id_string().c_str(),
                                       MEMBER_COL_ID_CHANGED,   changedVals[1],
-                                      MEMBER_COL_NAME,         realObj ? static_cast<const gchar *>(member.object.get_name(*context.osm)) : nullptr,
+                                      MEMBER_COL_NAME,         realObj ? static_cast<const gchar *>(context.osm->objectName(member.object)) : nullptr,
                                       MEMBER_COL_ROLE,         member.role,
                                       MEMBER_COL_ROLE_CHANGED, changedVals[2],
                                       MEMBER_COL_REF_ONLY,     realObj ? FALSE : TRUE,
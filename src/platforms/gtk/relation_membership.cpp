@@ -23,6 +23,7 @@
 #include <set>
 #include <string>
 #include <strings.h>
+#include <vector>
 
 #include <osm2go_annotations.h>
 #include <osm2go_cpp.h>
@@ -51,6 +52,7 @@ struct relitem_context_t {
   osm2go_platform::DialogGuard dialog;
   std::unique_ptr<GtkListStore, g_object_deleter> store;
   GtkTreeSelection * selection;
+  osm_t::MembershipMap memberships; ///< the position of item in the relations it is member of
 };
 
 enum {
@@ -69,6 +71,7 @@ relitem_context_t::relitem_context_t(object_t &o, const presets_items *pr, osm_t
   , osm(os)
   , store(nullptr)
   , selection(nullptr)
+  , memberships(os->memberships(o))
 {
 }
 
@@ -219,8 +222,10 @@ changed_foreach(GtkTreeModel *model, GtkTreePath *, GtkTreeIter *iter, gpointer
   gtk_tree_model_get(model, iter, RELITEM_COL_DATA, &relation, -1);
   assert(relation != nullptr);
 
-  std::vector<member_t>::const_iterator itEnd = relation->members.end();
-  std::vector<member_t>::const_iterator it = relation->find_member_object(context->item);
+  const osm_t::MembershipMap::const_iterator mit = context->memberships.find(relation);
+  std::vector<member_t>::const_iterator itEnd = relation->members.cend();
+  std::vector<member_t>::const_iterator it = mit == context->memberships.end() ? itEnd :
+                                             std::next(relation->members.cbegin(), mit->second);
 
   gboolean isSelected = gtk_tree_selection_iter_is_selected(context->selection, iter);
 
@@ -230,7 +235,7 @@ changed_foreach(GtkTreeModel *model, GtkTreePath *, GtkTreeIter *iter, gpointer
     /* either accept this or unselect again */
     if(relation_add_item(context->dialog.get(), relation, context->item, context->presets, context->osm)) {
       // vector was modified, update the iterator
-      itEnd = relation->members.end();
+      itEnd = relation->members.cend();
       // the item is now the last one in the chain
       it = std::prev(itEnd);
     } else {
@@ -243,7 +248,7 @@ changed_foreach(GtkTreeModel *model, GtkTreePath *, GtkTreeIter *iter, gpointer
     context->osm->mark_dirty(relation);
     it = relation->eraseMember(it);
     // vector was modified, update the iterator
-    itEnd = relation->members.end();
+    itEnd = relation->members.cend();
 
     // there could have been multiple instances, so check if there is more
     it = relation->find_member_object(context->item, it);
@@ -251,6 +256,11 @@ changed_foreach(GtkTreeModel *model, GtkTreePath *, GtkTreeIter *iter, gpointer
     return FALSE;
   }
 
+  if(it == itEnd)
+    context->memberships.erase(relation);
+  else
+    context->memberships[relation] = std::distance(relation->members.cbegin(), it);
+
   const unsigned int mflags = isOriginalRelation(context->osm, relation, context->item);
 
   gtk_list_store_set(GTK_LIST_STORE(model), iter,
@@ -301,8 +311,9 @@ struct relation_list_insert_functor {
   relitem_context_t &context;
   GtkTreeIter &sel_iter;
   trstring &selname; /* name of sel_iter */
-  inline relation_list_insert_functor(relitem_context_t &c, trstring &sn, GtkTreeIter &it)
-    : context(c), sel_iter(it), selname(sn) {}
+  std::vector<GtkTreeIter> &selected;
+  inline relation_list_insert_functor(relitem_context_t &c, trstring &sn, GtkTreeIter &it, std::vector<GtkTreeIter> &sel)
+    : context(c), sel_iter(it), selname(sn), selected(sel) {}
   void operator()(std::pair<item_id_t, relation_t *> pair);
 };
 
@@ -315,17 +326,21 @@ void relation_list_insert_functor::operator()(std::pair<item_id_t, relation_t *>
 
   GtkTreeIter iter;
   /* try to find something descriptive */
-  trstring name = relation->descriptiveNameOrId();
+  trstring name = context.osm->relationName(relation);
 
-  const std::vector<member_t>::const_iterator it = relation->find_member_object(context.item);
-  const bool isMember = it != relation->members.end();
+  const osm_t::MembershipMap::const_iterator it = context.memberships.find(relation);
+  const bool isMember = it != context.memberships.end();
 
-  const unsigned int mflags = isOriginalRelation(context.osm, relation, context.item);
+  // a relation that was never modified can't have changed the membership
+  const relation_t *orig = context.osm->originalObject(relation);
+  const unsigned int mflags = (isMember || orig != nullptr) ?
+                              relation->objectMembershipState(context.item, orig) :
+                              static_cast<unsigned int>(relation_t::MembershipUnmodified);
 
   /* Append a row and fill in some data */
   gtk_list_store_insert_with_values(context.store.get(), &iter, -1,
                                     RELITEM_COL_TYPE, relation->tags.get_value("type"),
-                                    RELITEM_COL_ROLE, isMember ? it->role : nullptr,
+                                    RELITEM_COL_ROLE, isMember ? relation->members[it->second].role : nullptr,
                                     RELITEM_COL_NAME, static_cast<const gchar *>(name),
                                     RELITEM_COL_ROLE_MODIFIED, (mflags & relation_t::RoleChanged) ? TRUE : FALSE,
                                     RELITEM_COL_MEMBER_MODIFIED, (mflags & relation_t::MembershipChanged) ? TRUE : FALSE,
@@ -335,7 +350,7 @@ void relation_list_insert_functor::operator()(std::pair<item_id_t, relation_t *>
   /* select all relations the current object is part of */
 
   if(isMember) {
-    gtk_tree_selection_select_iter(context.selection, &iter);
+    selected.push_back(iter);
     /* check if this element is earlier by name in the list */
     if(selname.isEmpty() || name.toStdString().compare(selname.toStdString()) < 0) {
       selname.swap(name);
@@ -397,20 +412,26 @@ relation_item_list_widget(relitem_context_t &context)
                                          G_TYPE_STRING,    // RELITEM_COL_NAME
                                          G_TYPE_POINTER)); // RELITEM_COL_DATA
 
-  gtk_tree_view_set_model(view, GTK_TREE_MODEL(context.store.get()));
+  /* build a list of iters of all items that should be selected */
+  trstring selname;
+  GtkTreeIter sel_iter;
+  std::vector<GtkTreeIter> selected;
+  relation_list_insert_functor inserter(context, selname, sel_iter, selected);
+
+  // fill the store before it is sorted and shown, so the rows do not need to be
+  // sorted in one by one and the view is not notified about every single row
+  std::for_each(context.osm->relations.begin(),
+                context.osm->relations.end(), inserter);
 
   // Debatable whether to sort by the "selected" or the "Name" column by
   // default. Both are be useful, in different ways.
   gtk_tree_sortable_set_sort_column_id(GTK_TREE_SORTABLE(context.store.get()),
                                        RELITEM_COL_NAME, GTK_SORT_ASCENDING);
 
-  /* build a list of iters of all items that should be selected */
-  trstring selname;
-  GtkTreeIter sel_iter;
-  relation_list_insert_functor inserter(context, selname, sel_iter);
+  gtk_tree_view_set_model(view, GTK_TREE_MODEL(context.store.get()));
 
-  std::for_each(context.osm->relations.begin(),
-                context.osm->relations.end(), inserter);
+  for(std::vector<GtkTreeIter>::iterator it = selected.begin(); it != selected.end(); it++)
+    gtk_tree_selection_select_iter(context.selection, &*it);
 
   if(!selname.isEmpty())
     list_view_scroll(view, context.selection, &sel_iter);
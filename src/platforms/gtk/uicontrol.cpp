@@ -21,6 +21,7 @@
 #include "osm2go_annotations.h"
 #include <osm2go_cpp.h>
 #include <osm2go_i18n.h>
+#include <osm2go_platform_gtk.h>
 #include "osm2go_platform_gtk_icon.h"
 
 // declared here so it is available for all lib users (i.e. testcases)
@@ -66,6 +67,20 @@ create_checkbox_item(trstring::native_type_arg label)
 #endif
 }
 
+void
+progress_cancel(bool *cancelled)
+{
+  *cancelled = true;
+}
+
+gboolean
+progress_delete(bool *cancelled)
+{
+  *cancelled = true;
+  // the dialog is destroyed when the operation has stopped
+  return TRUE;
+}
+
 } // namespace
 
 GtkWidget *
@@ -99,6 +114,8 @@ MainUiGtk::MainUiGtk()
 #else
   , menubar(GTK_MENU_SHELL(gtk_menu_bar_new()))
 #endif
+  , progressBar(nullptr)
+  , progressCancelled(false)
 {
   menuitems[MENU_ITEM_MAP_HIDE_SEL] = createMenuItem(_("_Hide selected"), "list-remove");
   menuitems[MENU_ITEM_MAP_SHOW_ALL] = createMenuItem(_("_Show all"), "list-add");
@@ -145,11 +162,52 @@ void MainUi::showNotification(trstring::arg_type message, unsigned int flags)
     statusbar->set(static_cast<const char *>(nativeMsg), flags & Highlight);
 }
 
+bool MainUi::showProgress(trstring::arg_type message, float fraction)
+{
+  assert(!message.isEmpty());
+  trstring::native_type nativeMsg = static_cast<trstring::native_type>(message);
+  return static_cast<MainUiGtk *>(this)->updateProgress(static_cast<const char *>(nativeMsg), fraction);
+}
+
+bool MainUiGtk::updateProgress(const char *message, float fraction)
+{
+  if(!progressDialog) {
+    progressCancelled = false;
+
+    GtkWidget *dialog = gtk_dialog_new();
+    gtk_window_set_default_size(GTK_WINDOW(dialog), 300, 10);
+    gtk_window_set_modal(GTK_WINDOW(dialog), TRUE);
+    gtk_window_set_transient_for(GTK_WINDOW(dialog), GTK_WINDOW(appdata_t::window));
+
+    progressBar = GTK_PROGRESS_BAR(gtk_progress_bar_new());
+    gtk_progress_bar_set_pulse_step(progressBar, 0.1);
+    gtk_box_pack_start(GTK_BOX(GTK_DIALOG(dialog)->vbox), GTK_WIDGET(progressBar), TRUE, TRUE, 0);
+
+    GtkWidget *button = osm2go_platform::button_new_with_label(_("Cancel"));
+    g_signal_connect_swapped(button, "clicked", G_CALLBACK(progress_cancel), &progressCancelled);
+    gtk_container_add(GTK_CONTAINER(GTK_DIALOG(dialog)->action_area), button);
+    g_signal_connect_swapped(dialog, "delete-event", G_CALLBACK(progress_delete), &progressCancelled);
+
+    gtk_widget_show_all(dialog);
+    progressDialog.reset(dialog);
+  }
+
+  gtk_window_set_title(GTK_WINDOW(progressDialog.get()), message);
+  if(fraction < 0)
+    gtk_progress_bar_pulse(progressBar);
+  else
+    gtk_progress_bar_set_fraction(progressBar, fraction);
+
+  return !progressCancelled;
+}
+
 void MainUiGtk::clearNotification(NotificationFlags flags)
 {
   statusbar_t *sbar = statusBar();
-  if (flags & Busy)
+  if (flags & Busy) {
     sbar->banner_busy_stop();
+    progressDialog.reset();
+  }
   if (flags & ClearNormal)
     sbar->set(nullptr, false);
 }
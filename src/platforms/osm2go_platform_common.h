@@ -80,6 +80,13 @@ namespace osm2go_platform {
    */
   dirguard userdatapath() __attribute__((warn_unused_result));
 
+  /**
+   * @brief return the path where downloaded data may be cached
+   *
+   * The returned path ends with a '/', it may not yet exist.
+   */
+  std::string cachepath() __attribute__((warn_unused_result));
+
   /**
    * @brief create the given directory and all missing intermediate directories
    */
@@ -16,6 +16,8 @@
 #include "osm2go_i18n.h"
 #include "osm2go_platform_qt.h"
 
+#include <utility>
+
 namespace {
 
 QHash<const char *, QString> roleCache;
@@ -155,7 +157,7 @@ QVariant RelationMemberModel::data(const QModelIndex &index, int role) const
       return static_cast<qint64>(member.object.get_id());
     case MEMBER_COL_NAME:
       if (member.object.is_real())
-        return member.object.get_name(*d->m_osm);
+        return d->m_osm->objectName(member.object);
       break;
     case MEMBER_COL_ROLE:
       return member.role;
@@ -270,18 +272,22 @@ bool RelationMemberModel::commit()
 {
   Q_D(RelationMemberModel);
 
-  const auto ritEnd = d->m_relation->members.end();
-  auto rit = d->m_relation->members.begin();
+  // search without write access, the members may be shared with the original object
+  const auto &members = std::as_const(d->m_relation->members);
+  const auto critEnd = members.end();
+  auto crit = members.begin();
   auto it = d->m_members.cbegin();
 
-  for (; rit != ritEnd; it++, rit++)
-    if (*it != *rit)
+  for (; crit != critEnd; it++, crit++)
+    if (*it != *crit)
       break;
 
-  if (rit == ritEnd)
+  if (crit == critEnd)
     return false;
 
+  const auto firstChange = std::distance(members.begin(), crit);
   d->m_osm->mark_dirty(d->m_relation);
+  auto rit = std::next(d->m_relation->members.begin(), firstChange);
 
   for (; it != d->m_members.cend(); it++, rit++) {
     if (it->role.isEmpty()) {
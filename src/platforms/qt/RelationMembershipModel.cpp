@@ -11,10 +11,13 @@
 #include <osm2go_annotations.h>
 #include "osm2go_i18n.h"
 
+#include <algorithm>
 #include <cassert>
+#include <unordered_map>
 
 RelationMembershipModel::RelationMembershipModel(osm_t::ref o, object_t obj, QObject *parent)
   : QAbstractTableModel(parent)
+  , m_memberships(o->memberships(obj))
   , m_osm(o)
   , m_obj(obj)
 {
@@ -24,6 +27,56 @@ RelationMembershipModel::RelationMembershipModel(osm_t::ref o, object_t obj, QOb
   for (auto &&m : std::as_const(m_osm->relations))
     if (!m.second->isDeleted())
       m_relations.emplace_back(m.second);
+
+  m_fetched = std::min(static_cast<int>(m_relations.size()), FetchBatchSize);
+}
+
+const member_t *RelationMembershipModel::memberOf(const relation_t *relation) const
+{
+  auto it = m_memberships.find(relation);
+  if (it == m_memberships.end())
+    return nullptr;
+
+  return &relation->members.at(it->second);
+}
+
+QVariant RelationMembershipModel::displayData(const relation_t *relation, int column) const
+{
+  switch (column) {
+  case RELITEM_COL_TYPE:
+    return QString::fromUtf8(relation->tags.get_value("type"));
+  case RELITEM_COL_ROLE: {
+    const member_t *member = memberOf(relation);
+    if (member == nullptr || member->role == nullptr)
+      return QVariant();
+    else
+      return QString::fromUtf8(member->role);
+  }
+  case RELITEM_COL_NAME:
+    return m_osm->relationName(relation);
+  default:
+    return QVariant();
+  }
+}
+
+void RelationMembershipModel::updateMembership(const relation_t *relation)
+{
+  auto it = relation->find_member_object(m_obj);
+  if (it == relation->members.cend())
+    m_memberships.erase(relation);
+  else
+    m_memberships[relation] = std::distance(relation->members.cbegin(), it);
+}
+
+void RelationMembershipModel::fetchRows(int count)
+{
+  count = std::min(count, static_cast<int>(m_relations.size()) - m_fetched);
+  if (count <= 0)
+    return;
+
+  beginInsertRows(QModelIndex(), m_fetched, m_fetched + count - 1);
+  m_fetched += count;
+  endInsertRows();
 }
 
 int RelationMembershipModel::rowCount(const QModelIndex &parent) const
@@ -31,7 +84,7 @@ int RelationMembershipModel::rowCount(const QModelIndex &parent) const
   if (unlikely(parent.isValid()))
     return 0;
 
-  return m_relations.size();
+  return m_fetched;
 }
 
 int RelationMembershipModel::columnCount(const QModelIndex &parent) const
@@ -48,32 +101,11 @@ QVariant RelationMembershipModel::data(const QModelIndex &index, int role) const
 
   switch (role) {
   case Qt::DisplayRole:
-  case Qt::EditRole: {
-    const auto *relation = m_relations.at(index.row());
-    switch (index.column()) {
-    case RELITEM_COL_TYPE:
-      return QString::fromUtf8(relation->tags.get_value("type"));
-    case RELITEM_COL_MEMBER:
-      break;
-    case RELITEM_COL_ROLE: {
-      auto it = relation->find_member_object(m_obj);
-      if (it == relation->members.end() || it->role == nullptr)
-        return QVariant();
-      else
-        return QString::fromUtf8(it->role);
-    }
-    case RELITEM_COL_NAME:
-      return relation->descriptiveNameOrId();
-    default:
-      break;
-    }
-    break;
-    }
+  case Qt::EditRole:
+    return displayData(m_relations.at(index.row()), index.column());
   case Qt::CheckStateRole:
-    if (index.column() == RELITEM_COL_MEMBER) {
-      const auto relation = m_relations.at(index.row());
-      return relation->find_member_object(m_obj) == relation->members.end() ? Qt::Unchecked : Qt::Checked;
-    }
+    if (index.column() == RELITEM_COL_MEMBER)
+      return m_memberships.count(m_relations.at(index.row())) == 0 ? Qt::Unchecked : Qt::Checked;
     break;
   case Qt::UserRole:
     return QVariant::fromValue(static_cast<void *>(m_relations.at(index.row())));
@@ -94,9 +126,9 @@ bool RelationMembershipModel::setData(const QModelIndex &idx, const QVariant &va
       return false;
     relation = m_relations.at(idx.row());
     if (value.value<Qt::CheckState>() == Qt::Unchecked) {
-      auto it = relation->find_member_object(m_obj);
-      assert(it != relation->members.end());
-      relation->members.erase(it);
+      auto it = m_memberships.find(relation);
+      assert(it != m_memberships.end());
+      relation->members.erase(std::next(relation->members.cbegin(), it->second));
     } else {
       relation->members.emplace_back(member_t(m_obj, nullptr));
     }
@@ -110,24 +142,109 @@ bool RelationMembershipModel::setData(const QModelIndex &idx, const QVariant &va
     const auto s = value.toString();
     member_t nm(m_obj, s.isEmpty() ? nullptr : s.toUtf8().constData());
 
-    if (auto it = relation->find_member_object(m_obj); it == relation->members.end()) {
+    if (auto it = m_memberships.find(relation); it == m_memberships.end())
       relation->members.emplace_back(nm);
-    } else {
-      auto mit = std::next(relation->members.begin(), std::distance(relation->members.cbegin(), it));
-      *mit = nm;
-    }
+    else
+      relation->members[it->second] = nm;
     break;
     }
   default:
     return false;
   }
 
+  // there may have been multiple instances of the object, so look again
+  updateMembership(relation);
+
   // always update both columns, even if only one changed
   emit dataChanged(index(idx.row(), RELITEM_COL_MEMBER), index(idx.row(), RELITEM_COL_ROLE));
   relation->flags |= OSM_FLAG_DIRTY;
+  m_osm->invalidateNames();
   return true;
 }
 
+bool RelationMembershipModel::canFetchMore(const QModelIndex &parent) const
+{
+  return !parent.isValid() && m_fetched < static_cast<int>(m_relations.size());
+}
+
+void RelationMembershipModel::fetchMore(const QModelIndex &parent)
+{
+  if (unlikely(parent.isValid()))
+    return;
+
+  fetchRows(FetchBatchSize);
+}
+
+void RelationMembershipModel::sort(int column, Qt::SortOrder order)
+{
+  if (unlikely(column < 0 || column >= RELITEM_NUM_COLS))
+    return;
+
+  emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+
+  // remember the relations the persistent indexes point to
+  const QModelIndexList oldIndexes = persistentIndexList();
+  std::vector<const relation_t *> oldRelations;
+  oldRelations.reserve(oldIndexes.size());
+  for (auto &&idx : oldIndexes)
+    oldRelations.emplace_back(m_relations.at(idx.row()));
+
+  if (column == RELITEM_COL_MEMBER) {
+    // there are only 2 possible values, unchecked ones come first in ascending order
+    const bool membersFirst = order != Qt::AscendingOrder;
+    std::stable_partition(m_relations.begin(), m_relations.end(), [this, membersFirst](const relation_t *r) {
+      return (m_memberships.count(r) != 0) == membersFirst;
+    });
+  } else {
+    // get every key only once, generating the names is expensive
+    std::vector<std::pair<QString, relation_t *>> keys;
+    keys.reserve(m_relations.size());
+    for (relation_t *r : m_relations)
+      keys.emplace_back(displayData(r, column).toString(), r);
+
+    const bool ascending = order == Qt::AscendingOrder;
+    std::stable_sort(keys.begin(), keys.end(), [ascending](const auto &a, const auto &b) {
+      const int c = QString::localeAwareCompare(a.first, b.first);
+      return ascending ? c < 0 : c > 0;
+    });
+
+    for (size_t i = 0; i < keys.size(); i++)
+      m_relations[i] = keys[i].second;
+  }
+
+  if (!oldIndexes.isEmpty()) {
+    std::unordered_map<const relation_t *, int> rows;
+    for (int row = 0; row < m_fetched; row++)
+      rows[m_relations[row]] = row;
+
+    // rows that are moved behind the fetched ones become invalid
+    QModelIndexList newIndexes;
+    newIndexes.reserve(oldIndexes.size());
+    for (int i = 0; i < oldIndexes.size(); i++) {
+      auto it = rows.find(oldRelations[i]);
+      newIndexes.append(it == rows.end() ? QModelIndex() : index(it->second, oldIndexes.at(i).column()));
+    }
+    changePersistentIndexList(oldIndexes, newIndexes);
+  }
+
+  emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+}
+
+QModelIndex RelationMembershipModel::firstMemberIndex()
+{
+  const auto it = std::find_if(m_relations.cbegin(), m_relations.cend(), [this](const relation_t *r) {
+    return m_memberships.count(r) != 0;
+  });
+  if (it == m_relations.cend())
+    return QModelIndex();
+
+  const int row = std::distance(m_relations.cbegin(), it);
+  if (row >= m_fetched)
+    fetchRows(row + 1 - m_fetched);
+
+  return index(row, RELITEM_COL_MEMBER);
+}
+
 QVariant RelationMembershipModel::headerData(int section, Qt::Orientation orientation, int role) const
 {
   if (role != Qt::DisplayRole || orientation != Qt::Horizontal)
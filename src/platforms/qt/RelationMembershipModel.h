@@ -25,10 +25,23 @@ class RelationMembershipModel : public QAbstractTableModel {
   Q_OBJECT
   Q_DISABLE_COPY(RelationMembershipModel)
 
+  /// all relations that are not deleted, in display order
   std::vector<relation_t *> m_relations;
+  /// the position of m_obj in the relations it is member of
+  osm_t::MembershipMap m_memberships;
+  /// the number of rows already announced to the views
+  int m_fetched;
   osm_t::ref m_osm;
 
+  const member_t *memberOf(const relation_t *relation) const;
+  QVariant displayData(const relation_t *relation, int column) const;
+  void updateMembership(const relation_t *relation);
+  void fetchRows(int count);
+
 public:
+  /// the number of rows made available at once
+  static constexpr int FetchBatchSize = 256;
+
   RelationMembershipModel(osm_t::ref o, object_t obj, QObject *parent = nullptr);
   ~RelationMembershipModel() override = default;
 
@@ -38,6 +51,17 @@ public:
   bool setData(const QModelIndex &idx, const QVariant &value, int role) override;
   QVariant headerData(int section, Qt::Orientation orientation, int role) const override;
   Qt::ItemFlags flags(const QModelIndex &index) const override;
+  bool canFetchMore(const QModelIndex &parent) const override;
+  void fetchMore(const QModelIndex &parent) override;
+  void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+  /**
+   * @brief the first row of a relation the object is member of
+   *
+   * The rows up to the returned one are fetched if needed. An invalid index
+   * is returned if the object is not member of any relation.
+   */
+  QModelIndex firstMemberIndex();
 
   const object_t m_obj;
 };
@@ -69,7 +69,7 @@ QVariant RelationModel::data(const QModelIndex &index, int role) const
     case RELATION_COL_TYPE:
       return rel->tags.get_value("type");
     case RELATION_COL_NAME:
-      return rel->descriptiveNameOrId();
+      return m_osm->relationName(rel);
     case RELATION_COL_MEMBERS:
       return static_cast<unsigned int>(rel->members.size());
     default:
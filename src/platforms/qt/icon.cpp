@@ -160,6 +160,18 @@ icon_t::icon_free(icon_item *buf)
     entries.erase(it);
 }
 
+size_t
+icon_t::memory_size() const
+{
+  const icon_buffer::BufferMap &entries = static_cast<const icon_buffer *>(this)->entries;
+  size_t ret = 0;
+  for(auto &&entry : entries) {
+    const QPixmap &buf = entry.second->buf;
+    ret += sizeof(*entry.second) + static_cast<size_t>(buf.width()) * buf.height() * buf.depth() / 8;
+  }
+  return ret;
+}
+
 icon_t &icon_t::instance()
 {
   static icon_buffer icons;
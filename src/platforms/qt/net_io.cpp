@@ -7,9 +7,11 @@
 #include "net_io.h"
 
 #include <notifications.h>
+#include <perf_trace.h>
 
 #include <cassert>
 #include <cstring>
+#include <deque>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -21,12 +23,15 @@
 #include <osm2go_i18n.h>
 #include "osm2go_stl.h"
 #include <osm2go_platform.h>
+#include <QCoreApplication>
 #include <QDebug>
+#include <QFile>
 #include <QNetworkAccessManager>
 #include <QNetworkRequest>
 #include <QNetworkReply>
 #include <QProgressDialog>
 #include <QSsl>
+#include <QTimer>
 #include <QUrl>
 
 namespace {
@@ -83,6 +88,7 @@ net_io_request_t::net_io_request_t(const std::string &u, std::string *smem)
 bool
 net_io_do(osm2go_platform::Widget *parent, net_io_request_t &request, const QString &title)
 {
+  PERF_SCOPE("net_io_do");
   /* the request structure is shared between master and worker thread. */
   /* typically the master thread will do some waiting until the worker */
   /* thread returns. But the master may very well stop waiting since e.g. */
@@ -222,6 +228,150 @@ net_io_download_file(osm2go_platform::Widget *parent, const std::string &url,
   return net_io_download_file(parent, url, filename, QString::fromStdString(title), compress);
 }
 
+namespace {
+
+QNetworkRequest
+file_request(const std::string &url)
+{
+  QNetworkRequest req(QUrl(QString::fromStdString(url)));
+#if QT_VERSION >= QT_VERSION_CHECK(5, 9, 0)
+  req.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+#else
+  req.setAttribute(QNetworkRequest::FollowRedirectsAttribute, true);
+#endif
+  req.setHeader(QNetworkRequest::UserAgentHeader, PACKAGE "-QtNetwork/" VERSION "-" QT_VERSION_STR);
+
+  return req;
+}
+
+/**
+ * @brief store the remaining data of a finished reply and move the file in place
+ * @returns if the download was successful
+ */
+bool
+finish_file_reply(QNetworkReply *r, QFile &f, net_io_file_request &request)
+{
+  f.write(r->readAll());
+  f.close();
+  // e.g. WMS servers report errors as XML documents with status 200
+  const bool success = r->error() == QNetworkReply::NoError &&
+                       r->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 200 &&
+                       r->header(QNetworkRequest::ContentTypeHeader).toString().startsWith(QLatin1String("image/"));
+  const QString target = QString::fromStdString(request.filename);
+  QFile::remove(target);
+  if(success && f.rename(target)) {
+    request.ok = true;
+  } else {
+    qDebug() << "download of" << request.url.c_str() << "failed";
+    f.remove();
+  }
+
+  return request.ok;
+}
+
+class net_io_async_qt : public net_io_async_t {
+  struct entry {
+    explicit entry(const net_io_file_request &r)
+      : request(r), file(QString::fromStdString(r.filename + ".part")) {}
+    net_io_file_request request;
+    QFile file;
+  };
+
+  const unsigned int parallel;
+  QNetworkAccessManager mgr;
+  std::deque<net_io_file_request> queue;
+  std::unordered_map<QNetworkReply *, std::unique_ptr<entry>> active;
+  unsigned int failed;    ///< requests that could not be started, reported later
+
+  void startNext();
+  void finished(QNetworkReply *r);
+
+public:
+  net_io_async_qt(unsigned int p, callback cb, void *context)
+    : net_io_async_t(cb, context), parallel(std::max(p, 1u)), failed(0) {}
+  ~net_io_async_qt() override;
+
+  void add(const net_io_file_request &request) override;
+  size_t pending() const override
+  { return queue.size() + active.size() + failed; }
+};
+
+net_io_async_qt::~net_io_async_qt()
+{
+  // no callbacks for aborted transfers
+  for(auto &&a : active) {
+    a.first->disconnect();
+    a.first->abort();
+    a.second->file.remove();
+    delete a.first;
+  }
+}
+
+void
+net_io_async_qt::add(const net_io_file_request &request)
+{
+  queue.push_back(request);
+  startNext();
+}
+
+void
+net_io_async_qt::startNext()
+{
+  while(active.size() < parallel && !queue.empty()) {
+    std::unique_ptr<entry> e = std::make_unique<entry>(queue.front());
+    queue.pop_front();
+
+    if(unlikely(!e->file.open(QIODevice::WriteOnly))) {
+      // the callback must not be called from within add()
+      failed++;
+      const net_io_file_request request = e->request;
+      QTimer::singleShot(0, &mgr, [this, request]() {
+        failed--;
+        done(cb_context, request);
+      });
+      continue;
+    }
+
+    QNetworkReply *r = mgr.get(file_request(e->request.url));
+    QFile *f = &e->file;
+    active[r] = std::move(e);
+
+    // nobody waits for these, a single tile must not block the queue for long
+    QTimer::singleShot(60000, r, [r]() { r->abort(); });
+
+    QObject::connect(r, &QIODevice::readyRead, [f, r]() {
+      f->write(r->readAll());
+    });
+    QObject::connect(r, &QNetworkReply::finished, [this, r]() {
+      finished(r);
+    });
+  }
+}
+
+void
+net_io_async_qt::finished(QNetworkReply *r)
+{
+  const auto it = active.find(r);
+  assert(it != active.end());
+  std::unique_ptr<entry> e = std::move(it->second);
+  active.erase(it);
+  r->deleteLater();
+
+  finish_file_reply(r, e->file, e->request);
+
+  startNext();
+
+  done(cb_context, e->request);
+}
+
+} // namespace
+
+net_io_async_t *
+net_io_async_t::create(unsigned int parallel, callback cb, void *context)
+{
+  return new net_io_async_qt(parallel, cb, context);
+}
+
 bool
 net_io_download_mem(osm2go_platform::Widget *parent, const std::string &url, std::string &data,
                     trstring::native_type_arg title)
@@ -194,6 +194,12 @@ osm2go_platform::userdatapath()
   return dirguard(p.toUtf8().constData());
 }
 
+std::string
+osm2go_platform::cachepath()
+{
+  return (QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1Char('/')).toStdString();
+}
+
 bool
 osm2go_platform::create_directories(const std::string &path)
 {
@@ -31,6 +31,8 @@ private slots:
   void addToRelations();
 
   void changeRole();
+  void lazyFetch();
+  void sorting();
 #ifdef QT_WIDGETS_LIB
   void changeRoleByDelegate();
 #endif
@@ -200,6 +202,86 @@ void TestRelationMembershipModel::changeRole()
   QCOMPARE(rel->members.front().role, nullptr);
 }
 
+void TestRelationMembershipModel::lazyFetch()
+{
+  auto osm = boundedOsm();
+  node_t *n = osm->node_new(lpos_t(1, 1));
+  osm->insert(n);
+
+  const int relCount = RelationMembershipModel::FetchBatchSize * 2 + 3;
+  std::vector<relation_t *> rels;
+
+  for (int i = 0; i < relCount; i++) {
+    rels.emplace_back(new relation_t());
+    osm->attach(rels.back());
+  }
+  // the relations are sorted by id, so this is the last row
+  rels.front()->members.emplace_back(member_t(object_t(n), "last"));
+
+  RelationMembershipModel model(osm, object_t(n));
+  QAbstractItemModelTester mt(&model);
+
+  QCOMPARE(model.rowCount(QModelIndex()), RelationMembershipModel::FetchBatchSize);
+  QVERIFY(model.canFetchMore(QModelIndex()));
+  model.fetchMore(QModelIndex());
+  QCOMPARE(model.rowCount(QModelIndex()), RelationMembershipModel::FetchBatchSize * 2);
+
+  // getting the member row fetches all rows up to that one
+  const QModelIndex idx = model.firstMemberIndex();
+  QVERIFY(idx.isValid());
+  QCOMPARE(idx.row(), relCount - 1);
+  QCOMPARE(model.rowCount(QModelIndex()), relCount);
+  QVERIFY(!model.canFetchMore(QModelIndex()));
+  QCOMPARE(model.data(idx, Qt::CheckStateRole).value<Qt::CheckState>(), Qt::Checked);
+  QCOMPARE(model.data(model.index(idx.row(), RELITEM_COL_ROLE), Qt::DisplayRole).toString(), QStringLiteral("last"));
+}
+
+void TestRelationMembershipModel::sorting()
+{
+  auto osm = boundedOsm();
+  node_t *n = osm->node_new(lpos_t(1, 1));
+  osm->insert(n);
+
+  std::vector<relation_t *> rels;
+  for (const char *name : { "b", "c", "a" }) {
+    rels.emplace_back(new relation_t());
+    osm->attach(rels.back());
+    rels.back()->tags.replace({ tag_t("name", name) });
+  }
+  rels.at(1)->members.emplace_back(member_t(object_t(n)));
+
+  RelationMembershipModel model(osm, object_t(n));
+  QAbstractItemModelTester mt(&model);
+
+  const QPersistentModelIndex pidx = model.index(1, RELITEM_COL_NAME);
+  QCOMPARE(pidx.data(Qt::DisplayRole).toString(), QStringLiteral("c"));
+
+  model.sort(RELITEM_COL_NAME, Qt::AscendingOrder);
+  for (int row = 0; row < 3; row++)
+    QCOMPARE(model.data(model.index(row, RELITEM_COL_NAME), Qt::DisplayRole).toString(), QString(QLatin1Char('a' + row)));
+  QCOMPARE(pidx.row(), 2);
+  QCOMPARE(model.firstMemberIndex().row(), 2);
+
+  model.sort(RELITEM_COL_NAME, Qt::DescendingOrder);
+  QCOMPARE(model.data(model.index(0, RELITEM_COL_NAME), Qt::DisplayRole).toString(), QStringLiteral("c"));
+  QCOMPARE(pidx.row(), 0);
+
+  // the order of the other relations is kept
+  model.sort(RELITEM_COL_MEMBER, Qt::AscendingOrder);
+  QCOMPARE(model.data(model.index(0, RELITEM_COL_NAME), Qt::DisplayRole).toString(), QStringLiteral("b"));
+  QCOMPARE(model.data(model.index(1, RELITEM_COL_NAME), Qt::DisplayRole).toString(), QStringLiteral("a"));
+  QCOMPARE(pidx.row(), 2);
+
+  model.sort(RELITEM_COL_MEMBER, Qt::DescendingOrder);
+  QCOMPARE(model.data(model.index(0, RELITEM_COL_MEMBER), Qt::CheckStateRole).value<Qt::CheckState>(), Qt::Checked);
+  QCOMPARE(pidx.row(), 0);
+
+  // removing the membership is reflected in the sorted model
+  QVERIFY(model.setData(model.index(0, RELITEM_COL_MEMBER), Qt::Unchecked, Qt::CheckStateRole));
+  QVERIFY(rels.at(1)->members.empty());
+  QVERIFY(!model.firstMemberIndex().isValid());
+}
+
 #ifdef QT_WIDGETS_LIB
 void TestRelationMembershipModel::changeRoleByDelegate()
 {
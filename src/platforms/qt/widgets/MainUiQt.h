@@ -13,6 +13,7 @@
 
 class QLabel;
 class QObject;
+class QProgressDialog;
 class QString;
 
 class MainUiQt : public MainUi {
@@ -33,6 +34,10 @@ public:
 
   void clearNotification(NotificationFlags flags) override;
 
+  bool updateProgress(const QString &message, float fraction);
+
   QPointer<QLabel> m_currentMessage;
   QPointer<QLabel> m_permanentMessage;
+  QPointer<QProgressDialog> m_progress;
+  bool m_progressCancelled = false;
 };
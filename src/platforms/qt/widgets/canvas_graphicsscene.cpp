@@ -5,9 +5,11 @@
  */
 
 #include "canvas_graphicsscene.h"
+#include "canvas_graphicsscene_tiles.h"
 
 #include <canvas_p.h>
 #include <map.h>
+#include <perf_trace.h>
 
 #include <algorithm>
 #include <array>
@@ -33,11 +35,9 @@
 #include <osm2go_platform.h>
 #include "osm2go_stl.h"
 
-enum DataKeyMagic {
-  DATA_KEY_DELETE_ITEM = 42,
-  DATA_KEY_MAP_ITEM = 47,
-  DATA_KEY_ZOOM = 51
-};
+/* the shapes of these groups are drawn from cached tiles, the highlights */
+/* in between are still painted directly */
+#define CANVAS_TILED ((1<<CANVAS_GROUP_POLYGONS) | (1<<CANVAS_GROUP_WAYS_OL) | (1<<CANVAS_GROUP_WAYS) | (1<<CANVAS_GROUP_WAYS_INT) | (1<<CANVAS_GROUP_NODES))
 
 canvas_t *
 canvas_t_create()
@@ -75,6 +75,29 @@ void CanvasScene::keyPressEvent(QKeyEvent *keyEvent)
 
 namespace {
 
+/**
+ * @brief the tile layer drawing the given item
+ * @retval nullptr the item is painted directly
+ */
+CanvasTileLayer *
+tileLayer(const QGraphicsItem *item)
+{
+  const QGraphicsItem *gr = item->parentItem();
+  if (gr == nullptr)
+    return nullptr;
+  return static_cast<CanvasTileLayer *>(gr->data(DATA_KEY_TILES).value<void *>());
+}
+
+/**
+ * @brief update the cached shape after the item has been modified
+ */
+void
+updateTiles(QGraphicsItem *item)
+{
+  if (auto *layer = tileLayer(item); layer != nullptr)
+    layer->update_item(static_cast<QAbstractGraphicsShapeItem *>(item));
+}
+
 /**
  * @brief delete the icon
  *
@@ -84,6 +107,8 @@ void
 destroyItem(QGraphicsItem *item)
 {
   auto *citem = reinterpret_cast<canvas_item_t *>(item);
+  if (auto *layer = tileLayer(item); layer != nullptr)
+    layer->remove(item);
   if (auto *deleter = static_cast<canvas_item_destroyer *>(item->data(DATA_KEY_DELETE_ITEM).value<void *>()); deleter != nullptr) {
     deleter->run(citem);
     delete deleter;
@@ -109,6 +134,17 @@ canvas_graphicsscene::canvas_graphicsscene()
     QGraphicsItemGroup *g = scene->createItemGroup({});
     group[gr] = g;
     g->setZValue(gr);
+
+    if (!(CANVAS_TILED & (1 << gr))) {
+      tiles[gr] = nullptr;
+      continue;
+    }
+    // consecutive groups share one layer, placed below the first of them
+    if (gr > 0 && tiles[gr - 1] != nullptr)
+      tiles[gr] = tiles[gr - 1];
+    else
+      tiles[gr] = new CanvasTileLayer(scene, gr - 0.5);
+    g->setData(DATA_KEY_TILES, QVariant::fromValue(static_cast<void *>(tiles[gr])));
   }
 
   static_cast<QGraphicsView *>(widget)->setScene(scene);
@@ -117,6 +153,18 @@ canvas_graphicsscene::canvas_graphicsscene()
 
 canvas_graphicsscene::~canvas_graphicsscene()
 {
+  // the layers are gone before the items, so the items must not refer to them anymore
+  for (unsigned int gr = 0; gr < group.size(); gr++) {
+    if (tiles[gr] == nullptr)
+      continue;
+    group[gr]->setData(DATA_KEY_TILES, QVariant());
+    if (gr + 1 == group.size() || tiles[gr + 1] != tiles[gr]) {
+      scene->removeItem(tiles[gr]);
+      delete tiles[gr];
+    }
+    tiles[gr] = nullptr;
+  }
+
   const auto l = scene->items();
   for (auto &&i : l)
     destroyItem(i);
@@ -136,14 +184,15 @@ canvas_t::set_background(const std::string &filename)
   auto *gcanvas = static_cast<canvas_graphicsscene *>(this);
   auto *gr = gcanvas->group[CANVAS_GROUP_BG];
 
-  // remove old background image, if any
-  if(auto childs = gr->childItems(); !childs.isEmpty()) {
-    assert(childs.count() == 1);
-    auto *old = childs.takeFirst();
+  // remove old background image or tiles, if any
+  const auto childs = gr->childItems();
+  for (auto *old : childs) {
     gr->removeFromGroup(old);
     gcanvas->scene->removeItem(old);
     delete old;
   }
+  gr->setPos(0, 0);
+  gcanvas->bg.image = false;
 
   QPixmap pm;
   if (!pm.load(QString::fromStdString(filename)))
@@ -158,14 +207,85 @@ canvas_t::set_background(const std::string &filename)
 
   auto *item = new QGraphicsPixmapItem(pm, gr);
   gr->addToGroup(item);
+  gcanvas->bg.image = true;
+
+  return true;
+}
+
+bool
+canvas_t::add_background_tile(const std::string &filename, lpos_t min, lpos_t max)
+{
+  auto *gcanvas = static_cast<canvas_graphicsscene *>(this);
+  auto *gr = gcanvas->group[CANVAS_GROUP_BG];
+
+  QPixmap pm;
+  if (!pm.load(QString::fromStdString(filename)))
+    return false;
+
+  assert(!gcanvas->bg.image);
+
+  auto *item = new QGraphicsPixmapItem(pm, gr);
+  item->setTransformationMode(Qt::SmoothTransformation);
+  item->setTransform(QTransform::fromScale(static_cast<qreal>(max.x - min.x) / pm.width(),
+                                           static_cast<qreal>(max.y - min.y) / pm.height()));
+  item->setPos(min.x, min.y);
+  gr->addToGroup(item);
 
   return true;
 }
 
+void
+canvas_t::clear_background_tiles()
+{
+  auto *gcanvas = static_cast<canvas_graphicsscene *>(this);
+  auto *gr = gcanvas->group[CANVAS_GROUP_BG];
+  assert(!gcanvas->bg.image);
+
+  const auto childs = gr->childItems();
+  for (auto *old : childs) {
+    gr->removeFromGroup(old);
+    gcanvas->scene->removeItem(old);
+    delete old;
+  }
+}
+
 void
 canvas_t::move_background(int x, int y)
 {
-  static_cast<canvas_graphicsscene *>(this)->group[CANVAS_GROUP_BG]->childItems().first()->setPos(x, y);
+  auto *gcanvas = static_cast<canvas_graphicsscene *>(this);
+  auto *gr = gcanvas->group[CANVAS_GROUP_BG];
+
+  if (!gcanvas->bg.image) {
+    // tiles are placed at their real position, so only the offset is applied
+    const auto origin = gcanvas->scene->sceneRect().normalized().topLeft();
+    gr->setPos(x - origin.x(), y - origin.y());
+  } else {
+    gr->childItems().first()->setPos(x, y);
+  }
+}
+
+lpos_t
+canvas_t::background_position() const
+{
+  auto *gcanvas = static_cast<const canvas_graphicsscene *>(this);
+  auto *gr = gcanvas->group[CANVAS_GROUP_BG];
+
+  QPointF p;
+  if (!gcanvas->bg.image)
+    p = gr->pos() + gcanvas->scene->sceneRect().normalized().topLeft();
+  else
+    p = gr->childItems().first()->pos();
+
+  return lpos_t(p.x(), p.y());
+}
+
+void
+canvas_t::visible_area(lpos_t &min, lpos_t &max) const
+{
+  const QGraphicsView * const view = static_cast<const QGraphicsView *>(widget);
+  const QRectF r = view->mapToScene(view->viewport()->rect()).boundingRect();
+  min = lpos_t(r.left(), r.top());
+  max = lpos_t(r.right(), r.bottom());
 }
 
 lpos_t
@@ -236,7 +356,12 @@ canvas_t::set_bounds(lpos_t min, lpos_t max)
   QRectF rect;
   rect.setBottomLeft(QPointF(min.x, min.y));
   rect.setTopRight(QPointF(max.x, max.y));
-  static_cast<canvas_graphicsscene *>(this)->scene->setSceneRect(rect);
+  auto *gcanvas = static_cast<canvas_graphicsscene *>(this);
+  gcanvas->scene->setSceneRect(rect);
+
+  for (unsigned int gr = 0; gr < gcanvas->group.size(); gr++)
+    if (gcanvas->tiles[gr] != nullptr && (gr == 0 || gcanvas->tiles[gr - 1] != gcanvas->tiles[gr]))
+      gcanvas->tiles[gr]->setBounds(rect);
 }
 
 /* ------------------- creating and destroying objects ---------------- */
@@ -253,6 +378,8 @@ canvas_t::erase(unsigned int group_mask)
       if(childs.isEmpty())
         continue;
       qDebug() << "Removing " << childs.count() << "children from group" << group << gr << gr->boundingRect();
+      if (gcanvas->tiles[group] != nullptr)
+        gcanvas->tiles[group]->clear(1 << group);
       for (auto &&c: childs) {
         gcanvas->scene->removeItem(c);
         destroyItem(c);
@@ -286,6 +413,21 @@ public:
   }
 };
 
+/**
+ * @brief let the tile layer of the group draw the item, if there is one
+ */
+void
+cacheItem(canvas_t *canvas, canvas_group_t group, QAbstractGraphicsShapeItem *item)
+{
+  CanvasTileLayer *layer = static_cast<canvas_graphicsscene *>(canvas)->tiles[group];
+  if (layer == nullptr)
+    return;
+
+  // the item is still needed to find it and to modify it, but it is not painted anymore
+  item->setFlag(QGraphicsItem::ItemHasNoContents);
+  layer->add(group, item);
+}
+
 } // namespace
 
 canvas_item_circle *
@@ -297,6 +439,7 @@ canvas_t::circle_new(canvas_group_t group, lpos_t c, float radius, int border, c
   if (border > 0)
     item->setPen(QPen(QColor::fromRgba(border_col.argb()), border));
   item->setBrush(QColor::fromRgba(fill_col.argb()));
+  cacheItem(this, group, item);
 
   auto *ret = reinterpret_cast<canvas_item_circle *>(item);
 
@@ -325,6 +468,7 @@ canvas_t::polyline_new(canvas_group_t group, const std::vector<lpos_t> &points,
   item->setPath(canvas_points_create(points));
 
   item->setPen(QPen(QColor::fromRgba(color.argb()), width, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
+  cacheItem(this, group, item);
 
   auto *ret = reinterpret_cast<canvas_item_polyline *>(item);
 
@@ -348,6 +492,7 @@ canvas_t::polygon_new(canvas_group_t group, const std::vector<lpos_t> &points, f
 
   item->setPen(QPen(QColor::fromRgba(color.argb()), width, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
   item->setBrush(QColor::fromRgba(fill.argb()));
+  cacheItem(this, group, item);
 
   auto *ret = reinterpret_cast<canvas_item_t *>(item);
 
@@ -357,6 +502,66 @@ canvas_t::polygon_new(canvas_group_t group, const std::vector<lpos_t> &points, f
   return ret;
 }
 
+canvas_item_t *
+canvas_t::markers_new(canvas_group_t group, const std::vector<lpos_t> &centers, float radius, color_t fill)
+{
+  QPainterPath path;
+  for (const auto c: centers)
+    path.addEllipse(QPointF(c.x, c.y), radius, radius);
+
+  auto *item = new ZoomedItem<QGraphicsPathItem>(this, group);
+  item->setPath(path);
+  item->setPen(Qt::NoPen);
+  item->setBrush(QColor::fromRgba(fill.argb()));
+
+  auto *ret = reinterpret_cast<canvas_item_t *>(item);
+
+  if (CANVAS_SELECTABLE & (1 << group))
+    (void) new canvas_item_info_markers(this, ret, centers, radius);
+
+  return ret;
+}
+
+canvas_item_t *
+canvas_t::polylines_new(canvas_group_t group, const std::vector<std::vector<lpos_t>> &lines, float width,
+                        color_t color)
+{
+  assert((CANVAS_SELECTABLE & (1 << group)) == 0);
+
+  QPainterPath path;
+  for (auto &&line : lines)
+    path.addPath(canvas_points_create(line));
+
+  auto *item = new ZoomedItem<QGraphicsPathItem>(this, group);
+  item->setPath(path);
+  item->setPen(QPen(QColor::fromRgba(color.argb()), width, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
+
+  return reinterpret_cast<canvas_item_t *>(item);
+}
+
+canvas_item_t *
+canvas_t::polygons_new(canvas_group_t group, const std::vector<std::vector<lpos_t>> &polygons, color_t fill)
+{
+  assert((CANVAS_SELECTABLE & (1 << group)) == 0);
+
+  QPainterPath path;
+  for (auto &&polygon : polygons) {
+    QPolygonF cpoints;
+    cpoints.reserve(polygon.size());
+    for (const auto p: polygon)
+      cpoints << QPointF(p.x, p.y);
+    path.addPolygon(cpoints);
+    path.closeSubpath();
+  }
+
+  auto *item = new ZoomedItem<QGraphicsPathItem>(this, group);
+  item->setPath(path);
+  item->setPen(Qt::NoPen);
+  item->setBrush(QColor::fromRgba(fill.argb()));
+
+  return reinterpret_cast<canvas_item_t *>(item);
+}
+
 /* place the image in pix centered on x/y on the canvas */
 canvas_item_pixmap *
 canvas_t::image_new(canvas_group_t group, icon_item *icon, lpos_t pos, float scale)
@@ -393,7 +598,12 @@ canvas_t::image_new(canvas_group_t group, icon_item *icon, lpos_t pos, float sca
 void
 canvas_item_t::operator delete(void *ptr)
 {
-  delete static_cast<QGraphicsItem *>(ptr);
+  auto *item = static_cast<QGraphicsItem *>(ptr);
+  if (item == nullptr)
+    return;
+  if (auto *layer = tileLayer(item); layer != nullptr)
+    layer->remove(item);
+  delete item;
 }
 
 /* ------------------------ accessing items ---------------------- */
@@ -401,7 +611,18 @@ canvas_item_t::operator delete(void *ptr)
 void
 canvas_item_polyline::set_points(const std::vector<lpos_t> &points)
 {
-  reinterpret_cast<QGraphicsPathItem *>(this)->setPath(canvas_points_create(points));
+  auto *item = reinterpret_cast<QGraphicsItem *>(this);
+  if (item->type() == QGraphicsPolygonItem::Type) {
+    QPolygonF cpoints;
+    cpoints.reserve(points.size());
+    for (const auto p: points)
+      cpoints << QPointF(p.x, p.y);
+    static_cast<QGraphicsPolygonItem *>(item)->setPolygon(cpoints);
+  } else {
+    assert_cmpnum(item->type(), QGraphicsPathItem::Type);
+    static_cast<QGraphicsPathItem *>(item)->setPath(canvas_points_create(points));
+  }
+  updateTiles(item);
 }
 
 void
@@ -410,10 +631,50 @@ canvas_item_circle::set_radius(float radius)
   auto *item = reinterpret_cast<QGraphicsEllipseItem *>(this);
   QRectF r = item->rect();
   const QPointF c = r.center();
-  r.setWidth(radius);
-  r.setHeight(radius);
+  r.setWidth(radius * 2);
+  r.setHeight(radius * 2);
   r.moveCenter(c);
   item->setRect(r);
+  updateTiles(item);
+}
+
+void
+canvas_item_circle::set_center(lpos_t c)
+{
+  auto *item = reinterpret_cast<QGraphicsEllipseItem *>(this);
+  QRectF r = item->rect();
+  r.moveCenter(QPointF(c.x, c.y));
+  item->setRect(r);
+  updateTiles(item);
+}
+
+void
+canvas_item_t::set_style(float width, color_t color, color_t fill)
+{
+  auto *item = reinterpret_cast<QGraphicsItem *>(this);
+  auto *sitem = static_cast<QAbstractGraphicsShapeItem *>(item);
+
+  switch (item->type()) {
+  case QGraphicsEllipseItem::Type:
+    // same as in circle_new()
+    sitem->setPen(width > 0 ? QPen(QColor::fromRgba(color.argb()), width) : QPen());
+    sitem->setBrush(QColor::fromRgba(fill.argb()));
+    break;
+  case QGraphicsPolygonItem::Type:
+    sitem->setBrush(QColor::fromRgba(fill.argb()));
+    // fallthrough
+  case QGraphicsPathItem::Type: {
+    // keep the dash pattern
+    auto pen = sitem->pen();
+    pen.setColor(QColor::fromRgba(color.argb()));
+    pen.setWidthF(width);
+    sitem->setPen(pen);
+    break;
+  }
+  default:
+    assert_unreachable();
+  }
+  updateTiles(item);
 }
 
 bool
@@ -427,7 +688,9 @@ canvas_t::ensureVisible(lpos_t lpos)
 void
 canvas_item_t::set_zoom_max(float zoom_max)
 {
-  reinterpret_cast<QGraphicsItem *>(this)->setData(DATA_KEY_ZOOM, zoom_max);
+  auto *item = reinterpret_cast<QGraphicsItem *>(this);
+  item->setData(DATA_KEY_ZOOM, zoom_max);
+  updateTiles(item);
 }
 
 void
@@ -439,9 +702,13 @@ canvas_item_t::set_dashed(float line_width, unsigned int dash_length_on, unsigne
 
   auto *sitem = static_cast<QAbstractGraphicsShapeItem *>(item);
   auto pen = sitem->pen();
-  pen.setDashPattern( { static_cast<qreal>(dash_length_on), static_cast<qreal>(dash_length_off) } );
+  if (dash_length_on == 0)
+    pen.setStyle(Qt::SolidLine);
+  else
+    pen.setDashPattern( { static_cast<qreal>(dash_length_on), static_cast<qreal>(dash_length_off) } );
   pen.setWidthF(line_width);
   sitem->setPen(pen);
+  updateTiles(item);
 }
 
 void
@@ -485,6 +752,7 @@ auto items_in_rect(CanvasScene *sc, lpos_t pos, double zoom)
 canvas_item_t *
 canvas_t::get_item_at(lpos_t pos) const
 {
+  PERF_SCOPE("canvas_t::get_item_at");
   const auto items = items_in_rect(static_cast<const canvas_graphicsscene *>(this)->scene, pos, get_zoom());
 
   QGraphicsItem *ret = nullptr;
@@ -504,6 +772,8 @@ canvas_t::get_next_item_at(lpos_t pos, canvas_item_t *oldtop) const
   const auto childs = qitem->parentItem()->childItems();
 
   qitem->setZValue(-1);
+  if (auto *layer = tileLayer(qitem); layer != nullptr)
+    layer->lower(qitem);
 
   for (auto &&o : childs)
     if (o != qitem)
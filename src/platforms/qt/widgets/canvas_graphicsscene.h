@@ -14,6 +14,7 @@
 #include <QGraphicsSceneMouseEvent>
 #include <QKeyEvent>
 
+class CanvasTileLayer;
 class QGraphicsItemGroup;
 
 class CanvasScene : public QGraphicsScene {
@@ -57,6 +58,13 @@ signals:
   void keyPress(int k);
 };
 
+enum DataKeyMagic {
+  DATA_KEY_DELETE_ITEM = 42,
+  DATA_KEY_MAP_ITEM = 47,
+  DATA_KEY_ZOOM = 51,
+  DATA_KEY_TILES = 53     ///< set on the groups whose shapes are drawn by a CanvasTileLayer
+};
+
 struct canvas_graphicsscene : public canvas_t {
   explicit canvas_graphicsscene();
   ~canvas_graphicsscene();
@@ -71,9 +79,17 @@ struct canvas_graphicsscene : public canvas_t {
 
   struct {
     struct { float x = 0, y = 0; } scale;
+    bool image = false;   ///< a single background image is shown, otherwise tiles
   } bg;
 
   std::array<QGraphicsItemGroup *, CANVAS_GROUPS> group;
+  /**
+   * @brief the layer drawing the shapes of each group
+   *
+   * Consecutive groups share one layer, nullptr for groups that are painted
+   * directly.
+   */
+  std::array<CanvasTileLayer *, CANVAS_GROUPS> tiles;
 
   std::array<std::vector<canvas_item_info_t *>, CANVAS_GROUPS> item_info;
 };
@@ -0,0 +1,361 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Rolf Eike Beer <eike@sf-mail.de>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "canvas_graphicsscene_tiles.h"
+
+#include "canvas_graphicsscene.h"
+#include <perf_trace.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <QGraphicsEllipseItem>
+#include <QGraphicsPathItem>
+#include <QGraphicsPolygonItem>
+#include <QGraphicsScene>
+#include <QPainter>
+#include <QRunnable>
+#include <QStyleOptionGraphicsItem>
+
+#include <osm2go_annotations.h>
+
+namespace {
+
+/**
+ * @brief the maximum number of tiles kept in memory
+ *
+ * Each tile needs 256kB, this is enough for several screens.
+ */
+const size_t MaxTiles = 160;
+
+class TileRenderer : public QRunnable {
+  CanvasTileLayer * const layer;
+  const std::shared_ptr<const std::vector<CanvasTileLayer::shape>> shapes;
+  const double zoom;
+  const int tx, ty;
+  const quint64 rev;
+public:
+  TileRenderer(CanvasTileLayer *l, std::shared_ptr<const std::vector<CanvasTileLayer::shape>> s,
+               double z, int x, int y, quint64 r)
+    : QRunnable(), layer(l), shapes(std::move(s)), zoom(z), tx(x), ty(y), rev(r) {}
+
+  void run() override;
+};
+
+void TileRenderer::run()
+{
+  PERF_SCOPE("CanvasTileLayer::render");
+
+  QImage image(CanvasTileLayer::TileSize, CanvasTileLayer::TileSize, QImage::Format_ARGB32_Premultiplied);
+  image.fill(Qt::transparent);
+
+  const qreal size = CanvasTileLayer::TileSize / zoom;
+  const QRectF area(tx * size, ty * size, size, size);
+
+  QPainter painter(&image);
+  painter.scale(zoom, zoom);
+  painter.translate(-area.left(), -area.top());
+
+  unsigned int painted = 0;
+  for(const CanvasTileLayer::shape &s : *shapes) {
+    if(s.zoom_max > zoom || !s.bounds.intersects(area))
+      continue;
+    painter.setPen(s.pen);
+    painter.setBrush(s.brush);
+    painter.drawPath(s.path);
+    painted++;
+  }
+  painter.end();
+
+  PERF_COUNT("CanvasTileLayer::render shapes", painted);
+
+  // the layer waits for all workers before it is destroyed, so it is still valid here
+  QMetaObject::invokeMethod(layer, "tileRendered", Qt::QueuedConnection, Q_ARG(double, zoom),
+                            Q_ARG(int, tx), Q_ARG(int, ty), Q_ARG(quint64, rev), Q_ARG(QImage, image));
+}
+
+/**
+ * @brief the drawing order: groups from bottom to top, then the order inside the group
+ */
+bool shape_order(const CanvasTileLayer::shape &a, const CanvasTileLayer::shape &b)
+{
+  if(a.group != b.group)
+    return a.group < b.group;
+  return a.seq < b.seq;
+}
+
+} // namespace
+
+CanvasTileLayer::CanvasTileLayer(QGraphicsScene *scene, qreal z)
+  : QGraphicsObject()
+  , revision(1)
+  , snapshotRevision(0)
+  , nextSeq(0)
+  , lowestSeq(0)
+  , frame(0)
+  , shownZoom(0)
+  , lastZoom(0)
+{
+  setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+  setZValue(z);
+  scene->addItem(this);
+}
+
+CanvasTileLayer::~CanvasTileLayer()
+{
+  pool.clear();
+  pool.waitForDone();
+}
+
+QRectF CanvasTileLayer::boundingRect() const
+{
+  return bounds;
+}
+
+void CanvasTileLayer::setBounds(const QRectF &r)
+{
+  prepareGeometryChange();
+  bounds = r.normalized();
+  invalidate(bounds);
+}
+
+QRectF CanvasTileLayer::tile_rect(const tile_key &key)
+{
+  const qreal size = TileSize / std::get<0>(key);
+  return QRectF(std::get<1>(key) * size, std::get<2>(key) * size, size, size);
+}
+
+CanvasTileLayer::shape CanvasTileLayer::make_shape(QAbstractGraphicsShapeItem *item)
+{
+  shape ret;
+
+  switch(item->type()) {
+  case QGraphicsEllipseItem::Type:
+    ret.path.addEllipse(static_cast<QGraphicsEllipseItem *>(item)->rect());
+    break;
+  case QGraphicsPathItem::Type:
+    ret.path = static_cast<QGraphicsPathItem *>(item)->path();
+    break;
+  case QGraphicsPolygonItem::Type:
+    ret.path.addPolygon(static_cast<QGraphicsPolygonItem *>(item)->polygon());
+    ret.path.closeSubpath();
+    break;
+  default:
+    assert_unreachable();
+  }
+
+  ret.pen = item->pen();
+  ret.brush = item->brush();
+  const qreal extra = ret.pen.style() == Qt::NoPen ? 0 : ret.pen.widthF() / 2 + 1;
+  ret.bounds = ret.path.boundingRect().adjusted(-extra, -extra, extra, extra);
+  const QVariant zm = item->data(DATA_KEY_ZOOM);
+  ret.zoom_max = zm.isNull() ? 0 : zm.value<float>();
+  ret.group = 0;
+  ret.seq = 0;
+
+  return ret;
+}
+
+void CanvasTileLayer::add(unsigned int group, QAbstractGraphicsShapeItem *item)
+{
+  shape s = make_shape(item);
+  s.group = group;
+  s.seq = nextSeq++;
+  invalidate(s.bounds);
+  shapes[item] = std::move(s);
+}
+
+void CanvasTileLayer::update_item(QAbstractGraphicsShapeItem *item)
+{
+  const auto it = shapes.find(item);
+  if(it == shapes.end())
+    return;
+
+  shape s = make_shape(item);
+  s.group = it->second.group;
+  s.seq = it->second.seq;
+  invalidate(it->second.bounds);
+  invalidate(s.bounds);
+  it->second = std::move(s);
+}
+
+void CanvasTileLayer::remove(const QGraphicsItem *item)
+{
+  const auto it = shapes.find(item);
+  if(it == shapes.end())
+    return;
+
+  invalidate(it->second.bounds);
+  shapes.erase(it);
+}
+
+void CanvasTileLayer::lower(const QGraphicsItem *item)
+{
+  const auto it = shapes.find(item);
+  if(it == shapes.end())
+    return;
+
+  it->second.seq = --lowestSeq;
+  invalidate(it->second.bounds);
+}
+
+void CanvasTileLayer::clear(unsigned int group_mask)
+{
+  for(auto it = shapes.begin(); it != shapes.end(); ) {
+    if(group_mask & (1 << it->second.group))
+      it = shapes.erase(it);
+    else
+      it++;
+  }
+
+  invalidate(bounds);
+}
+
+void CanvasTileLayer::invalidate(const QRectF &r)
+{
+  revision++;
+
+  bool any = false;
+  for(auto &&t : tiles) {
+    if(tile_rect(t.first).intersects(r)) {
+      t.second.dirty = revision;
+      any = true;
+    }
+  }
+
+  if(any)
+    update(r);
+}
+
+std::shared_ptr<const std::vector<CanvasTileLayer::shape>> CanvasTileLayer::current_snapshot()
+{
+  if(!snapshot || snapshotRevision != revision) {
+    PERF_SCOPE("CanvasTileLayer::snapshot");
+    auto v = std::make_shared<std::vector<shape>>();
+    v->reserve(shapes.size());
+    for(auto &&s : shapes)
+      v->push_back(s.second);
+    std::sort(v->begin(), v->end(), shape_order);
+    snapshot = std::move(v);
+    snapshotRevision = revision;
+  }
+
+  return snapshot;
+}
+
+void CanvasTileLayer::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *)
+{
+  PERF_SCOPE("CanvasTileLayer::paint");
+
+  const double zoom = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+  const qreal size = TileSize / zoom;
+  const QRectF exposed = option->exposedRect.intersected(bounds);
+  if(exposed.isEmpty())
+    return;
+
+  if(zoom != shownZoom) {
+    // the tiles of the previous zoom level are shown until the new ones are ready
+    lastZoom = shownZoom;
+    shownZoom = zoom;
+  }
+
+  frame++;
+
+  const int x0 = static_cast<int>(std::floor(exposed.left() / size));
+  const int x1 = static_cast<int>(std::floor(exposed.right() / size));
+  const int y0 = static_cast<int>(std::floor(exposed.top() / size));
+  const int y1 = static_cast<int>(std::floor(exposed.bottom() / size));
+
+  for(int ty = y0; ty <= y1; ty++) {
+    for(int tx = x0; tx <= x1; tx++) {
+      const tile_key key(zoom, tx, ty);
+      auto it = tiles.find(key);
+      if(it == tiles.end()) {
+        tile t;
+        t.dirty = revision;
+        t.rendered = 0;
+        t.pending = false;
+        it = tiles.insert(std::make_pair(key, t)).first;
+      }
+      tile &t = it->second;
+      t.lastUse = frame;
+
+      const QRectF rect = tile_rect(key);
+      if(!t.image.isNull())
+        painter->drawImage(rect, t.image);
+      else if(lastZoom > 0)
+        draw_fallback(painter, rect);
+
+      if(t.rendered < t.dirty && !t.pending) {
+        t.pending = true;
+        pool.start(new TileRenderer(this, current_snapshot(), zoom, tx, ty, revision));
+      }
+    }
+  }
+
+  evict();
+}
+
+void CanvasTileLayer::draw_fallback(QPainter *painter, const QRectF &area) const
+{
+  const qreal size = TileSize / lastZoom;
+  const int x0 = static_cast<int>(std::floor(area.left() / size));
+  const int x1 = static_cast<int>(std::floor(area.right() / size));
+  const int y0 = static_cast<int>(std::floor(area.top() / size));
+  const int y1 = static_cast<int>(std::floor(area.bottom() / size));
+
+  painter->save();
+  painter->setClipRect(area);
+  for(int ty = y0; ty <= y1; ty++) {
+    for(int tx = x0; tx <= x1; tx++) {
+      const tile_key key(lastZoom, tx, ty);
+      const auto it = tiles.find(key);
+      if(it != tiles.end() && !it->second.image.isNull())
+        painter->drawImage(tile_rect(key), it->second.image);
+    }
+  }
+  painter->restore();
+}
+
+void CanvasTileLayer::tileRendered(double zoom, int tx, int ty, quint64 rev, const QImage &image)
+{
+  const tile_key key(zoom, tx, ty);
+  const auto it = tiles.find(key);
+  // the tile may have been dropped in the meantime
+  if(it == tiles.end())
+    return;
+
+  it->second.image = image;
+  it->second.rendered = rev;
+  it->second.pending = false;
+
+  // if the tile has changed again while rendering paint() will start the next run
+  update(tile_rect(key));
+}
+
+void CanvasTileLayer::evict()
+{
+  if(tiles.size() <= MaxTiles)
+    return;
+
+  std::vector<uint64_t> uses;
+  uses.reserve(tiles.size());
+  for(auto &&t : tiles)
+    uses.push_back(t.second.lastUse);
+
+  // drop down to 3/4 of the limit, so this does not happen on every paint
+  const size_t keep = MaxTiles * 3 / 4;
+  std::nth_element(uses.begin(), std::next(uses.begin(), uses.size() - keep), uses.end());
+  const uint64_t limit = uses[uses.size() - keep];
+
+  for(auto it = tiles.begin(); it != tiles.end(); ) {
+    // the tiles of the current frame are always kept
+    if(it->second.lastUse < limit && it->second.lastUse != frame)
+      it = tiles.erase(it);
+    else
+      it++;
+  }
+}
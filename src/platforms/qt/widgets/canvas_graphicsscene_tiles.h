@@ -0,0 +1,154 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Rolf Eike Beer <eike@sf-mail.de>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include <QBrush>
+#include <QGraphicsObject>
+#include <QImage>
+#include <QPainterPath>
+#include <QPen>
+#include <QThreadPool>
+
+class QAbstractGraphicsShapeItem;
+
+/**
+ * @brief draws the shapes of some canvas groups from cached raster tiles
+ *
+ * The registered items stay in the scene, so they can still be found and
+ * modified, but they are not painted themselves. Instead their shapes are
+ * rendered into tiles of TileSize pixels on worker threads. Tiles are kept per
+ * zoom level and are only rendered again if an item overlapping them changes.
+ *
+ * The layer is a top level item placed directly below the lowest of its groups.
+ */
+class CanvasTileLayer : public QGraphicsObject {
+  Q_OBJECT
+  Q_DISABLE_COPY(CanvasTileLayer)
+
+public:
+  enum { Type = UserType + 1 };
+  enum { TileSize = 256 };
+
+  /**
+   * @brief the drawing information of one item
+   *
+   * This is a copy of the item state that can be accessed from the worker
+   * threads.
+   */
+  struct shape {
+    QPainterPath path;
+    QPen pen;
+    QBrush brush;
+    QRectF bounds;        ///< the area covered by the shape, including the pen
+    float zoom_max;       ///< the shape is only visible at least at this zoom level
+    unsigned int group;
+    int64_t seq;          ///< the drawing order inside the group
+  };
+
+  CanvasTileLayer(QGraphicsScene *scene, qreal z);
+  ~CanvasTileLayer() override;
+
+  int type() const override
+  { return Type; }
+  QRectF boundingRect() const override;
+  void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+  /**
+   * @brief set the area covered by the map
+   */
+  void setBounds(const QRectF &r);
+
+  /**
+   * @brief draw the given item from the tiles from now on
+   *
+   * The geometry, pen and brush of the item must already be set.
+   */
+  void add(unsigned int group, QAbstractGraphicsShapeItem *item);
+
+  /**
+   * @brief take the changed geometry or style of the item
+   */
+  void update_item(QAbstractGraphicsShapeItem *item);
+
+  /**
+   * @brief forget the given item
+   *
+   * Items not drawn by this layer are ignored.
+   */
+  void remove(const QGraphicsItem *item);
+
+  /**
+   * @brief draw the item below all others of its group
+   */
+  void lower(const QGraphicsItem *item);
+
+  /**
+   * @brief forget all items of the given groups
+   */
+  void clear(unsigned int group_mask);
+
+  /**
+   * @brief called when a worker has finished a tile
+   */
+  Q_INVOKABLE void tileRendered(double zoom, int tx, int ty, quint64 rev, const QImage &image);
+
+private:
+  typedef std::tuple<double, int, int> tile_key;  ///< zoom, column, row
+
+  struct tile {
+    QImage image;        ///< the last rendered contents, may be outdated
+    uint64_t dirty;      ///< the revision of the last change affecting this tile
+    uint64_t rendered;   ///< the revision the image was rendered from
+    uint64_t lastUse;
+    bool pending;        ///< a worker is rendering this tile
+  };
+
+  std::unordered_map<const QGraphicsItem *, shape> shapes;
+  std::map<tile_key, tile> tiles;
+  QRectF bounds;
+  QThreadPool pool;
+
+  uint64_t revision;          ///< incremented for every change of the shapes
+  std::shared_ptr<const std::vector<shape>> snapshot;
+  uint64_t snapshotRevision;
+  int64_t nextSeq;
+  int64_t lowestSeq;
+  uint64_t frame;             ///< incremented for every paint, used to find unused tiles
+  double shownZoom;           ///< the zoom level of the last paint
+  double lastZoom;            ///< the zoom level painted before shownZoom
+
+  static QRectF tile_rect(const tile_key &key);
+  static shape make_shape(QAbstractGraphicsShapeItem *item);
+
+  /**
+   * @brief mark all tiles overlapping the given area as outdated
+   */
+  void invalidate(const QRectF &r);
+
+  /**
+   * @brief the shapes in drawing order
+   *
+   * A new copy is only created if the shapes have changed since the last call.
+   */
+  std::shared_ptr<const std::vector<shape>> current_snapshot();
+
+  /**
+   * @brief draw the tiles of the previous zoom level covering the given area
+   */
+  void draw_fallback(QPainter *painter, const QRectF &area) const;
+
+  /**
+   * @brief drop the tiles that have not been used for the longest time
+   */
+  void evict();
+};
@@ -452,9 +452,8 @@ menu_create(appdata_internal &appdata, QMenuBar *menu)
 
   item = menu_append_new_item(submenu, trstring("&Import"), "document-import");
   QObject::connect(item, &QAction::triggered, [&appdata]() {
-    std::string fn = wms_import(appdata_t::window, appdata.project);
-    if (!fn.empty())
-      appdata.map->set_bg_image(fn, osm2go_platform::screenpos(0, 0));
+    if (wms_import(appdata_t::window, appdata.project))
+      appdata.map->set_bg_tiles(osm2go_platform::screenpos(0, 0));
   });
 
   item = appdata.menu_append_new_item(submenu, MainUi::MENU_ITEM_WMS_CLEAR);
@@ -8,6 +8,7 @@
 
 #include <appdata.h>
 #include "canvas_graphicsscene.h"
+#include <diff.h>
 #include <iconbar.h>
 
 #include <cassert>
@@ -16,9 +17,7 @@
 #include <QDebug>
 #include <QGraphicsView>
 
-namespace {
-
-void map_autosave(QGraphicsView *view, appdata_t &appdata)
+void map_graphicsview::map_autosave()
 {
   /* only do this if root window has focus as otherwise */
   /* a dialog may be open and modifying the basic structures */
@@ -27,13 +26,34 @@ void map_autosave(QGraphicsView *view, appdata_t &appdata)
 
     if(appdata.project && appdata.project->osm) {
       track_save(appdata.project, appdata.track.track.get());
-      appdata.project->diff_save();
+      autosave_diff();
     }
   } else
     qDebug() << "autosave suppressed";
 }
 
-} // namespace
+void map_graphicsview::autosave_diff()
+{
+  // the thread still holds a reference while it runs
+  if(unlikely(autosaveData.use_count() > 1)) {
+    qDebug() << "previous autosave still in progress";
+    return;
+  }
+  autosave_wait();
+
+  autosaveData.reset(appdata.project->diff_collect());
+  if(unlikely(!autosaveData))
+    return;
+
+  autosaveWorker = std::thread([snapshot = autosaveData]() { snapshot->write(); });
+}
+
+void map_graphicsview::autosave_wait()
+{
+  if(autosaveWorker.joinable())
+    autosaveWorker.join();
+  autosaveData.reset();
+}
 
 map_graphicsview::map_graphicsview(appdata_t &a)
   : map_t(a, new canvas_graphicsscene())
@@ -44,7 +64,7 @@ map_graphicsview::map_graphicsview(appdata_t &a)
   QObject::connect(static_cast<QGuiApplication *>(QApplication::instance()), &QGuiApplication::lastWindowClosed, [this](){ delete this; });
   autosave.setInterval(std::chrono::minutes(2));
   autosave.setSingleShot(false);
-  QObject::connect(&autosave, &QTimer::timeout, [v = view, &a = appdata](){ map_autosave(v, a); });
+  QObject::connect(&autosave, &QTimer::timeout, [this](){ map_autosave(); });
 
   auto cs = static_cast<CanvasScene *>(view->scene());
   QObject::connect(cs, &CanvasScene::mouseMove, [this](const QPointF &p) {
@@ -75,10 +95,17 @@ map_graphicsview::map_graphicsview(appdata_t &a)
   });
 }
 
+map_graphicsview::~map_graphicsview()
+{
+  autosave_wait();
+}
+
 void map_graphicsview::set_autosave(bool enable)
 {
   if(enable)
     autosave.start();
-  else
+  else {
     autosave.stop();
+    autosave_wait();
+  }
 }
@@ -8,18 +8,37 @@
 
 #include <map.h>
 
+#include <memory>
 #include <QTimer>
+#include <thread>
 
+class diff_snapshot;
 class QGraphicsView;
 
 class map_graphicsview : public map_t {
 public:
   map_graphicsview(appdata_t &a);
-  ~map_graphicsview() override = default;
+  ~map_graphicsview() override;
 
   void set_autosave(bool enable) override;
 
 private:
   QTimer autosave;
   QGraphicsView * const view;
+  std::thread autosaveWorker;                  ///< the thread writing the last diff snapshot
+  std::shared_ptr<diff_snapshot> autosaveData; ///< the snapshot, also referenced by the running thread
+
+  void map_autosave();
+
+  /**
+   * @brief write the current changes in the background
+   *
+   * If the previous write has not finished yet nothing is done.
+   */
+  void autosave_diff();
+
+  /**
+   * @brief wait until a pending background write has finished
+   */
+  void autosave_wait();
 };
@@ -103,14 +103,8 @@ relation_item_list_widget(relitem_context_t &context)
   view->resizeColumnsToContents();
   view->verticalHeader()->hide();
 
-  const int rc = model->rowCount(QModelIndex());
-  for (int i = 0; i < rc; i++) {
-    auto idx = model->index(i, RELITEM_COL_MEMBER);
-    if (idx.data(Qt::CheckStateRole).value<Qt::CheckState>() == Qt::Checked) {
-      view->scrollTo(idx);
-      break;
-    }
-  }
+  if (const QModelIndex idx = model->firstMemberIndex(); idx.isValid())
+    view->scrollTo(idx);
 
   return view;
 }
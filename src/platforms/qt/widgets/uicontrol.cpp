@@ -16,6 +16,7 @@
 #include <QLabel>
 #include <QMainWindow>
 #include <QMenu>
+#include <QProgressDialog>
 #include <QStatusBar>
 
 #include "osm2go_annotations.h"
@@ -104,6 +105,7 @@ void MainUiQt::clearNotification(NotificationFlags flags)
   if (flags & Busy) {
     statusbar->removeWidget(m_permanentMessage);
     delete m_permanentMessage;
+    delete m_progress;
     QGuiApplication::restoreOverrideCursor();
   }
   if (flags & ClearNormal) {
@@ -142,6 +144,34 @@ void MainUiQt::showMessage(unsigned int flags, const QString &message)
   }
 }
 
+bool MainUi::showProgress(trstring::native_type_arg message, float fraction)
+{
+  assert(!message.isEmpty());
+  return static_cast<MainUiQt *>(this)->updateProgress(message, fraction);
+}
+
+bool MainUiQt::updateProgress(const QString &message, float fraction)
+{
+  if (m_progress.isNull()) {
+    m_progressCancelled = false;
+    m_progress = new QProgressDialog(appdata_t::window);
+    m_progress->setWindowModality(Qt::WindowModal);
+    m_progress->setMinimumDuration(0);
+    QObject::connect(m_progress, &QProgressDialog::canceled, [this]() { m_progressCancelled = true; });
+  }
+
+  m_progress->setLabelText(message);
+  if (fraction < 0) {
+    // shows a busy indicator
+    m_progress->setRange(0, 0);
+  } else {
+    m_progress->setRange(0, 100);
+    m_progress->setValue(qRound(fraction * 100));
+  }
+
+  return !m_progressCancelled;
+}
+
 void MainUiQt::about_box()
 {
   abort(); // FIXME
@@ -67,6 +67,74 @@ void pos_t::toXmlProperties(xmlNodePtr node) const {
   xml_add_prop_coord(node, "lon", lon);
 }
 
+static void xml_write_attr_coord(xmlTextWriterPtr writer, const char *key, pos_float_t val)
+{
+  char str[16];
+  format_float(val, 7, str);
+  xmlTextWriterWriteAttribute(writer, BAD_CAST key, BAD_CAST str);
+}
+
+void pos_t::toXmlProperties(xmlTextWriterPtr writer) const {
+  xml_write_attr_coord(writer, "lat", lat);
+  xml_write_attr_coord(writer, "lon", lon);
+}
+
+// same rounding as format_float() so the written values do not depend on the storage format
+static int32_t pos_to_fixed(pos_float_t val)
+{
+  if(unlikely(std::isnan(val)))
+    return pos_fixed_t::invalid;
+  for(unsigned int k = 7; k > 0; k--)
+    val *= 10;
+  return static_cast<int32_t>(lround(val));
+}
+
+static pos_float_t pos_from_fixed(int32_t val)
+{
+  if(unlikely(val == pos_fixed_t::invalid))
+    return NAN;
+  return static_cast<pos_float_t>(val) / 10000000;
+}
+
+static void xml_add_prop_fixed(xmlNodePtr node, const char *key, int32_t val)
+{
+  char str[16];
+  format_float_int(val, 7, str);
+  xmlNewProp(node, BAD_CAST key, BAD_CAST str);
+}
+
+static void xml_write_attr_fixed(xmlTextWriterPtr writer, const char *key, int32_t val)
+{
+  char str[16];
+  format_float_int(val, 7, str);
+  xmlTextWriterWriteAttribute(writer, BAD_CAST key, BAD_CAST str);
+}
+
+const int32_t pos_fixed_t::invalid;
+
+pos_fixed_t::pos_fixed_t(const pos_t &pos) noexcept
+  : lat(pos_to_fixed(pos.lat))
+  , lon(pos_to_fixed(pos.lon))
+{
+}
+
+pos_fixed_t::operator pos_t() const noexcept
+{
+  return pos_t(pos_from_fixed(lat), pos_from_fixed(lon));
+}
+
+void pos_fixed_t::toXmlProperties(xmlNodePtr node) const
+{
+  xml_add_prop_fixed(node, "lat", lat);
+  xml_add_prop_fixed(node, "lon", lon);
+}
+
+void pos_fixed_t::toXmlProperties(xmlTextWriterPtr writer) const
+{
+  xml_write_attr_fixed(writer, "lat", lat);
+  xml_write_attr_fixed(writer, "lon", lon);
+}
+
 pos_t pos_t::fromXmlProperties(xmlNodePtr node, const char *latName, const char *lonName)
 {
   return pos_t(xml_get_prop_float(node, latName),
@@ -110,6 +178,200 @@ bool bounds_t::contains(lpos_t pos) const noexcept {
   return true;
 }
 
+/*
+ * Approximations of the math functions needed for the batch projections.
+ * They are written without branches, library calls, and conversions between
+ * double and 64 bit integers so the loops using them can be vectorized even
+ * with plain SSE2. The arguments are expected to be in the range needed for the Mercator
+ * projection, there is no handling of special values.
+ */
+
+// adding this moves the integer part of a double into the low bits of the mantissa
+static const double round_shifter = 6755399441055744.0; // 1.5 * 2^52
+
+static inline double bits_to_double(uint64_t bits)
+{
+  double d;
+  memcpy(&d, &bits, sizeof(d));
+  return d;
+}
+
+static inline uint64_t double_to_bits(double d)
+{
+  uint64_t bits;
+  memcpy(&bits, &d, sizeof(bits));
+  return bits;
+}
+
+/**
+ * @brief select one of 2 values depending on a comparison of non-negative numbers
+ * @returns a if v > limit, b otherwise
+ *
+ * This compares the bit patterns as integers. The compiler does not vectorize
+ * floating point comparisons as they may raise an exception.
+ */
+static inline double select_greater(double v, double limit, double a, double b)
+{
+  const uint64_t mask = 0 - ((double_to_bits(limit) - double_to_bits(v)) >> 63);
+  return bits_to_double((double_to_bits(a) & mask) | (double_to_bits(b) & ~mask));
+}
+
+/**
+ * @brief natural logarithm for positive values
+ */
+static inline double approx_log(double v)
+{
+  // split into mantissa in [1, 2) and exponent
+  const uint64_t bits = double_to_bits(v);
+  const double e = bits_to_double((bits >> 52) | 0x4330000000000000ULL) - (4503599627370496.0 + 1023);
+  const double m = bits_to_double((bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL);
+
+  // move the mantissa into [sqrt(0.5), sqrt(2)) so the series converges fast
+  const double mr = select_greater(m, M_SQRT2, m * 0.5, m);
+  const double er = select_greater(m, M_SQRT2, e + 1, e);
+
+  // log(m) = 2 * atanh(z), |z| <= 0.172
+  const double z = (mr - 1) / (mr + 1);
+  const double z2 = z * z;
+  double p = 1.0 / 19;
+  p = p * z2 + 1.0 / 17;
+  p = p * z2 + 1.0 / 15;
+  p = p * z2 + 1.0 / 13;
+  p = p * z2 + 1.0 / 11;
+  p = p * z2 + 1.0 / 9;
+  p = p * z2 + 1.0 / 7;
+  p = p * z2 + 1.0 / 5;
+  p = p * z2 + 1.0 / 3;
+  p = p * z2 + 1.0;
+
+  return er * M_LN2 + 2 * z * p;
+}
+
+/**
+ * @brief exponential function for arguments of moderate size
+ */
+static inline double approx_exp(double t)
+{
+  // t = k * log(2) + r, |r| <= log(2) / 2
+  const double shifted = t * M_LOG2E + round_shifter;
+  const double k = shifted - round_shifter;
+  // log(2) split in 2 parts so k * ln2_hi is exact
+  const double ln2_hi = 6.93147180369123816490e-01;
+  const double ln2_lo = 1.90821492927058770002e-10;
+  const double r = (t - k * ln2_hi) - k * ln2_lo;
+
+  double p = 1.0 + r / 13;
+  p = 1.0 + r / 12 * p;
+  p = 1.0 + r / 11 * p;
+  p = 1.0 + r / 10 * p;
+  p = 1.0 + r / 9 * p;
+  p = 1.0 + r / 8 * p;
+  p = 1.0 + r / 7 * p;
+  p = 1.0 + r / 6 * p;
+  p = 1.0 + r / 5 * p;
+  p = 1.0 + r / 4 * p;
+  p = 1.0 + r / 3 * p;
+  p = 1.0 + r / 2 * p;
+  p = 1.0 + r * p;
+
+  // the low bits of shifted contain k, put it into the exponent to get 2^k
+  const double scale = bits_to_double((double_to_bits(shifted) + 1023) << 52);
+
+  return p * scale;
+}
+
+/**
+ * @brief arcus tangens for arguments in [-1, 1]
+ */
+static inline double approx_atan(double z)
+{
+  const double tan_pi_8 = 0.41421356237309504880; // sqrt(2) - 1
+  const double tan_pi_16 = 0.19891236737965800691;
+
+  // atan(a) = pi/4 + atan((a - 1) / (a + 1)) reduces a to [-tan(pi/8), tan(pi/8)]
+  const double a = std::fabs(z);
+  const double a1 = select_greater(a, tan_pi_8, (a - 1) / (a + 1), a);
+  const double off1 = select_greater(a, tan_pi_8, M_PI_4, 0.0);
+
+  // atan(b) = pi/8 + atan((b - tan(pi/8)) / (1 + b * tan(pi/8))) reduces b to [-tan(pi/16), tan(pi/16)]
+  const double b = std::fabs(a1);
+  const double b1 = select_greater(b, tan_pi_16, (b - tan_pi_8) / (1 + b * tan_pi_8), b);
+  const double off2 = select_greater(b, tan_pi_16, M_PI_4 / 2, 0.0);
+
+  // atan(x) = x - x^3/3 + x^5/5 - ...
+  const double x2 = b1 * b1;
+  double p = -1.0 / 19;
+  p = p * x2 + 1.0 / 17;
+  p = p * x2 - 1.0 / 15;
+  p = p * x2 + 1.0 / 13;
+  p = p * x2 - 1.0 / 11;
+  p = p * x2 + 1.0 / 9;
+  p = p * x2 - 1.0 / 7;
+  p = p * x2 + 1.0 / 5;
+  p = p * x2 - 1.0 / 3;
+
+  const double res2 = std::copysign(off2 + b1 + b1 * x2 * p, a1);
+  return std::copysign(off1 + res2, z);
+}
+
+/**
+ * @brief log(tan(pi/4 + phi/2)) for the latitude phi in radians, i.e. the Mercator y coordinate
+ */
+static inline double approx_mercator_y(double phi)
+{
+  // tan(pi/4 + v) = (cos(v) + sin(v)) / (cos(v) - sin(v)), |v| <= pi/4
+  const double v = phi / 2;
+  const double v2 = v * v;
+
+  double sn = 1.0 - v2 / 272;
+  sn = 1.0 - v2 / 210 * sn;
+  sn = 1.0 - v2 / 156 * sn;
+  sn = 1.0 - v2 / 110 * sn;
+  sn = 1.0 - v2 / 72 * sn;
+  sn = 1.0 - v2 / 42 * sn;
+  sn = 1.0 - v2 / 20 * sn;
+  sn = v * (1.0 - v2 / 6 * sn);
+
+  double cs = 1.0 - v2 / 240;
+  cs = 1.0 - v2 / 182 * cs;
+  cs = 1.0 - v2 / 132 * cs;
+  cs = 1.0 - v2 / 90 * cs;
+  cs = 1.0 - v2 / 56 * cs;
+  cs = 1.0 - v2 / 30 * cs;
+  cs = 1.0 - v2 / 12 * cs;
+  cs = 1.0 - v2 / 2 * cs;
+
+  return approx_log((cs + sn) / (cs - sn));
+}
+
+void bounds_t::project(const pos_float_t *lat, const pos_float_t *lon, int *x, int *y, size_t count) const
+{
+  // keep the intermediate conversions to int of pos_t::toLpos()
+  for(size_t i = 0; i < count; i++) {
+    const int px = POS_EQ_RADIUS * DEG2RAD(lon[i]);
+    x[i] = (px - center.x) * scale;
+  }
+  for(size_t i = 0; i < count; i++) {
+    const int py = POS_EQ_RADIUS * approx_mercator_y(DEG2RAD(lat[i]));
+    y[i] = (-py + center.y) * scale;
+  }
+}
+
+void bounds_t::unproject(const int *x, const int *y, pos_float_t *lat, pos_float_t *lon, size_t count) const
+{
+  // same intermediate precision as lpos_t::toPos()
+  for(size_t i = 0; i < count; i++) {
+    const float fx = (x[i] / scale) + center.x;
+    lon[i] = RAD2DEG(fx / POS_EQ_RADIUS);
+  }
+  for(size_t i = 0; i < count; i++) {
+    const float fy = (-y[i] / scale) + center.y;
+    // 2 * atan(exp(t)) - pi/2 = 2 * atan(tanh(t / 2))
+    const double w = approx_exp(fy / POS_EQ_RADIUS);
+    lat[i] = RAD2DEG(2 * approx_atan((w - 1) / (w + 1)));
+  }
+}
+
 bool bounds_t::init(const pos_area &area)
 {
   ll = area;
@@ -16,8 +16,10 @@ typedef double pos_float_t;
 #ifdef __cplusplus
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <libxml/tree.h>
 #include <libxml/xmlreader.h>
+#include <libxml/xmlwriter.h>
 #include <string>
 
 #include <osm2go_cpp.h>
@@ -60,6 +62,7 @@ struct pos_t {
   lpos_t toLpos(const bounds_t &bounds) const;
 
   void toXmlProperties(xmlNodePtr node) const;
+  void toXmlProperties(xmlTextWriterPtr writer) const;
 
   static pos_t fromXmlProperties(xmlNodePtr node,
                                  const char *latName = "lat", const char *lonName = "lon");
@@ -115,6 +118,39 @@ struct pos_area {
   std::string print() const;
 };
 
+/**
+ * @brief global position stored as fixed point values
+ *
+ * The coordinates are stored in units of 1e-7 degrees, the precision the OSM
+ * API uses. This takes half the memory of pos_t and writes back exactly the
+ * values that were read.
+ */
+struct pos_fixed_t {
+  int32_t lat, lon;
+
+  inline pos_fixed_t() noexcept {}
+  // implicit on purpose so this can be used as a drop-in replacement for pos_t
+  pos_fixed_t(const pos_t &pos) noexcept;
+  operator pos_t() const noexcept;
+
+  inline bool operator==(const pos_fixed_t &other) const noexcept
+  { return lat == other.lat && lon == other.lon; }
+  inline bool operator!=(const pos_fixed_t &other) const noexcept
+  { return !operator==(other); }
+  inline bool valid() const noexcept
+  { return static_cast<pos_t>(*this).valid(); }
+
+  inline lpos_t toLpos(const bounds_t &bounds) const;
+
+  void toXmlProperties(xmlNodePtr node) const;
+  void toXmlProperties(xmlTextWriterPtr writer) const;
+
+  /**
+   * @brief value used for coordinates that are not a number
+   */
+  static const int32_t invalid = INT32_MIN;
+};
+
 /* local position */
 struct lpos_t {
   lpos_t() noexcept {}
@@ -137,8 +173,40 @@ struct bounds_t {
   float scale;
   bool contains(lpos_t pos) const noexcept;
   bool init(const pos_area &area);
+
+  /**
+   * @brief calculate the screen coordinates of many positions at once
+   * @param lat the latitudes of the positions
+   * @param lon the longitudes of the positions
+   * @param x where to store the resulting x coordinates
+   * @param y where to store the resulting y coordinates
+   * @param count number of entries in all arrays
+   *
+   * This uses polynomial approximations that the compiler can vectorize
+   * instead of the math library functions used by pos_t::toLpos(bounds). The
+   * results differ from those by at most 1 for latitudes up to +/-89 degrees.
+   */
+  void project(const pos_float_t *lat, const pos_float_t *lon, int *x, int *y, size_t count) const;
+
+  /**
+   * @brief calculate the global coordinates of many screen positions at once
+   * @param x the x coordinates of the positions
+   * @param y the y coordinates of the positions
+   * @param lat where to store the resulting latitudes
+   * @param lon where to store the resulting longitudes
+   * @param count number of entries in all arrays
+   *
+   * This is the counterpart of project(), the results differ from those of
+   * lpos_t::toPos() by less than 1e-9 degrees.
+   */
+  void unproject(const int *x, const int *y, pos_float_t *lat, pos_float_t *lon, size_t count) const;
 };
 
+inline lpos_t pos_fixed_t::toLpos(const bounds_t &bounds) const
+{
+  return static_cast<pos_t>(*this).toLpos(bounds);
+}
+
 void pos_lat_str(char *str, size_t len, pos_float_t latitude);
 static inline void pos_lon_str(char *str, size_t len, pos_float_t longitude)
 {
@@ -14,6 +14,7 @@
 #include "misc.h"
 #include "net_io.h"
 #include "notifications.h"
+#include <osm2go_log.h>
 #include "osm2go_platform.h"
 #include "settings.h"
 #include "track.h"
@@ -21,16 +22,21 @@
 #include "wms.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cerrno>
+#include <chrono>
+#include <condition_variable>
 #include <cstring>
 #include <dirent.h>
 #include <fcntl.h>
 #include <libxml/parser.h>
 #include <libxml/tree.h>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <sys/stat.h>
+#include <thread>
 #include <unistd.h>
 
 #include <string_view.hpp>
@@ -62,7 +68,7 @@ bool project_read(const std::string &project_file, project_t::ref project,
 
   /* parse the file and get the DOM */
   if(unlikely(!doc)) {
-    fprintf(stderr, "error: could not parse file %s\n", project_file.c_str());
+    OSM2GO_LOG(Project, Error, "could not parse file %s", project_file.c_str());
     return false;
   }
 
@@ -82,11 +88,11 @@ bool project_read(const std::string &project_file, project_t::ref project,
           if(strcmp(reinterpret_cast<const char *>(node->name), "desc") == 0) {
             xmlString desc(xmlNodeListGetString(doc.get(), node->children, 1));
             project->desc = static_cast<const char *>(desc);
-            printf("desc = %s\n", desc.get());
+            OSM2GO_LOG(Project, Debug, "desc = %s", desc.get());
           } else if(strcmp(reinterpret_cast<const char *>(node->name), "server") == 0) {
             xmlString str(xmlNodeListGetString(doc.get(), node->children, 1));
             project->adjustServer(str, defaultserver);
-            printf("server = %s\n", project->server(defaultserver).c_str());
+            OSM2GO_LOG(Project, Debug, "server = %s", project->server(defaultserver).c_str());
           } else if(strcmp(reinterpret_cast<const char *>(node->name), "map") == 0) {
             xmlString str(xmlGetProp(node, BAD_CAST "zoom"));
             if(str)
@@ -113,6 +119,19 @@ bool project_read(const std::string &project_file, project_t::ref project,
             if(!str.empty())
               project->wms_server += static_cast<const char *>(str);
 
+            str.reset(xmlGetProp(node, BAD_CAST "layers"));
+            if(!str.empty()) {
+              project->wms_layers = static_cast<const char *>(str);
+
+              str.reset(xmlGetProp(node, BAD_CAST "srs"));
+              if(!str.empty())
+                project->wms_srs = static_cast<const char *>(str);
+
+              str.reset(xmlGetProp(node, BAD_CAST "format"));
+              if(!str.empty())
+                project->wms_format = static_cast<const char *>(str);
+            }
+
             str.reset(xmlGetProp(node, BAD_CAST "x-offset"));
             if(!str.empty())
               project->wms_offset.x = strtoul(str, nullptr, 10);
@@ -123,7 +142,7 @@ bool project_read(const std::string &project_file, project_t::ref project,
           } else if(strcmp(reinterpret_cast<const char *>(node->name), "osm") == 0) {
             xmlString str(xmlNodeListGetString(doc.get(), node->children, 1));
             if(likely(!str.empty())) {
-              printf("osm = %s\n", str.get());
+              OSM2GO_LOG(Project, Debug, "osm = %s", str.get());
 
               /* make this a relative path if possible */
               /* if the project path actually is a prefix of this, */
@@ -131,7 +150,7 @@ bool project_read(const std::string &project_file, project_t::ref project,
               if(str.get()[0] == '/' && strlen(str) > project->path.size() &&
                  !strncmp(str, project->path.c_str(), project->path.size())) {
                 project->osmFile = reinterpret_cast<char *>(str.get() + project->path.size());
-                printf("osm name converted to relative %s\n", project->osmFile.c_str());
+                OSM2GO_LOG(Project, Info, "osm name converted to relative %s", project->osmFile.c_str());
               } else
                 project->osmFile = static_cast<const char *>(str);
             }
@@ -146,7 +165,7 @@ bool project_read(const std::string &project_file, project_t::ref project,
   }
 
   if(!hasProj) {
-    fprintf(stderr, "error: file %s does not contain <proj> element\n", project_file.c_str());
+    OSM2GO_LOG(Project, Error, "file %s does not contain <proj> element", project_file.c_str());
     return false;
   }
 
@@ -166,7 +185,7 @@ bool project_t::save(osm2go_platform::Widget *parent) {
   char str[16];
   const std::string &project_file = project_filename(*this);
 
-  printf("saving project to %s\n", project_file.c_str());
+  OSM2GO_LOG(Project, Info, "saving project to %s", project_file.c_str());
 
   /* check if project path exists */
   if(unlikely(!dirfd.valid())) {
@@ -223,6 +242,11 @@ bool project_t::save(osm2go_platform::Widget *parent) {
     node = xmlNewChild(root_node, nullptr, BAD_CAST "wms", nullptr);
     if(!wms_server.empty())
       xmlNewProp(node, BAD_CAST "server", BAD_CAST wms_server.c_str());
+    if(!wms_layers.empty()) {
+      xmlNewProp(node, BAD_CAST "layers", BAD_CAST wms_layers.c_str());
+      xmlNewProp(node, BAD_CAST "srs", BAD_CAST wms_srs.c_str());
+      xmlNewProp(node, BAD_CAST "format", BAD_CAST wms_format.c_str());
+    }
     snprintf(str, sizeof(str), "%d", wms_offset.x);
     xmlNewProp(node, BAD_CAST "x-offset", BAD_CAST str);
     snprintf(str, sizeof(str), "%d", wms_offset.y);
@@ -240,6 +264,7 @@ static void swap_project(project_t *one, project_t *other)
   one->name.swap(other->name);
   one->osmFile.swap(other->osmFile);
   one->dirfd.swap(other->dirfd);
+  one->diffState.swap(other->diffState);
   one->rserver.swap(other->rserver);
 }
 
@@ -287,8 +312,9 @@ bool project_t::rename(const std::string &nname, project_t::ref global, osm2go_p
     return false;
   }
 
-  // track
-  if(linkat(tmpproj->dirfd, (tmpproj->name + ".trk").c_str(), dirfd.fd, (nname + ".trk").c_str(), 0) != 0 && errno != ENOENT) {
+  // track, either as log or as GPX written by older versions
+  if((linkat(tmpproj->dirfd, (tmpproj->name + ".trklog").c_str(), dirfd.fd, (nname + ".trklog").c_str(), 0) != 0 && errno != ENOENT) ||
+     (linkat(tmpproj->dirfd, (tmpproj->name + ".trk").c_str(), dirfd.fd, (nname + ".trk").c_str(), 0) != 0 && errno != ENOENT)) {
     error_dlg(_("Unable to link OSM track file"), parent);
     swap_project(tmpproj.get(), this);
     project_delete(tmpproj);
@@ -307,7 +333,7 @@ bool project_t::rename(const std::string &nname, project_t::ref global, osm2go_p
 
     fdguard nfd(dup(dirfd));
     if(unlikely(!nfd.valid()))
-      printf("Unable to dup project path fd, error %i", errno);
+      OSM2GO_LOG(Project, Error, "Unable to dup project path fd, error %i", errno);
 
     global->dirfd.swap(nfd);
   }
@@ -353,7 +379,7 @@ std::vector<project_t *> project_scan(const std::string &base_path, int base_pat
 
     std::string fullname = project_exists(base_path_fd, d->d_name);
     if(!fullname.empty()) {
-      printf("found project %s\n", d->d_name);
+      OSM2GO_LOG(Project, Debug, "found project %s", d->d_name);
 
       /* try to read project and append it to chain */
       std::unique_ptr<project_t> n(std::make_unique<project_t>(d->d_name, base_path));
@@ -369,7 +395,7 @@ std::vector<project_t *> project_scan(const std::string &base_path, int base_pat
 /* ------------------------- create a new project ---------------------- */
 
 void project_close(appdata_t &appdata) {
-  printf("closing current project\n");
+  OSM2GO_LOG(Project, Info, "closing current project");
 
   /* Save track and turn off the handler callback */
   track_save(appdata.project, appdata.track.track.get());
@@ -390,7 +416,7 @@ void project_close(appdata_t &appdata) {
 
 void project_delete(std::unique_ptr<project_t> &project)
 {
-  printf("deleting project \"%s\"\n", project->name.c_str());
+  OSM2GO_LOG(Project, Info, "deleting project \"%s\"", project->name.c_str());
 
   /* remove entire directory from disk */
   dirguard dir(project->path);
@@ -475,74 +501,236 @@ static project_t *project_open(const std::string &name)
   return project.release();
 }
 
-static bool project_load_inner(appdata_t &appdata, std::unique_ptr<project_t> &project)
+namespace {
+
+/**
+ * @brief loads the data of a project in background threads
+ *
+ * The OSM data is parsed, the diff is restored and the tag index is built in
+ * one thread while the track is read in another one. Nothing of this touches
+ * the user interface, the results are picked up by the main thread once
+ * finished() returns true. The only global state used is the string cache,
+ * which may be used from several threads.
+ */
+class project_loader {
+  project_t * const project;
+  std::atomic<unsigned int> running;  ///< the number of workers not yet done
+  std::atomic<bool> parsed;
+  std::mutex mutex;
+  std::condition_variable done;       ///< signalled when a worker finishes
+  std::thread osmWorker;
+  std::thread trackWorker;
+
+  void load_osm();
+  void load_track();
+  void workerFinished();
+
+public:
+  explicit project_loader(project_t *p);
+  project_loader() O2G_DELETED_FUNCTION;
+  project_loader(const project_loader &) O2G_DELETED_FUNCTION;
+  project_loader &operator=(const project_loader &) O2G_DELETED_FUNCTION;
+  ~project_loader();
+
+  osm_t::parse_progress progress;
+  trstring::native_type errmsg;     ///< the result of the OSM data sanity check
+  unsigned int diffFlags;           ///< the diff_restore_results
+  trstring diffMessage;             ///< the problem found while restoring the diff
+  std::unique_ptr<track_t> track;
+
+  inline bool finished() const
+  { return running == 0; }
+
+  /**
+   * @brief the part of the work already done, negative if unknown
+   */
+  float fraction() const;
+
+  inline void cancel()
+  { progress.cancel = true; }
+
+  /**
+   * @brief wait until all workers are done or the timeout expires
+   */
+  void wait(std::chrono::milliseconds timeout);
+
+  /**
+   * @brief wait for the workers to stop
+   */
+  void join();
+};
+
+project_loader::project_loader(project_t *p)
+  : project(p)
+  , running(2)
+  , parsed(false)
+  , diffFlags(DIFF_NONE_PRESENT)
 {
-  std::swap(appdata.project, project);
+  osmWorker = std::thread(&project_loader::load_osm, this);
+  trackWorker = std::thread(&project_loader::load_track, this);
+}
 
-  /* --------- project structure ok: load its OSM file --------- */
+project_loader::~project_loader()
+{
+  cancel();
+  join();
+}
 
-  if(!appdata.project->parse_osm()) {
-    appdata.uicontrol->showNotification(trstring("Error opening %1").arg(appdata.project->osmFile), MainUi::Brief);
-    return false;
-  }
+void project_loader::join()
+{
+  if(osmWorker.joinable())
+    osmWorker.join();
+  if(trackWorker.joinable())
+    trackWorker.join();
+}
 
-  if(unlikely(!appdata.project->bounds.valid())) {
-    appdata.uicontrol->showNotification(trstring("Invalid project bounds in %1").arg(appdata.project->name), MainUi::Brief);
+void project_loader::workerFinished()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  running--;
+  done.notify_all();
+}
 
-    return false;
-  }
+void project_loader::wait(std::chrono::milliseconds timeout)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  done.wait_for(lock, timeout, [this]() { return finished(); });
+}
 
-  if(unlikely(appdata_t::window == nullptr))
-    return false;
+void project_loader::load_osm()
+{
+  project->osm.reset(osm_t::parse(project->path, project->osmFile, &progress));
+  parsed = true;
 
-  /* check if OSM data is valid */
-  osm2go_platform::process_events();
-  trstring::native_type errmsg = appdata.project->osm->sanity_check();
-  if(unlikely(!errmsg.isEmpty())) {
-    error_dlg(errmsg);
-    printf("project/osm sanity checks failed (%s), unloading project\n", errmsg.toStdString().c_str());
+  if(likely(project->osm) && !progress.cancel) {
+    errmsg = project->osm->sanity_check();
+    if(likely(errmsg.isEmpty())) {
+      diffFlags = project->diff_restore(&diffMessage);
 
-    return false;
+      // e.g. the object names search relations by their tags
+      project->osm->buildTagIndex();
+    }
   }
 
-  /* load diff possibly preset */
-  osm2go_platform::process_events();
-  if(unlikely(appdata_t::window == nullptr))
-    return false;
+  workerFinished();
+}
 
-  diff_restore(appdata.project, appdata.uicontrol.get());
+void project_loader::load_track()
+{
+  track.reset(track_load(*project));
 
-  /* prepare colors etc, draw data and adjust scroll/zoom settings */
-  osm2go_platform::process_events();
-  if(unlikely(appdata_t::window == nullptr))
-    return false;
+  workerFinished();
+}
 
-  appdata.map->init();
+float project_loader::fraction() const
+{
+  // reading the file takes by far the most time
+  if(parsed)
+    return 0.9f;
 
-  /* restore a track */
-  osm2go_platform::process_events();
-  if(unlikely(appdata_t::window == nullptr))
-    return false;
+  const float f = progress.fraction;
+  return f < 0 ? f : f * 0.8f;
+}
 
-  appdata.track_clear();
-  if(track_restore(appdata))
+} // namespace
+
+static bool project_load_inner(appdata_t &appdata, std::unique_ptr<project_t> &project)
+{
+  // the project only becomes the current one once it is completely loaded,
+  // until then it is only used by the loader threads
+  std::unique_ptr<project_t> loading;
+  loading.swap(project);
+
+  bool cancelled = false;
+  {
+    project_loader loader(loading.get());
+
+    /* keep the interface responsive while the data is loaded in the background */
+    bool progressShown = false;
+    const bool hasWindow = appdata_t::window != nullptr;
+    while(!loader.finished()) {
+      if(hasWindow && appdata_t::window == nullptr) {
+        // the application is shutting down
+        loader.cancel();
+        cancelled = true;
+      } else if(hasWindow && !cancelled) {
+        progressShown = true;
+        if(!appdata.uicontrol->showProgress(trstring("Loading %1").arg(loading->name), loader.fraction())) {
+          OSM2GO_LOG(Project, Info, "loading of project \"%s\" cancelled", loading->name.c_str());
+          loader.cancel();
+          cancelled = true;
+        }
+      }
+
+      osm2go_platform::process_events();
+      loader.wait(std::chrono::milliseconds(50));
+    }
+    loader.join();
+
+    if(progressShown)
+      appdata.uicontrol->clearNotification(MainUi::Busy);
+
+    if(unlikely(cancelled))
+      return false;
+
+    /* --------- project structure ok: check its OSM data --------- */
+
+    if(!loading->osm) {
+      appdata.uicontrol->showNotification(trstring("Error opening %1").arg(loading->osmFile), MainUi::Brief);
+      return false;
+    }
+
+    if(unlikely(!loading->bounds.valid())) {
+      appdata.uicontrol->showNotification(trstring("Invalid project bounds in %1").arg(loading->name), MainUi::Brief);
+
+      return false;
+    }
+
+    if(unlikely(appdata_t::window == nullptr))
+      return false;
+
+    /* check if OSM data is valid */
+    if(unlikely(!loader.errmsg.isEmpty())) {
+      error_dlg(loader.errmsg);
+      OSM2GO_LOG(Project, Warning, "project/osm sanity checks failed (%s), unloading project", loader.errmsg.toStdString().c_str());
+
+      return false;
+    }
+
+    std::swap(appdata.project, loading);
+
+    diff_restore_notify(loader.diffFlags, appdata.uicontrol.get(), loader.diffMessage);
+
+    /* the track has been read at the same time */
+    appdata.track_clear();
+    appdata.track.track.swap(loader.track);
+  }
+
+  /* prepare colors etc, draw the visible area and adjust scroll/zoom settings */
+  appdata.map->init();
+
+  track_menu_set(appdata);
+  if(appdata.track.track)
     appdata.map->track_draw(settings_t::instance()->trackVisibility, *appdata.track.track);
 
   /* finally load a background if present */
-  osm2go_platform::process_events();
-  if(unlikely(appdata_t::window == nullptr))
-    return false;
-
-  std::string wmsfn = wms_find_file(appdata.project->path);
-  if (!wmsfn.empty())
-    appdata.map->set_bg_image(wmsfn,
-                              osm2go_platform::screenpos(project->wms_offset.x, project->wms_offset.y));
+  const osm2go_platform::screenpos wmsoffset(appdata.project->wms_offset.x, appdata.project->wms_offset.y);
+  if(!appdata.project->wms_layers.empty()) {
+    appdata.map->set_bg_tiles(wmsoffset);
+  } else {
+    std::string wmsfn = wms_find_file(appdata.project->path);
+    if (!wmsfn.empty())
+      appdata.map->set_bg_image(wmsfn, wmsoffset);
+  }
 
   /* save the name of the project for the perferences */
   settings_t::instance()->project = appdata.project->name;
 
   appdata.uicontrol->clearNotification(MainUi::ClearBoth);
 
+  /* the user can already work with the map while the rest is drawn */
+  appdata.map->paint_remaining();
+
   return true;
 }
 
@@ -618,6 +806,7 @@ project_t::project_t(const std::string &n, nonstd::string_view base_path)
   , data_dirty(false)
   , isDemo(false)
   , dirfd(path.c_str())
+  , diffState(std::make_shared<diff_file_state>())
 {
   memset(&wms_offset, 0, sizeof(wms_offset));
 }
@@ -629,6 +818,7 @@ project_t::project_t(project_t &other)
   , data_dirty(other.data_dirty)
   , isDemo(other.isDemo)
   , dirfd(-1)
+  , diffState(std::make_shared<diff_file_state>())
 {
   swap_project(this, &other);
 }
@@ -20,6 +20,8 @@
 #include <osm2go_stl.h>
 
 struct appdata_t;
+class diff_snapshot;
+struct diff_file_state;
 class osm_t;
 
 struct project_t {
@@ -68,12 +70,16 @@ struct project_t {
   std::string rserver;
 
   std::string wms_server;
+  std::string wms_layers;   ///< the layers of a tiled WMS background
+  std::string wms_srs;
+  std::string wms_format;
 
   bool data_dirty;     // needs to download new data
   bool isDemo;         // if this is the demo project
   fdguard dirfd;       // filedescriptor of path
 
   std::unique_ptr<osm_t> osm;          ///< the OSM data
+  std::shared_ptr<diff_file_state> diffState; ///< shared with pending diff snapshots
 
   /**
    * @brief parse the OSM data file
@@ -125,14 +131,26 @@ struct project_t {
 
   /**
    * @brief save the changed data to storage
+   *
+   * This is the same as writing a snapshot immediately.
    */
   void diff_save() const;
 
+  /**
+   * @brief collect the changed data for saving it later
+   * @returns the serialized changes
+   * @retval nullptr no OSM data is loaded or serializing failed
+   *
+   * The returned object can be written from a background thread.
+   */
+  diff_snapshot *diff_collect() const __attribute__((warn_unused_result));
+
   /**
    * @brief restore changes from storage
+   * @param message if given problems are stored here instead of being shown
    * @returns status values from enum diff_restore_results
    */
-  unsigned int diff_restore();
+  unsigned int diff_restore(trstring *message = nullptr);
 
   /**
    * @brief create an empty project and save it to disk
@@ -29,6 +29,7 @@
 #include "osm2go_annotations.h"
 #include <osm2go_cpp.h>
 #include <osm2go_i18n.h>
+#include <osm2go_log.h>
 #include "osm2go_stl.h"
 
 #if !defined(LIBXML_TREE_ENABLED) || !defined(LIBXML_OUTPUT_ENABLED)
@@ -150,7 +151,7 @@ void parse_style_node(xmlNode *a_node, xmlString *fname, style_t &style)
         parse_color(cur_node, "color", style.background.color);
 
       } else
-        printf("  found unhandled style/%s\n", cur_node->name);
+        OSM2GO_LOG(Style, Debug, "  found unhandled style/%s", cur_node->name);
     }
   }
 
@@ -175,7 +176,7 @@ bool style_parse(const std::string &fullname, xmlString *fname, style_t &style)
   /* parse the file and get the DOM */
   if(unlikely(!doc)) {
     const xmlError *errP = xmlGetLastError();
-    printf("parsing %s failed: %s\n", fullname.c_str(), errP->message);
+    OSM2GO_LOG(Style, Warning, "parsing %s failed: %s", fullname.c_str(), errP->message);
   } else {
     for(xmlNode *cur_node = xmlDocGetRootElement(doc.get()); cur_node != nullptr;
         cur_node = cur_node->next) {
@@ -191,7 +192,7 @@ bool style_parse(const std::string &fullname, xmlString *fname, style_t &style)
             parse_style_node(cur_node, fname, style);
           }
         } else
-          printf("  found unhandled %s\n", cur_node->name);
+          OSM2GO_LOG(Style, Debug, "  found unhandled %s", cur_node->name);
       }
     }
   }
@@ -205,7 +206,7 @@ style_t *style_load_fname(const std::string &filename) {
   std::unique_ptr<josm_elemstyle> style(std::make_unique<josm_elemstyle>());
 
   if(likely(style_parse(filename, &fname, *style))) {
-    printf("  elemstyle filename: %s\n", static_cast<const char *>(fname));
+    OSM2GO_LOG(Style, Debug, "  elemstyle filename: %s", static_cast<const char *>(fname));
     if (style->load_elemstyles(fname))
       return style.release();
   }
@@ -215,20 +216,20 @@ style_t *style_load_fname(const std::string &filename) {
 
 style_t *style_t::load(const std::string &name)
 {
-  printf("Trying to load style %s\n", name.c_str());
+  OSM2GO_LOG(Style, Info, "Trying to load style %s", name.c_str());
 
   std::string fullname = find_file(name + ".style");
 
   if (unlikely(fullname.empty())) {
-    printf("style %s not found, trying %s instead\n", name.c_str(), DEFAULT_STYLE);
+    OSM2GO_LOG(Style, Warning, "style %s not found, trying %s instead", name.c_str(), DEFAULT_STYLE);
     fullname = find_file(DEFAULT_STYLE ".style");
     if (unlikely(fullname.empty())) {
-      printf("  style not found, failed to find fallback style too\n");
+      OSM2GO_LOG(Style, Error, "  style not found, failed to find fallback style too");
       return nullptr;
     }
   }
 
-  printf("  style filename: %s\n", fullname.c_str());
+  OSM2GO_LOG(Style, Debug, "  style filename: %s", fullname.c_str());
 
   return style_load_fname(fullname);
 }
@@ -312,7 +313,7 @@ static void unref_icon(const style_t::IconCache::value_type &pair)
 
 style_t::~style_t()
 {
-  printf("freeing style\n");
+  OSM2GO_LOG(Style, Debug, "freeing style");
 
   std::for_each(node_icons.begin(), node_icons.end(), unref_icon);
 }
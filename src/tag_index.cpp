@@ -0,0 +1,212 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Rolf Eike Beer <eike@sf-mail.de>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "tag_index.h"
+
+#include "memory_usage.h"
+#include "osm_objects.h"
+#include "osm_p.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "osm2go_annotations.h"
+#include <osm2go_cpp.h>
+
+tag_query_t::tag_query_t(const char *key, const char *value, unsigned int t)
+  : types(t)
+{
+  andTag(key, value);
+}
+
+tag_query_t &tag_query_t::andTag(const char *key, const char *value)
+{
+  assert(key != nullptr);
+  terms.push_back(condition(key, value));
+  return *this;
+}
+
+bool tag_query_t::resolve(std::vector<condition> &conditions) const
+{
+  conditions.clear();
+  conditions.reserve(terms.size());
+
+  for(size_t i = 0; i < terms.size(); i++) {
+    const char *key = value_cache.getValue(terms[i].first);
+    if(key == nullptr)
+      return false;
+    const char *value = nullptr;
+    if(terms[i].second != nullptr) {
+      value = value_cache.getValue(terms[i].second);
+      if(value == nullptr)
+        return false;
+    }
+    conditions.push_back(condition(key, value));
+  }
+
+  return true;
+}
+
+namespace {
+
+class condition_match_functor {
+  const tag_query_t::condition &cond;
+public:
+  explicit inline condition_match_functor(const tag_query_t::condition &c) : cond(c) {}
+  inline bool operator()(const tag_t &tag) const
+  { return tag.key_compare(cond.first) && (cond.second == nullptr || tag.value_compare(cond.second)); }
+};
+
+} // namespace
+
+bool tag_query_t::matches(const tag_list_t &tags, const std::vector<condition> &conditions)
+{
+  for(size_t i = 0; i < conditions.size(); i++)
+    if(!tags.contains(condition_match_functor(conditions[i])))
+      return false;
+
+  return true;
+}
+
+namespace {
+
+/**
+ * @brief collect the index entries for the tags of an object
+ */
+class tag_condition_collector {
+  std::vector<tag_query_t::condition> &conditions;
+public:
+  explicit inline tag_condition_collector(std::vector<tag_query_t::condition> &c) : conditions(c) {}
+  inline void operator()(const tag_t &tag)
+  {
+    conditions.push_back(tag_query_t::condition(tag.key, nullptr));
+    conditions.push_back(tag_query_t::condition(tag.key, tag.value));
+  }
+};
+
+/**
+ * @brief get the distinct index entries for the given object
+ *
+ * An object may have multiple tags with the same key, but it is only added
+ * once per key to the index.
+ */
+void objectConditions(const object_t &obj, std::vector<tag_query_t::condition> &conditions)
+{
+  conditions.clear();
+  static_cast<base_object_t *>(obj)->tags.for_each(tag_condition_collector(conditions));
+  std::sort(conditions.begin(), conditions.end());
+  conditions.erase(std::unique(conditions.begin(), conditions.end()), conditions.end());
+}
+
+inline item_id_t objectId(const object_t &obj)
+{
+  return static_cast<base_object_t *>(obj)->id;
+}
+
+bool objectLess(const object_t &a, const object_t &b)
+{
+  if(a.type != b.type)
+    return a.type < b.type;
+  return objectId(a) < objectId(b);
+}
+
+template<typename T>
+class index_builder {
+  tag_index_t &index;
+public:
+  explicit inline index_builder(tag_index_t &i) : index(i) {}
+  inline void operator()(const std::pair<item_id_t, T *> &pair)
+  {
+    if(!pair.second->tags.empty())
+      index.add(object_t(pair.second));
+  }
+};
+
+} // namespace
+
+tag_index_t::tag_index_t(const osm_t &osm)
+{
+  std::for_each(osm.nodes.begin(), osm.nodes.end(), index_builder<node_t>(*this));
+  std::for_each(osm.ways.begin(), osm.ways.end(), index_builder<way_t>(*this));
+  std::for_each(osm.relations.begin(), osm.relations.end(), index_builder<relation_t>(*this));
+}
+
+void tag_index_t::add(const object_t &obj)
+{
+  std::vector<tag_query_t::condition> conditions;
+  objectConditions(obj, conditions);
+
+  for(size_t i = 0; i < conditions.size(); i++) {
+    posting_list &list = postings[conditions[i]];
+    // while building the index the objects come in order, so this usually appends
+    list.insert(std::upper_bound(list.begin(), list.end(), obj, objectLess), obj);
+  }
+}
+
+void tag_index_t::postingRemove(posting_map::iterator it, const object_t &obj)
+{
+  posting_list &list = it->second;
+  const posting_list::iterator oit = std::lower_bound(list.begin(), list.end(), obj, objectLess);
+  assert(oit != list.end() && *oit == obj);
+  if(likely(oit != list.end() && *oit == obj))
+    list.erase(oit);
+}
+
+void tag_index_t::remove(const object_t &obj)
+{
+  std::vector<tag_query_t::condition> conditions;
+  objectConditions(obj, conditions);
+
+  for(size_t i = 0; i < conditions.size(); i++) {
+    const posting_map::iterator it = postings.find(conditions[i]);
+    assert(it != postings.end());
+    if(unlikely(it == postings.end()))
+      continue;
+    postingRemove(it, obj);
+    if(it->second.empty())
+      postings.erase(it);
+  }
+}
+
+std::vector<object_t> tag_index_t::find(const tag_query_t &query) const
+{
+  std::vector<object_t> ret;
+  std::vector<tag_query_t::condition> conditions;
+  if(!query.resolve(conditions))
+    return ret;
+
+  // start with the condition with the fewest objects, the others are checked on the objects
+  const posting_list *candidates = nullptr;
+  size_t best = 0;
+  for(size_t i = 0; i < conditions.size(); i++) {
+    const posting_map::const_iterator it = postings.find(conditions[i]);
+    if(it == postings.end())
+      return ret;
+    if(candidates == nullptr || it->second.size() < candidates->size()) {
+      candidates = &it->second;
+      best = i;
+    }
+  }
+  conditions.erase(conditions.begin() + best);
+
+  const posting_list::const_iterator itEnd = candidates->end();
+  for(posting_list::const_iterator it = candidates->begin(); it != itEnd; it++) {
+    if(!query.matchesType(it->type))
+      continue;
+    if(conditions.empty() || tag_query_t::matches(static_cast<base_object_t *>(*it)->tags, conditions))
+      ret.push_back(*it);
+  }
+
+  return ret;
+}
+
+size_t tag_index_t::memory_size() const
+{
+  size_t ret = memory_usage::heap(postings);
+  for(posting_map::const_iterator it = postings.begin(); it != postings.end(); it++)
+    ret += memory_usage::heap(it->second);
+  return ret;
+}
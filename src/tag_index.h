@@ -0,0 +1,131 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Rolf Eike Beer <eike@sf-mail.de>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include "osm.h"
+
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class tag_list_t;
+
+/**
+ * @brief a query for objects by their tags
+ *
+ * All conditions must match, i.e. they are combined with AND.
+ */
+class tag_query_t {
+public:
+  enum TypeFilter {
+    Nodes = 1 << object_t::NODE,
+    Ways = 1 << object_t::WAY,
+    Relations = 1 << object_t::RELATION,
+    AnyType = Nodes | Ways | Relations
+  };
+
+  /**
+   * @brief a key, or a key and value, mapped to the value cache
+   *
+   * value is nullptr if only the presence of the key is checked.
+   */
+  typedef std::pair<const char *, const char *> condition;
+
+  /**
+   * @brief constructor
+   * @param key the key that needs to be present
+   * @param value the value the key must have, nullptr to accept any value
+   * @param t the object types to search, a combination of TypeFilter
+   *
+   * The strings are only referenced, so they must stay valid as long as the query is used.
+   */
+  explicit tag_query_t(const char *key, const char *value = nullptr, unsigned int t = AnyType);
+
+  /**
+   * @brief add another condition that must match
+   */
+  tag_query_t &andTag(const char *key, const char *value = nullptr);
+
+  const unsigned int types;
+
+  inline bool matchesType(object_t::type_t type) const noexcept
+  { return (types & (1 << type)) != 0; }
+
+  /**
+   * @brief map the conditions to the value cache
+   * @returns if all strings are present in the cache
+   *
+   * If a string is not in the cache no object can match the query.
+   */
+  bool resolve(std::vector<condition> &conditions) const;
+
+  /**
+   * @brief check if the tags match all of the resolved conditions
+   */
+  static bool matches(const tag_list_t &tags, const std::vector<condition> &conditions);
+
+private:
+  std::vector<std::pair<const char *, const char *> > terms;
+};
+
+/**
+ * @brief maps the keys and key/value pairs of all objects to the objects using them
+ *
+ * The index only stores the objects, the keys and values are the pointers
+ * from the value cache, so building it does not copy any strings.
+ */
+class tag_index_t {
+  struct condition_hash {
+    inline size_t operator()(const tag_query_t::condition &c) const noexcept
+    { return std::hash<const char *>()(c.first) * 31 ^ std::hash<const char *>()(c.second); }
+  };
+
+  /// sorted like the results of find()
+  typedef std::vector<object_t> posting_list;
+  typedef std::unordered_map<tag_query_t::condition, posting_list, condition_hash> posting_map;
+
+  /// the objects per key (second is nullptr) and per key and value
+  posting_map postings;
+
+  static void postingRemove(posting_map::iterator it, const object_t &obj);
+
+public:
+  /**
+   * @brief create the index of all objects in osm
+   */
+  explicit tag_index_t(const osm_t &osm);
+
+  /**
+   * @brief add the current tags of the given object
+   */
+  void add(const object_t &obj);
+
+  /**
+   * @brief remove the current tags of the given object
+   *
+   * This must be called before the tags are changed.
+   */
+  void remove(const object_t &obj);
+
+  /**
+   * @brief find all objects matching the query
+   * @returns the objects sorted by type and id
+   */
+  std::vector<object_t> find(const tag_query_t &query) const;
+
+  /**
+   * @brief the number of distinct keys and key/value pairs in the index
+   */
+  inline size_t size() const
+  { return postings.size(); }
+
+  /**
+   * @brief the memory used by the index
+   */
+  size_t memory_size() const;
+};
@@ -10,6 +10,7 @@
 #endif
 
 #include "track.h"
+#include "track_p.h"
 
 #include "appdata.h"
 #include "fdguard.h"
@@ -22,6 +23,8 @@
 #include "uicontrol.h"
 
 #include <cassert>
+#include <cctype>
+#include <cerrno>
 #include <cmath>
 #include <cstring>
 #include <ctime>
@@ -42,15 +45,91 @@
 #include "osm2go_annotations.h"
 #include <osm2go_cpp.h>
 #include <osm2go_i18n.h>
+#include <osm2go_log.h>
 #include <osm2go_stl.h>
 
 /* format string used to altitude and time */
 #define DATE_FORMAT "%FT%T"
 
+/* the first line of every track log */
+#define TRACK_LOG_MAGIC "osm2go track log 1"
+
+/**
+ * @brief append-only on-disk log of a track
+ *
+ * Every record is a single line, so a crash while writing can only damage the
+ * last line of the file. The records are not synced to disk one by one, but
+ * in batches.
+ *
+ * The file starts with a line containing TRACK_LOG_MAGIC, then these records follow:
+ * @li "S": start of a new segment
+ * @li "P lat lon ele time": a point in the current segment, lat and lon in
+ *     1e-7 degrees, the elevation in cm or "-" if unknown, and the time in
+ *     seconds since the epoch
+ */
+class track_log_t {
+  fdguard fd;
+  unsigned int pending; ///< records written since the last sync
+  time_t lastSync;
+
+public:
+  enum {
+    SyncRecords = 30, ///< sync at least after this many records
+    SyncSeconds = 30  ///< sync at least after this many seconds
+  };
+
+  explicit track_log_t(int f);
+
+  bool write(const char *buf, size_t len, unsigned int records);
+  bool appendSegment()
+  { return write("S\n", 2, 1); }
+  bool appendPoint(const track_point_t &point);
+
+  /**
+   * @brief flush pending records to disk
+   * @param force sync even if the batch limits are not yet reached
+   */
+  void sync(bool force);
+
+  /**
+   * @brief format a point record
+   * @param buf the buffer to print to, must be at least 64 bytes
+   * @returns the length of the record
+   */
+  static size_t formatPoint(char *buf, const track_point_t &point);
+};
+
 namespace {
 
+// the input is UTF-8, so the bytes need to be converted before passing them to <cctype>
+inline bool is_space(char c)
+{
+  return isspace(static_cast<unsigned char>(c)) != 0;
+}
+
+inline bool is_digit(char c)
+{
+  return isdigit(static_cast<unsigned char>(c)) != 0;
+}
+
+/**
+ * @brief find the given string in the buffer
+ * @returns the start of the string or nullptr if it is not found
+ */
+inline const char *find_string(const char *p, const char *end, const char *needle, size_t len)
+{
+  const char *r = std::search(p, end, needle, needle + len);
+  return r == end ? nullptr : r;
+}
+
 class TrackSax : public SaxParser {
-  track_point_t *curPoint;
+  track_point_t curPoint;
+  unsigned int unknownDepth; ///< nesting level inside unknown elements
+
+  // times of consecutive points are usually in the same hour, so the result
+  // of mktime() for the start of that hour is cached
+  long cachedHour;
+  time_t cachedHourStart;
 
   enum State {
     DocStart,
@@ -84,15 +163,36 @@ class TrackSax : public SaxParser {
     }
   };
 
+  // buffers for the scanner, kept to avoid reallocations
+  std::string tagBuffer;
+  std::vector<std::string::size_type> attrOffsets;
+  std::vector<const char *> attrPointers;
+  std::vector<std::string> openTags;
+
 public:
   TrackSax();
 
   bool parse(const char *filename);
 
+  /**
+   * @brief parse the GPX data from memory
+   * @returns if the data could be handled
+   *
+   * This is a minimal XML tokenizer feeding the same callbacks as the SAX
+   * parser. It does not support entities, CDATA sections, DTDs, or encodings
+   * other than UTF-8 or ASCII. If those are found false is returned and the
+   * data has to be passed to the generic parser.
+   */
+  bool scan(const char *data, size_t len);
+
   std::unique_ptr<track_t> track;
-  std::vector<track_point_t>::size_type points;  ///< total points
+  track_point_list::size_type points;  ///< total points
 
 private:
+  void reset();
+  const char *scanStartTag(const char *p, const char *end);
+  bool parseTime(const char *str, time_t &t);
+
   void characters(const char *ch, int len) override;
   void startElement(const char *name, const char **attrs) override;
   void endElement(const char *name) override;
@@ -100,6 +200,46 @@ private:
 
 } // namespace
 
+double parse_decimal(const char *str)
+{
+  static const double pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+
+  const char *p = str;
+  const bool neg = (*p == '-');
+  if(neg || *p == '+')
+    p++;
+
+  uint64_t mantissa = 0;
+  unsigned int digits = 0;      // all digits
+  unsigned int significant = 0; // digits after the first non-zero one
+  unsigned int fraction = 0;    // digits after the dot
+  bool dot = false;
+  for(; significant <= 15; p++) {
+    if(*p >= '0' && *p <= '9') {
+      mantissa = mantissa * 10 + (*p - '0');
+      digits++;
+      if(mantissa != 0)
+        significant++;
+      if(dot)
+        fraction++;
+    } else if(*p == '.' && !dot) {
+      dot = true;
+    } else {
+      break;
+    }
+  }
+
+  if(unlikely(*p != '\0' || digits == 0 || significant > 15 || fraction >= sizeof(pow10) / sizeof(pow10[0])))
+    return osm2go_platform::string_to_double(str);
+
+  // both values are exactly representable, so the division is correctly rounded
+  const double r = static_cast<double>(mantissa) / pow10[fraction];
+  return neg ? -r : r;
+}
+
 /* make menu represent the track state */
 void track_menu_set(appdata_t &appdata) {
   if(unlikely(appdata_t::window == nullptr))
@@ -116,17 +256,35 @@ static track_t *track_read(const char *filename, bool dirty)
 {
   TrackSax sx;
   if(unlikely(!sx.parse(filename))) {
-    printf("track %s was empty/invalid track\n", filename);
+    OSM2GO_LOG(Track, Warning, "track %s was empty/invalid track", filename);
     return nullptr;
   }
 
   sx.track->dirty = dirty;
-  printf("Track %s is %sdirty, %zu points in %zu segments\n", filename, dirty ? "" : "not ",
+  OSM2GO_LOG(Track, Info, "Track %s is %sdirty, %zu points in %zu segments", filename, dirty ? "" : "not ",
     sx.points, sx.track->segments.size());
 
   return sx.track.release();
 }
 
+track_t *track_scan(const char *data, size_t len)
+{
+  TrackSax sx;
+  if(!sx.scan(data, len) || !sx.track || sx.track->segments.empty())
+    return nullptr;
+
+  return sx.track.release();
+}
+
+track_t *track_parse_sax(const char *filename)
+{
+  TrackSax sx;
+  if(!sx.parseFile(filename) || !sx.track || sx.track->segments.empty())
+    return nullptr;
+
+  return sx.track.release();
+}
+
 /* ----------------------  saving track --------------------------- */
 
 namespace {
@@ -174,168 +332,372 @@ void track_save_segs::save_point::operator()(const track_point_t &point) const
  * @brief write the track information to a GPX file
  * @param name the filename to write to
  * @param track the track data to write
- * @param xdoc previous xml
- *
- * If xdoc is given, the last track in xdoc is updated and all remaining ones
- * are appended. If xdoc is nullptr all tracks are saved.
- *
- * xdoc is freed.
  */
 void
-track_write(const char *name, const track_t *track, xmlDoc *xdoc)
-{
-  printf("writing track to %s\n", name);
-
-  xmlNodePtr trk_node;
-  std::vector<track_seg_t>::const_iterator it = track->segments.begin();
-  std::vector<track_seg_t>::const_iterator itEnd = track->segments.end();
-  xmlDocGuard doc(xdoc);
-  if(doc) {
-    xmlNodePtr cur_node;
-    xmlNodePtr root_node = xmlDocGetRootElement(doc.get());
-    bool err = false;
-    if (unlikely(!root_node || root_node->type != XML_ELEMENT_NODE ||
-                   strcasecmp(reinterpret_cast<const char *>(root_node->name), "gpx") != 0)) {
-      err = true;
-    } else {
-      cur_node = root_node->children;
-      while(cur_node != nullptr && cur_node->type != XML_ELEMENT_NODE)
-        cur_node = cur_node->next;
-      if(unlikely(!cur_node || !cur_node->children ||
-                    strcasecmp(reinterpret_cast<const char *>(cur_node->name), "trk") != 0)) {
-        err = true;
-      } else {
-        trk_node = cur_node;
-        /* assume that at most the last segment in the file was modified */
-        for (cur_node = cur_node->children; cur_node->next != nullptr; cur_node = cur_node->next) {
-          // skip non-nodes, e.g. if the user inserted a comment
-          if (cur_node->type != XML_ELEMENT_NODE)
-            continue;
-          // more tracks in the file than loaded, something is wrong
-          if(unlikely(it == itEnd)) {
-            err = true;
-            break;
-          }
-          /* something else, this track is not written from osm2go */
-          if(unlikely(strcasecmp(reinterpret_cast<const char *>(cur_node->name), "trkseg") != 0)) {
-            err = true;
-            break;
-          }
-          it++;
-        }
-      }
+track_write(const char *name, const track_t *track)
+{
+  OSM2GO_LOG(Track, Info, "writing track to %s", name);
+
+  xmlDocGuard doc(xmlNewDoc(BAD_CAST "1.0"));
+  xmlNodePtr root_node = xmlNewNode(nullptr, BAD_CAST "gpx");
+  xmlNewProp(root_node, BAD_CAST "xmlns",
+             BAD_CAST "http://www.topografix.com/GPX/1/0");
+  xmlNewProp(root_node, BAD_CAST "creator", BAD_CAST PACKAGE " v" VERSION);
+
+  xmlNodePtr trk_node = xmlNewChild(root_node, nullptr, BAD_CAST "trk", nullptr);
+  xmlDocSetRootElement(doc.get(), root_node);
+
+  std::for_each(track->segments.begin(), track->segments.end(), track_save_segs(trk_node));
+
+  xmlSaveFormatFileEnc(name, doc.get(), "UTF-8", 1);
+}
+
+} // namespace
+
+/* ----------------------  track log --------------------------- */
+
+track_log_t::track_log_t(int f)
+  : fd(f)
+  , pending(0)
+  , lastSync(time(nullptr))
+{
+}
+
+bool track_log_t::write(const char *buf, size_t len, unsigned int records)
+{
+  while(len > 0) {
+    ssize_t r = ::write(fd, buf, len);
+    if(unlikely(r < 0)) {
+      if(errno == EINTR)
+        continue;
+      OSM2GO_LOG(Track, Error, "writing to track log failed: %s", strerror(errno));
+      return false;
     }
-    if(unlikely(err)) {
-      doc.reset();
-    } else {
-      /* drop the last entry from XML, it will be rewritten */
-      xmlUnlinkNode(cur_node);
-      xmlFreeNode(cur_node);
+    buf += r;
+    len -= r;
+  }
+
+  pending += records;
+  return true;
+}
+
+size_t track_log_t::formatPoint(char *buf, const track_point_t &point)
+{
+  const long lat = lround(point.pos.lat * 10000000);
+  const long lon = lround(point.pos.lon * 10000000);
+  const long long t = point.time;
+  int len;
+
+  if(std::isnan(point.altitude))
+    len = snprintf(buf, 64, "P %ld %ld - %lld\n", lat, lon, t);
+  else
+    len = snprintf(buf, 64, "P %ld %ld %ld %lld\n", lat, lon,
+                   lround(point.altitude * 100), t);
+
+  return len;
+}
+
+bool track_log_t::appendPoint(const track_point_t &point)
+{
+  char buf[64];
+  return write(buf, formatPoint(buf, point), 1);
+}
+
+void track_log_t::sync(bool force)
+{
+  if(pending == 0)
+    return;
+
+  const time_t now = time(nullptr);
+  if(!force && pending < SyncRecords && now - lastSync < SyncSeconds)
+    return;
+
+  if(unlikely(fsync(fd) != 0))
+    OSM2GO_LOG(Track, Error, "syncing track log failed: %s", strerror(errno));
+
+  pending = 0;
+  lastSync = now;
+}
+
+bool track_log_write(int dirfd, const char *filename, const track_t &track)
+{
+  const std::string tmpname = std::string(filename) + ".new";
+
+  int fd = openat(dirfd, tmpname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(unlikely(fd < 0)) {
+    OSM2GO_LOG(Track, Error, "unable to create track log %s: %s", tmpname.c_str(), strerror(errno));
+    return false;
+  }
+  std::unique_ptr<track_log_t> log(std::make_unique<track_log_t>(fd));
+
+  // collect the records and write them in blocks
+  std::string buf = TRACK_LOG_MAGIC "\n";
+  unsigned int records = 0;
+  bool ok = true;
+  const std::vector<track_seg_t>::const_iterator sitEnd = track.segments.end();
+  for(std::vector<track_seg_t>::const_iterator sit = track.segments.begin(); ok && sit != sitEnd; sit++) {
+    if(sit->track_points.empty())
+      continue;
+    buf += "S\n";
+    records++;
+
+    const track_point_list::const_iterator itEnd = sit->track_points.end();
+    for(track_point_list::const_iterator it = sit->track_points.begin(); ok && it != itEnd; it++) {
+      char pbuf[64];
+      buf.append(pbuf, track_log_t::formatPoint(pbuf, *it));
+      if(++records >= 1024) {
+        ok = log->write(buf.c_str(), buf.size(), records);
+        buf.clear();
+        records = 0;
+      }
     }
   }
+  ok = ok && log->write(buf.c_str(), buf.size(), records);
 
-  if (!doc) {
-    doc.reset(xmlNewDoc(BAD_CAST "1.0"));
-    xmlNodePtr root_node = xmlNewNode(nullptr, BAD_CAST "gpx");
-    xmlNewProp(root_node, BAD_CAST "xmlns",
-               BAD_CAST "http://www.topografix.com/GPX/1/0");
-    xmlNewProp(root_node, BAD_CAST "creator", BAD_CAST PACKAGE " v" VERSION);
-    it = track->segments.begin();
+  if(unlikely(!ok)) {
+    unlinkat(dirfd, tmpname.c_str(), 0);
+    return false;
+  }
 
-    trk_node = xmlNewChild(root_node, nullptr, BAD_CAST "trk", nullptr);
-    xmlDocSetRootElement(doc.get(), root_node);
+  // make sure the contents are on disk before replacing the old file
+  log->sync(true);
+
+  if(unlikely(renameat(dirfd, tmpname.c_str(), dirfd, filename) != 0)) {
+    OSM2GO_LOG(Track, Error, "unable to rename track log to %s: %s", filename, strerror(errno));
+    unlinkat(dirfd, tmpname.c_str(), 0);
+    return false;
   }
 
-  std::for_each(it, itEnd, track_save_segs(trk_node));
+  // the file descriptor is still valid after the rename, just keep appending to it
+  track.log.swap(log);
+  track.dirty = false;
 
-  xmlSaveFormatFileEnc(name, doc.get(), "UTF-8", 1);
+  return true;
+}
+
+bool track_log_append(const track_t &track)
+{
+  if(!track.log)
+    return false;
+
+  const track_point_list &points = track.segments.back().track_points;
+  assert(!points.empty());
+
+  /* the segment is only written to the log together with its first point */
+  bool ok = points.size() > 1 || track.log->appendSegment();
+  if(likely(ok && track.log->appendPoint(points.back()))) {
+    track.log->sync(false);
+    return true;
+  }
+
+  track.reset_log();
+  return false;
+}
+
+namespace {
+
+class track_log_parser {
+  track_t &track;
+  bool inSegment;
+public:
+  explicit track_log_parser(track_t &t) : track(t), inSegment(false), points(0) {}
+
+  track_point_list::size_type points; ///< total points
+
+  bool parseLine(char *line);
+  void endSegment();
+};
+
+void track_log_parser::endSegment()
+{
+  if(!inSegment)
+    return;
+
+  track_point_list &last = track.segments.back().track_points;
+  if(unlikely(last.empty()))
+    track.segments.pop_back();
+  else
+    shrink_to_fit(last);
+  inSegment = false;
+}
+
+bool track_log_parser::parseLine(char *line)
+{
+  switch(line[0]) {
+  case 'S':
+    endSegment();
+    track.segments.push_back(track_seg_t());
+    inSegment = true;
+    return true;
+  case 'P': {
+    if(unlikely(!inSegment))
+      return false;
+
+    long lat, lon;
+    long long t;
+    char ele[16];
+    if(unlikely(sscanf(line + 1, " %ld %ld %15s %lld", &lat, &lon, ele, &t) != 4))
+      return false;
+
+    float alt = NAN;
+    if(strcmp(ele, "-") != 0)
+      alt = strtol(ele, nullptr, 10) / 100.0;
+
+    const pos_t pos(lat / 10000000.0, lon / 10000000.0);
+    if(unlikely(!pos.valid()))
+      return false;
+
+    track.segments.back().track_points.push_back(track_point_t(pos, alt, t));
+    points++;
+    return true;
+  }
+  default:
+    return false;
+  }
 }
 
 } // namespace
 
+track_t *track_log_read(int dirfd, const char *filename)
+{
+  fdguard fd(dirfd, filename, O_RDONLY);
+  if(!fd.valid())
+    return nullptr;
+
+  std::unique_ptr<track_t> track(std::make_unique<track_t>());
+  track_log_parser parser(*track);
+
+  std::string buf;
+  std::vector<char> block(64 * 1024);
+  bool header = true;
+  bool magic = true;
+  bool valid = true;
+  ssize_t r;
+  while(magic && (r = read(fd, block.data(), block.size())) != 0) {
+    if(unlikely(r < 0)) {
+      if(errno == EINTR)
+        continue;
+      valid = false;
+      break;
+    }
+    buf.append(block.data(), r);
+
+    std::string::size_type start = 0;
+    std::string::size_type nl;
+    while(magic && (nl = buf.find('\n', start)) != std::string::npos) {
+      buf[nl] = '\0';
+      if(unlikely(header)) {
+        magic = strcmp(&buf[start], TRACK_LOG_MAGIC) == 0;
+        header = false;
+      } else if(unlikely(!parser.parseLine(&buf[start]))) {
+        // skip the broken record, the points after it are still usable
+        OSM2GO_LOG(Track, Warning, "Track log %s: ignoring invalid record \"%s\"", filename, &buf[start]);
+        valid = false;
+      }
+      start = nl + 1;
+    }
+    buf.erase(0, start);
+  }
+  parser.endSegment();
+
+  // anything left is an incomplete record
+  if(!buf.empty())
+    valid = false;
+
+  OSM2GO_LOG(Track, Info, "Track log %s: %zu points in %zu segments%s", filename, parser.points,
+                          track->segments.size(), valid ? "" : ", damaged");
+
+  if(unlikely(header || !magic || track->segments.empty()))
+    return nullptr;
+
+  if(likely(valid)) {
+    int afd = openat(dirfd, filename, O_WRONLY | O_APPEND);
+    if(likely(afd >= 0))
+      track->log.reset(new track_log_t(afd));
+  }
+  track->dirty = !track->log;
+
+  return track.release();
+}
+
 /* save track in project */
 void track_save(project_t::ref project, const track_t *track)
 {
   if(!project)
     return;
 
-  /* no need to save again if it has already been saved */
-  if(track != nullptr && !track->dirty) {
-    printf("track is not dirty, no need to save it (again)\n");
-    return;
-  }
-
-  const std::string trk_name = project->path + project->name + ".trk";
-  const char *trkfname = trk_name.c_str() + project->path.size();
+  const std::string trk_name = project->name + ".trk";
+  const std::string log_name = project->name + ".trklog";
 
   if(track == nullptr) {
-    unlinkat(project->dirfd, trkfname, 0);
+    unlinkat(project->dirfd, log_name.c_str(), 0);
+    unlinkat(project->dirfd, trk_name.c_str(), 0);
     return;
   }
 
-  /* check if there already is such a track file and make it a backup */
-  /* in case saving new track fails */
-  const char *backupfn = "backup.trk";
-  xmlDocPtr doc = nullptr;
-
-  struct stat st;
-  if(fstatat(project->dirfd, trkfname, &st, 0) == 0 && S_ISREG(st.st_mode)) {
-    printf("backing up existing file '%s' to '%s'\n", trkfname, backupfn);
-    if(renameat(project->dirfd, trkfname, project->dirfd, backupfn) == 0) {
-      /* parse the old file and get the DOM */
-      fdguard bupfd(project->dirfd, backupfn, O_RDONLY);
-      if(likely(bupfd.valid()))
-        doc = xmlReadFd(bupfd, nullptr, nullptr, XML_PARSE_NONET);
-    }
+  /* no need to save again if it has already been saved */
+  if(!track->dirty) {
+    OSM2GO_LOG(Track, Debug, "track is not dirty, no need to save it (again)");
+    return;
   }
 
-  track_write(trk_name.c_str(), track, doc);
-  track->dirty = false;
-
-  /* if we reach this point writing the new file worked and we */
-  /* can delete the backup */
-  unlinkat(project->dirfd, backupfn, 0);
+  if(track->log) {
+    track->log->sync(true);
+    track->dirty = false;
+  } else if(track_log_write(project->dirfd, log_name.c_str(), *track)) {
+    /* the log replaces tracks saved as GPX by older versions */
+    unlinkat(project->dirfd, trk_name.c_str(), 0);
+    unlinkat(project->dirfd, "backup.trk", 0);
+  }
 }
 
 void track_export(const track_t *track, const char *filename) {
-  track_write(filename, track, nullptr);
+  track_write(filename, track);
 }
 
 /* ----------------------  loading track --------------------------- */
 
-bool track_restore(appdata_t &appdata) {
-  project_t::ref project = appdata.project;
+track_t *track_load(const project_t &project) {
+  const std::string log_name = project.name + ".trklog";
+  struct stat st;
 
+  if(likely(fstatat(project.dirfd, log_name.c_str(), &st, 0) == 0 && S_ISREG(st.st_mode))) {
+    OSM2GO_LOG(Track, Debug, "track log found, loading ...");
+    return track_log_read(project.dirfd, log_name.c_str());
+  }
+
+  /* tracks written by older versions are stored as GPX */
   /* first try to open a backup which is only present if saving the */
-  /* actual diff didn't succeed */
+  /* actual track didn't succeed */
   const char *backupfn = "backup.trk";
   std::string trk_name;
 
-  bool ret = true;
-  struct stat st;
-  if(unlikely(fstatat(project->dirfd, backupfn, &st, 0) == 0 && S_ISREG(st.st_mode))) {
-    printf("track backup present, loading it instead of real track ...\n");
-    trk_name = project->path + backupfn;
+  if(unlikely(fstatat(project.dirfd, backupfn, &st, 0) == 0 && S_ISREG(st.st_mode))) {
+    OSM2GO_LOG(Track, Debug, "track backup present, loading it instead of real track ...");
+    trk_name = project.path + backupfn;
   } else {
     // allocate in one go
-    trk_name = project->path + project->name + ".trk";
+    trk_name = project.path + project.name + ".trk";
 
     // use relative filename to test
-    if(fstatat(project->dirfd, trk_name.c_str() + project->path.size(), &st, 0) != 0 || !S_ISREG(st.st_mode)) {
-      printf("no track present!\n");
-      ret = false;
-    } else
-      printf("track found, loading ...\n");
+    if(fstatat(project.dirfd, trk_name.c_str() + project.path.size(), &st, 0) != 0 || !S_ISREG(st.st_mode)) {
+      OSM2GO_LOG(Track, Debug, "no track present!");
+      return nullptr;
+    }
+    OSM2GO_LOG(Track, Debug, "track found, loading ...");
   }
 
-  if (ret) {
-    appdata.track.track.reset(track_read(trk_name.c_str(), false));
-    ret = static_cast<bool>(appdata.track.track);
-  }
+  /* mark it dirty so it will be converted to a track log on next save */
+  return track_read(trk_name.c_str(), true);
+}
+
+bool track_restore(appdata_t &appdata) {
+  appdata.track.track.reset(track_load(*appdata.project));
+  const bool ret = static_cast<bool>(appdata.track.track);
 
   track_menu_set(appdata);
 
-  printf("restored track\n");
+  OSM2GO_LOG(Track, Info, "restored track");
 
   return ret;
 }
@@ -344,9 +706,12 @@ static void track_end_segment(std::unique_ptr<track_t> &track) {
   if(!track) return;
 
   if(track->active) {
-    printf("ending a segment\n");
+    OSM2GO_LOG(Track, Trace, "ending a segment");
     track->active = false;
 
+    if(track->log)
+      track->log->sync(true);
+
     /* todo: check if segment only has 1 point */
   }
 }
@@ -362,7 +727,7 @@ static void track_end_segment(std::unique_ptr<track_t> &track) {
 static bool track_append_position(appdata_t &appdata, const pos_t &pos, float alt, const lpos_t lpos) {
   /* no track at all? might be due to a "clear track" while running */
   if(unlikely(!appdata.track.track)) {
-    printf("restarting after \"clear\"\n");
+    OSM2GO_LOG(Track, Trace, "restarting after \"clear\"");
     appdata.track.track.reset(new track_t());
   }
   track_t * const track = appdata.track.track.get();
@@ -370,32 +735,36 @@ static bool track_append_position(appdata_t &appdata, const pos_t &pos, float al
   track_menu_set(appdata);
 
   if(unlikely(!track->active)) {
-    printf("starting new segment\n");
+    OSM2GO_LOG(Track, Trace, "starting new segment");
 
     track_seg_t seg;
     track->segments.push_back(seg);
     track->active = true;
   } else
-    printf("appending to current segment\n");
+    OSM2GO_LOG(Track, Trace, "appending to current segment");
 
   track_seg_t &seg = track->segments.back();
-  std::vector<track_point_t> &points = seg.track_points;
+  track_point_list &points = seg.track_points;
 
   /* don't append if point is the same as last time */
   settings_t::ref settings = settings_t::instance();
   bool ret;
-  if(unlikely(!points.empty() && points.back().pos == pos)) {
-    printf("same value as last point -> ignore\n");
+  if(unlikely(!points.empty() && points.back().pos == track_point_list::quantize(pos))) {
+    OSM2GO_LOG(Track, Trace, "same value as last point -> ignore");
     ret = false;
   } else {
     ret = true;
     track->dirty = true;
     points.push_back(track_point_t(pos, alt, time(nullptr)));
 
+    /* no log yet (e.g. after import or clear) or writing to it failed */
+    if(!track_log_append(*track))
+      track_save(appdata.project, track);
+
     if(settings->trackVisibility >= DrawCurrent) {
       if(seg.item_chain.empty()) {
         /* the segment can now be drawn for the first time */
-        printf("initial draw\n");
+        OSM2GO_LOG(Track, Trace, "initial draw");
         appdata.map->track_draw_seg(seg);
       } else {
         /* the segment has to be updated */
@@ -440,7 +809,7 @@ int track_t::gps_position_callback(void *context) {
 
   /* the map is only gone of the main screen is being closed */
   if(unlikely(!appdata.map)) {
-    printf("map has gone while tracking was active, stopping tracker\n");
+    OSM2GO_LOG(Track, Warning, "map has gone while tracking was active, stopping tracker");
 
     appdata.gps_state->setEnable(false);
 
@@ -457,13 +826,13 @@ int track_t::gps_position_callback(void *context) {
   float alt;
   pos_t pos = appdata.gps_state->get_pos(&alt);
   if(pos.valid()) {
-    printf("valid position %.6f/%.6f alt %.2f\n", pos.lat, pos.lon, alt);
+    OSM2GO_LOG(Track, Trace, "valid position %.6f/%.6f alt %.2f", pos.lat, pos.lon, alt);
     lpos_t lpos;
     lpos = pos.toLpos(appdata.project->osm->bounds);
     if(track_append_position(appdata, pos, alt, lpos) && settings->trackVisibility >= ShowPosition)
       appdata.map->track_pos(lpos);
   } else {
-    printf("no valid position\n");
+    OSM2GO_LOG(Track, Trace, "no valid position");
     /* end segment */
     track_end_segment(appdata.track.track);
     appdata.map->remove_gps_position();
@@ -478,14 +847,14 @@ static void track_do_enable_gps(appdata_t &appdata) {
   appdata.track.warn_cnt = 1;
 
   if(!appdata.track.track) {
-    printf("GPS: no track yet, starting new one\n");
+    OSM2GO_LOG(Track, Debug, "GPS: no track yet, starting new one");
     appdata.track.track.reset(new track_t());
   } else
-    printf("GPS: extending existing track\n");
+    OSM2GO_LOG(Track, Debug, "GPS: extending existing track");
 }
 
 void track_enable_gps(appdata_t &appdata, bool enable) {
-  printf("request to %sable gps\n", enable?"en":"dis");
+  OSM2GO_LOG(Track, Debug, "request to %sable gps", enable?"en":"dis");
 
   appdata.uicontrol->setActionEnable(MainUi::MENU_ITEM_TRACK_FOLLOW_GPS, enable);
 
@@ -494,7 +863,7 @@ void track_enable_gps(appdata_t &appdata, bool enable) {
 }
 
 track_t *track_import(const char *filename) {
-  printf("import %s\n", filename);
+  OSM2GO_LOG(Track, Info, "import %s", filename);
 
   return track_read(filename, true);
 }
@@ -516,7 +885,10 @@ track_point_t::track_point_t(const pos_t &p, float alt, time_t t)
 
 TrackSax::TrackSax()
   : SaxParser()
-  , curPoint(nullptr)
+  , curPoint()
+  , unknownDepth(0)
+  , cachedHour(-1)
+  , cachedHourStart(0)
   , state(DocStart)
   , track(nullptr)
   , points(0)
@@ -531,34 +903,249 @@ TrackSax::TrackSax()
 
 bool TrackSax::parse(const char *filename)
 {
-  if(unlikely(!parseFile(filename)))
-    return false;
+  osm2go_platform::MappedFile map(filename);
+  if(likely(map) && scan(map.data(), map.length())) {
+    map.reset();
+  } else {
+    map.reset();
+    reset();
+    if(unlikely(!parseFile(filename)))
+      return false;
+  }
 
   return track && !track->segments.empty();
 }
 
+void TrackSax::reset()
+{
+  track.reset();
+  points = 0;
+  state = DocStart;
+  unknownDepth = 0;
+  openTags.clear();
+}
+
+/**
+ * @brief parse a start tag and call startElement()
+ * @param p the first character of the element name
+ * @param end end of the buffer
+ * @returns the position of the closing '>' or nullptr if it could not be parsed
+ */
+const char *TrackSax::scanStartTag(const char *p, const char *end)
+{
+  tagBuffer.clear();
+  attrOffsets.clear();
+
+  const char *n = p;
+  while(p < end && *p != '>' && *p != '/' && !is_space(*p))
+    p++;
+  if(unlikely(p == n || p == end))
+    return nullptr;
+  tagBuffer.assign(n, p);
+  tagBuffer.push_back('\0');
+
+  for(;;) {
+    while(p < end && is_space(*p))
+      p++;
+    if(unlikely(p == end))
+      return nullptr;
+    if(*p == '>' || *p == '/')
+      break;
+
+    // attribute name
+    n = p;
+    while(p < end && *p != '=' && !is_space(*p) && *p != '>')
+      p++;
+    if(unlikely(p == n))
+      return nullptr;
+    attrOffsets.push_back(tagBuffer.size());
+    tagBuffer.append(n, p);
+    tagBuffer.push_back('\0');
+
+    while(p < end && is_space(*p))
+      p++;
+    if(unlikely(p == end || *p != '='))
+      return nullptr;
+    p++;
+    while(p < end && is_space(*p))
+      p++;
+    if(unlikely(p == end || (*p != '"' && *p != '\'')))
+      return nullptr;
+
+    // attribute value
+    const char quote = *p++;
+    n = p;
+    p = static_cast<const char *>(memchr(p, quote, end - p));
+    if(unlikely(p == nullptr || memchr(n, '&', p - n) != nullptr))
+      return nullptr;
+    attrOffsets.push_back(tagBuffer.size());
+    tagBuffer.append(n, p);
+    tagBuffer.push_back('\0');
+    p++;
+  }
+
+  const bool empty = (*p == '/');
+  if(empty && (++p == end || *p != '>'))
+    return nullptr;
+
+  // the buffer is complete now, so the pointers into it stay valid
+  attrPointers.clear();
+  for(std::vector<std::string::size_type>::const_iterator it = attrOffsets.begin(); it != attrOffsets.end(); it++)
+    attrPointers.push_back(tagBuffer.c_str() + *it);
+  attrPointers.push_back(nullptr);
+
+  startElement(tagBuffer.c_str(), attrPointers.data());
+  if(empty)
+    endElement(tagBuffer.c_str());
+  else
+    openTags.push_back(tagBuffer.c_str());
+
+  return p;
+}
+
+bool TrackSax::scan(const char *data, size_t len)
+{
+  const char *p = data;
+  const char * const end = data + len;
+
+  // skip UTF-8 byte order mark
+  if(len >= 3 && memcmp(p, "\xef\xbb\xbf", 3) == 0)
+    p += 3;
+
+  while(p < end) {
+    const char *lt = static_cast<const char *>(memchr(p, '<', end - p));
+    const char *textEnd = lt != nullptr ? lt : end;
+
+    // text outside of the root element is not reported by the SAX parser either
+    if(textEnd != p && !openTags.empty()) {
+      if(unlikely(memchr(p, '&', textEnd - p) != nullptr))
+        return false;
+      characters(p, textEnd - p);
+    }
+
+    if(lt == nullptr)
+      break;
+    p = lt + 1;
+    if(unlikely(p == end))
+      return false;
+
+    switch(*p) {
+    case '?': {
+      // processing instruction or XML declaration
+      const char *e = find_string(p, end, "?>", 2);
+      if(unlikely(e == nullptr))
+        return false;
+      p = e + 2;
+      break;
+    }
+    case '!': {
+      // only comments are supported, no DTD or CDATA
+      if(unlikely(end - p < 3 || memcmp(p, "!--", 3) != 0))
+        return false;
+      const char *e = find_string(p + 3, end, "-->", 3);
+      if(unlikely(e == nullptr))
+        return false;
+      p = e + 3;
+      break;
+    }
+    case '/': {
+      const char *gt = static_cast<const char *>(memchr(p, '>', end - p));
+      if(unlikely(gt == nullptr))
+        return false;
+      const char *n = p + 1;
+      const char *ne = gt;
+      while(ne > n && is_space(*(ne - 1)))
+        ne--;
+      if(unlikely(openTags.empty() || openTags.back().compare(0, std::string::npos, n, ne - n) != 0))
+        return false;
+      endElement(openTags.back().c_str());
+      openTags.pop_back();
+      p = gt + 1;
+      break;
+    }
+    default:
+      p = scanStartTag(p, end);
+      if(unlikely(p == nullptr))
+        return false;
+      p++;
+      break;
+    }
+  }
+
+  return openTags.empty() && state == DocStart;
+}
+
+bool TrackSax::parseTime(const char *str, time_t &t)
+{
+  // fast path for the common "YYYY-MM-DDTHH:MM:SS" format, anything after that is ignored
+  static const char pattern[] = "0000-00-00T00:00:00";
+  unsigned int i;
+  for(i = 0; i < sizeof(pattern) - 1; i++) {
+    if(pattern[i] == '0' ? !is_digit(str[i]) : str[i] != pattern[i])
+      break;
+  }
+
+  if(likely(i == sizeof(pattern) - 1)) {
+#define DIGITS2(o) ((str[o] - '0') * 10 + str[(o) + 1] - '0')
+    const int year = DIGITS2(0) * 100 + DIGITS2(2);
+    const int mon = DIGITS2(5);
+    const int mday = DIGITS2(8);
+    const int hour = DIGITS2(11);
+    const int min = DIGITS2(14);
+    const int sec = DIGITS2(17);
+#undef DIGITS2
+
+    if(likely(mon >= 1 && mon <= 12 && mday >= 1 && mday <= 31 && hour <= 23 && min <= 59 && sec <= 59)) {
+      const long hourKey = ((year * 12L + mon) * 31 + mday) * 24 + hour;
+      if(hourKey != cachedHour) {
+        struct tm time;
+        memset(&time, 0, sizeof(time));
+        time.tm_year = year - 1900;
+        time.tm_mon = mon - 1;
+        time.tm_mday = mday;
+        time.tm_hour = hour;
+        time.tm_isdst = -1;
+        cachedHourStart = mktime(&time);
+        cachedHour = hourKey;
+      }
+      t = cachedHourStart + min * 60 + sec;
+      return true;
+    }
+  }
+
+  struct tm time;
+  memset(&time, 0, sizeof(time));
+  time.tm_isdst = -1;
+  if(unlikely(strptime(str, DATE_FORMAT, &time) == nullptr))
+    return false;
+
+  t = mktime(&time);
+  return true;
+}
+
 void TrackSax::characters(const char *ch, int len)
 {
   std::string buf;
 
+  if(unlikely(unknownDepth > 0))
+    return;
+
   switch(state) {
   case TagEle:
     buf.assign(ch, len);
-    curPoint->altitude = xml_parse_float(reinterpret_cast<const xmlChar *>(buf.c_str()));
+    curPoint.altitude = parse_decimal(buf.c_str());
     break;
   case TagTime: {
     buf.assign(ch, len);
-    struct tm time;
-    memset(&time, 0, sizeof(time));
-    time.tm_isdst = -1;
-    if(likely(strptime(buf.c_str(), DATE_FORMAT, &time) != nullptr))
-      curPoint->time = mktime(&time);
+    time_t t;
+    if(likely(parseTime(buf.c_str(), t)))
+      curPoint.time = t;
     break;
   }
   default:
     for(int pos = 0; pos < len; pos++)
-      if(unlikely(!isspace(ch[pos]))) {
-        printf("unhandled character data: %*.*s state %i\n", len, len, ch, state);
+      if(unlikely(!is_space(ch[pos]))) {
+        OSM2GO_LOG(Track, Warning, "unhandled character data: %*.*s state %i", len, len, ch, state);
         break;
       }
   }
@@ -566,16 +1153,24 @@ void TrackSax::characters(const char *ch, int len)
 
 void TrackSax::startElement(const char *name, const char **attrs)
 {
+  // everything inside an unknown element is ignored
+  if(unlikely(unknownDepth > 0)) {
+    unknownDepth++;
+    return;
+  }
+
   StateMap::const_iterator it = std::find_if(tags.begin(), tags.end(), tag_find(name));
 
   if(unlikely(it == tags.end())) {
-    fprintf(stderr, "found unhandled element %s\n", name);
+    OSM2GO_LOG(Track, Warning, "found unhandled element %s", name);
+    unknownDepth++;
     return;
   }
 
   if(unlikely(state != it->oldState)) {
-    fprintf(stderr, "found element %s in state %i, but expected %i\n",
-            name, state, it->oldState);
+    OSM2GO_LOG(Track, Warning, "found element %s in state %i, but expected %i",
+               name, state, it->oldState);
+    unknownDepth++;
     return;
   }
 
@@ -590,14 +1185,12 @@ void TrackSax::startElement(const char *name, const char **attrs)
     track->segments.push_back(track_seg_t());
     break;
   case TagTrkPt:
-    track->segments.back().track_points.push_back(track_point_t());
-    points++;
-    curPoint = &track->segments.back().track_points.back();
+    curPoint = track_point_t();
     for(unsigned int i = 0; attrs[i] != nullptr; i += 2) {
       if(strcmp(reinterpret_cast<const char *>(attrs[i]), "lat") == 0)
-        curPoint->pos.lat = osm2go_platform::string_to_double(attrs[i + 1]);
+        curPoint.pos.lat = parse_decimal(attrs[i + 1]);
       else if(likely(strcmp(reinterpret_cast<const char *>(attrs[i]), "lon") == 0))
-        curPoint->pos.lon = osm2go_platform::string_to_double(attrs[i + 1]);
+        curPoint.pos.lon = parse_decimal(attrs[i + 1]);
     }
     break;
   default:
@@ -607,19 +1200,32 @@ void TrackSax::startElement(const char *name, const char **attrs)
 
 void TrackSax::endElement(const char *name)
 {
+  if(unlikely(unknownDepth > 0)) {
+    unknownDepth--;
+    return;
+  }
+
   StateMap::const_iterator it = std::find_if(tags.begin(), tags.end(), tag_find(name));
 
   assert(it != tags.end());
   assert(state == it->newState);
 
   switch(state){
+  case TagTrkPt:
+    if(likely(curPoint.pos.valid())) {
+      track->segments.back().track_points.push_back(curPoint);
+      points++;
+    } else {
+      OSM2GO_LOG(Track, Debug, "ignoring track point with invalid position");
+    }
+    break;
   case TagTrkSeg: {
     // drop empty segments
-    std::vector<track_point_t> &last = track->segments.back().track_points;
+    track_point_list &last = track->segments.back().track_points;
     if(unlikely(last.empty())) {
       track->segments.pop_back();
     } else {
-      // this vector will never be appended to again, so shrink it to the size
+      // this list will never be appended to again, so shrink it to the size
       // that is actually needed
       shrink_to_fit(last);
     }
@@ -631,8 +1237,160 @@ void TrackSax::endElement(const char *name)
   state = it->oldState;
 }
 
+namespace {
+
+inline int32_t track_coord(pos_float_t v)
+{
+  return lround(v * 10000000);
+}
+
+inline bool fits_delta(long long v)
+{
+  return v >= -INT16_MAX && v <= INT16_MAX;
+}
+
+struct block_first_compare {
+  template<typename T>
+  inline bool operator()(track_point_list::size_type idx, const T &b) const
+  { return idx < b.first; }
+};
+
+} // namespace
+
+pos_t track_point_list::quantize(const pos_t &pos)
+{
+  return pos_t(track_coord(pos.lat) / 10000000.0, track_coord(pos.lon) / 10000000.0);
+}
+
+void track_point_list::push_back(const track_point_t &point)
+{
+  assert(point.pos.valid());
+
+  const int32_t lat = track_coord(point.pos.lat);
+  const int32_t lon = track_coord(point.pos.lon);
+  const int32_t alt = std::isnan(point.altitude) ? static_cast<int32_t>(InvalidAltitude) :
+                      static_cast<int32_t>(lround(point.altitude * 100));
+
+  if(likely(!blocks.empty() && deltas.size() - blocks.back().first < MaxBlockPoints)) {
+    const block &b = blocks.back();
+    const long long dlat = static_cast<long long>(lat) - b.lat;
+    const long long dlon = static_cast<long long>(lon) - b.lon;
+    const long long dt = static_cast<long long>(point.time) - b.time;
+
+    delta d;
+    bool fits = fits_delta(dlat) && fits_delta(dlon) && dt >= 0 && dt <= UINT16_MAX;
+    if(alt == InvalidAltitude) {
+      d.altitude = InvalidAltitudeDelta;
+    } else if(b.altitude == InvalidAltitude) {
+      fits = false;
+    } else {
+      const long long dalt = static_cast<long long>(alt) - b.altitude;
+      fits = fits && fits_delta(dalt);
+      d.altitude = dalt;
+    }
+
+    if(likely(fits)) {
+      d.lat = dlat;
+      d.lon = dlon;
+      d.time = dt;
+      deltas.push_back(d);
+      return;
+    }
+  }
+
+  // start a new block with this point as base
+  block b;
+  b.time = point.time;
+  b.lat = lat;
+  b.lon = lon;
+  b.altitude = alt;
+  b.first = deltas.size();
+  blocks.push_back(b);
+
+  delta d;
+  d.lat = 0;
+  d.lon = 0;
+  d.altitude = alt == InvalidAltitude ? static_cast<int16_t>(InvalidAltitudeDelta) : 0;
+  d.time = 0;
+  deltas.push_back(d);
+}
+
+void track_point_list::clear()
+{
+  blocks.clear();
+  deltas.clear();
+}
+
+void track_point_list::shrink_to_fit()
+{
+  ::shrink_to_fit(blocks);
+  ::shrink_to_fit(deltas);
+}
+
+track_point_t track_point_list::at(size_type idx) const
+{
+  return decode(idx, findBlock(idx, blocks.size() - 1));
+}
+
+size_t track_point_list::memory_size() const
+{
+  return blocks.capacity() * sizeof(blocks.front()) + deltas.capacity() * sizeof(deltas.front());
+}
+
+track_point_list::size_type track_point_list::findBlock(size_type idx, size_type hint) const
+{
+  assert_cmpnum_op(idx, <, size());
+
+  // check the hint and the following block first, when iterating this will match
+  const size_type last = std::min<size_type>(hint + 2, blocks.size());
+  for(size_type i = hint; i < last; i++) {
+    if(blocks[i].first <= idx && (i + 1 == blocks.size() || blocks[i + 1].first > idx))
+      return i;
+  }
+
+  std::vector<block>::const_iterator it = std::upper_bound(blocks.begin(), blocks.end(), idx,
+                                                           block_first_compare());
+  return std::distance(blocks.begin(), it) - 1;
+}
+
+track_point_t track_point_list::decode(size_type idx, size_type blk) const
+{
+  const block &b = blocks[blk];
+  const delta &d = deltas[idx];
+
+  float alt;
+  if(d.altitude == InvalidAltitudeDelta)
+    alt = NAN;
+  else
+    alt = (b.altitude + d.altitude) / 100.0;
+
+  return track_point_t(pos_t((b.lat + d.lat) / 10000000.0, (b.lon + d.lon) / 10000000.0),
+                       alt, b.time + d.time);
+}
+
 track_t::track_t()
   : dirty(false)
   , active(false)
 {
 }
+
+track_t::~track_t()
+{
+  if(log)
+    log->sync(true);
+}
+
+void track_t::reset_log() const
+{
+  log.reset();
+  dirty = true;
+}
+
+size_t track_t::memory_size() const
+{
+  size_t ret = segments.capacity() * sizeof(segments.front());
+  for(size_t i = 0; i < segments.size(); i++)
+    ret += segments[i].track_points.memory_size() +
+           segments[i].item_chain.capacity() * sizeof(segments[i].item_chain.front());
+  return ret;
+}
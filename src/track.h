@@ -9,10 +9,15 @@
 #include "pos.h"
 #include "project.h"
 
+#include <cstddef>
+#include <cstdint>
 #include <ctime>
+#include <iterator>
+#include <memory>
 #include <vector>
 
 struct canvas_item_t;
+class track_log_t;
 
 enum TrackVisibility {
   RecordOnly,   ///< record track, nothing drawn
@@ -29,22 +34,200 @@ struct track_point_t {
   float altitude;
 };
 
+/**
+ * @brief compact storage of the points of a track segment
+ *
+ * The points are grouped in blocks. Every block stores the full position,
+ * time, and altitude of its first point, and every point is stored as small
+ * deltas to this base. A new block is started once a point does not fit into
+ * the delta range of the current block, or the block is full. This needs about
+ * a third of the memory of a plain vector of track_point_t.
+ *
+ * Positions are stored in 1e-7 degrees, which is also the precision used when
+ * the track is written to disk, and the altitude in cm.
+ */
+class track_point_list {
+public:
+  typedef std::size_t size_type;
+  class const_iterator;
+
+  inline track_point_list() {}
+
+  /**
+   * @brief append a point
+   *
+   * The position of the point must be valid.
+   */
+  void push_back(const track_point_t &point);
+  void clear();
+  void shrink_to_fit();
+
+  inline size_type size() const noexcept
+  { return deltas.size(); }
+  inline bool empty() const noexcept
+  { return deltas.empty(); }
+
+  track_point_t at(size_type idx) const;
+  inline track_point_t front() const
+  { return at(0); }
+  inline track_point_t back() const
+  { return at(size() - 1); }
+
+  inline const_iterator begin() const;
+  inline const_iterator end() const;
+
+  /**
+   * @brief the memory used by the point storage
+   */
+  size_t memory_size() const;
+
+  /**
+   * @brief round the position to the precision used in the storage
+   */
+  static pos_t quantize(const pos_t &pos);
+
+private:
+  enum {
+    MaxBlockPoints = 64,
+    InvalidAltitude = INT32_MIN,
+    InvalidAltitudeDelta = INT16_MIN
+  };
+
+  struct block {
+    time_t time;
+    int32_t lat, lon;    ///< 1e-7 degrees
+    int32_t altitude;    ///< cm, or InvalidAltitude
+    unsigned int first;  ///< index of the first point of this block
+  };
+  struct delta {
+    int16_t lat, lon;
+    int16_t altitude;    ///< cm, or InvalidAltitudeDelta
+    uint16_t time;
+  };
+
+  std::vector<block> blocks;
+  std::vector<delta> deltas;
+
+  /**
+   * @brief find the block containing the given point
+   * @param idx the point index
+   * @param hint the block to check first
+   */
+  size_type findBlock(size_type idx, size_type hint) const;
+  track_point_t decode(size_type idx, size_type blk) const;
+};
+
+/**
+ * @brief iterator over the decoded points of a track_point_list
+ *
+ * The points are returned by value, the iterator remembers the current block
+ * so sequential access does not need to search for it. As there is no real
+ * reference it is only declared as input iterator, the arithmetic operators
+ * have to be used directly instead of e.g. std::prev().
+ */
+class track_point_list::const_iterator {
+  friend class track_point_list;
+
+  const track_point_list *list;
+  size_type idx;
+  mutable size_type blk;
+  mutable track_point_t cur; ///< storage for operator->
+
+  inline const_iterator(const track_point_list *l, size_type i)
+    : list(l), idx(i), blk(0) {}
+
+public:
+  typedef std::input_iterator_tag iterator_category;
+  typedef track_point_t value_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef const track_point_t *pointer;
+  typedef track_point_t reference;
+
+  inline const_iterator() : list(nullptr), idx(0), blk(0) {}
+
+  inline reference operator*() const
+  {
+    blk = list->findBlock(idx, blk);
+    return list->decode(idx, blk);
+  }
+  inline pointer operator->() const
+  {
+    cur = operator*();
+    return &cur;
+  }
+  inline reference operator[](difference_type n) const
+  { return *(*this + n); }
+
+  inline const_iterator &operator++()
+  { ++idx; return *this; }
+  inline const_iterator operator++(int)
+  { const_iterator r = *this; ++idx; return r; }
+  inline const_iterator &operator--()
+  { --idx; return *this; }
+  inline const_iterator operator--(int)
+  { const_iterator r = *this; --idx; return r; }
+  inline const_iterator &operator+=(difference_type n)
+  { idx += n; return *this; }
+  inline const_iterator &operator-=(difference_type n)
+  { idx -= n; return *this; }
+  inline const_iterator operator+(difference_type n) const
+  { const_iterator r = *this; return r += n; }
+  inline const_iterator operator-(difference_type n) const
+  { const_iterator r = *this; return r -= n; }
+  inline difference_type operator-(const const_iterator &other) const
+  { return static_cast<difference_type>(idx) - static_cast<difference_type>(other.idx); }
+
+  inline bool operator==(const const_iterator &other) const
+  { return idx == other.idx; }
+  inline bool operator!=(const const_iterator &other) const
+  { return idx != other.idx; }
+  inline bool operator<(const const_iterator &other) const
+  { return idx < other.idx; }
+  inline bool operator>(const const_iterator &other) const
+  { return idx > other.idx; }
+  inline bool operator<=(const const_iterator &other) const
+  { return idx <= other.idx; }
+  inline bool operator>=(const const_iterator &other) const
+  { return idx >= other.idx; }
+};
+
+inline track_point_list::const_iterator track_point_list::begin() const
+{ return const_iterator(this, 0); }
+inline track_point_list::const_iterator track_point_list::end() const
+{ return const_iterator(this, size()); }
+
 struct track_seg_t {
-  std::vector<track_point_t> track_points;
+  track_point_list track_points;
   std::vector<canvas_item_t *> item_chain;
 };
 
 struct track_t {
   track_t();
-  inline ~track_t() {}
+  ~track_t();
 
   std::vector<track_seg_t> segments;
-  mutable bool dirty;
+  mutable bool dirty; ///< if there are points that have not been synced to disk
   bool active; ///< if the last element in segments is currently written to
+  /**
+   * @brief the on-disk log new points are appended to
+   *
+   * If this is not set the next save will write out the whole track.
+   */
+  mutable std::unique_ptr<track_log_t> log;
 
   void clear();
   void clear_current();
 
+  /**
+   * @brief close the log so the whole track is written again on the next save
+   */
+  void reset_log() const;
+
+  /**
+   * @brief the memory used by the points and their canvas item lists
+   */
+  size_t memory_size() const;
+
   static int gps_position_callback(void *context);
 };
 
@@ -52,9 +235,26 @@ struct appdata_t;
 struct project_t;
 struct track_t;
 
-/* used internally to save and restore the currently displayed track */
+/**
+ * @brief make sure the track of the project is stored on disk
+ * @param project the project the track belongs to
+ * @param track the track to save, or nullptr to remove the track files
+ *
+ * If the track already has an open log only the pending points are synced,
+ * otherwise the whole track is written as a new log.
+ */
 void track_save(project_t::ref project, const track_t *track);
 
+/**
+ * @brief read the track stored in the project directory
+ * @param project the project the track belongs to
+ * @returns the track or nullptr if none is present
+ *
+ * This does not touch the user interface, so it may be run in a background
+ * thread.
+ */
+track_t *track_load(const project_t &project);
+
 /**
  * @brief restore the track of the current project
  * @param appdata global appdata object
@@ -65,6 +265,41 @@ bool track_restore(appdata_t &appdata);
 /* accessible via the menu */
 void track_export(const track_t *track, const char *filename);
 track_t *track_import(const char *filename);
+
+/**
+ * @brief write the whole track as append-only log
+ * @param dirfd the directory to write to
+ * @param filename the name of the log file relative to dirfd
+ * @param track the track to write
+ * @returns if writing and syncing the file to disk was successful
+ *
+ * On success the log is attached to track so further points can be appended.
+ */
+bool track_log_write(int dirfd, const char *filename, const track_t &track);
+
+/**
+ * @brief append the last point of the last segment to the log of the track
+ * @param track the track to update
+ * @returns if the point was written to the log
+ *
+ * If the first point of a segment is appended the segment start is written
+ * first. If the track has no log or writing fails false is returned, and the
+ * track needs to be saved completely.
+ */
+bool track_log_append(const track_t &track);
+
+/**
+ * @brief read a track from an append-only log
+ * @param dirfd the directory to read from
+ * @param filename the name of the log file relative to dirfd
+ * @returns the track or nullptr if the file does not contain any points
+ *
+ * Invalid records, e.g. an incomplete last one from a crash while writing, are
+ * skipped. The log is only attached to the returned track for further appends
+ * if it did not contain such a record, otherwise the track is marked dirty so
+ * it will be rewritten on the next save.
+ */
+track_t *track_log_read(int dirfd, const char *filename);
 /**
  * @brief set enable state of "track export" and "track clear" menu entries
  * @param appdata global appdata object
@@ -0,0 +1,31 @@
+/*
+ * SPDX-FileCopyrightText: 2008 Till Harbaum <till@harbaum.org>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <cstddef>
+
+struct track_t;
+
+/**
+ * @brief parse a decimal number like "52.2720694"
+ *
+ * Plain numbers with at most 15 significant digits are converted directly,
+ * which gives exactly the same result as strtod(). Everything else is passed
+ * to osm2go_platform::string_to_double().
+ */
+double parse_decimal(const char *str);
+
+/**
+ * @brief parse GPX data from memory without libxml2
+ * @returns the track or nullptr if the data needs to be passed to the generic parser
+ */
+track_t *track_scan(const char *data, size_t len);
+
+/**
+ * @brief parse the GPX file only using libxml2
+ */
+track_t *track_parse_sax(const char *filename);
@@ -6,6 +6,7 @@
 
 #pragma once
 
+struct appdata_t;
 class statusbar_t;
 
 #include <osm2go_i18n.h>
@@ -60,6 +61,17 @@ public:
    */
   virtual void showNotification(trstring::arg_type message, unsigned int flags = NoFlags);
 
+  /**
+   * @brief show the progress of a long running operation
+   * @param message the text to show, must not be empty
+   * @param fraction the part of the work already done, negative if unknown
+   * @returns false if the user has asked to cancel the operation
+   *
+   * The first call shows a progress indicator with a cancel button, further
+   * calls update it. It is removed by clearNotification() with the Busy flag.
+   */
+  virtual bool showProgress(trstring::arg_type message, float fraction);
+
   /**
    * @brief clear the given type of messages
    */
@@ -67,6 +79,7 @@ public:
 
   /**
    * @brief show a modal about box
+   * @param appdata the data whose memory usage is shown
    */
-  void about_box();
+  void about_box(const appdata_t &appdata);
 };
@@ -7,18 +7,23 @@
 #include "wms.h"
 #include "wms_p.h"
 
+#include "canvas.h"
 #include "fdguard.h"
 #include "misc.h"
 #include "net_io.h"
 #include "notifications.h"
+#include "osm.h"
 #include "project.h"
 #include "settings.h"
 
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <cinttypes>
 #include <cmath>
+#include <cstdio>
 #include <cstring>
+#include <ctime>
 #include <filesystem>
 #include <libxml/parser.h>
 #include <libxml/tree.h>
@@ -29,6 +34,7 @@
 #include <vector>
 
 #include "osm2go_annotations.h"
+#include <osm2go_log.h>
 #include "osm2go_stl.h"
 #include <osm2go_i18n.h>
 
@@ -61,11 +67,6 @@ struct wms_t {
     : server(s) {}
 
   std::string server;
-  struct size_t {
-    size_t() : width(0), height(0) {}
-    unsigned int width, height;
-  };
-  size_t size;
 
   wms_cap_t cap;
 };
@@ -163,26 +164,26 @@ wms_cap_parse_layer(xmlDocPtr doc, xmlNode *a_node)
           wms_layer.epsg4326 = true;
         else
           wms_layer.srs = static_cast<const char *>(str);
-        printf("SRS = %s\n", str.get());
+        OSM2GO_LOG(Wms, Debug, "SRS = %s", str.get());
       } else if(strcasecmp(reinterpret_cast<const char *>(cur_node->name), "LatLonBoundingBox") == 0) {
         wms_layer.llbbox.bounds.min = pos_t::fromXmlProperties(cur_node, "miny", "minx");
         wms_layer.llbbox.bounds.max = pos_t::fromXmlProperties(cur_node, "maxy", "maxx");
       } else
-        printf("found unhandled WMT_MS_Capabilities/Capability/Layer/%s\n", cur_node->name);
+        OSM2GO_LOG(Wms, Debug, "found unhandled WMT_MS_Capabilities/Capability/Layer/%s", cur_node->name);
     }
   }
 
   wms_layer.llbbox.valid = wms_bbox_is_valid(wms_layer.llbbox.bounds);
 
-  printf("------------------- Layer: %s ---------------------------\n", wms_layer.title.c_str());
-  printf("Name: %s\n", wms_layer.name.c_str());
-  printf("EPSG-4326: %s\n", wms_layer.epsg4326?"yes":"no");
+  OSM2GO_LOG(Wms, Debug, "------------------- Layer: %s ---------------------------", wms_layer.title.c_str());
+  OSM2GO_LOG(Wms, Debug, "Name: %s", wms_layer.name.c_str());
+  OSM2GO_LOG(Wms, Debug, "EPSG-4326: %s", wms_layer.epsg4326?"yes":"no");
   if(wms_layer.llbbox.valid)
-    printf("LatLonBBox: %f/%f %f/%f\n",
-           wms_layer.llbbox.bounds.min.lat, wms_layer.llbbox.bounds.min.lon,
-           wms_layer.llbbox.bounds.max.lat, wms_layer.llbbox.bounds.max.lon);
+    OSM2GO_LOG(Wms, Debug, "LatLonBBox: %f/%f %f/%f",
+                           wms_layer.llbbox.bounds.min.lat, wms_layer.llbbox.bounds.min.lon,
+                           wms_layer.llbbox.bounds.max.lat, wms_layer.llbbox.bounds.max.lon);
   else
-    printf("No/invalid LatLonBBox\n");
+    OSM2GO_LOG(Wms, Debug, "No/invalid LatLonBBox");
 
   return wms_layer;
 }
@@ -205,15 +206,15 @@ wms_cap_parse_getmap(xmlDocPtr doc, xmlNode *a_node)
             wms_getmap.format |= it->second;
         }
       } else
-        printf("found unhandled WMT_MS_Capabilities/Capability/Request/GetMap/%s\n",
-               cur_node->name);
+        OSM2GO_LOG(Wms, Debug, "found unhandled WMT_MS_Capabilities/Capability/Request/GetMap/%s",
+                               cur_node->name);
     }
   }
 
-  printf("Supported formats: %s%s%s\n",
-         (wms_getmap.format & WMS_FORMAT_PNG) ? "png " : "",
-         (wms_getmap.format & WMS_FORMAT_GIF) ? "gif " : "",
-         (wms_getmap.format & (WMS_FORMAT_JPG | WMS_FORMAT_JPEG)) ? "jpg " : "");
+  OSM2GO_LOG(Wms, Debug, "Supported formats: %s%s%s",
+                         (wms_getmap.format & WMS_FORMAT_PNG) ? "png " : "",
+                         (wms_getmap.format & WMS_FORMAT_GIF) ? "gif " : "",
+                         (wms_getmap.format & (WMS_FORMAT_JPG | WMS_FORMAT_JPEG)) ? "jpg " : "");
   return wms_getmap;
 }
 
@@ -228,7 +229,7 @@ wms_cap_parse_request(xmlDocPtr doc, xmlNode *a_node)
       if(strcasecmp(reinterpret_cast<const char *>(cur_node->name), "GetMap") == 0)
         wms_request = wms_cap_parse_getmap(doc, cur_node);
       else
-        printf("found unhandled WMT_MS_Capabilities/Capability/Request/%s\n", cur_node->name);
+        OSM2GO_LOG(Wms, Debug, "found unhandled WMT_MS_Capabilities/Capability/Request/%s", cur_node->name);
     }
   }
 
@@ -249,7 +250,7 @@ wms_cap_parse_cap(xmlDocPtr doc, xmlNode *a_node, wms_cap_t *wms_cap)
       } else if(strcasecmp(reinterpret_cast<const char *>(cur_node->name), "Layer") == 0) {
         wms_cap->layers.push_back(wms_cap_parse_layer(doc, cur_node));
       } else
-        printf("found unhandled WMT_MS_Capabilities/Capability/%s\n", cur_node->name);
+        OSM2GO_LOG(Wms, Debug, "found unhandled WMT_MS_Capabilities/Capability/%s", cur_node->name);
     }
   }
 
@@ -271,7 +272,7 @@ wms_cap_parse(wms_t &wms, xmlDocPtr doc, xmlNode *a_node)
         if(!has_cap)
           has_cap = wms_cap_parse_cap(doc, cur_node, &wms.cap);
       } else
-        printf("found unhandled WMT_MS_Capabilities/%s\n", cur_node->name);
+        OSM2GO_LOG(Wms, Debug, "found unhandled WMT_MS_Capabilities/%s", cur_node->name);
     }
   }
 
@@ -290,49 +291,13 @@ wms_cap_parse_root(wms_t &wms, xmlDocPtr doc)
       if(likely(strcasecmp(reinterpret_cast<const char *>(cur_node->name), "WMT_MS_Capabilities") == 0))
         ret = wms_cap_parse(wms, doc, cur_node);
       else
-        printf("found unhandled %s\n", cur_node->name);
+        OSM2GO_LOG(Wms, Debug, "found unhandled %s", cur_node->name);
     }
   }
 
   return ret;
 }
 
-/* get pixel extent of image display */
-wms_t::size_t
-wms_setup_extent(const pos_area &pbounds)
-{
-  bounds_t bounds;
-  bounds.init(pbounds);
-
-  lpos_t lmin = pbounds.min.toLpos();
-  lmin.x -= bounds.center.x;
-  lmin.y -= bounds.center.y;
-  lmin.x *= bounds.scale;
-  lmin.y *= bounds.scale;
-
-  lpos_t lmax = pbounds.max.toLpos();
-  lmax.x -= bounds.center.x;
-  lmax.y -= bounds.center.y;
-  lmax.x *= bounds.scale;
-  lmax.y *= bounds.scale;
-
-  wms_t::size_t ret;
-  ret.width = lmax.x - lmin.x;
-  ret.height = lmax.y - lmin.y;
-
-  size_t m = std::max(ret.width, ret.height);
-  if (m > 2048) {
-    ret.width *= 2048;
-    ret.width /= m;
-    ret.height *= 2048;
-    ret.height /= m;
-  }
-
-  printf("WMS: required image size = %dx%d\n", ret.width, ret.height);
-
-  return ret;
-}
-
 } // namespace
 
 /* ---------------------- use ------------------- */
@@ -454,7 +419,7 @@ wms_get_layers(osm2go_platform::Widget *parent, wms_t &wms)
     error_dlg(trstring("WMS download failed:\n\n"
               "XML error while parsing capabilities:\n%1").arg(errP->message));
   } else {
-    printf("ok, parse doc tree\n");
+    OSM2GO_LOG(Wms, Debug, "ok, parse doc tree");
 
     parse_success = wms_cap_parse_root(wms, doc.get());
   }
@@ -474,7 +439,7 @@ wms_get_layers(osm2go_platform::Widget *parent, wms_t &wms)
   }
 
   /* ---------- evaluate layers ----------- */
-  printf("\nSearching for usable layers\n");
+  OSM2GO_LOG(Wms, Debug, "Searching for usable layers");
 
   requestable_layers_functor fc(layers);
 
@@ -489,54 +454,27 @@ wms_get_layers(osm2go_platform::Widget *parent, wms_t &wms)
   return layers;
 }
 
-std::string
-wms_get_selected_layer(osm2go_platform::Widget *parent, project_t::ref project, wms_t &wms,
-                       const std::string &layers, const std::string &srss)
+/**
+ * @brief store the selected layer in the project
+ */
+void
+wms_set_selected_layer(project_t::ref project, wms_t &wms, const std::string &layers,
+                       const std::string &srss)
 {
-  /* get required image size */
-  wms.size = wms_setup_extent(project->bounds);
-
-  /* uses epsg4326 if possible */
-  const char *srs = srss.empty() ? wms_layer_t::EPSG4326() : srss.c_str();
-
-  /* build strings of min and max lat and lon to be used in url */
-  const std::string coords = project->bounds.print();
-
-  /* find preferred supported video format */
+  /* find preferred supported image format */
   const FormatMap &ImageFormats = imageFormats();
   const FormatMap::const_iterator itEnd = ImageFormats.end();
   FormatMap::const_iterator it = std::find_if(std::cbegin(ImageFormats), itEnd,
                                               find_format_reverse_functor(wms.cap.request.format));
   assert(it != itEnd);
 
-  char buf[64];
-  sprintf(buf, "&WIDTH=%d&HEIGHT=%d&FORMAT=", wms.size.width, wms.size.height);
-
-  /* build complete url */
-  const std::array<const char *, 7> parts = { {
-  /* append styles entry */
-  // it is required, but it may be entirely empty since at least version 1.1.0
-  // meaning "default styles for all layers"
-                          "&STYLES="
-                          "&SRS=", srs, "&BBOX=", coords.c_str(),
-                          buf, it->first, "&reaspect=false"
-                          } };
-  const std::string url = std::accumulate(parts.begin(), parts.end(), wmsUrl(wms.server, "Map&LAYERS=") + layers);
-
-  const ExtensionMap &ImageFormatExtensions = imageFormatExtensions();
-  ExtensionMap::const_iterator extIt = ImageFormatExtensions.find(it->second);
-  assert(extIt != ImageFormatExtensions.end());
-  const std::string filename = project->path + "wms." + extIt->second;
-
   /* remove any existing image before */
   wms_remove_file(*project);
 
-  trstring::native_type wtitle = _("WMS layer");
-  if(!net_io_download_file(parent, url, filename, wtitle))
-    return std::string();
-
-  /* there should be a matching file on disk now */
-  return filename;
+  project->wms_layers = layers;
+  /* uses epsg4326 if possible */
+  project->wms_srs = srss.empty() ? wms_layer_t::EPSG4326() : srss;
+  project->wms_format = it->first;
 }
 
 } // namespace
@@ -579,6 +517,10 @@ void wms_remove_file(project_t &project) {
 
     unlinkat(project.dirfd, filename.c_str(), 0);
   }
+
+  project.wms_layers.clear();
+  project.wms_srs.clear();
+  project.wms_format.clear();
 }
 
 namespace {
@@ -604,7 +546,7 @@ std::vector<wms_server_t *> wms_server_get_default()
   return servers;
 }
 
-std::string
+bool
 wms_import(osm2go_platform::Widget *parent, project_t::ref project)
 {
   assert(project);
@@ -618,18 +560,326 @@ wms_import(osm2go_platform::Widget *parent, project_t::ref project)
   /* get server from dialog */
   std::string srv = wms_server_dialog(parent, project->wms_server);
   if (srv.empty())
-    return std::string();
+    return false;
 
   /* ------------- copy values back into project ---------------- */
   project->wms_server.swap(srv);
 
   const wms_layer_t::list layers = wms_get_layers(parent, wms);
   if(layers.empty())
-    return std::string();
+    return false;
 
   const std::string &l = wms_layer_dialog(parent, project->bounds, layers);
-  if(!l.empty())
-    return wms_get_selected_layer(parent, project, wms, l, layers.front().srs);
+  if(l.empty())
+    return false;
+
+  wms_set_selected_layer(project, wms, l, layers.front().srs);
+
+  return true;
+}
+
+/* ---------------------- tiles ------------------- */
+
+namespace {
+
+inline double
+tile_span(unsigned int zoom)
+{
+  return 360.0 / (1u << zoom);
+}
+
+} // namespace
+
+pos_area wms_tile_t::bounds() const
+{
+  const double span = tile_span(zoom);
+
+  return pos_area(pos_t(90.0 - (y + 1) * span, x * span - 180.0),
+                  pos_t(90.0 - y * span, (x + 1) * span - 180.0));
+}
+
+std::string wms_tile_t::cacheName(const char *extension) const
+{
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%u/%u/%u.%s", zoom, x, y, extension);
+
+  return buf;
+}
+
+unsigned int wms_tile_zoom(double degPerPixel)
+{
+  if(unlikely(!(degPerPixel > 0)))
+    return wms_tile_t::MaxZoom;
+
+  // the first zoom level where one tile pixel is not bigger than a screen pixel
+  const double z = std::ceil(std::log2(360.0 / (wms_tile_t::Pixels * degPerPixel)));
+
+  if(z < wms_tile_t::MinZoom)
+    return wms_tile_t::MinZoom;
+  if(z > wms_tile_t::MaxZoom)
+    return wms_tile_t::MaxZoom;
+  return static_cast<unsigned int>(z);
+}
+
+std::vector<wms_tile_t> wms_tiles_for_area(const pos_area &area, unsigned int zoom)
+{
+  std::vector<wms_tile_t> ret;
+
+  if(unlikely(!area.valid() || !area.normalized()))
+    return ret;
+
+  const double span = tile_span(zoom);
+  const unsigned int columns = 1u << zoom;
+  const unsigned int rows = columns / 2;
+
+  const unsigned int xmin = std::floor((area.min.lon + 180.0) / span);
+  const unsigned int xmax = std::min<unsigned int>(std::floor((area.max.lon + 180.0) / span), columns - 1);
+  const unsigned int ymin = std::floor((90.0 - area.max.lat) / span);
+  const unsigned int ymax = std::min<unsigned int>(std::floor((90.0 - area.min.lat) / span), rows - 1);
+
+  ret.reserve((xmax - xmin + 1) * (ymax - ymin + 1));
+  for(unsigned int y = ymin; y <= ymax; y++)
+    for(unsigned int x = xmin; x <= xmax; x++)
+      ret.push_back(wms_tile_t(zoom, x, y));
+
+  return ret;
+}
+
+std::string wms_tile_cache_key(const std::string &server, const std::string &layers,
+                               const std::string &srs, const std::string &format)
+{
+  // FNV-1a, the key must be stable across program runs
+  uint64_t hash = 14695981039346656037ULL;
+  const std::array<const std::string *, 4> parts = { { &server, &layers, &srs, &format } };
+  for(unsigned int i = 0; i < parts.size(); i++) {
+    const std::string &part = *parts[i];
+    for(std::string::size_type j = 0; j < part.size(); j++) {
+      hash ^= static_cast<unsigned char>(part[j]);
+      hash *= 1099511628211ULL;
+    }
+    // separator, so "ab" + "c" differs from "a" + "bc"
+    hash *= 1099511628211ULL;
+  }
+
+  char buf[17];
+  snprintf(buf, sizeof(buf), "%016" PRIx64, hash);
+
+  return buf;
+}
+
+std::string wms_tile_url(const std::string &server, const std::string &layers,
+                         const std::string &srs, const std::string &format, const wms_tile_t &tile)
+{
+  char buf[64];
+  snprintf(buf, sizeof(buf), "&WIDTH=%d&HEIGHT=%d&FORMAT=", wms_tile_t::Pixels, wms_tile_t::Pixels);
+
+  const std::string coords = tile.bounds().print();
+
+  /* build complete url */
+  const std::array<const char *, 7> parts = { {
+  // it is required, but it may be entirely empty since at least version 1.1.0
+  // meaning "default styles for all layers"
+                          "&STYLES="
+                          "&SRS=", srs.c_str(), "&BBOX=", coords.c_str(),
+                          buf, format.c_str(), "&reaspect=false"
+                          } };
+  return std::accumulate(parts.begin(), parts.end(), wmsUrl(server, "Map&LAYERS=") + layers);
+}
+
+const char *wms_format_extension(const std::string &format)
+{
+  const FormatMap &ImageFormats = imageFormats();
+  const FormatMap::const_iterator it = ImageFormats.find(format.c_str());
+  if(unlikely(it == ImageFormats.end()))
+    return nullptr;
+
+  const ExtensionMap &ImageFormatExtensions = imageFormatExtensions();
+  const ExtensionMap::const_iterator extIt = ImageFormatExtensions.find(it->second);
+  assert(extIt != ImageFormatExtensions.end());
+
+  return extIt->second;
+}
+
+void wms_tile_backoff::failed(const wms_tile_t &tile, time_t now)
+{
+  failure &f = failures[tile];
+  unsigned int delay = FirstDelay;
+  for(unsigned int i = 0; i < f.count && delay < MaxDelay; i++)
+    delay *= 2;
+  f.until = now + std::min<unsigned int>(delay, MaxDelay);
+  f.count++;
+}
+
+bool wms_tile_backoff::blocked(const wms_tile_t &tile, time_t now) const
+{
+  const std::map<wms_tile_t, failure>::const_iterator it = failures.find(tile);
+
+  return it != failures.end() && now < it->second.until;
+}
+
+wms_tiles_t::wms_tiles_t(const project_t &project, const std::string &cachebase)
+  : server(project.wms_server)
+  , layers(project.wms_layers)
+  , srs(project.wms_srs)
+  , format(project.wms_format)
+  , extension(wms_format_extension(format))
+  , cachedir(cachebase + wms_tile_cache_key(server, layers, srs, format) + '/')
+  , lbounds(project.osm->bounds)
+  , canvas(nullptr)
+  , zoom(0)
+{
+}
+
+wms_tiles_t::~wms_tiles_t()
+{
+}
+
+std::string wms_tiles_t::tileUrl(const wms_tile_t &tile) const
+{
+  return wms_tile_url(server, layers, srs, format, tile);
+}
+
+std::string wms_tiles_t::tileFile(const wms_tile_t &tile) const
+{
+  return cachedir + tile.cacheName(extension);
+}
+
+std::vector<wms_tile_t> wms_tiles_t::tiles(const pos_area &area, double degPerPixel) const
+{
+  // only the project area is interesting
+  const pos_area &pbounds = lbounds.ll;
+  const pos_area clipped(pos_t(std::max(area.min.lat, pbounds.min.lat), std::max(area.min.lon, pbounds.min.lon)),
+                         pos_t(std::min(area.max.lat, pbounds.max.lat), std::min(area.max.lon, pbounds.max.lon)));
+
+  std::vector<wms_tile_t> ret;
+  for(unsigned int z = wms_tile_zoom(degPerPixel); z >= wms_tile_t::MinZoom; z--) {
+    ret = wms_tiles_for_area(clipped, z);
+    if(ret.size() <= MaxTiles)
+      break;
+  }
+
+  return ret;
+}
+
+bool wms_tiles_t::update(canvas_t *cv)
+{
+  lpos_t vmin, vmax;
+  cv->visible_area(vmin, vmax);
+  if(vmax.x <= vmin.x || vmax.y <= vmin.y)
+    return false;
+
+  // the y axis is inverted on the canvas
+  const pos_t topleft = vmin.toPos(lbounds);
+  const pos_t bottomright = vmax.toPos(lbounds);
+  const pos_area area(pos_t(bottomright.lat, topleft.lon), pos_t(topleft.lat, bottomright.lon));
+
+  return show(cv, area, area.lonDist() / ((vmax.x - vmin.x) * cv->get_zoom()));
+}
+
+bool wms_tiles_t::show(canvas_t *cv, const pos_area &area, double degPerPixel)
+{
+  if(unlikely(extension == nullptr))
+    return false;
+
+  canvas = cv;
+  current = tiles(area, degPerPixel);
+  if(current.empty())
+    return false;
+
+  // a new zoom level replaces all tiles, otherwise only new ones are added
+  if(current.front().zoom != zoom) {
+    canvas->clear_background_tiles();
+    shown.clear();
+    zoom = current.front().zoom;
+  }
+
+  // tiles of an earlier view that are not yet requested are no longer interesting
+  wanted.clear();
+
+  bool complete = true;
+  const time_t now = time(nullptr);
+  for(std::vector<wms_tile_t>::const_iterator it = current.begin(); it != current.end(); it++) {
+    if(isShown(*it))
+      continue;
+
+    // every file is checked only once, later the downloads keep track of it
+    std::map<wms_tile_t, bool>::iterator cit = incache.find(*it);
+    if(cit == incache.end())
+      cit = incache.insert(std::make_pair(*it, std::filesystem::is_regular_file(tileFile(*it)))).first;
+
+    if(cit->second)
+      showTile(*it);
+    if(isShown(*it))
+      continue;
+
+    complete = false;
+    if(!backoff.blocked(*it, now))
+      wanted.push_back(*it);
+  }
+
+  requestTiles();
+
+  return complete;
+}
+
+void wms_tiles_t::showTile(const wms_tile_t &tile)
+{
+  const std::string fname = tileFile(tile);
+  const pos_area tb = tile.bounds();
+  const lpos_t tmin = pos_t(tb.max.lat, tb.min.lon).toLpos(lbounds);
+  const lpos_t tmax = pos_t(tb.min.lat, tb.max.lon).toLpos(lbounds);
+
+  if(likely(canvas->add_background_tile(fname, tmin, tmax))) {
+    shown.insert(tile);
+    return;
+  }
+
+  // a broken file would otherwise stay in the cache forever
+  OSM2GO_LOG(Wms, Warning, "WMS: removing unusable tile %s", fname.c_str());
+  unlink(fname.c_str());
+  incache[tile] = false;
+  backoff.failed(tile, time(nullptr));
+}
+
+void wms_tiles_t::requestTiles()
+{
+  while(!wanted.empty() && (!downloader || downloader->pending() < ParallelDownloads)) {
+    const wms_tile_t tile = wanted.front();
+    wanted.pop_front();
+
+    const std::string fname = tileFile(tile);
+    if(requested.find(fname) != requested.end())
+      continue;
+    if(unlikely(!osm2go_platform::create_directories(fname.substr(0, fname.rfind('/')))))
+      continue;
+
+    if(!downloader)
+      downloader.reset(net_io_async_t::create(ParallelDownloads, downloaded, this));
+
+    requested.insert(std::make_pair(fname, tile));
+    downloader->add(net_io_file_request(tileUrl(tile), fname));
+  }
+}
+
+void wms_tiles_t::downloaded(void *context, const net_io_file_request &request)
+{
+  wms_tiles_t * const wt = static_cast<wms_tiles_t *>(context);
+
+  const std::map<std::string, wms_tile_t>::iterator it = wt->requested.find(request.filename);
+  assert(it != wt->requested.end());
+  const wms_tile_t tile = it->second;
+  wt->requested.erase(it);
+
+  if(request.ok) {
+    wt->backoff.succeeded(tile);
+    wt->incache[tile] = true;
+    // the view may have changed in the mean time
+    if(!wt->isShown(tile) && std::find(wt->current.begin(), wt->current.end(), tile) != wt->current.end())
+      wt->showTile(tile);
+  } else {
+    OSM2GO_LOG(Wms, Warning, "WMS: downloading %s failed", request.url.c_str());
+    wt->backoff.failed(tile, time(nullptr));
+  }
 
-  return std::string();
+  wt->requestTiles();
 }
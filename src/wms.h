@@ -10,9 +10,18 @@
 
 #include <osm2go_platform.h>
 
+#include <ctime>
+#include <deque>
+#include <map>
+#include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
+class canvas_t;
+class net_io_async_t;
+struct net_io_file_request;
+
 struct wms_server_t {
   explicit inline wms_server_t() {}
   explicit inline wms_server_t(const char *n, const char *s) __attribute__ ((nonnull(2,3)))
@@ -20,8 +29,192 @@ struct wms_server_t {
   std::string name, server;
 };
 
-std::string wms_import(osm2go_platform::Widget *parent, project_t::ref project);
+/**
+ * @brief a tile of a tiled WMS background
+ *
+ * The tiles form a regular grid in EPSG:4326. On zoom level z every tile
+ * spans 360/2^z degrees in both directions, the tile 0/0 starts at 180 W 90 N.
+ */
+struct wms_tile_t {
+  enum {
+    Pixels = 256,  ///< width and height of a tile image
+    MinZoom = 1,
+    MaxZoom = 24
+  };
+
+  inline wms_tile_t(unsigned int z, unsigned int tx, unsigned int ty) noexcept
+    : zoom(z), x(tx), y(ty) {}
+
+  unsigned int zoom, x, y;
+
+  inline bool operator<(const wms_tile_t &other) const noexcept
+  {
+    if(zoom != other.zoom)
+      return zoom < other.zoom;
+    if(x != other.x)
+      return x < other.x;
+    return y < other.y;
+  }
+  inline bool operator==(const wms_tile_t &other) const noexcept
+  { return zoom == other.zoom && x == other.x && y == other.y; }
+
+  /**
+   * @brief the area covered by this tile
+   */
+  pos_area bounds() const;
+
+  /**
+   * @brief the path of the cached image relative to the layer cache directory
+   */
+  std::string cacheName(const char *extension) const;
+};
+
+/**
+ * @brief select a WMS layer as background for the project
+ * @returns if a tiled background layer was configured
+ *
+ * The layer is stored in the project, the tiles are loaded by wms_tiles_t.
+ */
+bool wms_import(osm2go_platform::Widget *parent, project_t::ref project);
+
+/**
+ * @brief find the background image of a project using a single image
+ *
+ * These are created by older versions, new imports are always tiled.
+ */
 std::string wms_find_file(const std::string &project_path);
+
+/**
+ * @brief remove the background image and layer configuration of the project
+ */
 void wms_remove_file(project_t &project);
 
+/**
+ * @brief remembers tiles that could not be downloaded
+ *
+ * A failed tile is only requested again after a delay that doubles with every
+ * further failure, so an unreachable server is not asked on every change of
+ * the view.
+ */
+class wms_tile_backoff {
+  struct failure {
+    time_t until;        ///< no new request before this time
+    unsigned int count;  ///< number of consecutive failures
+  };
+  std::map<wms_tile_t, failure> failures;
+
+public:
+  enum {
+    FirstDelay = 30,     ///< seconds to wait after the first failure
+    MaxDelay = 3600
+  };
+
+  void failed(const wms_tile_t &tile, time_t now);
+  inline void succeeded(const wms_tile_t &tile)
+  { failures.erase(tile); }
+
+  /**
+   * @brief check if the tile may not be requested yet
+   */
+  bool blocked(const wms_tile_t &tile, time_t now) const;
+};
+
+/**
+ * @brief a WMS background made of tiles loaded on demand
+ *
+ * The tiles are kept in an on-disk cache shared by all projects using the
+ * same layer. Missing tiles are downloaded in the background and added to
+ * the canvas once they arrive.
+ */
+class wms_tiles_t {
+  const std::string server;
+  const std::string layers;
+  const std::string srs;
+  const std::string format;
+  const char * const extension;
+  const std::string cachedir;    ///< directory of the cached tiles, ends with '/'
+  const bounds_t lbounds;        ///< the projection used for the canvas
+
+  canvas_t *canvas;              ///< the canvas of the last update
+  std::vector<wms_tile_t> current; ///< the tiles needed for the current view
+  std::set<wms_tile_t> shown;    ///< the tiles currently on the canvas
+  std::map<wms_tile_t, bool> incache; ///< tiles already checked if they are in the cache
+  std::deque<wms_tile_t> wanted; ///< tiles of the current view still to be requested
+  std::map<std::string, wms_tile_t> requested; ///< the running downloads by file name
+  wms_tile_backoff backoff;
+  std::unique_ptr<net_io_async_t> downloader;
+  unsigned int zoom;             ///< the zoom level of the shown tiles
+
+  /**
+   * @brief put the tile on the canvas
+   *
+   * A file that can not be loaded is removed from the cache.
+   */
+  void showTile(const wms_tile_t &tile);
+
+  /**
+   * @brief start downloads for the wanted tiles
+   */
+  void requestTiles();
+
+  static void downloaded(void *context, const net_io_file_request &request);
+
+public:
+  explicit wms_tiles_t(const project_t &project, const std::string &cachebase);
+  ~wms_tiles_t();
+
+  enum {
+    MaxTiles = 64,       ///< maximum number of tiles shown at once
+    ParallelDownloads = 4
+  };
+
+  inline const std::string &cacheDir() const noexcept
+  { return cachedir; }
+
+  /**
+   * @brief show the tiles for the visible area
+   * @param cv the canvas to draw on
+   * @returns if the tiles cover the visible area
+   *
+   * Tiles not in the cache are downloaded in the background and shown once
+   * they arrive. This does not block.
+   */
+  bool update(canvas_t *cv);
+
+  /**
+   * @brief show the tiles for the given area
+   * @param cv the canvas to draw on
+   * @param area the visible area
+   * @param degPerPixel the current resolution
+   * @returns if the tiles cover the visible area
+   *
+   * This is update() with the view given explicitely.
+   */
+  bool show(canvas_t *cv, const pos_area &area, double degPerPixel);
+
+  /**
+   * @brief get the tiles needed for the given area and zoom level
+   * @param area the visible area
+   * @param degPerPixel the current resolution
+   *
+   * The zoom level is reduced if the area would need more than MaxTiles.
+   */
+  std::vector<wms_tile_t> tiles(const pos_area &area, double degPerPixel) const;
+
+  std::string tileUrl(const wms_tile_t &tile) const;
+  std::string tileFile(const wms_tile_t &tile) const;
+
+  /**
+   * @brief the number of tiles being downloaded or waiting for it
+   */
+  inline size_t pending() const
+  { return requested.size() + wanted.size(); }
+
+  /**
+   * @brief check if the tile is currently on the canvas
+   */
+  inline bool isShown(const wms_tile_t &tile) const
+  { return shown.find(tile) != shown.end(); }
+};
+
 std::vector<wms_server_t *> wms_server_get_default(void);
@@ -50,3 +50,34 @@ struct wms_layer_t {
 bool wms_llbbox_fits(const pos_area &bounds, const wms_llbbox_t &llbbox);
 std::string wms_layer_dialog(osm2go_platform::Widget *parent, const pos_area &bounds, const wms_layer_t::list &layers);
 std::string wms_server_dialog(osm2go_platform::Widget *parent, const std::string &wms_server);
+
+/**
+ * @brief the zoom level whose tiles have about the given resolution
+ * @param degPerPixel the resolution in degrees per screen pixel
+ */
+unsigned int wms_tile_zoom(double degPerPixel);
+
+/**
+ * @brief all tiles of the given zoom level intersecting area
+ */
+std::vector<wms_tile_t> wms_tiles_for_area(const pos_area &area, unsigned int zoom);
+
+/**
+ * @brief the directory name of the tile cache for the given layer
+ *
+ * Every combination of server, layers, SRS, and format gets an own directory.
+ */
+std::string wms_tile_cache_key(const std::string &server, const std::string &layers,
+                               const std::string &srs, const std::string &format);
+
+/**
+ * @brief the GetMap request for a single tile
+ */
+std::string wms_tile_url(const std::string &server, const std::string &layers,
+                         const std::string &srs, const std::string &format, const wms_tile_t &tile);
+
+/**
+ * @brief the file extension for the given image MIME type
+ * @returns the extension or nullptr if the format is not supported
+ */
+const char *wms_format_extension(const std::string &format);
@@ -0,0 +1,231 @@
+#include <cache_set.h>
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <osm2go_annotations.h>
+#include <osm2go_cpp.h>
+
+namespace {
+
+void testBasic()
+{
+  cache_set cache;
+
+  assert(cache.insert(static_cast<const char *>(nullptr)) == nullptr);
+  assert(cache.insert(std::string()) == nullptr);
+  assert_cmpnum(cache.size(), 0);
+
+  const char *a = cache.insert("highway");
+  assert(a != nullptr);
+  assert_cmpstr(a, "highway");
+  assert_cmpnum(cache_set::length(a), 7);
+
+  // same string gives the same pointer, no matter how it is passed
+  const std::string hw = "highway";
+  assert(cache.insert(hw) == a);
+  assert(cache.insert("highwayfoo", 7) == a);
+  assert(cache.getValue("highway") == a);
+  assert(cache.getValue(hw.c_str(), hw.size()) == a);
+  assert_cmpnum(cache.size(), 1);
+
+  // a prefix is a different string, and the result is always terminated
+  const char *b = cache.insert("highwayfoo", 4);
+  assert(b != a);
+  assert_cmpstr(b, "high");
+  assert_cmpnum(cache_set::length(b), 4);
+
+  assert(cache.getValue("residential") == nullptr);
+
+  // empty strings can be cached
+  const char *e = cache.insert("");
+  assert(e != nullptr);
+  assert_cmpstr(e, "");
+  assert(cache.insert("", 0) == e);
+  assert_cmpnum(cache.size(), 3);
+}
+
+/**
+ * @brief many and long strings, the pointers must stay stable while the table grows
+ */
+void testMany()
+{
+  cache_set cache;
+  std::vector<const char *> ptrs;
+  std::vector<std::string> values;
+
+  for(unsigned int i = 0; i < 20000; i++) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "value%u", i);
+    values.push_back(buf);
+  }
+  // longer than a single arena block
+  values.push_back(std::string(100000, 'x'));
+  values.push_back(std::string(20000, 'y'));
+
+  for(size_t i = 0; i < values.size(); i++)
+    ptrs.push_back(cache.insert(values[i]));
+
+  assert_cmpnum(cache.size(), values.size());
+  for(size_t i = 0; i < values.size(); i++) {
+    assert(cache.insert(values[i]) == ptrs[i]);
+    assert_cmpstr(ptrs[i], values[i]);
+    assert_cmpnum(cache_set::length(ptrs[i]), values[i].size());
+  }
+
+  std::string total;
+  for(size_t i = 0; i < values.size(); i++)
+    total += values[i];
+  assert_cmpnum_op(cache.memory_size(), >, total.size());
+}
+
+void testGenerations()
+{
+  cache_set cache;
+
+  const char *perm = cache.insert("permanent");
+  const unsigned int g1 = cache.newGeneration();
+  const unsigned int g2 = cache.newGeneration();
+  assert(g1 != 0);
+  assert(g1 != g2);
+
+  const char *only1;
+  const char *shared;
+  const char *promoted;
+  {
+    cache_set::generation_scope scope(cache, g1);
+    // already permanent
+    assert(cache.insert("permanent") == perm);
+    only1 = cache.insert("only1");
+    shared = cache.insert("shared");
+    promoted = cache.insert("promoted");
+    // the same generation again does not change anything
+    assert(cache.insert("only1") == only1);
+  }
+  {
+    cache_set::generation_scope scope(cache, g2);
+    assert(cache.insert("shared") == shared);
+    cache.insert("only2");
+  }
+  // used outside of any generation
+  assert(cache.insert("promoted") == promoted);
+  assert_cmpnum(cache.size(), 5);
+
+  // getValue() does not count as use
+  assert(cache.getValue("only1") == only1);
+
+  cache.releaseGeneration(g1);
+  assert_cmpnum(cache.size(), 4);
+  assert(cache.getValue("only1") == nullptr);
+  assert(cache.getValue("permanent") == perm);
+  assert(cache.getValue("shared") == shared);
+  assert(cache.getValue("promoted") == promoted);
+  assert_cmpstr(shared, "shared");
+  assert_cmpstr(promoted, "promoted");
+
+  cache.releaseGeneration(g2);
+  assert_cmpnum(cache.size(), 3);
+  assert(cache.getValue("only2") == nullptr);
+  assert(cache.getValue("shared") == shared);
+
+  // a released string can be added again
+  const char *again = cache.insert("only1");
+  assert_cmpstr(again, "only1");
+  assert(cache.insert("only1") == again);
+  assert_cmpnum(cache.size(), 4);
+
+  // a generation without strings
+  cache.releaseGeneration(cache.newGeneration());
+  assert_cmpnum(cache.size(), 4);
+}
+
+/**
+ * @brief releasing a generation frees its memory
+ */
+void testReclaim()
+{
+  cache_set cache;
+  cache.insert("base");
+  const size_t base = cache.memory_size();
+
+  const unsigned int g = cache.newGeneration();
+  {
+    cache_set::generation_scope scope(cache, g);
+    for(unsigned int i = 0; i < 50000; i++) {
+      char buf[32];
+      snprintf(buf, sizeof(buf), "value%u", i);
+      cache.insert(buf);
+    }
+  }
+  const size_t full = cache.memory_size();
+  assert_cmpnum_op(full, >, base + 50000 * 6);
+
+  cache.releaseGeneration(g);
+  assert_cmpnum(cache.size(), 1);
+  // the table has grown, but the memory of the strings is gone
+  assert_cmpnum_op(cache.memory_size() + 50000 * 16, <, full);
+  assert(cache.getValue("base") != nullptr);
+}
+
+void fillGeneration(cache_set *cache, unsigned int generation, std::vector<const char *> *ptrs)
+{
+  cache_set::generation_scope scope(*cache, generation);
+  for(unsigned int i = 0; i < 20000; i++) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "thread%u_%u", generation, i);
+    ptrs->push_back(cache->insert(buf));
+    // shared by both threads, so it becomes permanent
+    cache->insert(buf + strlen("thread") + 1);
+  }
+}
+
+/**
+ * @brief the active generation is per thread, and concurrent inserts are safe
+ */
+void testThreads()
+{
+  cache_set cache;
+  const unsigned int g1 = cache.newGeneration();
+  const unsigned int g2 = cache.newGeneration();
+  assert(g1 < 10 && g2 < 10);
+
+  std::vector<const char *> p1, p2;
+  std::thread t1(fillGeneration, &cache, g1, &p1);
+  std::thread t2(fillGeneration, &cache, g2, &p2);
+  // this thread has no active generation, so this string is permanent
+  const char *perm = cache.insert("main");
+  t1.join();
+  t2.join();
+
+  assert_cmpnum(cache.size(), 3 * 20000 + 1);
+  for(unsigned int i = 0; i < p1.size(); i++)
+    assert(cache.getValue(p1[i]) == p1[i]);
+
+  cache.releaseGeneration(g1);
+  assert_cmpnum(cache.size(), 2 * 20000 + 1);
+  assert(cache.getValue(p2.front()) == p2.front());
+  assert(cache.getValue("_0") != nullptr);
+  assert(cache.getValue("main") == perm);
+
+  cache.releaseGeneration(g2);
+  assert_cmpnum(cache.size(), 20000 + 1);
+}
+
+} // namespace
+
+int main()
+{
+  testBasic();
+  testMany();
+  testGenerations();
+  testReclaim();
+  testThreads();
+
+  return 0;
+}
+
+#include "dummy_appdata.h"
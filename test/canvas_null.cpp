@@ -0,0 +1,276 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Rolf Eike Beer <eike@sf-mail.de>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/**
+ * @file canvas_null.cpp
+ *
+ * canvas implementation that does not draw anything, used for benchmarking
+ * the map code without any toolkit overhead
+ */
+
+#include "canvas_null.h"
+
+#include <canvas_p.h>
+
+#include <vector>
+
+#include <osm2go_annotations.h>
+
+struct canvas_item_null {
+  canvas_item_null(canvas_null *cv, canvas_group_t g)
+    : canvas(cv), group(g), user_data(nullptr) {}
+  ~canvas_item_null();
+
+  canvas_null * const canvas;
+  const canvas_group_t group;
+  map_item_t *user_data;
+  std::vector<canvas_item_destroyer *> destroyers;
+};
+
+canvas_item_null::~canvas_item_null()
+{
+  canvas_item_t * const item = reinterpret_cast<canvas_item_t *>(this);
+  for(size_t i = 0; i < destroyers.size(); i++) {
+    destroyers[i]->run(item);
+    delete destroyers[i];
+  }
+}
+
+canvas_null::canvas_null()
+  : canvas_t(nullptr)
+  , bgpos(0, 0)
+  , zoom(1.0)
+{
+}
+
+canvas_null::~canvas_null()
+{
+  // the destroyers may not delete other items, so this is safe
+  const std::unordered_set<canvas_item_null *> all = std::move(items);
+  for(std::unordered_set<canvas_item_null *>::const_iterator it = all.begin(); it != all.end(); it++)
+    delete *it;
+}
+
+canvas_item_t *canvas_null::item_new(canvas_group_t group)
+{
+  canvas_item_null * const item = new canvas_item_null(this, group);
+  items.insert(item);
+  return reinterpret_cast<canvas_item_t *>(item);
+}
+
+lpos_t canvas_t::window2world(const osm2go_platform::screenpos &p) const
+{
+  const double zoom = static_cast<const canvas_null *>(this)->zoom;
+  return lpos_t(p.x() / zoom, p.y() / zoom);
+}
+
+osm2go_platform::screenpos canvas_t::scroll_get() const
+{
+  return osm2go_platform::screenpos(0, 0);
+}
+
+void canvas_t::set_background(color_t)
+{
+}
+
+bool canvas_t::set_background(const std::string &)
+{
+  return false;
+}
+
+bool canvas_t::add_background_tile(const std::string &, lpos_t, lpos_t)
+{
+  return false;
+}
+
+void canvas_t::clear_background_tiles()
+{
+}
+
+void canvas_t::move_background(int x, int y)
+{
+  static_cast<canvas_null *>(this)->bgpos = lpos_t(x, y);
+}
+
+lpos_t canvas_t::background_position() const
+{
+  return static_cast<const canvas_null *>(this)->bgpos;
+}
+
+void canvas_t::visible_area(lpos_t &min, lpos_t &max) const
+{
+  min = lpos_t(0, 0);
+  max = lpos_t(0, 0);
+}
+
+void canvas_t::erase(unsigned int group_mask)
+{
+  canvas_null * const cn = static_cast<canvas_null *>(this);
+  std::vector<canvas_item_null *> gone;
+
+  for(std::unordered_set<canvas_item_null *>::const_iterator it = cn->items.begin(); it != cn->items.end(); it++)
+    if(group_mask & (1 << (*it)->group))
+      gone.push_back(*it);
+
+  for(size_t i = 0; i < gone.size(); i++)
+    delete reinterpret_cast<canvas_item_t *>(gone[i]);
+}
+
+canvas_item_t *canvas_t::get_item_at(lpos_t) const
+{
+  return nullptr;
+}
+
+canvas_item_t *canvas_t::get_next_item_at(lpos_t, canvas_item_t *) const
+{
+  return nullptr;
+}
+
+double canvas_t::set_zoom(double zoom)
+{
+  static_cast<canvas_null *>(this)->zoom = zoom;
+  return zoom;
+}
+
+double canvas_t::get_zoom() const
+{
+  return static_cast<const canvas_null *>(this)->zoom;
+}
+
+osm2go_platform::screenpos canvas_t::scroll_to(const osm2go_platform::screenpos &s)
+{
+  return s;
+}
+
+osm2go_platform::screenpos canvas_t::scroll_step(const osm2go_platform::screenpos &d)
+{
+  return d;
+}
+
+void canvas_t::set_bounds(lpos_t, lpos_t)
+{
+}
+
+canvas_item_circle *canvas_t::circle_new(canvas_group_t group, lpos_t c, float radius, int border,
+                                         color_t, color_t)
+{
+  canvas_item_t * const item = static_cast<canvas_null *>(this)->item_new(group);
+
+  if(CANVAS_SELECTABLE & (1 << group))
+    (void) new canvas_item_info_circle(this, item, c, static_cast<unsigned int>(radius) + border);
+
+  return static_cast<canvas_item_circle *>(item);
+}
+
+canvas_item_polyline *canvas_t::polyline_new(canvas_group_t group, const std::vector<lpos_t> &points,
+                                             float width, color_t)
+{
+  canvas_item_t * const item = static_cast<canvas_null *>(this)->item_new(group);
+
+  if(CANVAS_SELECTABLE & (1 << group))
+    (void) new canvas_item_info_poly(this, item, false, width, points);
+
+  return static_cast<canvas_item_polyline *>(item);
+}
+
+canvas_item_t *canvas_t::polygon_new(canvas_group_t group, const std::vector<lpos_t> &points,
+                                     float width, color_t, color_t)
+{
+  canvas_item_t * const item = static_cast<canvas_null *>(this)->item_new(group);
+
+  if(CANVAS_SELECTABLE & (1 << group))
+    (void) new canvas_item_info_poly(this, item, true, width, points);
+
+  return item;
+}
+
+canvas_item_pixmap *canvas_t::image_new(canvas_group_t group, icon_item *, lpos_t pos, float scale)
+{
+  canvas_item_t * const item = static_cast<canvas_null *>(this)->item_new(group);
+
+  if(CANVAS_SELECTABLE & (1 << group))
+    (void) new canvas_item_info_circle(this, item, pos, static_cast<unsigned int>(12 * scale));
+
+  return static_cast<canvas_item_pixmap *>(item);
+}
+
+canvas_item_t *canvas_t::markers_new(canvas_group_t group, const std::vector<lpos_t> &centers,
+                                     float radius, color_t)
+{
+  canvas_item_t * const item = static_cast<canvas_null *>(this)->item_new(group);
+
+  if(CANVAS_SELECTABLE & (1 << group))
+    (void) new canvas_item_info_markers(this, item, centers, static_cast<unsigned int>(radius));
+
+  return item;
+}
+
+canvas_item_t *canvas_t::polylines_new(canvas_group_t group, const std::vector<std::vector<lpos_t> > &,
+                                       float, color_t)
+{
+  return static_cast<canvas_null *>(this)->item_new(group);
+}
+
+canvas_item_t *canvas_t::polygons_new(canvas_group_t group, const std::vector<std::vector<lpos_t> > &,
+                                      color_t)
+{
+  return static_cast<canvas_null *>(this)->item_new(group);
+}
+
+bool canvas_t::ensureVisible(const lpos_t)
+{
+  return false;
+}
+
+void canvas_item_t::operator delete(void *ptr)
+{
+  if(unlikely(ptr == nullptr))
+    return;
+
+  canvas_item_null * const item = static_cast<canvas_item_null *>(ptr);
+  item->canvas->items.erase(item);
+  delete item;
+}
+
+void canvas_item_polyline::set_points(const std::vector<lpos_t> &)
+{
+}
+
+void canvas_item_circle::set_radius(float)
+{
+}
+
+void canvas_item_circle::set_center(lpos_t)
+{
+}
+
+void canvas_item_t::set_style(float, color_t, color_t)
+{
+}
+
+void canvas_item_t::set_zoom_max(float)
+{
+}
+
+void canvas_item_t::set_dashed(float, unsigned int, unsigned int)
+{
+}
+
+void canvas_item_t::set_user_data(map_item_t *data)
+{
+  reinterpret_cast<canvas_item_null *>(this)->user_data = data;
+  destroy_connect(new map_item_destroyer(data));
+}
+
+map_item_t *canvas_item_t::get_user_data()
+{
+  return reinterpret_cast<canvas_item_null *>(this)->user_data;
+}
+
+void canvas_item_t::destroy_connect(canvas_item_destroyer *d)
+{
+  reinterpret_cast<canvas_item_null *>(this)->destroyers.push_back(d);
+}
@@ -0,0 +1,42 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Rolf Eike Beer <eike@sf-mail.de>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <canvas.h>
+
+#include <unordered_set>
+
+struct canvas_item_null;
+
+/**
+ * @brief a canvas that only keeps track of the items
+ *
+ * This replaces the platform canvas implementation, so the code creating the
+ * canvas items can be run and measured without any toolkit. Nothing is drawn,
+ * the items only store their group, user data and destroyers.
+ */
+class canvas_null : public canvas_t {
+  friend struct canvas_item_null;
+  friend class canvas_t;
+  friend struct canvas_item_t;
+
+  std::unordered_set<canvas_item_null *> items;
+  lpos_t bgpos;
+  canvas_item_t *item_new(canvas_group_t group);
+
+public:
+  canvas_null();
+  ~canvas_null();
+
+  double zoom;
+
+  /**
+   * @brief the number of currently existing items
+   */
+  inline size_t size() const
+  { return items.size(); }
+};
@@ -140,6 +140,78 @@ void testToBottom()
   assert_null(search3);
 }
 
+void testUpdate()
+{
+  std::vector<lpos_t> points;
+  points.push_back(lpos_t(0, 0));
+  points.push_back(lpos_t(100, 0));
+
+  canvas_holder canvas;
+
+  canvas_item_t * const line = canvas->polyline_new(CANVAS_GROUP_WAYS, points, 1, 0);
+  assert(line != nullptr);
+  assert(canvas->get_item_at(lpos_t(50, 0)) == line);
+
+  // move the line away, it must now be found at the new position only
+  points.push_back(lpos_t(100, 300));
+  for (unsigned int i = 0; i < points.size(); i++)
+    points[i].y += 200;
+  canvas->poly_update(line, points, 3, color_t::black());
+  assert_null(canvas->get_item_at(lpos_t(50, 0)));
+  assert(canvas->get_item_at(lpos_t(50, 200)) == line);
+
+  std::optional<unsigned int> segnum = canvas->get_item_segment(line, lpos_t(100, 400));
+  assert(segnum);
+  assert_cmpnum(*segnum, 1);
+
+  const canvas_t::item_mapping_t::const_iterator it = canvas->item_mapping.find(line);
+  assert(it != canvas->item_mapping.end());
+  const canvas_item_info_poly *poly = static_cast<const canvas_item_info_poly *>(it->second);
+  assert_cmpnum(poly->num_points, 3);
+  assert_cmpnum(poly->width, 3);
+
+  canvas_item_circle * const circle = canvas->circle_new(CANVAS_GROUP_NODES, lpos_t(1000, 20), 15,
+                                                         0, color_t::black());
+  assert(circle != nullptr);
+  assert(canvas->get_item_at(lpos_t(1000, 20)) == circle);
+
+  canvas->circle_update(circle, lpos_t(2000, 20), 10, 2, color_t::black());
+  assert_null(canvas->get_item_at(lpos_t(1000, 20)));
+  assert(canvas->get_item_at(lpos_t(2000, 20)) == circle);
+
+  const canvas_item_info_circle *cinfo = static_cast<const canvas_item_info_circle *>(canvas->item_mapping[circle]);
+  assert_cmpnum(cinfo->radius, 12);
+}
+
+void testMarkers()
+{
+  std::vector<lpos_t> centers;
+  centers.push_back(lpos_t(0, 0));
+  centers.push_back(lpos_t(100, 0));
+  centers.push_back(lpos_t(100, 8));
+
+  canvas_holder canvas;
+
+  canvas_item_t * const markers = canvas->markers_new(CANVAS_GROUP_NODES_IHL, centers, 5, color_t::black());
+  assert(markers != nullptr);
+  assert(canvas->get_item_at(lpos_t(0, 0)) == markers);
+  assert_null(canvas->get_item_at(lpos_t(500, 500)));
+
+  std::optional<unsigned int> idx = canvas->get_item_marker(markers, lpos_t(1, 1));
+  assert(idx);
+  assert_cmpnum(*idx, 0);
+
+  // the closest of the overlapping markers is returned
+  idx = canvas->get_item_marker(markers, lpos_t(100, 1));
+  assert(idx);
+  assert_cmpnum(*idx, 1);
+  idx = canvas->get_item_marker(markers, lpos_t(100, 6));
+  assert(idx);
+  assert_cmpnum(*idx, 2);
+
+  assert(!canvas->get_item_marker(markers, lpos_t(500, 500)));
+}
+
 void testTrackSegments()
 {
   char tmpdir[] = "/tmp/osm2go-canvas-points-XXXXXX";
@@ -247,6 +319,8 @@ int main(int argc, char **argv)
   testSegment();
   testInObject();
   testToBottom();
+  testUpdate();
+  testMarkers();
   testTrackSegments();
 
   return 0;
@@ -115,8 +115,9 @@ void verify_diff(osm_t::ref osm)
   // added in diff
   const node_t * const nn1 = osm->object_by_id<node_t>(-1);
   assert(nn1 != nullptr);
-  assert_cmpnum(nn1->pos.lat, 52.2693518);
-  assert_cmpnum(nn1->pos.lon, 9.576014);
+  const pos_t nn1pos = nn1->pos;
+  assert_cmpnum(nn1pos.lat, 52.2693518);
+  assert_cmpnum(nn1pos.lon, 9.576014);
   assert(nn1->tags.empty());
   // added in diff, same position as existing node
   const node_t * const nn2 = osm->object_by_id<node_t>(-3577031227LL);
@@ -293,6 +294,77 @@ project_t *setup_for_restore(const char *argv2, const std::string &osm_path)
   return project.release();
 }
 
+/**
+ * @brief restore a diff that ends in the middle of an object
+ *
+ * Everything before the damage is kept, the rest of the file is lost.
+ */
+void test_damaged(const std::string &osm_path, const char *name)
+{
+  char tmpdir[] = "/tmp/osm2go-diff_restore-XXXXXX";
+  if(mkdtemp(tmpdir) == nullptr) {
+    std::cerr << "cannot create temporary directory" << std::endl;
+    abort();
+  }
+
+  // a project directory with the original data and the damaged diff
+  const std::string base = tmpdir + std::string("/");
+  const std::string ppath = base + name + '/';
+  mkdir(ppath.c_str(), S_IRWXU);
+  const std::string osmfile = name + std::string(".osm");
+  const std::string origosm = osm_path + name + '/' + osmfile;
+  assert_cmpnum(symlink(origosm.c_str(), (ppath + osmfile).c_str()), 0);
+  const std::string damaged = osm_path + name + "/diff_restore_damaged.diff";
+  const std::string difffile = ppath + name + ".diff";
+  assert_cmpnum(symlink(damaged.c_str(), difffile.c_str()), 0);
+
+  std::unique_ptr<project_t> project(std::make_unique<project_t>(name, base));
+  project->osmFile = osmfile;
+  bool pvalid = project->parse_osm();
+  assert(pvalid);
+
+  trstring msg;
+  unsigned int flags = project->diff_restore(&msg);
+  assert_cmpnum(flags, DIFF_RESTORED | DIFF_HAS_HIDDEN | DIFF_ELEMENTS_IGNORED);
+  const std::string msgstr = msg.toStdString();
+  assert(msgstr.find(name + std::string(".diff")) != std::string::npos);
+  assert(msgstr.find("is damaged") != std::string::npos);
+
+  osm_t::ref osm = project->osm;
+  assert_cmpnum(osm_nodes, osm->nodes.size());
+  assert_cmpnum(osm_ways, osm->ways.size());
+  assert_cmpnum(osm_relations, osm->relations.size());
+
+  // the objects before the damage are restored
+  const node_t * const n72 = osm->object_by_id<node_t>(638499572);
+  assert(n72 != nullptr);
+  assert(n72->isDirty());
+  assert_cmpstr(n72->tags.get_value("testtag"), "true");
+  const node_t * const n21 = osm->object_by_id<node_t>(3577031221LL);
+  assert(n21 != nullptr);
+  assert(n21->isDeleted());
+  const way_t * const w52 = osm->object_by_id<way_t>(351899452);
+  assert(w52 != nullptr);
+  assert(osm->wayIsHidden(w52));
+
+  // the damaged one and everything that would have followed is not
+  const way_t * const w55 = osm->object_by_id<way_t>(351899455);
+  assert(w55 != nullptr);
+  assert(!w55->isDeleted());
+  assert(!w55->isDirty());
+  const relation_t * const r55 = osm->object_by_id<relation_t>(1922655);
+  assert(r55 != nullptr);
+  assert(!r55->isDeleted());
+
+  verify_osm_db::run(osm);
+
+  project.reset();
+  unlink(difffile.c_str());
+  unlink((ppath + osmfile).c_str());
+  rmdir(ppath.c_str());
+  rmdir(tmpdir);
+}
+
 } // namespace
 
 int main(int argc, char **argv)
@@ -379,7 +451,14 @@ int main(int argc, char **argv)
     // should not do anything bad
     diff_restore(sproject, nullptr);
 
+    // a snapshot taken earlier must not replace the newer saved state
+    std::unique_ptr<diff_snapshot> snapshot(sproject->diff_collect());
+    assert(snapshot);
     sproject->diff_save();
+    assert(!snapshot->write());
+    snapshot.reset(sproject->diff_collect());
+    assert(snapshot->write());
+    snapshot.reset();
     bpath += argv[2];
     std::string bdiff = bpath;
     std::string no_diff = bpath;
@@ -438,6 +517,8 @@ int main(int argc, char **argv)
 
   test_osmChange(osm, argv[3]);
 
+  test_damaged(osm_path, argv[2]);
+
   xmlCleanupParser();
 
   return result;
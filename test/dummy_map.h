@@ -130,9 +130,9 @@ public:
    */
   void test_function();
 
-  void pen_down_item_public(canvas_item_t *item)
+  void pen_down_item_public(canvas_item_t *item, lpos_t pos = lpos_t(0, 0))
   {
-    pen_down_item(item);
+    pen_down_item(item, pos);
   }
 
   void button_press_public(const osm2go_platform::screenpos &p)
@@ -0,0 +1,189 @@
+#include "osm_generator.h"
+
+#include <diff.h>
+#include <josm_presets_p.h>
+#include <osm.h>
+#include <osm_objects.h>
+#include <project.h>
+#include <project_p.h>
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <libxml/parser.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <unistd.h>
+
+#include <osm2go_annotations.h>
+#include <osm2go_test.h>
+
+namespace {
+
+std::string readFile(const std::string &fname)
+{
+  std::ifstream in(fname.c_str(), std::ios::binary);
+  assert(in.good());
+  return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void test_deterministic(const std::string &tmpdir, const presets_items_internal *presets)
+{
+  osm_generator first(4, 7, presets);
+  assert(first.write(tmpdir + "first.osm"));
+  osm_generator second(4, 7, presets);
+  assert(second.write(tmpdir + "second.osm"));
+  osm_generator other(4, 8, presets);
+  assert(other.write(tmpdir + "other.osm"));
+
+  const std::string &data = readFile(tmpdir + "first.osm");
+  assert_cmpnum(data.size(), first.stats().bytes);
+  assert(data == readFile(tmpdir + "second.osm"));
+  assert(data != readFile(tmpdir + "other.osm"));
+
+  // writing again gives the same result
+  assert(first.write(tmpdir + "second.osm"));
+  assert(data == readFile(tmpdir + "second.osm"));
+
+  unlink((tmpdir + "first.osm").c_str());
+  unlink((tmpdir + "second.osm").c_str());
+  unlink((tmpdir + "other.osm").c_str());
+}
+
+void test_content(const std::string &tmpdir, const presets_items_internal *presets)
+{
+  const unsigned int size = 10;
+  osm_generator generator(size, 1, presets);
+  assert_cmpnum_op(generator.templateCount().first, >, 100);
+  assert_cmpnum_op(generator.templateCount().second, >, 100);
+
+  assert(generator.write(tmpdir + "content.osm"));
+  std::unique_ptr<osm_t> osm(osm_t::parse(tmpdir, "content.osm"));
+  assert(osm);
+
+  // parsing for a background thread reports the progress and can be cancelled
+  osm_t::parse_progress progress;
+  std::unique_ptr<osm_t> again(osm_t::parse(tmpdir, "content.osm", &progress));
+  assert(again);
+  assert_cmpnum(again->nodes.size(), osm->nodes.size());
+  assert_cmpnum_op(progress.fraction.load(), >, 0.5);
+  assert_cmpnum_op(progress.fraction.load(), <=, 1);
+  progress.cancel = true;
+  again.reset(osm_t::parse(tmpdir, "content.osm", &progress));
+  assert(!again);
+
+  unlink((tmpdir + "content.osm").c_str());
+
+  const osm_generator::statistics &stats = generator.stats();
+  assert_cmpnum(osm->nodes.size(), stats.nodes);
+  assert_cmpnum(osm->ways.size(), stats.ways);
+  assert_cmpnum(osm->relations.size(), stats.relations);
+  assert(osm->bounds.ll.contains(osm->nodes.begin()->second->pos));
+
+  const relation_t *circle = nullptr;
+  unsigned int multipolygons = 0;
+  for(std::map<item_id_t, relation_t *>::const_iterator it = osm->relations.begin(); it != osm->relations.end(); it++) {
+    if(it->second->tags.get_value("name") != nullptr)
+      circle = it->second;
+    else if(it->second->is_multipolygon())
+      multipolygons++;
+  }
+  assert(circle != nullptr);
+  assert_cmpnum(circle->members.size(), size * size + 2 * (size + 1));
+  assert_cmpnum_op(multipolygons, >, 0);
+
+  // the tags of the points of interest are skewed
+  std::map<std::string, unsigned int> poiTags;
+  unsigned int addresses = 0;
+  for(std::map<item_id_t, node_t *>::const_iterator it = osm->nodes.begin(); it != osm->nodes.end(); it++) {
+    const node_t * const n = it->second;
+    if(n->ways != 0 || n->tags.get_value("highway") != nullptr)
+      continue;
+    assert(n->tags.hasRealTags());
+    const osm_t::TagMap &tags = n->tags.asMap();
+    poiTags[tags.begin()->first + '=' + tags.begin()->second]++;
+  }
+  for(std::map<item_id_t, way_t *>::const_iterator it = osm->ways.begin(); it != osm->ways.end(); it++)
+    if(it->second->tags.get_value("addr:housenumber") != nullptr)
+      addresses++;
+  assert_cmpnum(addresses, size * size * 4);
+
+  unsigned int maxCount = 0;
+  for(std::map<std::string, unsigned int>::const_iterator it = poiTags.begin(); it != poiTags.end(); it++)
+    maxCount = std::max(maxCount, it->second);
+  assert_cmpnum_op(poiTags.size(), >, 10);
+  assert_cmpnum_op(maxCount, >, 5);
+}
+
+void test_diff(const std::string &tmpdir, const presets_items_internal *presets)
+{
+  osm_generator generator(3, 42, presets);
+  std::unique_ptr<project_t> project(generator.createProject("generated", tmpdir));
+  assert(project);
+  assert(!project->diff_file_present());
+
+  assert(osm_generator::createDiff(project, 42));
+  assert(project->diff_file_present());
+  const osm_t::dirty_t &dirty = project->osm->modified();
+  assert_cmpnum_op(dirty.nodes.added.size(), >, 0);
+  assert_cmpnum_op(dirty.nodes.changed.size(), >, 0);
+  assert_cmpnum_op(dirty.nodes.deleted.size(), >, 0);
+  assert_cmpnum_op(dirty.ways.changed.size(), >, 0);
+
+  // load the data again and apply the changes
+  std::unique_ptr<project_t> reloaded(new project_t("generated", tmpdir));
+  reloaded->osmFile = project->osmFile;
+  assert(reloaded->parse_osm());
+  assert_cmpnum(reloaded->diff_restore(), DIFF_RESTORED);
+
+  const osm_t::dirty_t &rdirty = reloaded->osm->modified();
+  assert_cmpnum(rdirty.nodes.added.size(), dirty.nodes.added.size());
+  assert_cmpnum(rdirty.nodes.changed.size(), dirty.nodes.changed.size());
+  assert_cmpnum(rdirty.nodes.deleted.size(), dirty.nodes.deleted.size());
+  assert_cmpnum(rdirty.ways.changed.size(), dirty.ways.changed.size());
+
+  reloaded.reset();
+  project_delete(project);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  OSM2GO_TEST_INIT(argc, argv);
+
+  if(argc != 2)
+    return EINVAL;
+
+  char tmpdir[] = "/tmp/osm2go-generated-XXXXXX";
+  if(mkdtemp(tmpdir) == nullptr) {
+    std::cerr << "cannot create temporary directory" << std::endl;
+    return 1;
+  }
+  const std::string tmp = tmpdir + std::string("/");
+
+  xmlInitParser();
+
+  std::unique_ptr<presets_items_internal> presets(new presets_items_internal());
+  if(!presets->addFile(argv[1], std::string(), -1)) {
+    std::cerr << "cannot load presets from " << argv[1] << std::endl;
+    return 1;
+  }
+
+  test_deterministic(tmp, presets.get());
+  test_deterministic(tmp, nullptr);
+  test_content(tmp, presets.get());
+  test_diff(tmp, presets.get());
+
+  xmlCleanupParser();
+
+  assert_cmpnum(rmdir(tmpdir), 0);
+
+  return 0;
+}
+
+#include "dummy_appdata.h"
@@ -0,0 +1,112 @@
+#include <osm2go_log.h>
+
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+
+#include <osm2go_annotations.h>
+#include <osm2go_test.h>
+
+namespace {
+
+unsigned int evaluated;
+
+int expensive()
+{
+  evaluated++;
+  return 42;
+}
+
+void test_defaults()
+{
+  osm2go_log::reset();
+
+  for(unsigned int i = 0; i < osm2go_log::NumCategories; i++) {
+    const osm2go_log::Category c = static_cast<osm2go_log::Category>(i);
+    assert(osm2go_log::enabled(c, osm2go_log::Error));
+    assert(osm2go_log::enabled(c, osm2go_log::Warning));
+    assert(osm2go_log::enabled(c, osm2go_log::Info));
+    assert(!osm2go_log::enabled(c, osm2go_log::Debug));
+    assert(!osm2go_log::enabled(c, osm2go_log::Trace));
+  }
+
+  assert_cmpstr(osm2go_log::categoryName(osm2go_log::Osm), "osm");
+  assert_cmpstr(osm2go_log::categoryName(osm2go_log::Ui), "ui");
+}
+
+void test_configure()
+{
+  osm2go_log::reset();
+
+  assert(osm2go_log::configure("debug"));
+  assert(osm2go_log::enabled(osm2go_log::Map, osm2go_log::Debug));
+  assert(!osm2go_log::enabled(osm2go_log::Map, osm2go_log::Trace));
+
+  // later entries override earlier ones
+  assert(osm2go_log::configure("error,map=trace,net=warning"));
+  assert(osm2go_log::enabled(osm2go_log::Map, osm2go_log::Trace));
+  assert(osm2go_log::enabled(osm2go_log::Net, osm2go_log::Warning));
+  assert(!osm2go_log::enabled(osm2go_log::Net, osm2go_log::Info));
+  assert(osm2go_log::enabled(osm2go_log::Track, osm2go_log::Error));
+  assert(!osm2go_log::enabled(osm2go_log::Track, osm2go_log::Warning));
+
+  // invalid entries are skipped, the valid ones are still applied
+  assert(!osm2go_log::configure("verbose,track=info,foo=debug,diff=bar"));
+  assert(osm2go_log::enabled(osm2go_log::Track, osm2go_log::Info));
+  assert(!osm2go_log::enabled(osm2go_log::Diff, osm2go_log::Warning));
+
+  assert(osm2go_log::configure(""));
+  assert(osm2go_log::configure(",,"));
+  assert(osm2go_log::enabled(osm2go_log::Track, osm2go_log::Info));
+
+  osm2go_log::reset();
+  assert(!osm2go_log::enabled(osm2go_log::Map, osm2go_log::Trace));
+  assert(osm2go_log::enabled(osm2go_log::Net, osm2go_log::Info));
+}
+
+/**
+ * @brief the arguments of disabled messages are not evaluated
+ */
+void test_lazy()
+{
+  osm2go_log::reset();
+  evaluated = 0;
+
+  OSM2GO_LOG(Map, Trace, "value %i", expensive());
+  OSM2GO_LOG(Map, Debug, "value %i", expensive());
+  assert_cmpnum(evaluated, 0);
+
+  OSM2GO_LOG(Map, Info, "value %i", expensive());
+  OSM2GO_LOG(Map, Warning, "value %i", expensive());
+  assert_cmpnum(evaluated, 2);
+
+  assert(osm2go_log::configure("map=trace"));
+  OSM2GO_LOG(Map, Trace, "value %i", expensive());
+  OSM2GO_LOG(Track, Trace, "value %i", expensive());
+#if OSM2GO_LOG_MAX_LEVEL >= 4
+  assert_cmpnum(evaluated, 3);
+#else
+  // compiled out completely
+  assert_cmpnum(evaluated, 2);
+#endif
+
+  osm2go_log::reset();
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  OSM2GO_TEST_INIT(argc, argv);
+
+  if(argc != 1)
+    return EINVAL;
+
+  test_defaults();
+  test_configure();
+  test_lazy();
+
+  return 0;
+}
+
+#include "dummy_appdata.h"
@@ -872,8 +872,18 @@ void test_select(const std::string &tmpdir)
 #endif
 
   assert(m->selected.object == object_t(w));
-  // 1 for each node, 1 for the arrow, and 1 for the way itself
-  assert_cmpnum(m->highlight.items.size(), 4);
+  // 1 for all node markers, 1 for all arrows, and 1 for the way itself
+  assert_cmpnum(m->highlight.items.size(), 3);
+
+  // the nodes of the way share a single markers item
+  const map_item_t wayItem(object_t(w), nullptr);
+  assert(m->highlight.isHighlighted(wayItem));
+  const map_item_t wayNode(object_t(w->node_chain.front()), nullptr);
+  assert(m->highlight.isHighlighted(wayNode));
+  const map_item_t wayNode2(object_t(w->node_chain.back()), nullptr);
+  assert(m->highlight.isHighlighted(wayNode2));
+  const map_item_t otherNode(object_t(n), nullptr);
+  assert(!m->highlight.isHighlighted(otherNode));
 
   // deselect
   osm2go_platform::screenpos emptypos(node1pos.x(), node2pos.y());
@@ -893,6 +903,7 @@ void test_select(const std::string &tmpdir)
 
   ui->m_statusTexts.push_back(trstring("unspecified relation"));
   m->select_relation(r);
+  // 1 for the way and 1 for the node markers
   assert_cmpnum(m->highlight.items.size(), 2);
 
   assert(m->selected.object == r_obj);
@@ -936,8 +947,8 @@ void test_redraw_way_on_node_delete(const std::string &tmpdir)
   m->select_way(w);
 
   assert(m->selected.object == object_t(w));
-  // way + 3 nodes + 2 arrows
-  assert_cmpnum(m->highlight.items.size(), 6);
+  // way + node markers + arrows
+  assert_cmpnum(m->highlight.items.size(), 3);
   // the way is not kept selected here because the map would delete the selected object,
   // so this is not a path present anyway in the code as a node should be deleted
   expectMapItemDeselect(ui);
@@ -950,8 +961,122 @@ void test_redraw_way_on_node_delete(const std::string &tmpdir)
   m->select_way(w);
 
   assert(m->selected.object == object_t(w));
-  // way + 2 nodes + 1 arrow
-  assert_cmpnum(m->highlight.items.size(), 4);
+  // way + node markers + arrows
+  assert_cmpnum(m->highlight.items.size(), 3);
+}
+
+// the objects outside of the visible area are only drawn by paint_remaining()
+void test_init_visible_first(const std::string &tmpdir)
+{
+  appdata_t a;
+  a.project.reset(new project_t("foo", tmpdir));
+  canvas_holder canvas;
+  std::unique_ptr<test_map> m(std::make_unique<test_map>(a, *canvas, test_map::NodeStyle));
+  a.project->osm.reset(new osm_t());
+  osm_t::ref o = a.project->osm;
+  set_bounds(o);
+
+  std::vector<node_t *> nodes;
+  for (int x = o->bounds.min.x; x <= o->bounds.max.x; x += 8) {
+    for (int y = o->bounds.min.y; y <= o->bounds.max.y; y += 8) {
+      node_t *n = o->node_new(lpos_t(x, y));
+      o->attach(n);
+      nodes.push_back(n);
+    }
+  }
+
+  m->init();
+
+  lpos_t vmin, vmax;
+  canvas->visible_area(vmin, vmax);
+  for (size_t i = 0; i < nodes.size(); i++) {
+    const lpos_t p = nodes[i]->lpos;
+    const bool visible = p.x >= vmin.x && p.x <= vmax.x && p.y >= vmin.y && p.y <= vmax.y;
+    assert((nodes[i]->map_item != nullptr) == visible);
+  }
+
+  m->paint_remaining();
+
+  for (size_t i = 0; i < nodes.size(); i++)
+    assert(nodes[i]->map_item != nullptr);
+}
+
+// takes the project away as if it was closed, but keeps the data the map items reference
+struct project_closer {
+  explicit project_closer(appdata_t &a) : appdata(a) {}
+
+  appdata_t &appdata;
+  std::unique_ptr<project_t> closed;
+
+  void close()
+  {
+    closed.swap(appdata.project);
+  }
+
+#ifndef QT_VERSION
+  static gboolean idle_close(gpointer data)
+  {
+    static_cast<project_closer *>(data)->close();
+    return FALSE;
+  }
+#endif
+};
+
+// the project is closed while paint_remaining() lets the interface process events
+void test_paint_remaining_project_closed(const std::string &tmpdir)
+{
+  appdata_t a;
+  a.project.reset(new project_t("foo", tmpdir));
+  canvas_holder canvas;
+  std::unique_ptr<test_map> m(std::make_unique<test_map>(a, *canvas, test_map::NodeStyle));
+  a.project->osm.reset(new osm_t());
+  osm_t::ref o = a.project->osm;
+  set_bounds(o);
+
+  // enough objects outside of the visible area to need more than one chunk
+  std::vector<node_t *> nodes;
+  for (int i = 0; i < 250; i++) {
+    for (int x = o->bounds.min.x; x <= o->bounds.max.x; x += 8) {
+      for (int y = o->bounds.min.y; y <= o->bounds.max.y; y += 8) {
+        node_t *n = o->node_new(lpos_t(x, y));
+        o->attach(n);
+        nodes.push_back(n);
+      }
+    }
+  }
+
+  // only a small part of the map is visible
+  a.project->map_state.zoom = 64;
+  m->init();
+
+  size_t pending = 0;
+  for (size_t i = 0; i < nodes.size(); i++)
+    if (nodes[i]->map_item == nullptr)
+      pending++;
+  assert_cmpnum_op(pending, >, 2000);
+
+  project_closer closer(a);
+#ifdef QT_VERSION
+  QTimer::singleShot(0, [&closer]() { closer.close(); });
+#else
+  g_idle_add(project_closer::idle_close, &closer);
+#endif
+
+  // any widget makes paint_remaining() draw in chunks
+  appdata_t::window = canvas->widget;
+  m->paint_remaining();
+  appdata_t::window = nullptr;
+
+  assert(!a.project);
+  assert(closer.closed);
+
+  size_t drawn = 0;
+  for (size_t i = 0; i < nodes.size(); i++)
+    if (nodes[i]->map_item != nullptr)
+      drawn++;
+  assert_cmpnum_op(drawn, <, nodes.size());
+
+  closer.close();
 }
 
 } // namespace
@@ -991,6 +1116,8 @@ int main(int argc, char **argv)
   test_map_reverse(osm_path);
   test_select(osm_path);
   test_redraw_way_on_node_delete(osm_path);
+  test_init_visible_first(osm_path);
+  test_paint_remaining_project_closed(osm_path);
 
   assert_cmpnum(rmdir(tmpdir), 0);
 
@@ -0,0 +1,170 @@
+#include <memory_usage.h>
+
+#include <cow_vector.h>
+#include <osm.h>
+#include <osm_objects.h>
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <osm2go_annotations.h>
+#include <osm2go_test.h>
+
+namespace {
+
+const memory_report::entry *findEntry(const memory_report &report, const char *name)
+{
+  for(size_t i = 0; i < report.entries.size(); i++)
+    if(strcmp(report.entries[i].name, name) == 0)
+      return &report.entries[i];
+  return nullptr;
+}
+
+void set_bounds(osm_t::ref o)
+{
+  bool b = o->bounds.init(pos_area(pos_t(52.2692786, 9.5750497), pos_t(52.2695463, 9.5755)));
+  assert(b);
+}
+
+void test_helpers()
+{
+  std::string s;
+  assert_cmpnum(memory_usage::heap(s), 0);
+  s.assign(200, 'x');
+  assert_cmpnum_op(memory_usage::heap(s), >, 200);
+
+  std::vector<int> v;
+  v.reserve(100);
+  assert_cmpnum(memory_usage::heap(v), 100 * sizeof(int));
+
+  std::map<int, int> m;
+  assert_cmpnum(memory_usage::heap(m), 0);
+  m[1] = 2;
+  m[3] = 4;
+  assert_cmpnum_op(memory_usage::heap(m), >, 2 * sizeof(std::pair<const int, int>));
+}
+
+void test_report()
+{
+  memory_report report;
+  assert_cmpnum(report.total(), 0);
+
+  report.add("first", 2, 1000);
+  report.add("second", 0, 24);
+  assert_cmpnum(report.total(), 1024);
+
+  const std::string &text = report.text();
+  assert(text.find("first") != std::string::npos);
+  assert(text.find("second") != std::string::npos);
+  assert(text.find("total") != std::string::npos);
+}
+
+/**
+ * @brief shared contents are split between the owners
+ */
+void test_cow_shared()
+{
+  cow_vector<int> a;
+  assert_cmpnum(a.memory_size(), 0);
+
+  a.reserve(1000);
+  a.push_back(1);
+  const size_t full = a.memory_size();
+  assert_cmpnum_op(full, >=, 1000 * sizeof(int));
+
+  cow_vector<int> b(a);
+  cow_vector<int> c(a);
+  assert_cmpnum(a.memory_size(), full / 3);
+  assert_cmpnum(b.memory_size(), full / 3);
+  assert_cmpnum(c.memory_size(), full / 3);
+
+  // the modified instance keeps the big buffer, the others share a copy
+  b.push_back(2);
+  assert_cmpnum_op(b.memory_size(), >=, 1000 * sizeof(int));
+  assert_cmpnum(a.memory_size(), c.memory_size());
+  assert_cmpnum_op(a.memory_size() + c.memory_size(), <, b.memory_size());
+}
+
+void test_osm()
+{
+  std::unique_ptr<osm_t> osm(std::make_unique<osm_t>());
+  set_bounds(osm);
+
+  memory_report empty;
+  osm->memory_usage(empty);
+  assert_cmpnum(findEntry(empty, "nodes")->count, 0);
+  assert_cmpnum(findEntry(empty, "tag lists")->bytes, 0);
+  assert(findEntry(empty, "tag index") == nullptr);
+
+  way_t *w = new way_t();
+  for(int i = 0; i < 100; i++) {
+    node_t *n = osm->node_new(lpos_t(i, i * 2));
+    osm->attach(n);
+    w->append_node(n);
+    osm_t::TagMap tags;
+    tags.insert(osm_t::TagMap::value_type("barrier", "bollard"));
+    osm->updateTags(object_t(n), tags);
+  }
+  osm->attach(w);
+
+  memory_report report;
+  osm->memory_usage(report);
+  const memory_report::entry *nodes = findEntry(report, "nodes");
+  assert(nodes != nullptr);
+  assert_cmpnum(nodes->count, 100);
+  assert_cmpnum_op(nodes->bytes, >=, 100 * sizeof(node_t));
+  const memory_report::entry *ways = findEntry(report, "ways");
+  assert(ways != nullptr);
+  assert_cmpnum(ways->count, 1);
+  assert_cmpnum_op(ways->bytes, >=, sizeof(way_t) + 100 * sizeof(node_t *));
+  assert_cmpnum_op(findEntry(report, "tag lists")->bytes, >=, 100 * sizeof(tag_t));
+  assert_cmpnum(findEntry(report, "original objects")->count, 0);
+
+  osm->buildTagIndex();
+  memory_report indexed;
+  osm->memory_usage(indexed);
+  const memory_report::entry *index = findEntry(indexed, "tag index");
+  assert(index != nullptr);
+  assert_cmpnum(index->count, 2);
+  assert_cmpnum_op(index->bytes, >=, 200 * sizeof(object_t));
+
+  // modifying an object that exists upstream keeps a copy of the original
+  base_attributes ba(47);
+  ba.version = 1;
+  node_t *nd = osm->node_new(pos_t(52.26935, 9.5752), ba);
+  osm->insert(nd);
+  osm_t::TagMap tags;
+  tags.insert(osm_t::TagMap::value_type("amenity", "bench"));
+  osm->updateTags(object_t(nd), tags);
+
+  memory_report modified;
+  osm->memory_usage(modified);
+  const memory_report::entry *orig = findEntry(modified, "original objects");
+  assert_cmpnum(orig->count, 1);
+  assert_cmpnum_op(orig->bytes, >=, sizeof(node_t));
+  assert_cmpnum_op(modified.total(), >, indexed.total());
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  OSM2GO_TEST_INIT(argc, argv);
+
+  if(argc != 1)
+    return EINVAL;
+
+  test_helpers();
+  test_report();
+  test_cow_shared();
+  test_osm();
+
+  return 0;
+}
+
+#include "dummy_appdata.h"
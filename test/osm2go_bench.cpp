@@ -0,0 +1,408 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Rolf Eike Beer <eike@sf-mail.de>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/**
+ * @file osm2go_bench.cpp
+ *
+ * Measures the time of the expensive operations on a generated dataset and
+ * prints the results as JSON, together with the estimated memory usage after
+ * painting the map in the last iteration. No toolkit is used for drawing, the
+ * map is painted on a canvas that only records the items.
+ */
+
+#include "canvas_null.h"
+#include "dummy_map.h"
+#include "osm_generator.h"
+
+#include <diff.h>
+#include <fdguard.h>
+#include <josm_presets_p.h>
+#include <map.h>
+#include <memory_usage.h>
+#include <osm.h>
+#include <osm_objects.h>
+#include <project.h>
+#include <project_p.h>
+#include <style.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <libxml/parser.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include <osm2go_annotations.h>
+#include <osm2go_test.h>
+
+namespace {
+
+/**
+ * @brief the timings of one measured operation
+ */
+struct bench_result {
+  explicit bench_result(const char *n) : name(n) {}
+  const char *name;
+  std::vector<double> samples; ///< milliseconds
+};
+
+class bench_timer {
+  bench_result &result;
+  const std::chrono::steady_clock::time_point start;
+public:
+  explicit inline bench_timer(bench_result &r)
+    : result(r), start(std::chrono::steady_clock::now()) {}
+  ~bench_timer()
+  {
+    const std::chrono::duration<double, std::milli> d = std::chrono::steady_clock::now() - start;
+    result.samples.push_back(d.count());
+  }
+};
+
+enum {
+  BENCH_PARSE,
+  BENCH_COLORIZE,
+  BENCH_PAINT,
+  BENCH_REDRAW,
+  BENCH_DIRTY,
+  BENCH_GENERATE_XML,
+  BENCH_DIFF_SAVE,
+  BENCH_DIFF_RESTORE,
+  BENCH_DIFF_SAVE_FEW,
+  BENCH_COUNT
+};
+
+struct colorizer {
+  const style_t &style;
+  explicit inline colorizer(const style_t &s) : style(s) {}
+  inline void operator()(const std::pair<item_id_t, node_t *> &pair) const
+  {
+    style.colorize(pair.second);
+  }
+  inline void operator()(const std::pair<item_id_t, way_t *> &pair) const
+  {
+    style.colorize(pair.second);
+  }
+};
+
+/**
+ * @brief draw all ways again, as it happens when they are edited
+ */
+struct redrawer {
+  map_t &map;
+  explicit inline redrawer(map_t &m) : map(m) {}
+  inline void operator()(const std::pair<item_id_t, way_t *> &pair) const
+  {
+    map.drawColorized(pair.second);
+  }
+};
+
+void generate_all_xml(const osm_t::dirty_t &dirty)
+{
+  const std::string changeset = "42";
+  size_t len = 0;
+  for(size_t i = 0; i < dirty.nodes.changed.size(); i++) {
+    xmlChar *x = dirty.nodes.changed[i]->generate_xml(changeset);
+    len += xmlStrlen(x);
+    xmlFree(x);
+  }
+  for(size_t i = 0; i < dirty.ways.changed.size(); i++) {
+    xmlChar *x = dirty.ways.changed[i]->generate_xml(changeset);
+    len += xmlStrlen(x);
+    xmlFree(x);
+  }
+  for(size_t i = 0; i < dirty.relations.changed.size(); i++) {
+    xmlChar *x = dirty.relations.changed[i]->generate_xml(changeset);
+    len += xmlStrlen(x);
+    xmlFree(x);
+  }
+  assert_cmpnum_op(len, >, 0);
+}
+
+/**
+ * @brief move some nodes spread over the whole dataset
+ * @param osm the unmodified data
+ * @param count how many nodes to move
+ *
+ * This is the usual case when the diff is saved: much data, but only few edits.
+ */
+void move_nodes(osm_t::ref osm, unsigned int count)
+{
+  const size_t step = std::max<size_t>(osm->nodes.size() / count, 1);
+  size_t cnt = 0;
+  unsigned int moved = 0;
+  for(std::map<item_id_t, node_t *>::iterator it = osm->nodes.begin();
+      it != osm->nodes.end() && moved < count; it++, cnt++) {
+    if(cnt % step != 0)
+      continue;
+    node_t * const n = it->second;
+    osm->mark_dirty(n);
+    n->lpos = lpos_t(n->lpos.x + 1, n->lpos.y + 1);
+    n->pos = n->lpos.toPos(osm->bounds);
+    moved++;
+  }
+}
+
+void print_result(FILE *out, const bench_result &r, bool last)
+{
+  double sum = 0;
+  for(size_t i = 0; i < r.samples.size(); i++)
+    sum += r.samples[i];
+
+  fprintf(out, "    \"%s\": { \"min\": %.3f, \"mean\": %.3f, \"max\": %.3f, \"samples\": [",
+          r.name, *std::min_element(r.samples.begin(), r.samples.end()),
+          sum / r.samples.size(), *std::max_element(r.samples.begin(), r.samples.end()));
+  for(size_t i = 0; i < r.samples.size(); i++)
+    fprintf(out, "%s%.3f", i == 0 ? "" : ", ", r.samples[i]);
+  fprintf(out, "] }%s\n", last ? "" : ",");
+}
+
+void usage(const char *name)
+{
+  fprintf(stderr, "Usage: %s [--size N] [--iterations N] [--seed N] [--edits N] [--style NAME] [--output FILE] [--verbose] [--no-presets]\n"
+                  "\n"
+                  "  --size N        the number of blocks per side of the generated town (default 30)\n"
+                  "  --iterations N  how often every operation is measured (default 3)\n"
+                  "  --seed N        the seed for generating the dataset (default 1)\n"
+                  "  --edits N       the number of nodes moved before diff_save_few (default 10)\n"
+                  "  --style NAME    the map style to use (default mapnik)\n"
+                  "  --output FILE   write the results to the given file instead of stdout\n"
+                  "  --verbose       do not suppress the diagnostic output\n"
+                  "  --no-presets    do not take the tags of the generated objects from the presets\n", name);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  OSM2GO_TEST_INIT(argc, argv);
+
+  unsigned int size = 30;
+  unsigned int iterations = 3;
+  uint32_t seed = 1;
+  unsigned int edits = 10;
+  std::string styleName = "mapnik";
+  const char *outname = nullptr;
+  bool verbose = false;
+  bool usePresets = true;
+
+  for(int i = 1; i < argc; i++) {
+    const bool hasValue = i + 1 < argc;
+    if(strcmp(argv[i], "--size") == 0 && hasValue) {
+      size = strtoul(argv[++i], nullptr, 10);
+    } else if(strcmp(argv[i], "--iterations") == 0 && hasValue) {
+      iterations = strtoul(argv[++i], nullptr, 10);
+    } else if(strcmp(argv[i], "--seed") == 0 && hasValue) {
+      seed = strtoul(argv[++i], nullptr, 10);
+    } else if(strcmp(argv[i], "--edits") == 0 && hasValue) {
+      edits = strtoul(argv[++i], nullptr, 10);
+    } else if(strcmp(argv[i], "--style") == 0 && hasValue) {
+      styleName = argv[++i];
+    } else if(strcmp(argv[i], "--output") == 0 && hasValue) {
+      outname = argv[++i];
+    } else if(strcmp(argv[i], "--verbose") == 0) {
+      verbose = true;
+    } else if(strcmp(argv[i], "--no-presets") == 0) {
+      usePresets = false;
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if(size == 0 || iterations == 0 || edits == 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  // the code under test writes lots of diagnostics to stdout, keep them out of the results
+  FILE *out;
+  if(outname != nullptr) {
+    out = fopen(outname, "w");
+    if(out == nullptr) {
+      fprintf(stderr, "cannot create %s: %s\n", outname, strerror(errno));
+      return 1;
+    }
+  } else {
+    out = fdopen(dup(STDOUT_FILENO), "w");
+  }
+  if(!verbose && freopen("/dev/null", "w", stdout) == nullptr) {
+    fprintf(stderr, "cannot redirect stdout: %s\n", strerror(errno));
+    return 1;
+  }
+
+  char tmpdir[] = "/tmp/osm2go-bench-XXXXXX";
+  if(mkdtemp(tmpdir) == nullptr) {
+    fprintf(stderr, "cannot create temporary directory: %s\n", strerror(errno));
+    return 1;
+  }
+
+  xmlInitParser();
+
+  std::unique_ptr<presets_items_internal> presets;
+  if(usePresets) {
+    const std::string &presetsFile = find_file("defaultpresets.xml");
+    presets.reset(new presets_items_internal());
+    if(presetsFile.empty() || !presets->addFile(presetsFile, std::string(), -1)) {
+      fprintf(stderr, "cannot load presets\n");
+      return 1;
+    }
+  }
+
+  osm_generator generator(size, seed, presets.get());
+
+  appdata_t appdata;
+  // keep them so they show up in the memory usage
+  appdata.presets.reset(presets.release());
+  appdata.style.reset(style_t::load(styleName));
+  if(!appdata.style) {
+    fprintf(stderr, "cannot load style %s\n", styleName.c_str());
+    return 1;
+  }
+
+  appdata.project.reset(generator.createProject("bench", tmpdir + std::string("/")));
+  if(!appdata.project) {
+    fprintf(stderr, "cannot create the project\n");
+    return 1;
+  }
+  project_t::ref project = appdata.project;
+  const osm_generator::statistics &info = generator.stats();
+
+  std::vector<bench_result> results;
+  results.push_back(bench_result("parse"));
+  results.push_back(bench_result("colorize"));
+  results.push_back(bench_result("paint"));
+  results.push_back(bench_result("redraw"));
+  results.push_back(bench_result("dirty"));
+  results.push_back(bench_result("generate_xml"));
+  results.push_back(bench_result("diff_save"));
+  results.push_back(bench_result("diff_restore"));
+  results.push_back(bench_result("diff_save_few"));
+  assert_cmpnum(results.size(), BENCH_COUNT);
+
+  size_t canvasItems = 0;
+  memory_report memory;
+  for(unsigned int i = 0; i < iterations; i++) {
+    {
+      bench_timer t(results[BENCH_PARSE]);
+      if(!project->parse_osm()) {
+        fprintf(stderr, "cannot parse the generated data\n");
+        return 1;
+      }
+    }
+    osm_t::ref osm = project->osm;
+
+    {
+      bench_timer t(results[BENCH_COLORIZE]);
+      std::for_each(osm->nodes.begin(), osm->nodes.end(), colorizer(*appdata.style));
+      std::for_each(osm->ways.begin(), osm->ways.end(), colorizer(*appdata.style));
+    }
+
+    {
+      canvas_null canvas;
+      {
+        test_map map(appdata, &canvas);
+        {
+          bench_timer t(results[BENCH_PAINT]);
+          map.paint();
+        }
+        canvasItems = canvas.size();
+        {
+          bench_timer t(results[BENCH_REDRAW]);
+          std::for_each(osm->ways.begin(), osm->ways.end(), redrawer(map));
+        }
+        // the existing items are updated, not replaced
+        assert_cmpnum(canvas.size(), canvasItems);
+        if(i + 1 == iterations) {
+          appdata.map = &map;
+          memory = memory_report::collect(appdata);
+          appdata.map = nullptr;
+        }
+      }
+    }
+
+    osm_generator::modify(osm, seed + i);
+
+    {
+      bench_timer t(results[BENCH_DIRTY]);
+      const osm_t::dirty_t dirty = osm->modified();
+      (void) dirty;
+    }
+
+    {
+      const osm_t::dirty_t dirty = osm->modified();
+      bench_timer t(results[BENCH_GENERATE_XML]);
+      generate_all_xml(dirty);
+    }
+
+    {
+      bench_timer t(results[BENCH_DIFF_SAVE]);
+      project->diff_save();
+    }
+
+    if(!project->parse_osm()) {
+      fprintf(stderr, "cannot parse the generated data\n");
+      return 1;
+    }
+
+    {
+      bench_timer t(results[BENCH_DIFF_RESTORE]);
+      const unsigned int flags = project->diff_restore();
+      assert_cmpnum(flags, DIFF_RESTORED);
+    }
+    assert(!project->osm->is_clean(false));
+
+    if(!project->parse_osm()) {
+      fprintf(stderr, "cannot parse the generated data\n");
+      return 1;
+    }
+    move_nodes(project->osm, edits);
+    // the first allocations after freeing the old data are slow, keep that out of the measurement
+    project->diff_save();
+
+    {
+      bench_timer t(results[BENCH_DIFF_SAVE_FEW]);
+      project->diff_save();
+    }
+  }
+
+  fprintf(out, "{\n"
+               "  \"version\": \"%s\",\n"
+               "  \"unit\": \"ms\",\n"
+               "  \"iterations\": %u,\n"
+               "  \"edits\": %u,\n"
+               "  \"dataset\": { \"size\": %u, \"seed\": %" PRIu32 ", \"nodes\": %u, \"ways\": %u, "
+               "\"relations\": %u, \"bytes\": %ld, \"presets\": %s, \"canvas_items\": %zu },\n"
+               "  \"results\": {\n",
+          VERSION, iterations, edits, size, seed, info.nodes, info.ways, info.relations, info.bytes,
+          usePresets ? "true" : "false", canvasItems);
+  for(size_t i = 0; i < results.size(); i++)
+    print_result(out, results[i], i + 1 == results.size());
+  fputs("  },\n"
+        "  \"memory\": {\n", out);
+  for(size_t i = 0; i < memory.entries.size(); i++)
+    fprintf(out, "    \"%s\": { \"objects\": %zu, \"bytes\": %zu },\n", memory.entries[i].name,
+            memory.entries[i].count, memory.entries[i].bytes);
+  fprintf(out, "    \"total\": %zu\n"
+               "  }\n}\n", memory.total());
+  fclose(out);
+
+  project_delete(appdata.project);
+  rmdir(tmpdir);
+
+  xmlCleanupParser();
+
+  return 0;
+}
+
+#include "dummy_appdata.h"
@@ -2646,6 +2646,134 @@ void test_updateMembers()
   }
 }
 
+/**
+ * @brief check that the original objects share their contents with the modified ones
+ */
+void test_shared_original()
+{
+  std::unique_ptr<osm_t> osm(std::make_unique<osm_t>());
+  set_bounds(osm);
+
+  const lpos_t startPos(10, 10);
+  base_attributes ba(1234);
+  ba.version = 1;
+  node_t * const n = osm->node_new(startPos.toPos(osm->bounds), ba);
+  osm->insert(n);
+  ba.id = 43;
+  node_t * const n2 = osm->node_new(startPos.toPos(osm->bounds), ba);
+  osm->insert(n2);
+
+  osm_t::TagMap tags;
+  tags.insert(osm_t::TagMap::value_type("highway", "residential"));
+
+  way_t * const w = new way_t(ba);
+  w->append_node(n);
+  w->append_node(n2);
+  w->tags.replace(tags);
+  osm->insert(w);
+
+  relation_t * const r = new relation_t(ba);
+  r->members.push_back(member_t(object_t(n), "stop"));
+  r->members.push_back(member_t(object_t(w), "forward"));
+  osm_t::TagMap rtags;
+  rtags.insert(osm_t::TagMap::value_type("type", "route"));
+  r->tags.replace(rtags);
+  osm->insert(r);
+
+  // marking as dirty does not copy the node chain
+  osm->mark_dirty(w);
+  const way_t * const ow = osm->originalObject(w);
+  assert(ow != nullptr);
+  assert(w->node_chain.isShared());
+  assert(ow->node_chain.isShared());
+  assert(*w == *ow);
+
+  // the chain of the original way and the role in the original relation must not change
+  w->reverse(osm);
+  assert(!w->node_chain.isShared());
+  assert(!ow->node_chain.isShared());
+  assert(w->first_node() == n2);
+  assert(ow->first_node() == n);
+
+  const relation_t * const orel = osm->originalObject(r);
+  assert(orel != nullptr);
+  assert(!r->members.isShared());
+  assert_cmpstr(r->members.back().role, "backward");
+  assert_cmpstr(orel->members.back().role, "forward");
+  assert(orel->members.front() == r->members.front());
+
+  osm_t::TagMap ntags = tags;
+  ntags.insert(osm_t::TagMap::value_type("name", "foo"));
+  osm->updateTags(object_t(w), ntags);
+  assert(w->tags == ntags);
+  assert(ow->tags == tags);
+
+  // once everything is reverted the way is considered unmodified again
+  w->reverse(osm);
+  assert(ow->first_node() == n);
+  osm->updateTags(object_t(w), tags);
+  assert_null(osm->originalObject(w));
+  assert(!w->node_chain.isShared());
+
+  // the role has been restored by reversing again
+  assert_cmpstr(r->members.back().role, "forward");
+  assert(*r == *orel);
+  osm->unmark_dirty(r);
+  assert_null(osm->originalObject(r));
+
+  // a relation also shares the members
+  osm->mark_dirty(r);
+  assert(r->members.isShared());
+  assert(osm->originalObject(r)->members.isShared());
+  osm->unmark_dirty(r);
+  assert(!r->members.isShared());
+}
+
+void test_memberships()
+{
+  std::unique_ptr<osm_t> osm(std::make_unique<osm_t>());
+  set_bounds(osm);
+
+  node_t * const n = osm->node_new(lpos_t(10, 10));
+  osm->attach(n);
+  node_t * const n2 = osm->node_new(lpos_t(20, 20));
+  osm->attach(n2);
+
+  assert(osm->memberships(object_t(n)).empty());
+
+  relation_t * const r1 = new relation_t();
+  r1->members.push_back(member_t(object_t(n2), nullptr));
+  r1->members.push_back(member_t(object_t(n), "stop"));
+  r1->members.push_back(member_t(object_t(n), "platform"));
+  osm->attach(r1);
+  relation_t * const r2 = new relation_t();
+  r2->members.push_back(member_t(object_t(n2), nullptr));
+  osm->attach(r2);
+  base_attributes ba(42);
+  ba.version = 1;
+  relation_t * const r3 = new relation_t(ba);
+  r3->members.push_back(member_t(object_t(n), nullptr));
+  osm->insert(r3);
+
+  // only the first occurrence is recorded
+  osm_t::MembershipMap m = osm->memberships(object_t(n));
+  assert_cmpnum(m.size(), 2);
+  assert_cmpnum(m[r1], 1);
+  assert_cmpnum(m[r3], 0);
+
+  m = osm->memberships(object_t(n2));
+  assert_cmpnum(m.size(), 2);
+  assert_cmpnum(m[r1], 0);
+  assert_cmpnum(m[r2], 0);
+
+  // deleted relations are ignored
+  osm->relation_delete(r3);
+  m = osm->memberships(object_t(n));
+  assert(r3->isDeleted());
+  assert_cmpnum(m.size(), 1);
+  assert(m.find(r1) != m.end());
+}
+
 } // namespace
 
 int main(int argc, char **argv)
@@ -2686,6 +2814,8 @@ int main(int argc, char **argv)
   test_delete_markdirty();
   test_membership_state();
   test_updateMembers();
+  test_shared_original();
+  test_memberships();
 
   xmlCleanupParser();
 
@@ -0,0 +1,120 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Rolf Eike Beer <eike@sf-mail.de>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/**
+ * @file osm_generate.cpp
+ *
+ * Creates a project with synthetic OSM data and optionally a diff file.
+ */
+
+#include "osm_generator.h"
+
+#include <fdguard.h>
+#include <josm_presets_p.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <libxml/parser.h>
+#include <memory>
+#include <string>
+
+#include <osm2go_annotations.h>
+#include <osm2go_test.h>
+
+namespace {
+
+void usage(const char *name)
+{
+  fprintf(stderr, "Usage: %s [--size N] [--seed N] [--presets FILE|--no-presets] [--diff] DIRECTORY NAME\n"
+                  "\n"
+                  "Creates the project NAME in DIRECTORY.\n"
+                  "\n"
+                  "  --size N        the number of blocks per side of the generated town (default 30)\n"
+                  "  --seed N        the seed for generating the data (default 1)\n"
+                  "  --presets FILE  the presets to take the tags from (default: defaultpresets.xml)\n"
+                  "  --no-presets    use a small builtin set of tags\n"
+                  "  --diff          also create a diff file with changes to the data\n", name);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  OSM2GO_TEST_INIT(argc, argv);
+
+  unsigned int size = 30;
+  uint32_t seed = 1;
+  std::string presetsFile;
+  bool usePresets = true;
+  bool diff = false;
+
+  int i;
+  for(i = 1; i < argc && strncmp(argv[i], "--", 2) == 0; i++) {
+    const bool hasValue = i + 1 < argc;
+    if(strcmp(argv[i], "--size") == 0 && hasValue) {
+      size = strtoul(argv[++i], nullptr, 10);
+    } else if(strcmp(argv[i], "--seed") == 0 && hasValue) {
+      seed = strtoul(argv[++i], nullptr, 10);
+    } else if(strcmp(argv[i], "--presets") == 0 && hasValue) {
+      presetsFile = argv[++i];
+    } else if(strcmp(argv[i], "--no-presets") == 0) {
+      usePresets = false;
+    } else if(strcmp(argv[i], "--diff") == 0) {
+      diff = true;
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if(size == 0 || argc - i != 2) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  std::string basePath = argv[i];
+  if(basePath.back() != '/')
+    basePath += '/';
+  const std::string name = argv[i + 1];
+
+  xmlInitParser();
+
+  std::unique_ptr<presets_items_internal> presets;
+  if(usePresets) {
+    if(presetsFile.empty())
+      presetsFile = find_file("defaultpresets.xml");
+    presets.reset(new presets_items_internal());
+    if(presetsFile.empty() || !presets->addFile(presetsFile, std::string(), -1)) {
+      fprintf(stderr, "cannot load presets\n");
+      return 1;
+    }
+  }
+
+  osm_generator generator(size, seed, presets.get());
+  presets.reset();
+
+  std::unique_ptr<project_t> project(generator.createProject(name, basePath));
+  if(!project) {
+    fprintf(stderr, "cannot create project %s in %s\n", name.c_str(), basePath.c_str());
+    return 1;
+  }
+
+  const osm_generator::statistics &stats = generator.stats();
+  printf("%s%s: %u nodes, %u ways, %u relations, %ld bytes\n", project->path.c_str(), project->osmFile.c_str(),
+         stats.nodes, stats.ways, stats.relations, stats.bytes);
+
+  if(diff && !osm_generator::createDiff(project, seed)) {
+    fprintf(stderr, "cannot create the diff file\n");
+    return 1;
+  }
+
+  xmlCleanupParser();
+
+  return 0;
+}
+
+#include "dummy_appdata.h"
@@ -0,0 +1,468 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Rolf Eike Beer <eike@sf-mail.de>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/**
+ * @file osm_generator.cpp
+ *
+ * Creates synthetic OSM data for benchmarks and stress tests.
+ */
+
+#include "osm_generator.h"
+
+#include <josm_presets_p.h>
+#include <osm_objects.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+
+#include <osm2go_annotations.h>
+
+namespace {
+
+const double baseLat = 52.0;
+const double baseLon = 9.0;
+const double blockSize = 0.001;
+
+const char *highways[] = { "residential", "residential", "residential", "tertiary", "secondary", "service" };
+const char *buildings[] = { "yes", "yes", "yes", "house", "house", "residential", "garage", "commercial" };
+
+/**
+ * @brief collects the tags of all preset items usable for nodes and areas
+ */
+class template_collector {
+  std::vector<osm_generator::tag_template> &nodes;
+  std::vector<osm_generator::tag_template> &areas;
+
+  static void addWidgets(osm_generator::tag_template &tpl, const std::vector<presets_element_t *> &widgets);
+public:
+  template_collector(std::vector<osm_generator::tag_template> &n, std::vector<osm_generator::tag_template> &a)
+    : nodes(n), areas(a) {}
+  void operator()(const presets_item_t *item);
+};
+
+bool hasKey(const std::vector<std::pair<std::string, std::string> > &tags, const std::string &key)
+{
+  for(size_t i = 0; i < tags.size(); i++)
+    if(tags[i].first == key)
+      return true;
+  return false;
+}
+
+void template_collector::addWidgets(osm_generator::tag_template &tpl, const std::vector<presets_element_t *> &widgets)
+{
+  for(size_t i = 0; i < widgets.size(); i++) {
+    const presets_element_t * const w = widgets[i];
+    switch(w->type) {
+    case WIDGET_TYPE_KEY: {
+      const presets_element_key * const k = static_cast<const presets_element_key *>(w);
+      if(!k->value.empty() && !hasKey(tpl.fixed, k->key))
+        tpl.fixed.push_back(std::make_pair(k->key, k->value));
+      break;
+    }
+    case WIDGET_TYPE_COMBO:
+    case WIDGET_TYPE_MULTISELECT: {
+      const presets_element_selectable * const s = static_cast<const presets_element_selectable *>(w);
+      if(!s->key.empty() && !s->values.empty())
+        tpl.optional.push_back(std::make_pair(s->key, s->values));
+      break;
+    }
+    case WIDGET_TYPE_CHECK: {
+      const presets_element_checkbox * const c = static_cast<const presets_element_checkbox *>(w);
+      tpl.optional.push_back(std::make_pair(c->key, std::vector<std::string>(1, c->value_on.empty() ? "yes" : c->value_on)));
+      break;
+    }
+    case WIDGET_TYPE_REFERENCE:
+      addWidgets(tpl, static_cast<const presets_element_reference *>(w)->item->widgets);
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+void template_collector::operator()(const presets_item_t *item)
+{
+  if(item->type & presets_item_t::TY_GROUP) {
+    const std::vector<presets_item_t *> &items = static_cast<const presets_item_group *>(item)->items;
+    std::for_each(items.begin(), items.end(), *this);
+    return;
+  }
+  if(!item->isItem())
+    return;
+
+  osm_generator::tag_template tpl;
+  addWidgets(tpl, static_cast<const presets_item *>(item)->widgets);
+  // items without fixed tags can't be recognized
+  if(tpl.fixed.empty())
+    return;
+
+  // the values of the fixed keys are already set
+  for(size_t i = tpl.optional.size(); i > 0; i--)
+    if(hasKey(tpl.fixed, tpl.optional[i - 1].first))
+      tpl.optional.erase(tpl.optional.begin() + i - 1);
+
+  if(item->type & presets_item_t::TY_NODE)
+    nodes.push_back(tpl);
+  if(item->type & presets_item_t::TY_CLOSED_WAY)
+    areas.push_back(tpl);
+}
+
+/**
+ * @brief shuffle the templates and calculate the cumulative weights
+ *
+ * The weight of an entry is 1/rank, so the distribution follows Zipf's law.
+ */
+void rank_templates(std::vector<osm_generator::tag_template> &templates, std::vector<double> &weights,
+                    osm_generator::random &rnd)
+{
+  for(size_t i = templates.size(); i > 1; i--)
+    std::swap(templates[i - 1], templates[rnd.next(i)]);
+
+  double sum = 0;
+  weights.reserve(templates.size());
+  for(size_t i = 0; i < templates.size(); i++) {
+    sum += 1.0 / (i + 1);
+    weights.push_back(sum);
+  }
+}
+
+osm_generator::tag_template fallback_template(const char *k, const char *v)
+{
+  osm_generator::tag_template ret;
+  ret.fixed.push_back(std::make_pair(k, v));
+  return ret;
+}
+
+} // namespace
+
+osm_generator::osm_generator(unsigned int s, uint32_t sd, const presets_items_internal *presets)
+  : size(s)
+  , seed(sd)
+  , rnd(sd)
+  , f(nullptr)
+  , wbuf(nullptr)
+  , wlen(0)
+  , w(nullptr)
+{
+  if(presets != nullptr)
+    std::for_each(presets->items.begin(), presets->items.end(), template_collector(nodeTemplates, areaTemplates));
+
+  if(nodeTemplates.empty()) {
+    nodeTemplates.push_back(fallback_template("amenity", "bench"));
+    nodeTemplates.push_back(fallback_template("amenity", "waste_basket"));
+    nodeTemplates.push_back(fallback_template("amenity", "post_box"));
+    nodeTemplates.push_back(fallback_template("amenity", "restaurant"));
+    nodeTemplates.push_back(fallback_template("amenity", "cafe"));
+  }
+  if(areaTemplates.empty()) {
+    areaTemplates.push_back(fallback_template("leisure", "playground"));
+    areaTemplates.push_back(fallback_template("landuse", "grass"));
+    areaTemplates.push_back(fallback_template("amenity", "parking"));
+  }
+
+  // a different sequence than the one used for writing
+  random shuffle(~sd);
+  rank_templates(nodeTemplates, nodeWeights, shuffle);
+  rank_templates(areaTemplates, areaWeights, shuffle);
+}
+
+pos_area osm_generator::bounds() const
+{
+  return pos_area(pos_t(baseLat - blockSize, baseLon - blockSize),
+                  pos_t(baseLat + (size + 1) * blockSize, baseLon + (size + 1) * blockSize));
+}
+
+const osm_generator::tag_template &osm_generator::pick(const std::vector<tag_template> &templates,
+                                                       const std::vector<double> &weights)
+{
+  const double r = rnd.next() * weights.back() / (1 << 24);
+  const size_t idx = std::upper_bound(weights.begin(), weights.end(), r) - weights.begin();
+  return templates[std::min(idx, templates.size() - 1)];
+}
+
+void osm_generator::tag(FILE *out, const std::string &k, const std::string &v)
+{
+  // preset values may contain anything
+  std::string value;
+  value.reserve(v.size());
+  for(size_t i = 0; i < v.size(); i++) {
+    switch(v[i]) {
+    case '&':
+      value += "&amp;";
+      break;
+    case '<':
+      value += "&lt;";
+      break;
+    case '>':
+      value += "&gt;";
+      break;
+    case '\'':
+      value += "&apos;";
+      break;
+    case '"':
+      value += "&quot;";
+      break;
+    default:
+      value += v[i];
+    }
+  }
+  fprintf(out, "    <tag k='%s' v='%s'/>\n", k.c_str(), value.c_str());
+}
+
+void osm_generator::tag(const char *k, unsigned int v)
+{
+  fprintf(w, "    <tag k='%s' v='%u'/>\n", k, v);
+}
+
+void osm_generator::writeTemplate(FILE *out, const tag_template &tpl)
+{
+  for(size_t i = 0; i < tpl.fixed.size(); i++)
+    tag(out, tpl.fixed[i].first, tpl.fixed[i].second);
+
+  for(size_t i = 0; i < tpl.optional.size(); i++) {
+    if(rnd.next(3) != 0)
+      continue;
+    const std::vector<std::string> &values = tpl.optional[i].second;
+    // the first value is the most common one
+    tag(out, tpl.optional[i].first, values[rnd.next(2) == 0 ? 0 : rnd.next(values.size())]);
+  }
+}
+
+unsigned int osm_generator::node_open(double lat, double lon, bool tagged)
+{
+  fprintf(f, "  <node id='%u' version='1' changeset='1' lat='%.7f' lon='%.7f'%s>\n",
+          ++info.nodes, lat, lon, tagged ? "" : "/");
+  return info.nodes;
+}
+
+unsigned int osm_generator::closed_way(double lat, double lon, double dlat, double dlon)
+{
+  const unsigned int first = info.nodes + 1;
+  node_open(lat, lon, false);
+  node_open(lat + dlat, lon, false);
+  node_open(lat + dlat, lon + dlon, false);
+  node_open(lat, lon + dlon, false);
+
+  fprintf(w, "  <way id='%u' version='1' changeset='1'>\n", ++info.ways);
+  for(unsigned int i = 0; i < 4; i++)
+    fprintf(w, "    <nd ref='%u'/>\n", first + i);
+  fprintf(w, "    <nd ref='%u'/>\n", first);
+
+  return info.ways;
+}
+
+unsigned int osm_generator::building(double lat, double lon, unsigned int row, unsigned int number)
+{
+  const unsigned int id = closed_way(lat, lon, blockSize / 5, blockSize / 5);
+  tag(w, "building", buildings[rnd.next(sizeof(buildings) / sizeof(buildings[0]))]);
+  fprintf(w, "    <tag k='addr:street' v='Street %u'/>\n", row);
+  tag("addr:housenumber", number);
+  if(rnd.next(4) == 0)
+    tag("building:levels", 1 + rnd.next(5));
+  fputs("  </way>\n", w);
+
+  return id;
+}
+
+bool osm_generator::write(const std::string &fname)
+{
+  f = fopen(fname.c_str(), "w");
+  if(f == nullptr) {
+    fprintf(stderr, "cannot create %s: %s\n", fname.c_str(), strerror(errno));
+    return false;
+  }
+  w = open_memstream(&wbuf, &wlen);
+  info = statistics();
+  rnd = random(seed);
+
+  const pos_area area = bounds();
+
+  fputs("<?xml version='1.0' encoding='UTF-8'?>\n"
+        "<osm version='0.6' generator='osm2go'>\n", f);
+  fprintf(f, "  <bounds minlat='%.7f' minlon='%.7f' maxlat='%.7f' maxlon='%.7f'/>\n",
+          area.min.lat, area.min.lon, area.max.lat, area.max.lon);
+
+  // the street crossings, they are referenced by 2 ways each
+  for(unsigned int row = 0; row <= size; row++)
+    for(unsigned int col = 0; col <= size; col++)
+      node_open(baseLat + row * blockSize, baseLon + col * blockSize, false);
+
+  // the streets, first the rows, then the columns
+  for(unsigned int row = 0; row <= size; row++) {
+    fprintf(w, "  <way id='%u' version='1' changeset='1'>\n", ++info.ways);
+    for(unsigned int col = 0; col <= size; col++)
+      fprintf(w, "    <nd ref='%u'/>\n", row * (size + 1) + col + 1);
+    tag(w, "highway", highways[rnd.next(sizeof(highways) / sizeof(highways[0]))]);
+    fprintf(w, "    <tag k='name' v='Street %u'/>\n", row);
+    fputs("  </way>\n", w);
+  }
+  for(unsigned int col = 0; col <= size; col++) {
+    fprintf(w, "  <way id='%u' version='1' changeset='1'>\n", ++info.ways);
+    for(unsigned int row = 0; row <= size; row++)
+      fprintf(w, "    <nd ref='%u'/>\n", row * (size + 1) + col + 1);
+    tag(w, "highway", highways[rnd.next(sizeof(highways) / sizeof(highways[0]))]);
+    fprintf(w, "    <tag k='name' v='Avenue %u'/>\n", col);
+    fputs("  </way>\n", w);
+  }
+  const unsigned int streets = info.ways;
+
+  // outer and inner way of the multipolygons
+  std::vector<std::pair<unsigned int, unsigned int> > landuse;
+  std::vector<std::vector<unsigned int> > stops(size);
+
+  for(unsigned int row = 0; row < size; row++) {
+    for(unsigned int col = 0; col < size; col++) {
+      const double lat = baseLat + row * blockSize;
+      const double lon = baseLon + col * blockSize;
+
+      unsigned int firstBuilding = 0;
+      for(unsigned int b = 0; b < 4; b++) {
+        const unsigned int id = building(lat + blockSize * (0.1 + (b / 2) * 0.5),
+                                         lon + blockSize * (0.1 + (b % 2) * 0.5), row, col * 4 + b + 1);
+        if(b == 0)
+          firstBuilding = id;
+      }
+
+      // a point of interest in the middle of the block
+      node_open(lat + blockSize / 2, lon + blockSize / 2, true);
+      writeTemplate(f, pick(nodeTemplates, nodeWeights));
+      fputs("  </node>\n", f);
+
+      // a bus stop at the street
+      stops[row].push_back(node_open(lat + blockSize / 20, lon + blockSize / 2, true));
+      tag(f, "highway", "bus_stop");
+      fprintf(f, "    <tag k='name' v='Stop %u/%u'/>\n  </node>\n", row, col);
+
+      if(rnd.next(2) == 0) {
+        // an area feature between the buildings
+        closed_way(lat + blockSize * 0.35, lon + blockSize * 0.35, blockSize / 10, blockSize / 10);
+        writeTemplate(w, pick(areaTemplates, areaWeights));
+        fputs("  </way>\n", w);
+      }
+
+      if(rnd.next(10) == 0) {
+        // a multipolygon around the block with a building as inner ring
+        const double d = blockSize / 50;
+        closed_way(lat + d, lon + d, blockSize - 2 * d, blockSize - 2 * d);
+        fputs("  </way>\n", w);
+        landuse.push_back(std::make_pair(info.ways, firstBuilding));
+      }
+    }
+  }
+
+  for(size_t i = 0; i < landuse.size(); i++) {
+    fprintf(w, "  <relation id='%u' version='1' changeset='1'>\n", ++info.relations);
+    fprintf(w, "    <member type='way' ref='%u' role='outer'/>\n", landuse[i].first);
+    fprintf(w, "    <member type='way' ref='%u' role='inner'/>\n", landuse[i].second);
+    tag(w, "type", "multipolygon");
+    tag(w, "landuse", "residential");
+    fputs("  </relation>\n", w);
+  }
+
+  for(unsigned int row = 0; row < size; row++) {
+    fprintf(w, "  <relation id='%u' version='1' changeset='1'>\n", ++info.relations);
+    for(size_t i = 0; i < stops[row].size(); i++)
+      fprintf(w, "    <member type='node' ref='%u' role='platform'/>\n", stops[row][i]);
+    fprintf(w, "    <member type='way' ref='%u' role=''/>\n", row + 1);
+    fprintf(w, "    <member type='way' ref='%u' role=''/>\n", streets);
+    tag(w, "type", "route");
+    tag(w, "route", "bus");
+    tag("ref", row + 1);
+    fputs("  </relation>\n", w);
+  }
+
+  // the circle line visits every stop and uses every street
+  fprintf(w, "  <relation id='%u' version='1' changeset='1'>\n", ++info.relations);
+  for(unsigned int row = 0; row < size; row++)
+    for(size_t i = 0; i < stops[row].size(); i++)
+      fprintf(w, "    <member type='node' ref='%u' role='stop'/>\n", stops[row][i]);
+  for(unsigned int i = 1; i <= streets; i++)
+    fprintf(w, "    <member type='way' ref='%u' role=''/>\n", i);
+  tag(w, "type", "route");
+  tag(w, "route", "tram");
+  tag(w, "name", "Circle Line");
+  fputs("  </relation>\n", w);
+
+  fclose(w);
+  w = nullptr;
+  fwrite(wbuf, 1, wlen, f);
+  free(wbuf);
+  wbuf = nullptr;
+  fputs("</osm>\n", f);
+
+  info.bytes = ftell(f);
+  const bool ret = ferror(f) == 0;
+  if(fclose(f) != 0 || !ret) {
+    fprintf(stderr, "cannot write %s: %s\n", fname.c_str(), strerror(errno));
+    f = nullptr;
+    return false;
+  }
+  f = nullptr;
+
+  return true;
+}
+
+project_t *osm_generator::createProject(const std::string &name, const std::string &base_path)
+{
+  std::unique_ptr<project_t> project(std::make_unique<project_t>(name, base_path));
+  project->bounds = bounds();
+  project->osmFile = name + ".osm";
+
+  if(!project->save() || !write(project->path + project->osmFile))
+    return nullptr;
+
+  return project.release();
+}
+
+void osm_generator::modify(osm_t::ref osm, uint32_t sd)
+{
+  random r(sd);
+  std::vector<node_t *> pois;
+  unsigned int cnt = 0;
+
+  for(std::map<item_id_t, node_t *>::iterator it = osm->nodes.begin(); it != osm->nodes.end(); it++, cnt++) {
+    node_t * const n = it->second;
+    if(n->ways == 0) {
+      pois.push_back(n);
+    } else if(cnt % 10 == 0) {
+      osm->mark_dirty(n);
+      n->lpos = lpos_t(n->lpos.x + 1 + r.next(5), n->lpos.y + 1 + r.next(5));
+      n->pos = n->lpos.toPos(osm->bounds);
+    }
+  }
+
+  cnt = 0;
+  for(std::map<item_id_t, way_t *>::iterator it = osm->ways.begin(); it != osm->ways.end(); it++, cnt++) {
+    if(cnt % 10 != 0)
+      continue;
+    osm_t::TagMap tags = it->second->tags.asMap();
+    tags.insert(osm_t::TagMap::value_type("note", "modified"));
+    osm->updateTags(object_t(it->second), tags);
+  }
+
+  for(size_t i = 0; i < pois.size(); i += 20)
+    osm->node_delete(pois[i]);
+
+  for(size_t i = 0; i < pois.size(); i += 10) {
+    node_t *n = osm->node_new(lpos_t(pois[i]->lpos.x + 3, pois[i]->lpos.y + 3));
+    osm->attach(n);
+  }
+}
+
+bool osm_generator::createDiff(project_t::ref project, uint32_t sd)
+{
+  if(!project->osm && !project->parse_osm())
+    return false;
+
+  modify(project->osm, sd);
+  project->diff_save();
+
+  return project->diff_file_present();
+}
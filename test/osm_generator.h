@@ -0,0 +1,154 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Rolf Eike Beer <eike@sf-mail.de>
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <osm.h>
+#include <project.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+class presets_items_internal;
+
+/**
+ * @brief creates synthetic OSM data of a given size
+ *
+ * The data is a town with a street grid. Every block is surrounded by streets
+ * and contains 4 buildings with addresses, a point of interest, a bus stop and
+ * sometimes an area feature. Some blocks are covered by landuse multipolygons.
+ * Every street row has a bus route, and a circle line contains all stops and
+ * streets, so it has size² + 2 * (size + 1) members.
+ *
+ * If presets are given the points of interest and area features get their tags
+ * from them. The presets are used with a skewed distribution, so few of them
+ * are used very often and most of them only rarely, like in real data.
+ *
+ * The output only depends on the size, the seed and the presets.
+ */
+class osm_generator {
+public:
+  /**
+   * @brief a simple deterministic random number generator
+   *
+   * The results must not depend on the platform, so std::rand() can't be used.
+   */
+  class random {
+    uint32_t state;
+  public:
+    explicit inline random(uint32_t seed) : state(seed) {}
+    inline uint32_t next()
+    {
+      state = state * 1664525u + 1013904223u;
+      return state >> 8;
+    }
+    inline uint32_t next(uint32_t limit)
+    { return next() % limit; }
+  };
+
+  struct statistics {
+    statistics() : nodes(0), ways(0), relations(0), bytes(0) {}
+    unsigned int nodes, ways, relations;
+    long bytes;
+  };
+
+  /**
+   * @brief the tags of one preset item
+   */
+  struct tag_template {
+    std::vector<std::pair<std::string, std::string> > fixed; ///< always set
+    std::vector<std::pair<std::string, std::vector<std::string> > > optional; ///< set sometimes with one of the values
+  };
+
+  /**
+   * @brief constructor
+   * @param s the number of blocks per side of the town
+   * @param sd the seed for the random numbers
+   * @param presets the presets to take the tags from, may be nullptr
+   *
+   * The presets are only used in the constructor.
+   */
+  osm_generator(unsigned int s, uint32_t sd, const presets_items_internal *presets = nullptr);
+
+  const unsigned int size;
+  const uint32_t seed;
+
+  /**
+   * @brief the area covered by the data
+   */
+  pos_area bounds() const;
+
+  /**
+   * @brief write the data as OSM XML
+   * @returns if writing was successful
+   */
+  bool write(const std::string &fname);
+
+  /**
+   * @brief create a project for the data
+   * @param name the project name
+   * @param base_path the directory to create the project directory in
+   * @returns the new project, the data is not loaded
+   * @retval nullptr creating the project failed
+   */
+  project_t *createProject(const std::string &name, const std::string &base_path);
+
+  /**
+   * @brief statistics of the last data written
+   */
+  inline const statistics &stats() const
+  { return info; }
+
+  /**
+   * @brief the number of templates found in the presets for nodes and areas
+   */
+  inline std::pair<size_t, size_t> templateCount() const
+  { return std::make_pair(nodeTemplates.size(), areaTemplates.size()); }
+
+  /**
+   * @brief modify some of the objects like a user would do
+   * @param osm the data to modify
+   * @param sd the seed for the random numbers
+   *
+   * Nodes are moved, tags are added, points of interest are deleted and new
+   * nodes are created.
+   */
+  static void modify(osm_t::ref osm, uint32_t sd);
+
+  /**
+   * @brief create a diff file for the project
+   * @param project the project, the data will be loaded if needed
+   * @param sd the seed for the modifications
+   * @returns if the diff file was written
+   */
+  static bool createDiff(project_t::ref project, uint32_t sd);
+
+private:
+  statistics info;
+  random rnd;
+  FILE *f;
+  char *wbuf;
+  size_t wlen;
+  /// buffers the ways and relations, they must follow all nodes
+  FILE *w;
+
+  std::vector<tag_template> nodeTemplates;
+  std::vector<tag_template> areaTemplates;
+  std::vector<double> nodeWeights; ///< the cumulative weights of nodeTemplates
+  std::vector<double> areaWeights; ///< the cumulative weights of areaTemplates
+
+  const tag_template &pick(const std::vector<tag_template> &templates, const std::vector<double> &weights);
+  void writeTemplate(FILE *out, const tag_template &tpl);
+
+  unsigned int node_open(double lat, double lon, bool tagged);
+  void tag(FILE *out, const std::string &k, const std::string &v);
+  void tag(const char *k, unsigned int v);
+  unsigned int closed_way(double lat, double lon, double dlat, double dlon);
+  unsigned int building(double lat, double lon, unsigned int row, unsigned int number);
+};
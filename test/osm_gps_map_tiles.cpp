@@ -0,0 +1,38 @@
+#include <osm-gps-map.h>
+
+#include <cassert>
+#include <cstring>
+
+#include <osm2go_annotations.h>
+#include <osm2go_cpp.h>
+
+namespace {
+
+void testTileData()
+{
+  const char png[] = "\x89PNG\r\n\x1a\n\0\0\0\rIHDR";
+  const char jpeg[] = "\xff\xd8\xff\xe0\0\x10JFIF";
+  const char html[] = "<html><body>Service unavailable</body></html>";
+
+  assert(osm_gps_map_tile_data_valid("png", "image/png", png, sizeof(png) - 1) == TRUE);
+  // a missing header is not an error
+  assert(osm_gps_map_tile_data_valid("png", nullptr, png, sizeof(png) - 1) == TRUE);
+  assert(osm_gps_map_tile_data_valid("png", "text/html", png, sizeof(png) - 1) == FALSE);
+  assert(osm_gps_map_tile_data_valid("png", "image/png", html, strlen(html)) == FALSE);
+  assert(osm_gps_map_tile_data_valid("png", "image/png", jpeg, sizeof(jpeg) - 1) == FALSE);
+  assert(osm_gps_map_tile_data_valid("png", "image/png", png, 4) == FALSE);
+  assert(osm_gps_map_tile_data_valid("png", "image/png", png, 0) == FALSE);
+  assert(osm_gps_map_tile_data_valid("jpg", "image/jpeg", jpeg, sizeof(jpeg) - 1) == TRUE);
+  assert(osm_gps_map_tile_data_valid("jpg", "image/jpeg", png, sizeof(png) - 1) == FALSE);
+}
+
+} // namespace
+
+int main()
+{
+  testTileData();
+
+  return 0;
+}
+
+#include "dummy_appdata.h"
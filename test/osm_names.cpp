@@ -714,6 +714,56 @@ void test_railway_tracks()
   helper_node(tags, trstring("rail: \"%1\"").arg("1761"));
 }
 
+/**
+ * @brief the cached names follow the modifications
+ */
+void test_cached_names()
+{
+  std::unique_ptr<osm_t> osm(std::make_unique<osm_t>());
+  way_t *w = construct_way(osm, -3);
+
+  osm_t::TagMap tags;
+  tags.insert(osm_t::TagMap::value_type("building", "yes"));
+  tags.insert(osm_t::TagMap::value_type("addr:housenumber", "42"));
+  osm->updateTags(object_t(w), tags);
+
+  assert_cmpstr(osm->objectName(object_t(w)), "building housenumber 42");
+  assert_cmpstr(osm->objectName(object_t(w)), object_t(w).get_name(*osm));
+
+  // changing the tags changes the name
+  tags.insert(osm_t::TagMap::value_type("addr:street", "Highway to hell"));
+  osm->updateTags(object_t(w), tags);
+  assert_cmpstr(osm->objectName(object_t(w)), "building Highway to hell 42");
+
+  // a new relation changes the name of its members
+  osm->updateTags(object_t(w), osm_t::TagMap());
+  assert_cmpstr(osm->objectName(object_t(w)), "unspecified way/area");
+  relation_t *r = new relation_t();
+  r->members.push_back(member_t(object_t(w), "outer"));
+  osm->attach(r);
+  assert_cmpstr(osm->objectName(object_t(w)), trstring("way/area: '%1' in %2 %3").arg("outer").arg("relation").arg(r->idName()));
+  assert_cmpstr(osm->relationName(r), r->idName());
+
+  // the relation names change together with the tags
+  osm_t::TagMap rtags;
+  rtags.insert(osm_t::TagMap::value_type("type", "multipolygon"));
+  rtags.insert(osm_t::TagMap::value_type("name", "Lake"));
+  osm->updateTags(object_t(r), rtags);
+  assert_cmpstr(osm->relationName(r), "Lake");
+  assert_cmpstr(osm->objectName(object_t(w)), trstring("way/area: '%1' of multipolygon %2").arg("outer").arg("\"Lake\""));
+
+  // membership changes are done after marking the relation as modified
+  osm->mark_dirty(r);
+  r->members.clear();
+  assert_cmpstr(osm->objectName(object_t(w)), "unspecified way/area");
+
+  // direct modifications need explicit invalidation
+  r->members.push_back(member_t(object_t(w), "outer"));
+  assert_cmpstr(osm->objectName(object_t(w)), "unspecified way/area");
+  osm->invalidateNames();
+  assert_cmpstr(osm->objectName(object_t(w)), trstring("way/area: '%1' of multipolygon %2").arg("outer").arg("\"Lake\""));
+}
+
 } // namespace
 
 int main()
@@ -736,6 +786,7 @@ int main()
   test_power_generator();
   test_railway_signals();
   test_railway_tracks();
+  test_cached_names();
 
   xmlCleanupParser();
 
@@ -0,0 +1,189 @@
+#include <perf_trace.h>
+
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include <osm2go_annotations.h>
+#include <osm2go_test.h>
+
+namespace {
+
+const perf_trace::summary_entry *findEntry(const std::vector<perf_trace::summary_entry> &entries, const char *name)
+{
+  for(size_t i = 0; i < entries.size(); i++)
+    if(strcmp(entries[i].name, name) == 0)
+      return &entries[i];
+  return nullptr;
+}
+
+void timed(unsigned int value)
+{
+  PERF_SCOPE("test timer");
+  PERF_COUNT("test counter", value);
+}
+
+void worker()
+{
+  for(unsigned int i = 0; i < 10; i++)
+    timed(100 + i);
+}
+
+std::string readFile(const std::string &fname)
+{
+  std::ifstream in(fname.c_str(), std::ios::binary);
+  assert(in.good());
+  return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void test_summary()
+{
+  // nothing is reported before the sites are used
+  assert(findEntry(perf_trace::summary(), "test timer") == nullptr);
+
+  for(unsigned int i = 0; i < 5; i++)
+    timed(i);
+
+  std::thread thread(worker);
+  thread.join();
+
+  const std::vector<perf_trace::summary_entry> &entries = perf_trace::summary();
+  for(size_t i = 1; i < entries.size(); i++)
+    assert_cmpnum_op(strcmp(entries[i - 1].name, entries[i].name), <, 0);
+
+  const perf_trace::summary_entry *timer = findEntry(entries, "test timer");
+  assert(timer != nullptr);
+  assert(timer->kind == perf_trace::site::Timer);
+  assert_cmpnum(timer->count, 15);
+  assert_cmpnum_op(timer->max, <=, timer->total);
+
+  const perf_trace::summary_entry *counter = findEntry(entries, "test counter");
+  assert(counter != nullptr);
+  assert(counter->kind == perf_trace::site::Counter);
+  assert_cmpnum(counter->count, 15);
+  assert_cmpnum(counter->max, 109);
+  // 0..4 from the main thread, 100..109 from the worker
+  assert_cmpnum(counter->total, 10 + 1045);
+
+  const std::string &text = perf_trace::summary_text();
+  assert(text.find("test timer") != std::string::npos);
+  assert(text.find("test counter") != std::string::npos);
+}
+
+void test_trace(const std::string &fname)
+{
+  assert(perf_trace::write_chrome_trace(fname));
+
+  const std::string &data = readFile(fname);
+  assert_cmpnum(data.compare(0, 15, "{\"traceEvents\":"), 0);
+  assert(data.find("\"name\":\"test timer\",\"ph\":\"X\"") != std::string::npos);
+  assert(data.find("\"name\":\"test counter\",\"ph\":\"C\"") != std::string::npos);
+  assert(data.find("\"args\":{\"value\":109}") != std::string::npos);
+
+  assert(!perf_trace::write_chrome_trace("/nonexistent/trace.json"));
+}
+
+/**
+ * @brief only the newest events are kept in the trace
+ */
+void test_overflow(const std::string &fname)
+{
+  for(unsigned int i = 0; i < 100000; i++)
+    PERF_COUNT("overflow counter", i);
+
+  assert(perf_trace::write_chrome_trace(fname));
+  const std::string &data = readFile(fname);
+
+  // the old events of this thread are gone, the new ones are there
+  assert(data.find("\"args\":{\"value\":1}") == std::string::npos);
+  assert(data.find("\"args\":{\"value\":99999}") != std::string::npos);
+  // the events of the worker thread live in their own buffer
+  assert(data.find("\"args\":{\"value\":109}") != std::string::npos);
+
+  const std::vector<perf_trace::summary_entry> &entries = perf_trace::summary();
+  const perf_trace::summary_entry *counter = findEntry(entries, "overflow counter");
+  assert(counter != nullptr);
+  assert_cmpnum(counter->count, 100000);
+  assert_cmpnum(counter->max, 99999);
+}
+
+void reuseWorker()
+{
+  PERF_COUNT("reuse counter", 4242);
+}
+
+/**
+ * @brief a new thread reuses the buffer of a finished one
+ */
+void test_reuse(const std::string &fname)
+{
+  std::thread thread(reuseWorker);
+  thread.join();
+
+  assert(perf_trace::write_chrome_trace(fname));
+  const std::string &data = readFile(fname);
+
+  // the events of the first worker are gone, the new thread got a new id
+  assert(data.find("\"args\":{\"value\":109}") == std::string::npos);
+  assert(data.find("\"tid\":3,\"args\":{\"value\":4242}") != std::string::npos);
+}
+
+void busyWorker(const std::atomic<bool> *stop)
+{
+  for(unsigned int i = 0; !*stop; i++)
+    PERF_COUNT("busy counter", i);
+}
+
+/**
+ * @brief the trace can be written while another thread records events
+ */
+void test_concurrent(const std::string &fname)
+{
+  std::atomic<bool> stop(false);
+  std::thread thread(busyWorker, &stop);
+
+  for(unsigned int i = 0; i < 5; i++)
+    assert(perf_trace::write_chrome_trace(fname));
+
+  stop = true;
+  thread.join();
+
+  assert(perf_trace::write_chrome_trace(fname));
+  const std::string &data = readFile(fname);
+  assert(data.find("\"name\":\"busy counter\"") != std::string::npos);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  OSM2GO_TEST_INIT(argc, argv);
+
+  if(argc != 1)
+    return EINVAL;
+
+  char tmpfile[] = "/tmp/osm2go-trace-XXXXXX";
+  const int fd = mkstemp(tmpfile);
+  assert_cmpnum_op(fd, >=, 0);
+  close(fd);
+
+  test_summary();
+  test_trace(tmpfile);
+  test_overflow(tmpfile);
+  test_reuse(tmpfile);
+  test_concurrent(tmpfile);
+
+  unlink(tmpfile);
+
+  return 0;
+}
+
+#include "dummy_appdata.h"
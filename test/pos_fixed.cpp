@@ -0,0 +1,103 @@
+#include <misc.h>
+#include <pos.h>
+
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <libxml/tree.h>
+#include <string>
+#include <vector>
+
+#include <osm2go_annotations.h>
+#include <osm2go_cpp.h>
+#include <osm2go_stl.h>
+
+namespace {
+
+static_assert(sizeof(pos_fixed_t) * 2 == sizeof(pos_t) || sizeof(pos_float_t) == sizeof(float),
+              "fixed point positions should need half the memory of pos_t");
+
+void checkRoundtrip(const pos_t &pos)
+{
+  const pos_fixed_t fixed(pos);
+  const pos_t back = fixed;
+  assert_cmpnum(back.lat, pos.lat);
+  assert_cmpnum(back.lon, pos.lon);
+  assert(pos_fixed_t(back) == fixed);
+}
+
+std::string xmlProp(xmlNodePtr node, const char *name)
+{
+  xmlString v(xmlGetProp(node, BAD_CAST name));
+  assert(v);
+  return static_cast<const char *>(v);
+}
+
+void checkXml(const pos_t &pos)
+{
+  xmlDocGuard doc(xmlNewDoc(BAD_CAST "1.0"));
+  xmlNodePtr nf = xmlNewNode(nullptr, BAD_CAST "fixed");
+  xmlNodePtr nd = xmlNewNode(nullptr, BAD_CAST "double");
+  xmlDocSetRootElement(doc.get(), nf);
+  xmlAddChild(nf, nd);
+
+  pos.toXmlProperties(nd);
+  pos_fixed_t(pos).toXmlProperties(nf);
+
+  assert_cmpstr(xmlProp(nf, "lat"), xmlProp(nd, "lat").c_str());
+  assert_cmpstr(xmlProp(nf, "lon"), xmlProp(nd, "lon").c_str());
+}
+
+/**
+ * @brief values as they come from the OSM API are preserved exactly
+ */
+void testRoundtrip()
+{
+  const std::vector<pos_t> positions = {
+    pos_t(52.2693518, 9.576014),
+    pos_t(-33.8567844, 151.2152967),
+    pos_t(0, 0),
+    pos_t(0.0000001, -0.0000001),
+    pos_t(89.9999999, -179.9999999),
+    pos_t(-90, 180)
+  };
+
+  for(size_t i = 0; i < positions.size(); i++) {
+    checkRoundtrip(positions.at(i));
+    checkXml(positions.at(i));
+  }
+
+  const pos_fixed_t fixed(pos_t(52.2693518, 9.576014));
+  assert_cmpnum(fixed.lat, 522693518);
+  assert_cmpnum(fixed.lon, 95760140);
+}
+
+void testInvalid()
+{
+  const pos_fixed_t fixed(pos_t(NAN, 9.576014));
+  assert_cmpnum(fixed.lat, pos_fixed_t::invalid);
+  assert(!fixed.valid());
+
+  const pos_t back = fixed;
+  assert(std::isnan(back.lat));
+  assert_cmpnum(back.lon, 9.576014);
+
+  assert(pos_fixed_t(pos_t(52.2693518, 9.576014)).valid());
+}
+
+} // namespace
+
+int main()
+{
+  xmlInitParser();
+
+  testRoundtrip();
+  testInvalid();
+
+  xmlCleanupParser();
+
+  return 0;
+}
+
+#include "dummy_appdata.h"
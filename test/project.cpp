@@ -337,6 +337,11 @@ testRename(const std::string &tmpdir, const char *diff_file)
       assert_cmpnum_op(static_cast<int>(osmfd), >=, 0);
     }
 
+    {
+      fdguard trkfd(openat(project->dirfd, (project->name + ".trklog").c_str(), O_CREAT | O_WRONLY, S_IRUSR | S_IWUSR));
+      assert_cmpnum_op(static_cast<int>(trkfd), >=, 0);
+    }
+
     // use an already existing diff
     osm2go_platform::MappedFile mf(diff_file);
     assert(static_cast<bool>(mf));
@@ -414,6 +419,9 @@ testRename(const std::string &tmpdir, const char *diff_file)
     // track file exists
     assert_cmpnum(stat((project->path + project->name + ".trk").c_str(), &st), 0);
     assert_cmpnum(st.st_size, 0);
+    // track log exists
+    assert_cmpnum(stat((project->path + project->name + ".trklog").c_str(), &st), 0);
+    assert_cmpnum(st.st_size, 0);
     // diff exists
     const std::string ndiffname = project->path + project->name + ".diff";
     osm2go_platform::MappedFile ndiff(ndiffname);
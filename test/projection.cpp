@@ -0,0 +1,116 @@
+#include <pos.h>
+
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <osm2go_annotations.h>
+#include <osm2go_cpp.h>
+
+namespace {
+
+/**
+ * @brief create positions all over the valid range
+ */
+void fillPositions(std::vector<pos_float_t> &lat, std::vector<pos_float_t> &lon)
+{
+  // odd step sizes so the values are not all "nice" numbers
+  for(pos_float_t la = -89; la <= 89; la += 0.0713) {
+    for(pos_float_t lo = -180; lo <= 180; lo += 7.3) {
+      lat.push_back(la);
+      lon.push_back(lo);
+    }
+  }
+}
+
+/**
+ * @brief the batch projection matches the one for single positions
+ */
+void testProject(const pos_area &area)
+{
+  bounds_t bounds;
+  assert(bounds.init(area));
+
+  std::vector<pos_float_t> lat, lon;
+  fillPositions(lat, lon);
+
+  const size_t count = lat.size();
+  std::vector<int> x(count), y(count);
+  bounds.project(lat.data(), lon.data(), x.data(), y.data(), count);
+
+  unsigned int differences = 0;
+  for(size_t i = 0; i < count; i++) {
+    const lpos_t ref = pos_t(lat[i], lon[i]).toLpos(bounds);
+    assert_cmpnum(x[i], ref.x);
+    assert_cmpnum_op(std::abs(y[i] - ref.y), <=, 1);
+    if(y[i] != ref.y)
+      differences++;
+  }
+
+  std::cout << "center " << area.centerLat() << '/' << area.centerLon() << ": "
+            << differences << " of " << count << " projected positions differ by 1" << std::endl;
+  // rounding differences should happen only rarely
+  assert_cmpnum_op(differences * 1000, <, count);
+}
+
+/**
+ * @brief the batch reverse projection matches the one for single positions
+ */
+void testUnproject(const pos_area &area)
+{
+  bounds_t bounds;
+  assert(bounds.init(area));
+
+  std::vector<pos_float_t> lat, lon;
+  fillPositions(lat, lon);
+
+  const size_t count = lat.size();
+  std::vector<int> x(count), y(count);
+  for(size_t i = 0; i < count; i++) {
+    const lpos_t lpos = pos_t(lat[i], lon[i]).toLpos(bounds);
+    x[i] = lpos.x;
+    y[i] = lpos.y;
+  }
+
+  bounds.unproject(x.data(), y.data(), lat.data(), lon.data(), count);
+
+  for(size_t i = 0; i < count; i++) {
+    const pos_t ref = lpos_t(x[i], y[i]).toPos(bounds);
+    assert_cmpnum(lon[i], ref.lon);
+    assert_cmpnum_op(std::abs(lat[i] - ref.lat), <, 1e-9);
+  }
+}
+
+void testEmpty()
+{
+  bounds_t bounds;
+  assert(bounds.init(pos_area(pos_t(52.25, 9.55), pos_t(52.28, 9.6))));
+
+  // nothing to do must not crash
+  bounds.project(nullptr, nullptr, nullptr, nullptr, 0);
+  bounds.unproject(nullptr, nullptr, nullptr, nullptr, 0);
+}
+
+} // namespace
+
+int main()
+{
+  const std::vector<pos_area> areas = {
+    pos_area(pos_t(52.25, 9.55), pos_t(52.28, 9.6)),
+    pos_area(pos_t(-0.1, -78.5), pos_t(0.1, -78.3)),
+    pos_area(pos_t(-70.7, 11.7), pos_t(-70.6, 11.9)),
+    pos_area(pos_t(84.9, -179.9), pos_t(85.0, -179.5))
+  };
+
+  for(size_t i = 0; i < areas.size(); i++) {
+    testProject(areas.at(i));
+    testUnproject(areas.at(i));
+  }
+  testEmpty();
+
+  return 0;
+}
+
+#include "dummy_appdata.h"
@@ -0,0 +1,330 @@
+#include <osm.h>
+#include <osm_objects.h>
+#include <osm_p.h>
+#include <tag_index.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <osm2go_annotations.h>
+#include <osm2go_cpp.h>
+
+namespace {
+
+void set_bounds(osm_t::ref o)
+{
+  bool b = o->bounds.init(pos_area(pos_t(52.2692786, 9.5750497), pos_t(52.2695463, 9.5755)));
+  assert(b);
+}
+
+class reference_match {
+  const char * const key;
+  const char * const value;
+public:
+  inline reference_match(const char *k, const char *v) : key(k), value(v) {}
+  bool operator()(const tag_t &tag) const
+  { return strcmp(tag.key, key) == 0 && (value == nullptr || strcmp(tag.value, value) == 0); }
+};
+
+/**
+ * @brief find the objects matching the given tags without any help from osm_t
+ */
+template<typename T>
+void referenceScan(const std::map<item_id_t, T *> &map, const char *key, const char *value,
+                   const char *key2, const char *value2, std::vector<object_t> &result)
+{
+  for(typename std::map<item_id_t, T *>::const_iterator it = map.begin(); it != map.end(); it++) {
+    const tag_list_t &tags = it->second->tags;
+    if(tags.contains(reference_match(key, value)) &&
+       (key2 == nullptr || tags.contains(reference_match(key2, value2))))
+      result.push_back(object_t(it->second));
+  }
+}
+
+void checkQuery(osm_t::ref osm, const char *key, const char *value, unsigned int types = tag_query_t::AnyType,
+                const char *key2 = nullptr, const char *value2 = nullptr)
+{
+  std::vector<object_t> ref;
+  if(types & tag_query_t::Nodes)
+    referenceScan(osm->nodes, key, value, key2, value2, ref);
+  if(types & tag_query_t::Ways)
+    referenceScan(osm->ways, key, value, key2, value2, ref);
+  if(types & tag_query_t::Relations)
+    referenceScan(osm->relations, key, value, key2, value2, ref);
+
+  tag_query_t query(key, value, types);
+  if(key2 != nullptr)
+    query.andTag(key2, value2);
+
+  const std::vector<object_t> res = osm->find_tagged(query);
+  assert_cmpnum(res.size(), ref.size());
+  for(size_t i = 0; i < res.size(); i++)
+    assert(res[i] == ref[i]);
+}
+
+void checkAllQueries(osm_t::ref osm)
+{
+  checkQuery(osm, "highway", nullptr);
+  checkQuery(osm, "highway", "residential");
+  checkQuery(osm, "highway", "residential", tag_query_t::Ways);
+  checkQuery(osm, "highway", nullptr, tag_query_t::Nodes);
+  checkQuery(osm, "name", nullptr);
+  checkQuery(osm, "name", "Main Street");
+  checkQuery(osm, "highway", nullptr, tag_query_t::AnyType, "name", nullptr);
+  checkQuery(osm, "highway", "residential", tag_query_t::AnyType, "name", "Main Street");
+  checkQuery(osm, "type", "associatedStreet", tag_query_t::Relations);
+  checkQuery(osm, "oneway", "yes");
+  checkQuery(osm, "oneway", "-1");
+  checkQuery(osm, "building", nullptr);
+  checkQuery(osm, "addr:housenumber", "3");
+  // strings that are not in the value cache at all
+  checkQuery(osm, "no such key in the cache", nullptr);
+  checkQuery(osm, "highway", "no such value in the cache");
+}
+
+std::unique_ptr<osm_t> createTestData()
+{
+  std::unique_ptr<osm_t> osm(std::make_unique<osm_t>());
+  set_bounds(osm);
+
+  const char *highways[] = { "residential", "primary", "service" };
+  std::vector<node_t *> nodes;
+  for(int i = 0; i < 30; i++) {
+    node_t *n = osm->node_new(lpos_t(i, i * 2));
+    osm->attach(n);
+    nodes.push_back(n);
+    osm_t::TagMap tags;
+    if(i % 3 == 0)
+      tags.insert(osm_t::TagMap::value_type("highway", "crossing"));
+    if(i % 5 == 0) {
+      tags.insert(osm_t::TagMap::value_type("building", "yes"));
+      tags.insert(osm_t::TagMap::value_type("addr:housenumber", std::to_string(i % 7)));
+    }
+    osm->updateTags(object_t(n), tags);
+  }
+
+  for(int i = 0; i < 10; i++) {
+    way_t *w = new way_t();
+    for(int j = 0; j < 3; j++)
+      w->append_node(nodes[i * 3 + j]);
+    osm->attach(w);
+    osm_t::TagMap tags;
+    tags.insert(osm_t::TagMap::value_type("highway", highways[i % 3]));
+    if(i % 2 == 0)
+      tags.insert(osm_t::TagMap::value_type("name", "Main Street"));
+    if(i % 4 == 1)
+      tags.insert(osm_t::TagMap::value_type("oneway", "yes"));
+    osm->updateTags(object_t(w), tags);
+  }
+
+  relation_t *r = new relation_t();
+  osm->attach(r);
+  osm_t::TagMap rtags;
+  rtags.insert(osm_t::TagMap::value_type("type", "associatedStreet"));
+  rtags.insert(osm_t::TagMap::value_type("name", "Main Street"));
+  osm->updateTags(object_t(r), rtags);
+
+  return osm;
+}
+
+void testQueries()
+{
+  std::unique_ptr<osm_t> osm = createTestData();
+
+  // without index
+  assert(!osm->hasTagIndex());
+  checkAllQueries(osm);
+
+  osm->buildTagIndex();
+  assert(osm->hasTagIndex());
+  checkAllQueries(osm);
+
+  // objects with multiple tags with the same key are only found once
+  node_t *n = osm->nodes.begin()->second;
+  osm_t::TagMap tags;
+  tags.insert(osm_t::TagMap::value_type("name", "A"));
+  tags.insert(osm_t::TagMap::value_type("name", "B"));
+  osm->updateTags(object_t(n), tags);
+  assert_cmpnum(osm->find_tagged(tag_query_t("name", nullptr, tag_query_t::Nodes)).size(), 1);
+  checkAllQueries(osm);
+}
+
+/**
+ * @brief the index is kept up to date by all edit operations
+ */
+void testUpdates()
+{
+  std::unique_ptr<osm_t> osm = createTestData();
+  osm->buildTagIndex();
+
+  // plain tag change
+  way_t *w = osm->ways.begin()->second;
+  osm_t::TagMap tags = w->tags.asMap();
+  tags.erase("name");
+  tags.insert(osm_t::TagMap::value_type("name", "Side Street"));
+  osm->updateTags(object_t(w), tags);
+  checkAllQueries(osm);
+  checkQuery(osm, "name", "Side Street");
+
+  // reversing changes the oneway tag
+  way_t *ow = nullptr;
+  for(std::map<item_id_t, way_t *>::const_iterator it = osm->ways.begin(); ow == nullptr && it != osm->ways.end(); it++)
+    if(it->second->tags.get_value("oneway") != nullptr)
+      ow = it->second;
+  assert(ow != nullptr);
+  ow->reverse(osm);
+  checkAllQueries(osm);
+  assert_cmpstr(ow->tags.get_value("oneway"), "-1");
+
+  // splitting creates a new way with the same tags
+  const size_t residentials = osm->find_tagged(tag_query_t("highway", "residential", tag_query_t::Ways)).size();
+  way_t *sw = static_cast<way_t *>(osm->find_tagged(tag_query_t("highway", "residential", tag_query_t::Ways)).front());
+  way_t *neww = sw->split(osm, std::next(sw->node_chain.begin()), true);
+  assert(neww != nullptr);
+  assert_cmpnum(osm->find_tagged(tag_query_t("highway", "residential", tag_query_t::Ways)).size(), residentials + 1);
+  checkAllQueries(osm);
+
+  // merging nodes moves the tags
+  std::array<way_t *, 2> mergeways;
+  node_t *n1 = static_cast<node_t *>(osm->find_tagged(tag_query_t("building", nullptr, tag_query_t::Nodes)).front());
+  node_t *n2 = static_cast<node_t *>(osm->find_tagged(tag_query_t("highway", "crossing", tag_query_t::Nodes)).back());
+  osm->mergeNodes(n1, n2, mergeways);
+  checkAllQueries(osm);
+
+  // merging ways
+  way_t *w1 = nullptr, *w2 = nullptr;
+  for(std::map<item_id_t, way_t *>::const_iterator it = osm->ways.begin(); w2 == nullptr && it != osm->ways.end(); it++) {
+    for(std::map<item_id_t, way_t *>::const_iterator jt = std::next(it); jt != osm->ways.end(); jt++) {
+      if(it->second->isDeleted() || jt->second->isDeleted())
+        continue;
+      if(it->second->ends_with_node(jt->second->node_chain.front()) ||
+         it->second->ends_with_node(jt->second->node_chain.back())) {
+        w1 = it->second;
+        w2 = jt->second;
+        break;
+      }
+    }
+  }
+  assert(w1 != nullptr);
+  osm->mergeWays(w1, w2, nullptr);
+  checkAllQueries(osm);
+
+  // deleted objects are not found anymore
+  const std::vector<object_t> buildings = osm->find_tagged(tag_query_t("building"));
+  assert(!buildings.empty());
+  osm->node_delete(static_cast<node_t *>(buildings.front()));
+  assert_cmpnum(osm->find_tagged(tag_query_t("building")).size(), buildings.size() - 1);
+  checkAllQueries(osm);
+
+  relation_t *r = osm->relations.begin()->second;
+  osm->relation_delete(r);
+  assert(osm->find_tagged(tag_query_t("type", "associatedStreet")).empty());
+  checkAllQueries(osm);
+
+  // direct changes with a guard
+  way_t *gw = static_cast<way_t *>(osm->find_tagged(tag_query_t("highway", "primary", tag_query_t::Ways)).front());
+  {
+    osm_t::TagChangeGuard guard(*osm, object_t(gw));
+    gw->tags.replace(osm_t::TagMap());
+  }
+  checkAllQueries(osm);
+}
+
+class relation_member_functor {
+  const member_t member;
+  const char * const type;
+public:
+  inline relation_member_functor(const char *t, const char *r, const object_t &o)
+    : member(o, r), type(value_cache.insert(t)) {}
+  bool operator()(const std::pair<item_id_t, relation_t *> &it) const
+  { return it.second->tags.get_value("type") == type &&
+           std::find(it.second->members.cbegin(), it.second->members.cend(), member) != it.second->members.cend(); }
+  bool operator()(const object_t &obj) const
+  {
+    const relation_t *r = static_cast<relation_t *>(obj);
+    return std::find(r->members.cbegin(), r->members.cend(), member) != r->members.cend();
+  }
+};
+
+/**
+ * @brief compare the predicate scans with the tag index
+ *
+ * This is the lookup done for the names of buildings: search the
+ * associatedStreet relation a building is a member of.
+ */
+void benchmark()
+{
+  std::unique_ptr<osm_t> osm(std::make_unique<osm_t>());
+  set_bounds(osm);
+
+  const unsigned int relationCount = 20000;
+  const unsigned int lookups = 500;
+  std::vector<node_t *> houses;
+  base_attributes ba;
+  ba.version = 1;
+  for(unsigned int i = 0; i < relationCount; i++) {
+    ba.id = i + 1;
+    node_t *n = new node_t(ba, lpos_t(i % 100, i / 100));
+    osm->insert(n);
+    houses.push_back(n);
+  }
+  for(unsigned int i = 0; i < relationCount; i++) {
+    ba.id = i + 1;
+    relation_t *r = new relation_t(ba);
+    std::vector<tag_t> tags;
+    // most relations are something else, as in real data
+    tags.push_back(tag_t("type", i % 20 == 0 ? "associatedStreet" : i % 2 ? "route" : "multipolygon"));
+    tags.push_back(tag_t("name", "Street"));
+    r->tags.replace(std::move(tags));
+    r->members.push_back(member_t(object_t(houses[i]), "house"));
+    osm->insert(r);
+  }
+
+  std::vector<const relation_t *> scanResults, indexResults;
+  scanResults.reserve(lookups);
+  indexResults.reserve(lookups);
+
+  const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  for(unsigned int i = 0; i < lookups; i++)
+    scanResults.push_back(osm->find_relation(relation_member_functor("associatedStreet", "house",
+                                                                     object_t(houses[(i * 40) % relationCount]))));
+  const std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+  osm->buildTagIndex();
+  const std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+  for(unsigned int i = 0; i < lookups; i++) {
+    const std::vector<object_t> rels = osm->find_tagged(tag_query_t("type", "associatedStreet", tag_query_t::Relations));
+    const std::vector<object_t>::const_iterator it = std::find_if(rels.begin(), rels.end(),
+                          relation_member_functor("associatedStreet", "house", object_t(houses[(i * 40) % relationCount])));
+    indexResults.push_back(it == rels.end() ? nullptr : static_cast<relation_t *>(*it));
+  }
+  const std::chrono::steady_clock::time_point t3 = std::chrono::steady_clock::now();
+
+  assert(scanResults == indexResults);
+  assert(std::find(scanResults.begin(), scanResults.end(), nullptr) == scanResults.end());
+
+  std::cout << lookups << " relation lookups in " << relationCount << " relations: predicate scan "
+            << std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count() << " us, index build "
+            << std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() << " us, index lookups "
+            << std::chrono::duration_cast<std::chrono::microseconds>(t3 - t2).count() << " us" << std::endl;
+}
+
+} // namespace
+
+int main()
+{
+  testQueries();
+  testUpdates();
+  benchmark();
+
+  return 0;
+}
+
+#include "dummy_appdata.h"
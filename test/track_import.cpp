@@ -0,0 +1,191 @@
+#include <track.h>
+#include <track_p.h>
+
+#include <cassert>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <libxml/parser.h>
+#include <memory>
+#include <string>
+#include <unistd.h>
+
+#include <osm2go_annotations.h>
+#include <osm2go_cpp.h>
+#include <osm2go_platform.h>
+
+namespace {
+
+void compare_tracks(const track_t &a, const track_t &b)
+{
+  assert_cmpnum(a.segments.size(), b.segments.size());
+
+  for(std::vector<track_seg_t>::size_type i = 0; i < a.segments.size(); i++) {
+    const track_point_list &pa = a.segments.at(i).track_points;
+    const track_point_list &pb = b.segments.at(i).track_points;
+
+    assert_cmpnum(pa.size(), pb.size());
+    for(track_point_list::size_type j = 0; j < pa.size(); j++) {
+      assert(pa.at(j).pos == pb.at(j).pos);
+      assert_cmpnum(pa.at(j).time, pb.at(j).time);
+      if(std::isnan(pa.at(j).altitude))
+        assert(std::isnan(pb.at(j).altitude));
+      else
+        assert_cmpnum(pa.at(j).altitude, pb.at(j).altitude);
+    }
+  }
+}
+
+/**
+ * @brief the scanner must handle the file and give the same result as libxml2
+ */
+void testFile(const char *filename)
+{
+  osm2go_platform::MappedFile map(filename);
+  assert(map);
+
+  std::unique_ptr<track_t> scanned(track_scan(map.data(), map.length()));
+  assert(scanned);
+  std::unique_ptr<track_t> sax(track_parse_sax(filename));
+  assert(sax);
+
+  compare_tracks(*sax, *scanned);
+}
+
+void testDecimal()
+{
+  const char *values[] = {
+    "0", "-0", "1", "52.2720694", "-33.8567844", "151.213108", "9.5816714",
+    "179.9999999", "-180", "+42.5", "0.0000001", "8848.86", "-0.01",
+    "0.1234567890123", "123456789012345", ".5", "5.",
+    // these are handled by the fallback
+    "1234567890123456789", "1e3", "0.12345678901234567890123", "1,5",
+    nullptr
+  };
+
+  for(unsigned int i = 0; values[i] != nullptr; i++) {
+    const double d = parse_decimal(values[i]);
+    const double ref = osm2go_platform::string_to_double(values[i]);
+    if(std::isnan(ref))
+      assert(std::isnan(d));
+    else
+      assert_cmpnum(d, ref);
+  }
+
+  // check a lot of values with 7 decimal places, as written by osm2go
+  char buf[32];
+  for(int i = -1800000000; i <= 1800000000; i += 9876543) {
+    snprintf(buf, sizeof(buf), "%s%d.%07d", i < 0 ? "-" : "", std::abs(i) / 10000000, std::abs(i) % 10000000);
+    assert_cmpnum(parse_decimal(buf), strtod(buf, nullptr));
+  }
+}
+
+const char *gpx_head = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                       "<gpx xmlns=\"http://www.topografix.com/GPX/1/0\">\n";
+
+void testUnknownElements(const std::string &tmpfile)
+{
+  const std::string data = std::string("\xef\xbb\xbf") + gpx_head +
+      "<!-- a comment <trk> -->\n"
+      "<metadata><name>test</name><trk><trkseg/></trk></metadata>\n"
+      "<trk><name>a &amp; b</name>\n"
+      "<trkseg>\n"
+      "<trkpt lon='9.5816714' lat = \"52.2720694\"><ele>42.5</ele><time>2014-07-01T16:41:06Z</time>"
+      "<extensions><speed>5</speed></extensions></trkpt>\n"
+      "<trkpt lat=\"52.2720701\" lon=\"9.5816641\"/>\n"
+      "</trkseg></trk></gpx>\n";
+
+  // the entity can't be handled by the scanner
+  assert(!track_scan(data.c_str(), data.size()));
+
+  FILE *f = fopen(tmpfile.c_str(), "w");
+  assert(f != nullptr);
+  assert_cmpnum(fwrite(data.c_str(), 1, data.size(), f), data.size());
+  fclose(f);
+
+  std::unique_ptr<track_t> track(track_import(tmpfile.c_str()));
+  assert(track);
+  assert_cmpnum(track->segments.size(), 1);
+  assert_cmpnum(track->segments.front().track_points.size(), 2);
+  assert_cmpnum(track->segments.front().track_points.front().altitude, 42.5);
+
+  // without the entity both must give the same result
+  std::string plain = data;
+  plain.replace(plain.find("&amp;"), 5, "and");
+  std::unique_ptr<track_t> scanned(track_scan(plain.c_str(), plain.size()));
+  assert(scanned);
+  compare_tracks(*track, *scanned);
+}
+
+/**
+ * @brief non-ASCII bytes next to the places where whitespace is skipped
+ */
+void testUtf8()
+{
+  const std::string data = std::string(gpx_head) +
+      "<!-- Stra\xc3\x9f" "e \xe2\x80\x94 ?> -- -->\n"
+      "<trk><name>M\xc3\xbcnchen \xe2\x86\x92 K\xc3\xb6ln</name>\n"
+      "<trkseg>\xc2\xa0\n"
+      "<trkpt lat=\"52.2720694\" lon=\"9.5816714\" \xc3\xa4=\"\xc3\xb6\"><time>2014-07-01T16:41:06Z</time></trkpt>\n"
+      "</trkseg \n></trk></gpx>\n";
+
+  std::unique_ptr<track_t> track(track_scan(data.c_str(), data.size()));
+  assert(track);
+  assert_cmpnum(track->segments.size(), 1);
+  assert_cmpnum(track->segments.front().track_points.size(), 1);
+  assert_cmpnum(track->segments.front().track_points.front().time, 1404232866);
+}
+
+void testInvalid()
+{
+  const char *invalid[] = {
+    "<gpx><trk><trkseg><trkpt lat=\"1\" lon=\"2\"></trkseg></trk></gpx>",
+    "<gpx><trk><trkseg><trkpt lat=\"1\" lon=\"2\"/></trkseg></trk>",
+    "<gpx><trk><trkseg><trkpt lat=\"1\" lon=\"2/></trkseg></trk></gpx>",
+    "<!DOCTYPE gpx><gpx><trk><trkseg><trkpt lat=\"1\" lon=\"2\"/></trkseg></trk></gpx>",
+    "<gpx><trk><trkseg><![CDATA[x]]></trkseg></trk></gpx>",
+    "<gpx><trk><trkseg><trkpt lat=\"1\" lon=\"2\"/></trkseg></trk></gpx",
+    nullptr
+  };
+
+  for(unsigned int i = 0; invalid[i] != nullptr; i++)
+    assert(!track_scan(invalid[i], strlen(invalid[i])));
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if(argc != 3)
+    return EINVAL;
+
+  char tmpdir[] = "/tmp/osm2go-track-import-XXXXXX";
+
+  if(mkdtemp(tmpdir) == nullptr) {
+    std::cerr << "cannot create temporary directory" << std::endl;
+    return 1;
+  }
+
+  const std::string tmpfile = std::string(tmpdir) + "/test.gpx";
+
+  xmlInitParser();
+
+  testFile(argv[1]);
+  testFile(argv[2]);
+  testDecimal();
+  testUnknownElements(tmpfile);
+  testUtf8();
+  testInvalid();
+
+  xmlCleanupParser();
+
+  unlink(tmpfile.c_str());
+  assert_cmpnum(rmdir(tmpdir), 0);
+
+  return 0;
+}
+
+#include "dummy_appdata.h"
@@ -0,0 +1,222 @@
+#include <track.h>
+
+#include <fdguard.h>
+
+#include <cassert>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <libxml/parser.h>
+#include <memory>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <osm2go_annotations.h>
+#include <osm2go_cpp.h>
+#include <osm2go_platform.h>
+
+namespace {
+
+const char *logname = "test.trklog";
+
+void compare_tracks(const track_t &a, const track_t &b)
+{
+  assert_cmpnum(a.segments.size(), b.segments.size());
+
+  for(std::vector<track_seg_t>::size_type i = 0; i < a.segments.size(); i++) {
+    const track_point_list &pa = a.segments.at(i).track_points;
+    const track_point_list &pb = b.segments.at(i).track_points;
+
+    assert_cmpnum(pa.size(), pb.size());
+    for(track_point_list::size_type j = 0; j < pa.size(); j++) {
+      assert(pa.at(j).pos == pb.at(j).pos);
+      assert_cmpnum(pa.at(j).time, pb.at(j).time);
+      if(std::isnan(pa.at(j).altitude))
+        assert(std::isnan(pb.at(j).altitude));
+      else
+        assert_cmpnum(pa.at(j).altitude, pb.at(j).altitude);
+    }
+  }
+}
+
+void compare_files(const std::string &a, const std::string &b)
+{
+  osm2go_platform::MappedFile fa(a);
+  osm2go_platform::MappedFile fb(b);
+
+  assert(fa);
+  assert(fb);
+  assert_cmpmem(fa.data(), fa.length(), fb.data(), fb.length());
+}
+
+/**
+ * @brief convert the GPX file to a log and back and check nothing is lost
+ * @returns the exported GPX file
+ */
+std::string roundtrip(const std::string &tmpdir, int dirfd, const char *gpx)
+{
+  std::unique_ptr<track_t> track(track_import(gpx));
+  assert(track);
+  assert(track->dirty);
+
+  assert(track_log_write(dirfd, logname, *track));
+  assert(!track->dirty);
+  assert(track->log);
+
+  std::unique_ptr<track_t> logtrack(track_log_read(dirfd, logname));
+  assert(logtrack);
+  assert(!logtrack->dirty);
+  assert(logtrack->log);
+  assert(!logtrack->active);
+
+  compare_tracks(*track, *logtrack);
+
+  const std::string origgpx = tmpdir + "orig.gpx";
+  const std::string loggpx = tmpdir + "log.gpx";
+  track_export(track.get(), origgpx.c_str());
+  track_export(logtrack.get(), loggpx.c_str());
+
+  compare_files(origgpx, loggpx);
+
+  unlink(origgpx.c_str());
+
+  return loggpx;
+}
+
+void testAppend(int dirfd)
+{
+  std::unique_ptr<track_t> track(std::make_unique<track_t>());
+  // nothing to append to
+  track->segments.push_back(track_seg_t());
+  track->segments.back().track_points.push_back(track_point_t(pos_t(52.2720694, 9.5816714), 42.47f, 1404225666));
+  assert(!track_log_append(*track));
+
+  assert(track_log_write(dirfd, logname, *track));
+
+  // what track_append_position() does
+  track->segments.back().track_points.push_back(track_point_t(pos_t(52.2720701, 9.5816641), 42.5f, 1404225667));
+  assert(track_log_append(*track));
+  track->segments.push_back(track_seg_t());
+  track->segments.back().track_points.push_back(track_point_t(pos_t(-33.8567844, 151.213108), NAN, 1404225670));
+  assert(track_log_append(*track));
+  track->segments.back().track_points.push_back(track_point_t(pos_t(-33.8567841, -0.0000001), -12.5f, 1404225671));
+  assert(track_log_append(*track));
+
+  std::unique_ptr<track_t> logtrack(track_log_read(dirfd, logname));
+  assert(logtrack);
+  compare_tracks(*track, *logtrack);
+
+  // e.g. after clearing the current segment the track needs to be written again
+  track->reset_log();
+  assert(track->dirty);
+  assert(!track->log);
+  assert(!track_log_append(*track));
+}
+
+void testDamaged(int dirfd)
+{
+  std::unique_ptr<track_t> track(std::make_unique<track_t>());
+  track->segments.push_back(track_seg_t());
+  track->segments.back().track_points.push_back(track_point_t(pos_t(52.2720694, 9.5816714), 42.47f, 1404225666));
+  track->segments.back().track_points.push_back(track_point_t(pos_t(52.2720701, 9.5816641), NAN, 1404225667));
+
+  assert(track_log_write(dirfd, logname, *track));
+  track.reset();
+
+  // simulate a crash in the middle of writing a record
+  {
+    fdguard fd(dirfd, logname, O_WRONLY | O_APPEND);
+    assert(fd.valid());
+    const char *partial = "P 5227207";
+    assert_cmpnum(write(fd, partial, strlen(partial)), strlen(partial));
+  }
+
+  track.reset(track_log_read(dirfd, logname));
+  assert(track);
+  assert_cmpnum(track->segments.size(), 1);
+  assert_cmpnum(track->segments.front().track_points.size(), 2);
+  // the damaged log must not be appended to, but rewritten
+  assert(!track->log);
+  assert(track->dirty);
+
+  // a broken record in the middle only loses that record
+  {
+    track = std::make_unique<track_t>();
+    track->segments.push_back(track_seg_t());
+    track->segments.back().track_points.push_back(track_point_t(pos_t(52.2720694, 9.5816714), 42.47f, 1404225666));
+    assert(track_log_write(dirfd, logname, *track));
+
+    fdguard fd(dirfd, logname, O_WRONLY | O_APPEND);
+    assert(fd.valid());
+    const char *records = "P 52272 garbage\nP 522720701 95816641 - 1404225667\nS\nP 522720710 95816650 4250 1404225668\n";
+    assert_cmpnum(write(fd, records, strlen(records)), strlen(records));
+  }
+
+  track.reset(track_log_read(dirfd, logname));
+  assert(track);
+  assert_cmpnum(track->segments.size(), 2);
+  assert_cmpnum(track->segments.front().track_points.size(), 2);
+  assert_cmpnum(track->segments.front().track_points.at(1).time, 1404225667);
+  assert_cmpnum(track->segments.back().track_points.size(), 1);
+  assert_cmpnum(track->segments.back().track_points.at(0).time, 1404225668);
+  assert(!track->log);
+  assert(track->dirty);
+
+  // not a track log at all
+  {
+    fdguard fd(openat(dirfd, logname, O_WRONLY | O_TRUNC));
+    assert(fd.valid());
+    const char *garbage = "<gpx>\n";
+    assert_cmpnum(write(fd, garbage, strlen(garbage)), strlen(garbage));
+  }
+  track.reset(track_log_read(dirfd, logname));
+  assert(!track);
+
+  // no file at all
+  unlinkat(dirfd, logname, 0);
+  track.reset(track_log_read(dirfd, logname));
+  assert(!track);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if(argc != 3)
+    return EINVAL;
+
+  char tmpdir[] = "/tmp/osm2go-track-log-XXXXXX";
+
+  if(mkdtemp(tmpdir) == nullptr) {
+    std::cerr << "cannot create temporary directory" << std::endl;
+    return 1;
+  }
+
+  const std::string tmppath = std::string(tmpdir) + '/';
+  fdguard dirfd(tmpdir);
+  assert(dirfd.valid());
+
+  xmlInitParser();
+
+  // the file written by osm2go must be reproduced exactly
+  const std::string loggpx = roundtrip(tmppath, dirfd, argv[1]);
+  compare_files(argv[1], loggpx);
+  unlink(loggpx.c_str());
+
+  unlink(roundtrip(tmppath, dirfd, argv[2]).c_str());
+
+  testAppend(dirfd);
+  testDamaged(dirfd);
+
+  xmlCleanupParser();
+
+  unlinkat(dirfd, logname, 0);
+  assert_cmpnum(rmdir(tmpdir), 0);
+
+  return 0;
+}
+
+#include "dummy_appdata.h"
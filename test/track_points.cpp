@@ -0,0 +1,163 @@
+#include <track.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+#include <osm2go_annotations.h>
+#include <osm2go_cpp.h>
+
+namespace {
+
+// operator* returns the points by value, so only the input iterator guarantees are given
+static_assert(std::is_same<std::iterator_traits<track_point_list::const_iterator>::iterator_category,
+                           std::input_iterator_tag>::value, "track point iterator must not claim to be a forward iterator");
+
+void compare_points(const track_point_t &a, const track_point_t &b)
+{
+  assert(a.pos == b.pos);
+  assert_cmpnum(a.time, b.time);
+  if(std::isnan(a.altitude))
+    assert(std::isnan(b.altitude));
+  else
+    assert_cmpnum(a.altitude, b.altitude);
+}
+
+/**
+ * @brief check the list contains exactly the given points
+ */
+void compare_list(const std::vector<track_point_t> &ref, const track_point_list &list)
+{
+  assert_cmpnum(ref.size(), list.size());
+
+  // sequential access
+  track_point_list::const_iterator it = list.begin();
+  for(std::vector<track_point_t>::const_iterator rit = ref.begin(); rit != ref.end(); rit++, it++)
+    compare_points(*rit, *it);
+  assert(it == list.end());
+
+  // backwards and random access
+  for(size_t i = ref.size(); i > 0; i--)
+    compare_points(ref.at(i - 1), list.at(i - 1));
+  for(size_t i = 0; i < ref.size(); i += 7)
+    compare_points(ref.at(i), list.begin()[i]);
+
+  if(!ref.empty()) {
+    compare_points(ref.front(), list.front());
+    compare_points(ref.back(), list.back());
+    assert((list.end() - 1)->pos == ref.back().pos);
+    assert_cmpnum(std::distance(list.begin(), list.end()), ref.size());
+  }
+}
+
+void testEmpty()
+{
+  track_point_list list;
+
+  assert(list.empty());
+  assert_cmpnum(list.size(), 0);
+  assert(list.begin() == list.end());
+}
+
+void testDeltas()
+{
+  std::vector<track_point_t> ref;
+
+  // a point far away from the previous one in every aspect
+  ref.push_back(track_point_t(pos_t(52.2720694, 9.5816714), 42.47f, 1404225666));
+  ref.push_back(track_point_t(pos_t(52.2720701, 9.5816641), 42.5f, 1404225667));
+  ref.push_back(track_point_t(pos_t(-33.8567844, 151.213108), 42.5f, 1404225668));
+  ref.push_back(track_point_t(pos_t(-33.8567844, 151.213108), -0.01f, 1404225669));
+  ref.push_back(track_point_t(pos_t(-33.8567844, 151.213108), 8848.86f, 1404225670));
+  // time going backwards
+  ref.push_back(track_point_t(pos_t(-33.8567844, 151.213108), 8848.86f, 1404225600));
+  // big gap in time
+  ref.push_back(track_point_t(pos_t(-33.8567844, 151.213108), 8848.86f, 1504225600));
+  // unknown altitude, going from known to unknown and back
+  ref.push_back(track_point_t(pos_t(-33.8567844, 151.213108), NAN, 1504225601));
+  ref.push_back(track_point_t(pos_t(-33.8567844, 151.213108), 8848.8f, 1504225602));
+  ref.push_back(track_point_t(pos_t(-33.8567844, 151.213108), NAN, 1504225603));
+  ref.push_back(track_point_t(pos_t(-33.8567844, 151.213108), NAN, 1504225604));
+  ref.push_back(track_point_t(pos_t(-33.8567844, 151.213108), 1.0f, 1504225605));
+  // the extremes
+  ref.push_back(track_point_t(pos_t(90, 180), 0.0f, 0));
+  ref.push_back(track_point_t(pos_t(-90, -180), 0.0f, 0));
+  ref.push_back(track_point_t(pos_t(-90, 180), 0.0f, 0));
+
+  track_point_list list;
+  for(std::vector<track_point_t>::const_iterator it = ref.begin(); it != ref.end(); it++)
+    list.push_back(*it);
+
+  compare_list(ref, list);
+
+  list.shrink_to_fit();
+  compare_list(ref, list);
+
+  list.clear();
+  assert(list.empty());
+}
+
+void testQuantize()
+{
+  const pos_t pos(52.27206941234, 9.58167145678);
+  const pos_t q = track_point_list::quantize(pos);
+
+  assert_cmpnum(q.lat, 52.2720694);
+  assert_cmpnum(q.lon, 9.5816715);
+  assert(track_point_list::quantize(q) == q);
+
+  track_point_list list;
+  list.push_back(track_point_t(pos, NAN, 1));
+  assert(list.back().pos == q);
+}
+
+/**
+ * @brief simulate a long recording, point every second, moving at varying speed
+ */
+void testLong()
+{
+  const unsigned int count = 1000000;
+  std::vector<track_point_t> ref;
+  ref.reserve(count);
+  track_point_list list;
+
+  pos_t pos(52.2720694, 9.5816714);
+  float alt = 80;
+  time_t t = 1404225666;
+  for(unsigned int i = 0; i < count; i++) {
+    // up to about 40 m per second
+    const double speed = (i / 1000) % 40 * 0.0000035;
+    pos.lat += speed * sin(i / 300.0);
+    pos.lon += speed * cos(i / 200.0);
+    alt += (static_cast<int>(i % 11) - 5) * 0.03f;
+    t += 1 + (i % 97 == 0 ? 30 : 0);
+    const track_point_t pt(track_point_list::quantize(pos), std::round(alt * 100) / 100, t);
+    ref.push_back(pt);
+    list.push_back(pt);
+  }
+
+  compare_list(ref, list);
+
+  list.shrink_to_fit();
+  std::cout << "memory for " << count << " points: " << list.memory_size() << " bytes, "
+            << ref.capacity() * sizeof(ref.front()) << " bytes uncompressed" << std::endl;
+  assert_cmpnum_op(list.memory_size() * 2, <, ref.capacity() * sizeof(ref.front()));
+}
+
+} // namespace
+
+int main()
+{
+  testEmpty();
+  testDeltas();
+  testQuantize();
+  testLong();
+
+  return 0;
+}
+
+#include "dummy_appdata.h"
@@ -0,0 +1,319 @@
+#include <wms.h>
+#include <wms_p.h>
+
+#include <canvas.h>
+#include <osm.h>
+#include <project.h>
+
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unistd.h>
+
+#include <osm2go_annotations.h>
+#include <osm2go_platform.h>
+#include <osm2go_stl.h>
+#include <osm2go_test.h>
+
+namespace {
+
+// a 1x1 grayscale PNG image
+const unsigned char tilePng[] = {
+  0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48, 0x44, 0x52,
+  0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x08, 0x00, 0x00, 0x00, 0x00, 0x3a, 0x7e, 0x9b,
+  0x55, 0x00, 0x00, 0x00, 0x0a, 0x49, 0x44, 0x41, 0x54, 0x78, 0x9c, 0x63, 0x68, 0x00, 0x00, 0x00,
+  0x82, 0x00, 0x81, 0x77, 0xcd, 0x72, 0xb6, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae,
+  0x42, 0x60, 0x82
+};
+
+const pos_area pbounds(pos_t(52.2692786, 9.5750497), pos_t(52.2795463, 9.5855));
+
+void setupProject(project_t &project)
+{
+  project.osm.reset(new osm_t());
+  bool b = project.osm->bounds.init(pbounds);
+  assert(b);
+  project.wms_server = "http://localhost:8080/wms?";
+  project.wms_layers = "osm";
+  project.wms_srs = "EPSG:4326";
+  project.wms_format = "image/png";
+}
+
+/**
+ * @brief put a tile into the cache as the download would do it
+ * @param valid if the file should contain a valid image or be empty
+ */
+void cacheTile(const wms_tiles_t &tiles, const wms_tile_t &tile, bool valid)
+{
+  const std::string fname = tiles.tileFile(tile);
+  assert(osm2go_platform::create_directories(fname.substr(0, fname.rfind('/'))));
+  FILE *f = fopen(fname.c_str(), "w");
+  assert(f != nullptr);
+  if(valid)
+    assert_cmpnum(fwrite(tilePng, 1, sizeof(tilePng), f), sizeof(tilePng));
+  fclose(f);
+}
+
+/**
+ * @brief remove the files and directories created by cacheTile()
+ */
+void removeCache(const wms_tiles_t &tiles, const std::vector<wms_tile_t> &cached)
+{
+  for(std::vector<wms_tile_t>::const_iterator it = cached.begin(); it != cached.end(); it++) {
+    std::string dir = tiles.tileFile(*it);
+    unlink(dir.c_str());
+    // the directories of the zoom level and column, they are only removed once empty
+    for(int i = 0; i < 2; i++) {
+      dir.erase(dir.rfind('/'));
+      rmdir(dir.c_str());
+    }
+  }
+
+  std::string dir = tiles.cacheDir();
+  for(int i = 0; i < 2; i++) {
+    dir.erase(dir.rfind('/'));
+    assert_cmpnum(rmdir(dir.c_str()), 0);
+  }
+}
+
+void testTileMath()
+{
+  // tile 0/0 is at 180 W 90 N
+  const pos_area b = wms_tile_t(1, 0, 0).bounds();
+  assert_cmpnum(b.min.lon, -180);
+  assert_cmpnum(b.max.lon, 0);
+  assert_cmpnum(b.min.lat, -90);
+  assert_cmpnum(b.max.lat, 90);
+
+  const pos_area b2 = wms_tile_t(3, 5, 1).bounds();
+  assert_cmpnum(b2.min.lon, 45);
+  assert_cmpnum(b2.max.lon, 90);
+  assert_cmpnum(b2.min.lat, 0);
+  assert_cmpnum(b2.max.lat, 45);
+
+  assert_cmpstr(wms_tile_t(3, 5, 1).cacheName("png"), "3/5/1.png");
+
+  // one tile pixel should not be bigger than a screen pixel
+  assert_cmpnum(wms_tile_zoom(360.0 / wms_tile_t::Pixels / 1024), 10);
+  assert_cmpnum(wms_tile_zoom(360.0 / wms_tile_t::Pixels / 1000), 10);
+  assert_cmpnum(wms_tile_zoom(1000), wms_tile_t::MinZoom);
+  assert_cmpnum(wms_tile_zoom(0), wms_tile_t::MaxZoom);
+  assert_cmpnum(wms_tile_zoom(1e-12), wms_tile_t::MaxZoom);
+
+  // an area inside a single tile
+  const pos_area small(pos_t(52.27, 9.57), pos_t(52.28, 9.58));
+  std::vector<wms_tile_t> tiles = wms_tiles_for_area(small, 10);
+  assert_cmpnum(tiles.size(), 1);
+  assert(tiles.front().bounds().contains(small.min));
+  assert(tiles.front().bounds().contains(small.max));
+
+  // an area spanning 2x3 tiles
+  const double span = 360.0 / 1024;
+  const pos_area big(pos_t(52.0 - 2 * span, 9.6 - span), pos_t(52.0, 9.6));
+  tiles = wms_tiles_for_area(big, 10);
+  assert_cmpnum(tiles.size(), 6);
+  for(std::vector<wms_tile_t>::const_iterator it = tiles.begin(); it != tiles.end(); it++)
+    assert_cmpnum(it->zoom, 10);
+
+  // the edges of the world
+  const pos_area world(pos_t(-90, -180), pos_t(90, 180));
+  assert_cmpnum(wms_tiles_for_area(world, 1).size(), 2);
+  assert_cmpnum(wms_tiles_for_area(world, 3).size(), 32);
+
+  assert(wms_tiles_for_area(pos_area(pos_t(NAN, NAN), pos_t(NAN, NAN)), 5).empty());
+}
+
+void testUrl()
+{
+  const std::string key = wms_tile_cache_key("https://example.com/wms?", "a,b", "EPSG:4326", "image/png");
+  assert_cmpnum(key.size(), 16);
+  // stable
+  assert_cmpstr(key, wms_tile_cache_key("https://example.com/wms?", "a,b", "EPSG:4326", "image/png"));
+  // every part matters
+  assert(key != wms_tile_cache_key("https://example.com/wms?", "a", "EPSG:4326", "image/png"));
+  assert(key != wms_tile_cache_key("https://example.com/wms?", "a,b", "EPSG:4326", "image/jpeg"));
+  assert(wms_tile_cache_key("a", "bc", "", "") != wms_tile_cache_key("ab", "c", "", ""));
+
+  const std::string url = wms_tile_url("https://example.com/wms?", "a,b", "EPSG:4326", "image/png",
+                                       wms_tile_t(3, 5, 1));
+  assert_cmpstr(url, "https://example.com/wms?SERVICE=wms&VERSION=1.1.1&REQUEST=GetMap&LAYERS=a,b"
+                     "&STYLES=&SRS=EPSG:4326&BBOX=45,0,90,45&WIDTH=256&HEIGHT=256&FORMAT=image/png"
+                     "&reaspect=false");
+
+  assert_cmpstr(wms_format_extension("image/png"), "png");
+  assert_cmpstr(wms_format_extension("image/jpeg"), "jpg");
+  assert_null(wms_format_extension("image/tiff"));
+}
+
+/**
+ * @brief check which tiles are needed and which are taken from the cache
+ *
+ * The cache is filled locally as the download would do it.
+ */
+void testCache(const std::string &tmpdir)
+{
+  project_t project("wms_test", tmpdir);
+  setupProject(project);
+
+  const std::string cachebase = tmpdir + "/cache/";
+  wms_tiles_t tiles(project, cachebase);
+  assert_cmpstr(tiles.cacheDir(), cachebase + wms_tile_cache_key(project.wms_server, project.wms_layers,
+                                                                  project.wms_srs, project.wms_format) + '/');
+
+  // a view much bigger than the project is clipped to the project bounds
+  const pos_area view(pos_t(52, 9), pos_t(53, 10));
+  const double degPerPixel = pbounds.lonDist() / 1024;
+  std::vector<wms_tile_t> needed = tiles.tiles(view, degPerPixel);
+  assert(!needed.empty());
+  assert_cmpnum_op(needed.size(), <=, wms_tiles_t::MaxTiles);
+  for(std::vector<wms_tile_t>::const_iterator it = needed.begin(); it != needed.end(); it++) {
+    const pos_area tb = it->bounds();
+    assert_cmpnum_op(tb.max.lat, >, pbounds.min.lat);
+    assert_cmpnum_op(tb.min.lat, <, pbounds.max.lat);
+    assert_cmpnum_op(tb.max.lon, >, pbounds.min.lon);
+    assert_cmpnum_op(tb.min.lon, <, pbounds.max.lon);
+  }
+
+  assert_cmpstr(tiles.tileFile(needed.front()), tiles.cacheDir() + needed.front().cacheName("png"));
+  assert(tiles.tileUrl(needed.front()).find("http://localhost:8080/wms?SERVICE=wms") == 0);
+
+  // very high resolution would need too many tiles, so the zoom level is reduced
+  needed = tiles.tiles(pbounds, 1e-9);
+  assert_cmpnum_op(needed.size(), <=, wms_tiles_t::MaxTiles);
+  assert_cmpnum_op(needed.front().zoom, <, wms_tile_t::MaxZoom);
+}
+
+/**
+ * @brief the offset of the background must survive a change of the zoom level
+ *
+ * All tiles are in the cache, so nothing is downloaded.
+ */
+void testOffset(const std::string &tmpdir)
+{
+  project_t project("wms_test", tmpdir);
+  setupProject(project);
+
+  const std::string cachebase = tmpdir + "/cache/";
+  wms_tiles_t tiles(project, cachebase);
+
+  const double degPerPixel = pbounds.lonDist() / 1024;
+  const std::vector<wms_tile_t> needed = tiles.tiles(pbounds, degPerPixel);
+  const std::vector<wms_tile_t> needed2 = tiles.tiles(pbounds, degPerPixel * 4);
+  assert(needed.front().zoom != needed2.front().zoom);
+  for(std::vector<wms_tile_t>::const_iterator it = needed.begin(); it != needed.end(); it++)
+    cacheTile(tiles, *it, true);
+  for(std::vector<wms_tile_t>::const_iterator it = needed2.begin(); it != needed2.end(); it++)
+    cacheTile(tiles, *it, true);
+
+  canvas_holder canvas;
+  const lpos_t offset(17, -23);
+  canvas->move_background(offset.x, offset.y);
+
+  assert(tiles.show(*canvas, pbounds, degPerPixel));
+  assert_cmpnum(tiles.pending(), 0);
+  assert(tiles.isShown(needed.front()));
+  lpos_t bgpos = canvas->background_position();
+  assert_cmpnum(bgpos.x, offset.x);
+  assert_cmpnum(bgpos.y, offset.y);
+
+  // a different zoom level replaces all tiles
+  assert(tiles.show(*canvas, pbounds, degPerPixel * 4));
+  assert_cmpnum(tiles.pending(), 0);
+  assert(tiles.isShown(needed2.front()));
+  assert(!tiles.isShown(needed.front()));
+  bgpos = canvas->background_position();
+  assert_cmpnum(bgpos.x, offset.x);
+  assert_cmpnum(bgpos.y, offset.y);
+
+  std::vector<wms_tile_t> cached = needed;
+  cached.insert(cached.end(), needed2.begin(), needed2.end());
+  removeCache(tiles, cached);
+}
+
+/**
+ * @brief broken tiles are removed and not requested again immediately
+ */
+void testBroken(const std::string &tmpdir)
+{
+  project_t project("wms_test", tmpdir);
+  setupProject(project);
+
+  const std::string cachebase = tmpdir + "/cache/";
+  wms_tiles_t tiles(project, cachebase);
+
+  // the lowest zoom level, so the empty file is the only one needed
+  const double degPerPixel = 1;
+  const std::vector<wms_tile_t> needed = tiles.tiles(pbounds, degPerPixel);
+  assert_cmpnum(needed.size(), 1);
+  cacheTile(tiles, needed.front(), false);
+
+  canvas_holder canvas;
+  assert(!tiles.show(*canvas, pbounds, degPerPixel));
+  assert(!tiles.isShown(needed.front()));
+  assert(!std::filesystem::is_regular_file(tiles.tileFile(needed.front())));
+  // the tile is blocked for now, so no download is started
+  assert_cmpnum(tiles.pending(), 0);
+
+  removeCache(tiles, needed);
+}
+
+void testBackoff()
+{
+  wms_tile_backoff backoff;
+  const wms_tile_t tile(10, 1, 2);
+  const wms_tile_t other(10, 2, 1);
+  const time_t now = 1000000;
+
+  assert(!backoff.blocked(tile, now));
+
+  backoff.failed(tile, now);
+  assert(backoff.blocked(tile, now));
+  assert(backoff.blocked(tile, now + wms_tile_backoff::FirstDelay - 1));
+  assert(!backoff.blocked(tile, now + wms_tile_backoff::FirstDelay));
+  assert(!backoff.blocked(other, now));
+
+  // the delay doubles with every failure
+  backoff.failed(tile, now);
+  assert(backoff.blocked(tile, now + 2 * wms_tile_backoff::FirstDelay - 1));
+  assert(!backoff.blocked(tile, now + 2 * wms_tile_backoff::FirstDelay));
+
+  // but is limited
+  for(int i = 0; i < 20; i++)
+    backoff.failed(tile, now);
+  assert(backoff.blocked(tile, now + wms_tile_backoff::MaxDelay - 1));
+  assert(!backoff.blocked(tile, now + wms_tile_backoff::MaxDelay));
+
+  backoff.succeeded(tile);
+  assert(!backoff.blocked(tile, now));
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  OSM2GO_TEST_INIT(argc, argv);
+
+  char tmpdir[] = "/tmp/osm2go-wms-tiles-XXXXXX";
+
+  if(mkdtemp(tmpdir) == nullptr) {
+    std::cerr << "cannot create temporary directory" << std::endl;
+    return 1;
+  }
+
+  testTileMath();
+  testUrl();
+  testCache(tmpdir);
+  testOffset(tmpdir);
+  testBroken(tmpdir);
+  testBackoff();
+
+  assert_cmpnum(rmdir(tmpdir), 0);
+
+  return 0;
+}
+
+#include "dummy_appdata.h"